@@ -0,0 +1,117 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#ifndef PRODDL_COMMON_PARALLEL_H__
+#define PRODDL_COMMON_PARALLEL_H__
+
+// Minimal shared-memory parallel helpers on top of std::thread.
+// The work is always split statically, so that for a given number of
+// threads every worker gets the same slice of the input from run to run.
+// Callers rely on that to keep floating point reductions reproducible.
+
+#include <thread>
+
+#include <vector>
+
+#include <exception>
+
+#include <algorithm>
+
+namespace PRODDL { namespace Parallel {
+
+
+  // Resolve the requested number of threads: values <= 0 mean
+  // "use all hardware threads".
+
+  inline int resolveThreads(int nThreads) {
+    if( nThreads <= 0 ) {
+      unsigned nHw = std::thread::hardware_concurrency();
+      nThreads = nHw > 0 ? int(nHw) : 1;
+    }
+    return nThreads;
+  }
+
+  // Static partition of [0,n) into nParts contiguous ranges.
+  // Range 'iPart' is returned as [begin,end).
+
+  inline void blockRange(int n, int nParts, int iPart, int& begin, int& end) {
+    int chunk = n / nParts;
+    int rem = n % nParts;
+    begin = iPart * chunk + std::min(iPart,rem);
+    end = begin + chunk + (iPart < rem ? 1 : 0);
+  }
+
+  // Call f(iThread) for iThread in [0,nThreads). Thread 0 is the calling
+  // thread. An exception thrown by any worker is rethrown here after all
+  // workers are joined (the one from the lowest thread index wins).
+
+  template<class F>
+  void runThreads(int nThreads, F f) {
+
+    if( nThreads <= 1 ) {
+      f(0);
+      return;
+    }
+
+    std::vector<std::exception_ptr> errors(nThreads);
+
+    std::vector<std::thread> threads;
+
+    threads.reserve(nThreads-1);
+
+    for(int i_thr = 1; i_thr < nThreads; i_thr++) {
+      threads.push_back(std::thread([&f,&errors,i_thr]() {
+	    try {
+	      f(i_thr);
+	    }
+	    catch(...) {
+	      errors[i_thr] = std::current_exception();
+	    }
+	  }));
+    }
+
+    try {
+      f(0);
+    }
+    catch(...) {
+      errors[0] = std::current_exception();
+    }
+
+    for(size_t i_thr = 0; i_thr < threads.size(); i_thr++) {
+      threads[i_thr].join();
+    }
+
+    for(int i_thr = 0; i_thr < nThreads; i_thr++) {
+      if( errors[i_thr] ) {
+	std::rethrow_exception(errors[i_thr]);
+      }
+    }
+
+  }
+
+  // Split [0,n) statically into nThreads ranges and call f(iThread,begin,end)
+  // for each non-empty one.
+
+  template<class F>
+  void forRanges(int nThreads, int n, F f) {
+
+    nThreads = std::max(1,std::min(nThreads,n));
+
+    runThreads(nThreads,[&f,n,nThreads](int i_thr) {
+	int begin, end;
+	blockRange(n,nThreads,i_thr,begin,end);
+	if( begin < end ) {
+	  f(i_thr,begin,end);
+	}
+      });
+
+  }
+
+} } // namespace PRODDL::Parallel
+
+#endif // PRODDL_COMMON_PARALLEL_H__
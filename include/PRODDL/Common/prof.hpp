@@ -0,0 +1,241 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#ifndef PRODDL_COMMON_PROF_H__
+#define PRODDL_COMMON_PROF_H__
+
+// Phase timers and event counters of the docking pipeline.
+//
+// Each thread accumulates into its own Stats object, so timing a phase costs
+// two clock reads and two additions, without any locking. The per-thread
+// objects are owned by the Registry and outlive their threads; total() sums
+// them, and must be called when no other thread is updating them
+// (e.g. after Parallel::runThreads() returns).
+//
+// Usage:
+//   { Prof::ScopedTimer t(Prof::PH_R2C); plan.execute(); }
+//   Prof::count(Prof::CNT_BYTES_WRITTEN,size);
+
+#include <chrono>
+
+#include <list>
+
+#include <mutex>
+
+namespace PRODDL { namespace Prof {
+
+
+  enum Phase {
+    PH_PROJECT,       // projection of molecules onto the grids
+    PH_R2C,           // forward FFTs
+    PH_MULTIPLY,      // multiplication of spectra
+    PH_C2R,           // inverse FFTs
+    PH_COLLECT_TOTAL, // sum of the correlation grids into the total one
+    PH_SELECT,        // selection of the best translations from the total grid
+    PH_CLUSTER,       // clustering of translations
+    PH_SYMMETRY,      // filter of symmetric multimers
+    PH_IO,            // reading and writing of scan results
+    PH_POSE_CLUSTER,  // clustering of the final poses by ligand RMSD
+    PH_RESTRAINTS,    // drawing of the restraint masks over the translations
+    N_PHASES
+  };
+
+  enum Counter {
+    CNT_ROTATIONS,       // scanned rotations
+    CNT_CANDIDATES,      // translations selected from the FFT grids
+    CNT_RESULTS_PUSHED,  // candidates accepted into the final results queue
+    CNT_QUEUE_EVICTIONS, // results pushed out of the full final queue
+    CNT_RESTRAINED,      // translations rejected by the restraints before the selection
+    CNT_SLABS,           // slabs correlated in the low memory mode (FFTSlabCorrelators)
+    CNT_BYTES_WRITTEN,
+    CNT_BYTES_READ,
+    N_COUNTERS
+  };
+
+  inline const char* phaseName(int phase) {
+    static const char* names[N_PHASES] = {
+      "project", "r2c", "multiply", "c2r", "collectTotal",
+      "select", "cluster", "symmetry", "io", "poseCluster",
+      "restraints"
+    };
+    return names[phase];
+  }
+
+  inline const char* counterName(int counter) {
+    static const char* names[N_COUNTERS] = {
+      "rotations", "candidates", "resultsPushed", "queueEvictions", "restrained",
+      "slabs", "bytesWritten", "bytesRead"
+    };
+    return names[counter];
+  }
+
+
+  struct Stats {
+
+    // time (s) and number of entries for each phase
+    double seconds[N_PHASES];
+    long long calls[N_PHASES];
+
+    long long counts[N_COUNTERS];
+
+    // wall time of the task(s), and the number of tasks merged into this object
+    double wallSeconds;
+    int nTasks;
+
+    Stats() {
+      clear();
+    }
+
+    void clear() {
+      for(int i = 0; i < N_PHASES; i++) {
+	seconds[i] = 0;
+	calls[i] = 0;
+      }
+      for(int i = 0; i < N_COUNTERS; i++) {
+	counts[i] = 0;
+      }
+      wallSeconds = 0;
+      nTasks = 0;
+    }
+
+    // Add up all fields. Merged wallSeconds is the total time of all tasks.
+
+    void merge(const Stats& x) {
+      for(int i = 0; i < N_PHASES; i++) {
+	seconds[i] += x.seconds[i];
+	calls[i] += x.calls[i];
+      }
+      for(int i = 0; i < N_COUNTERS; i++) {
+	counts[i] += x.counts[i];
+      }
+      wallSeconds += x.wallSeconds;
+      nTasks += x.nTasks;
+    }
+
+  }; // struct Stats
+
+
+  class Registry {
+
+  public:
+
+    static Registry& instance() {
+      static Registry registry;
+      return registry;
+    }
+
+    // New zeroed Stats object for the calling thread
+
+    Stats& add() {
+      std::lock_guard<std::mutex> lock(mutex);
+      perThread.push_back(Stats());
+      return perThread.back();
+    }
+
+    Stats total() {
+      std::lock_guard<std::mutex> lock(mutex);
+      Stats x;
+      for(std::list<Stats>::const_iterator p = perThread.begin(); p != perThread.end(); ++p) {
+	x.merge(*p);
+      }
+      return x;
+    }
+
+    void clear() {
+      std::lock_guard<std::mutex> lock(mutex);
+      for(std::list<Stats>::iterator p = perThread.begin(); p != perThread.end(); ++p) {
+	p->clear();
+      }
+    }
+
+  protected:
+
+    std::mutex mutex;
+
+    // std::list keeps the objects in place as threads are added
+    std::list<Stats> perThread;
+
+  }; // class Registry
+
+
+  // Stats of the calling thread
+
+  inline Stats& local() {
+    thread_local Stats *p = 0;
+    if( ! p ) {
+      p = &Registry::instance().add();
+    }
+    return *p;
+  }
+
+  inline void count(Counter counter, long long n = 1) {
+    local().counts[counter] += n;
+  }
+
+  inline Stats total() {
+    return Registry::instance().total();
+  }
+
+
+  class ScopedTimer {
+
+  public:
+
+    typedef std::chrono::steady_clock Clock;
+
+    explicit ScopedTimer(Phase _phase):
+      phase(_phase),
+      start(Clock::now())
+    {}
+
+    ~ScopedTimer() {
+      Stats& s = local();
+      s.seconds[phase] += std::chrono::duration<double>(Clock::now() - start).count();
+      s.calls[phase]++;
+    }
+
+  protected:
+
+    Phase phase;
+
+    Clock::time_point start;
+
+  }; // class ScopedTimer
+
+
+  // Wall time of a task, from construction to the call of stop()
+
+  class TaskTimer {
+
+  public:
+
+    typedef std::chrono::steady_clock Clock;
+
+    TaskTimer():
+      start(Clock::now())
+    {}
+
+    // Totals of all threads, with the wall time of this task
+
+    Stats stop() const {
+      Stats s = total();
+      s.wallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+      s.nTasks = 1;
+      return s;
+    }
+
+  protected:
+
+    Clock::time_point start;
+
+  }; // class TaskTimer
+
+
+}} // namespace PRODDL::Prof
+
+#endif // PRODDL_COMMON_PROF_H__
@@ -0,0 +1,37 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#ifndef PRODDL_PROF_IO_JSON_H__
+#define PRODDL_PROF_IO_JSON_H__
+
+/*
+*
+Methods to save Prof::Stats as a JSON summary and to load it back.
+Besides the raw fields, the summary has derived values (seconds per
+call of each phase, rotations per second of task time), which are
+ignored when loading.
+*
+*/
+
+#include "PRODDL/Common/prof.hpp"
+
+#include <string>
+
+namespace PRODDL {
+
+	void save_prof_stats_to_json_file(const Prof::Stats& stats,std::string out_file);
+
+	void load_prof_stats_from_json_file(std::string inp_file,Prof::Stats& stats);
+
+	// Write a one-line per phase/counter text summary into the log
+
+	void log_prof_stats(const Prof::Stats& stats);
+
+} // namespace PRODDL
+
+#endif // PRODDL_PROF_IO_JSON_H__
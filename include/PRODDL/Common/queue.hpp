@@ -218,12 +218,15 @@ namespace PRODDL {
       return size_limit;
     }
 
-    void 
+    // Returns true if 'x' was inserted (possibly pushing out
+    // the current top element of the full queue)
+
+    bool
     push(const value_type& x) 
     {
 
       if(! limit_comp(x,max_val_limit))
-	return;
+	return false;
 
       dbg::assertion(dbg::error, DBG_ASSERTION( is_valid ));
 
@@ -235,7 +238,7 @@ namespace PRODDL {
 	if( size_limit > 0 && comp(x,top()) )
 	  pop();
 	else
-	  return;
+	  return false;
       }
 
       try 
@@ -248,6 +251,8 @@ namespace PRODDL {
 	  c.clear();
 	  throw; 
 	}
+
+      return true;
     }
 
     // This function is defined so that back_inserter(...) would work
@@ -95,6 +95,16 @@ namespace PRODDL { namespace Geom {
 					return Translation<T_num>(Point( - (diam(1) + diam(0))/2) );
 			}
 
+			// Move this object by applying coordinate transformation. The result
+			// is the diameter of the transformed point set, so it does not have
+			// to be recomputed after moving the points rigidly.
+
+			void applyTransformation(const RotationTranslation<T_num>& transform) {
+				ATLOG_TRACE_3;
+				diam(0) = transform(diam(0));
+				diam(1) = transform(diam(1));
+			}
+
 		};
 
 
@@ -0,0 +1,329 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#ifndef PRODDL_GEOM_BOUNDING_CACHE_H__
+#define PRODDL_GEOM_BOUNDING_CACHE_H__
+
+// Geometry descriptors of point sets (molecules), computed once and shared.
+//
+// The same receptor and ligand coordinates are passed to Bounding::Diameter
+// and Bounding::Box many times: by MolStruct, by the FFT box size classes
+// and by the constructor of every rigid refinement object. The approximate
+// diameter and especially the minimum volume bounding box are expensive.
+// DescriptorCache returns a Descriptor for the given coordinates, keyed by a
+// hash of the coordinate values (not by the address of the array, because
+// the arrays are copied and moved around freely). The coordinates are
+// compared in full on a hash match.
+//
+// Cheap properties (axis aligned bounds, centroid, principal axes) are
+// computed when the descriptor is created; the diameter and the minimum
+// volume box are computed on the first request. Any number of threads can
+// ask for the same descriptor: each property is computed by one of them
+// while the others wait for it.
+
+#include "PRODDL/Geom/bounding.hpp"
+
+#include "PRODDL/External/nr/nr_arr.hpp"
+#include "PRODDL/External/nr/nr.hpp"
+
+#include "PRODDL/Common/parallel.hpp"
+
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+
+#include <map>
+#include <mutex>
+#include <utility>
+#include <cstring>
+#include <cmath>
+
+namespace PRODDL { namespace Geom {
+
+	namespace Bounding {
+
+		template<typename T_num>
+		class Descriptor : boost::noncopyable {
+
+		public:
+
+			typedef typename SpaceTraits<T_num>::Point3 Point;
+			typedef typename SpaceTraits<T_num>::Point3Pair PointPair;
+			typedef typename SpaceTraits<T_num>::Matrix3x3 Matrix3;
+			typedef typename SpaceTraits<T_num>::VPoint3 VPoint;
+
+			typedef boost::shared_ptr<Descriptor> Ptr;
+
+		public:
+
+			explicit Descriptor(const VPoint& _points):
+			points(_points.copy())
+			{
+				ATALWAYS(points.size() > 0,"Bounding::Descriptor: empty point set");
+				bounds = Box<T_num>(points,true).getDiagonal();
+				computePrincipalAxes();
+			}
+
+			int size() const {
+				return points.size();
+			}
+
+			// Copy of the coordinates this descriptor was computed for
+
+			const VPoint& getPoints() const {
+				return points;
+			}
+
+			// Lower and upper corners of the box along the coordinate axes
+
+			const PointPair& getBounds() const {
+				return bounds;
+			}
+
+			const Point& getCentroid() const {
+				return centroid;
+			}
+
+			// Principal axes (unit vectors) in rows, largest variance first,
+			// same layout as Box::getDirections()
+
+			const Matrix3& getPrincipalAxes() const {
+				return axes;
+			}
+
+			// Variance of the points along each of the principal axes
+
+			const Point& getPrincipalMoments() const {
+				return moments;
+			}
+
+			// Bounding::Diameter(points)
+
+			const Diameter<T_num>& getDiameter() const {
+				std::call_once(diamOnce,[this]() {
+						diam = Diameter<T_num>(points);
+					});
+				return diam;
+			}
+
+			// Bounding::Box(points) with the default minimum volume search parameters
+
+			const Box<T_num>& getBox() const {
+				std::call_once(boxOnce,[this]() {
+						box = Box<T_num>(points);
+					});
+				return box;
+			}
+
+			// Compute the diameter and the box in parallel, if they are not
+			// computed yet
+
+			void computeAll(int nThreads = 2) const {
+				Parallel::runThreads(std::min(Parallel::resolveThreads(nThreads),2),[this](int i_thr) {
+						if( i_thr == 0 ) {
+							getDiameter();
+						}
+						else {
+							getBox();
+						}
+					});
+				// no-op if the second thread did it
+				getBox();
+			}
+
+			// True if 'other' has the same coordinates as this descriptor
+
+			bool matches(const VPoint& other) const {
+				if( other.size() != points.size() ) {
+					return false;
+				}
+				for(int i = 0; i < points.size(); i++) {
+					const Point& x = other(other.lbound(0) + i);
+					const Point& y = points(points.lbound(0) + i);
+					if( x(0) != y(0) || x(1) != y(1) || x(2) != y(2) ) {
+						return false;
+					}
+				}
+				return true;
+			}
+
+			// FNV-1a hash of the coordinate values
+
+			static uint64_t hash(const VPoint& p) {
+				uint64_t h = 14695981039346656037ULL;
+				for(int i = p.lbound(0); i <= p.ubound(0); i++) {
+					for(int j = 0; j < 3; j++) {
+						T_num x = p(i)(j);
+						unsigned char bytes[sizeof(T_num)];
+						std::memcpy(bytes,&x,sizeof(T_num));
+						for(size_t k = 0; k < sizeof(T_num); k++) {
+							h = (h ^ bytes[k]) * 1099511628211ULL;
+						}
+					}
+				}
+				return h;
+			}
+
+		protected:
+
+			void computePrincipalAxes() {
+
+				typedef typename SpaceTraits<double>::Matrix3x3 Matrix3D;
+				typedef typename SpaceTraits<double>::Point3 PointD;
+
+				int n = points.size();
+
+				PointD cm(0.);
+
+				for(int i = 0; i < n; i++) {
+					for(int j = 0; j < 3; j++) {
+						cm(j) += points(i)(j);
+					}
+				}
+
+				cm /= n;
+
+				Matrix3D cov;
+
+				for(int j = 0; j < 3; j++) {
+					for(int k = 0; k < 3; k++) {
+						double s = 0;
+						for(int i = 0; i < n; i++) {
+							s += (points(i)(j) - cm(j))*(points(i)(k) - cm(k));
+						}
+						cov(j,k) = s/n;
+					}
+				}
+
+				// eigenvectors in columns of 'vec', largest eigenvalue first
+
+				Matrix3D vec;
+				PointD eigenVal;
+				int nrot;
+				nr::MatrixAdaptor<double> cov_nrc(cov.dataFirst(),1,3,1,3), vec_nrc(vec.dataFirst(),1,3,1,3);
+				nr::jacobi(cov_nrc.rowPointers(),3,eigenVal.dataFirst()-1,vec_nrc.rowPointers(),&nrot);
+				nr::eigsrt(eigenVal.dataFirst()-1,vec_nrc.rowPointers(),3,false);
+
+				for(int j = 0; j < 3; j++) {
+					centroid(j) = T_num(cm(j));
+				}
+
+				for(int k = 0; k < 3; k++) {
+					moments(k) = T_num(std::max(eigenVal(k),0.));
+					for(int j = 0; j < 3; j++) {
+						axes(k,j) = T_num(vec(j,k));
+					}
+				}
+
+			}
+
+		protected:
+
+			VPoint points;
+
+			PointPair bounds;
+
+			Point centroid;
+
+			Matrix3 axes;
+
+			Point moments;
+
+			mutable std::once_flag diamOnce;
+
+			mutable Diameter<T_num> diam;
+
+			mutable std::once_flag boxOnce;
+
+			mutable Box<T_num> box;
+
+		};
+
+
+		// Process-wide cache of descriptors. It holds at most 'maxEntries'
+		// point sets; when it is full, the whole cache is dropped (descriptors
+		// still referenced by the callers stay valid).
+
+		template<typename T_num>
+		class DescriptorCache {
+
+		public:
+
+			typedef Descriptor<T_num> DescriptorT;
+			typedef typename DescriptorT::Ptr Ptr;
+			typedef typename DescriptorT::VPoint VPoint;
+
+			enum { maxEntries = 64 };
+
+		public:
+
+			// Descriptor of 'points', created on the first call for these coordinates
+
+			static Ptr get(const VPoint& points) {
+				std::pair<int,uint64_t> key(points.size(),DescriptorT::hash(points));
+				State& s = state();
+				std::lock_guard<std::mutex> lock(s.mtx);
+				typename Entries::iterator it = s.entries.find(key);
+				if( it != s.entries.end() && it->second->matches(points) ) {
+					s.nHits++;
+					return it->second;
+				}
+				if( it == s.entries.end() && int(s.entries.size()) >= maxEntries ) {
+					ATLOG_OUT_3("Bounding::DescriptorCache is full, dropping all entries");
+					s.entries.clear();
+				}
+				// new point set, or a hash collision which replaces the old entry
+				Ptr p(new DescriptorT(points));
+				s.entries[key] = p;
+				return p;
+			}
+
+			static void clear() {
+				State& s = state();
+				std::lock_guard<std::mutex> lock(s.mtx);
+				s.entries.clear();
+			}
+
+			static int size() {
+				State& s = state();
+				std::lock_guard<std::mutex> lock(s.mtx);
+				return s.entries.size();
+			}
+
+			// Number of calls to get() that found an existing descriptor
+
+			static long numHits() {
+				State& s = state();
+				std::lock_guard<std::mutex> lock(s.mtx);
+				return s.nHits;
+			}
+
+		protected:
+
+			typedef std::map<std::pair<int,uint64_t>,Ptr> Entries;
+
+			struct State {
+				std::mutex mtx;
+				Entries entries;
+				long nHits;
+				State(): nHits(0) {}
+			};
+
+			static State& state() {
+				static State s;
+				return s;
+			}
+
+		};
+
+	} //namespace Bounding
+
+}} // namespace PRODDL::Geom
+
+#endif // PRODDL_GEOM_BOUNDING_CACHE_H__
@@ -0,0 +1,337 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#ifndef PRODDL_GEOM_INTERFACE_CONTACTS_H__
+#define PRODDL_GEOM_INTERFACE_CONTACTS_H__
+
+#include "PRODDL/types.hpp"
+#include "PRODDL/Geom/partpoints_compact.hpp"
+#include "PRODDL/Common/parallel.hpp"
+#include "PRODDL/Common/debug.hpp"
+
+#include <stdint.h>
+
+#include <vector>
+#include <algorithm>
+
+// Group (residue) contacts between the receptor and many rigid body poses
+// of the ligand.
+//
+// Neighbors::contactGroupPairs() (pairdist.hpp) builds a new cell list for
+// every call. Here, the receptor atoms are put into a PartitionedPointsCompact
+// once, and only the ligand is transformed for each pose. As in
+// contactGroupPairs(), two groups are in contact if they have at least
+// 'minContacts' atom pairs within the cutoff distance.
+//
+// The result for a batch of poses is kept in flat arrays: the contact pairs
+// of all poses in CSR layout, and the interface groups of each pose as
+// bitsets. Poses are split statically between threads, and the result does
+// not depend on the number of threads.
+
+namespace PRODDL {
+
+  template<typename T_num>
+  class InterfaceContacts {
+
+  public:
+
+    typedef Types<T_num> TypesT;
+    typedef typename TypesT::Point Point;
+    typedef typename TypesT::Points Points;
+    typedef typename TypesT::Ints Ints;
+    typedef typename TypesT::RotationTranslation RotationTranslation;
+    typedef typename TypesT::RotTranValue RotTranValue;
+
+    // receptor atoms keep the index of their group as the point data
+    typedef Geom::Points::PartitionedPointsCompact<T_num,int,3> PartPoints;
+
+    typedef uint64_t Word;
+
+    enum { wordBits = 64 };
+
+    // Contacts for a batch of poses
+
+    struct Result {
+
+      // contact pairs of pose 'i' are [offsets[i],offsets[i+1]) in
+      // 'recGroup' and 'ligGroup', sorted by the receptor group first
+      std::vector<int> offsets;
+      std::vector<int> recGroup;
+      std::vector<int> ligGroup;
+
+      // receptor groups in contact in pose 'i' are set in the words
+      // [i*nRecWords,(i+1)*nRecWords) of 'recMask', same for the ligand
+      int nRecWords;
+      int nLigWords;
+      std::vector<Word> recMask;
+      std::vector<Word> ligMask;
+
+      Result(): offsets(1,0), nRecWords(0), nLigWords(0) {}
+
+      int numPoses() const {
+	return int(offsets.size()) - 1;
+      }
+
+      int numContacts(int i_pose) const {
+	return offsets[i_pose+1] - offsets[i_pose];
+      }
+
+      bool isRecInterface(int i_pose, int i_group) const {
+	return testBit(recMask,nRecWords,i_pose,i_group);
+      }
+
+      bool isLigInterface(int i_pose, int i_group) const {
+	return testBit(ligMask,nLigWords,i_pose,i_group);
+      }
+
+    };
+
+  public:
+
+    // 'recGroup' and 'ligGroup' - group index (>= 0) of each atom, such as
+    // the sequential residue number
+
+    InterfaceContacts(const Points& rec, const Ints& recGroup,
+		      const Points& lig, const Ints& ligGroup,
+		      T_num cutoff, int minContacts = 1):
+      m_lig(lig.copy()),
+      m_ligGroup(ligGroup.copy()),
+      m_cutoff(cutoff),
+      m_minContacts(std::max(minContacts,1))
+    {
+
+      ATALWAYS(rec.size() > 0 && lig.size() > 0,"InterfaceContacts: empty receptor or ligand");
+
+      ATALWAYS(rec.size() == recGroup.size() && lig.size() == ligGroup.size(),
+	       "InterfaceContacts: the number of group indices must match the number of atoms");
+
+      ATALWAYS(cutoff > 0,"InterfaceContacts: the cutoff must be positive");
+
+      ATALWAYS(blitz::min(recGroup) >= 0 && blitz::min(ligGroup) >= 0,
+	       "InterfaceContacts: negative group index");
+
+      m_nRecGroups = blitz::max(recGroup) + 1;
+      m_nLigGroups = blitz::max(ligGroup) + 1;
+
+      m_lBound = rec(0);
+      m_uBound = rec(0);
+
+      for(int i = 0; i < rec.size(); i++) {
+	for(int d = 0; d < 3; d++) {
+	  m_lBound(d) = std::min(m_lBound(d),rec(i)(d));
+	  m_uBound(d) = std::max(m_uBound(d),rec(i)(d));
+	}
+      }
+
+      m_parts.init(m_lBound,m_uBound,cutoff);
+
+      m_parts.reserve(rec.size());
+
+      for(int i = 0; i < rec.size(); i++) {
+	m_parts.insert(rec(i),recGroup(i));
+      }
+
+      m_parts.build();
+
+      // ligand atoms outside of this box have no receptor atoms within the cutoff
+
+      m_lBound -= cutoff;
+      m_uBound += cutoff;
+
+    }
+
+    int numRecGroups() const {
+      return m_nRecGroups;
+    }
+
+    int numLigGroups() const {
+      return m_nLigGroups;
+    }
+
+    T_num getCutoff() const {
+      return m_cutoff;
+    }
+
+    int getMinContacts() const {
+      return m_minContacts;
+    }
+
+    // Compute contacts for poses [first,first+nPoses). The iterator must be
+    // random access, with RotationTranslation or RotTranValue (as returned
+    // by IORigid::getCoords()) as the value type.
+    // nThreads <= 0 means all hardware threads.
+
+    template<class InpIter>
+    void compute(InpIter first, int nPoses, Result& res, int nThreads = 1) const {
+
+      res.nRecWords = numWords(m_nRecGroups);
+      res.nLigWords = numWords(m_nLigGroups);
+      res.offsets.assign(nPoses+1,0);
+      res.recGroup.clear();
+      res.ligGroup.clear();
+      res.recMask.assign(size_t(nPoses)*res.nRecWords,0);
+      res.ligMask.assign(size_t(nPoses)*res.nLigWords,0);
+
+      if( nPoses <= 0 ) {
+	return;
+      }
+
+      nThreads = std::max(1,std::min(Parallel::resolveThreads(nThreads),nPoses));
+
+      // contact pairs found by each thread, in the order of poses
+      std::vector<std::vector<int> > thrPairs(nThreads);
+
+      Parallel::forRanges(nThreads,nPoses,[&](int i_thr, int begin, int end) {
+
+	  Points ligPos;
+	  std::vector<long long> keys;
+	  std::vector<int>& pairs = thrPairs[i_thr];
+
+	  for(int i_pose = begin; i_pose < end; i_pose++) {
+
+	    poseTran(first[i_pose])(m_lig,ligPos);
+
+	    keys.clear();
+	    findAtomContacts(ligPos,keys);
+	    std::sort(keys.begin(),keys.end());
+
+	    // each run of equal keys is one pair of groups
+
+	    int nPairs = 0;
+
+	    for(size_t i = 0; i < keys.size(); ) {
+	      size_t j = i + 1;
+	      while( j < keys.size() && keys[j] == keys[i] ) {
+		j++;
+	      }
+	      if( int(j - i) >= m_minContacts ) {
+		int i_rec = int(keys[i] / m_nLigGroups);
+		int i_lig = int(keys[i] % m_nLigGroups);
+		pairs.push_back(i_rec);
+		pairs.push_back(i_lig);
+		setBit(res.recMask,res.nRecWords,i_pose,i_rec);
+		setBit(res.ligMask,res.nLigWords,i_pose,i_lig);
+		nPairs++;
+	      }
+	      i = j;
+	    }
+
+	    res.offsets[i_pose+1] = nPairs;
+
+	  }
+
+	});
+
+      for(int i_pose = 0; i_pose < nPoses; i_pose++) {
+	res.offsets[i_pose+1] += res.offsets[i_pose];
+      }
+
+      res.recGroup.resize(res.offsets[nPoses]);
+      res.ligGroup.resize(res.offsets[nPoses]);
+
+      int k = 0;
+
+      for(int i_thr = 0; i_thr < nThreads; i_thr++) {
+	const std::vector<int>& pairs = thrPairs[i_thr];
+	for(size_t i = 0; i < pairs.size(); i += 2, k++) {
+	  res.recGroup[k] = pairs[i];
+	  res.ligGroup[k] = pairs[i+1];
+	}
+      }
+
+    }
+
+    static int numWords(int nBits) {
+      return (nBits + wordBits - 1) / wordBits;
+    }
+
+  protected:
+
+    // Append receptor*numLigGroups()+ligand group key for every atom pair
+    // within the cutoff
+
+    void findAtomContacts(const Points& ligPos, std::vector<long long>& keys) const {
+
+      T_num cutoff2 = m_parts.getCutoffP2();
+
+      typename PartPoints::CellIndex cellInd;
+
+      for(int i = 0; i < ligPos.size(); i++) {
+
+	const Point& p = ligPos(i);
+
+	if( ! inBox(p) ) {
+	  continue;
+	}
+
+	long long i_lig = m_ligGroup(i);
+
+	m_parts.getCellIndex(p,cellInd);
+
+	for(typename PartPoints::SubDomainIter iterNeighb = cellInd.getNeighbors();
+	    iterNeighb.not_end();
+	    iterNeighb.next()) {
+	  if( m_parts.r2(iterNeighb.pos(),p) <= cutoff2 ) {
+	    keys.push_back((long long)(*iterNeighb) * m_nLigGroups + i_lig);
+	  }
+	}
+
+      }
+
+    }
+
+    bool inBox(const Point& p) const {
+      for(int d = 0; d < 3; d++) {
+	if( p(d) < m_lBound(d) || p(d) > m_uBound(d) ) {
+	  return false;
+	}
+      }
+      return true;
+    }
+
+    static const RotationTranslation& poseTran(const RotationTranslation& x) {
+      return x;
+    }
+
+    static const RotationTranslation& poseTran(const RotTranValue& x) {
+      return x.tran;
+    }
+
+    static void setBit(std::vector<Word>& mask, int nWords, int i_pose, int i_bit) {
+      mask[size_t(i_pose)*nWords + i_bit/wordBits] |= Word(1) << (i_bit % wordBits);
+    }
+
+    static bool testBit(const std::vector<Word>& mask, int nWords, int i_pose, int i_bit) {
+      return (mask[size_t(i_pose)*nWords + i_bit/wordBits] >> (i_bit % wordBits)) & 1;
+    }
+
+  protected:
+
+    PartPoints m_parts;
+
+    Points m_lig;
+
+    Ints m_ligGroup;
+
+    int m_nRecGroups;
+
+    int m_nLigGroups;
+
+    T_num m_cutoff;
+
+    int m_minContacts;
+
+    // receptor bounding box extended by the cutoff
+    Point m_lBound, m_uBound;
+
+  }; // class InterfaceContacts
+
+
+} // namespace PRODDL
+
+#endif // PRODDL_GEOM_INTERFACE_CONTACTS_H__
@@ -627,14 +627,7 @@ c     rotate and translate reference coordinates into global frame
 c
 	*/
 
-	for(int k=0;k<xyz.size();k++) {
-	  T_num xterm = xyzrb(k)(0);
-	  T_num yterm = xyzrb(k)(1);
-	  T_num zterm = xyzrb(k)(2);
-	  xyz(k)(0) = a(0,0)*xterm + a(1,0)*yterm + a(2,0)*zterm + xyzcm(0);
-	  xyz(k)(1) = a(0,1)*xterm + a(1,1)*yterm + a(2,1)*zterm + xyzcm(1);
-	  xyz(k)(2) = a(0,2)*xterm + a(1,2)*yterm + a(2,2)*zterm + xyzcm(2);
-	}
+	RigidKernel<T_num>(Math::transpose(a),xyzcm).apply(xyzrb,xyz);
     }
 
     static
@@ -13,6 +13,8 @@
 
 #include "PRODDL/Geom/partpoints.hpp"
 
+#include "PRODDL/Geom/partpoints_compact.hpp"
+
 #include <blitz/array.h>
 #include <blitz/tinyvec2.h>
 
@@ -255,6 +257,121 @@ namespace PRODDL { namespace Geom { namespace Points {
     };
 
 
+    // Same interface as PartitionedPoints2, but based on PartitionedPointsCompact,
+    // which keeps the inserted set in contiguous arrays sorted by cell.
+    // Stores only indices of inserted points, positions are kept by the
+    // base class in separate coordinate arrays.
+
+    class PartitionedPointsCompact2 : public PartitionedPointsCompact<T_num,int,n_dim> {
+
+    protected:
+
+      typedef PartitionedPointsCompact<T_num,int,n_dim> Base;
+
+      bool firstSetInserted;
+
+    public:
+
+      PartitionedPointsCompact2() : firstSetInserted(false) {}
+
+      PartitionedPointsCompact2(const typename Base::Point& lBoundS, 
+				const typename Base::Point& uBoundS, 
+				T_num cutoff) :
+	Base(lBoundS,uBoundS,cutoff), firstSetInserted(false) 
+	{}
+
+      void init(const typename Base::Point& lBoundS, 
+		const typename Base::Point& uBoundS, 
+		T_num cutoff) {
+	Base::init(lBoundS,uBoundS,cutoff);
+	firstSetInserted = false;      
+      }
+
+      // Insert initial set of points. Insert can be done only once after the object is
+      // intitialized or zapPoints() is called.
+
+      void insert(const Vvect& points) {
+
+	ATALWAYS( ! firstSetInserted, \
+		  "PartitionedPointsCompact2::insert() method can be called only once");
+
+	Base::reserve(points.size());
+
+	for( int i_point =0; i_point < points.size(); i_point++ ) {
+	  Base::insert(points(i_point),i_point);
+	}
+
+	Base::build();
+
+	firstSetInserted = true;
+
+      }
+
+      // Same as the first version of insert(), but also will return pairs
+      // of close points within the inserted set. Unlike PartitionedPoints2,
+      // pairs are found after all points are sorted, with the half-shell
+      // stencil, so the order of pairs differs. In each pair, the first index
+      // is always larger than the second one, as in PartitionedPoints2.
+
+      void insert(const Vvect& points,VIPair& indexPairs, fvect& distanceP2) {
+
+	insert(points);
+
+	indexPairs.clear();
+	distanceP2.clear();
+
+	T_num cutoff2 = Base::getCutoffP2();
+
+	for(typename Base::HalfShellIter iter(*this); iter.not_end(); iter.next()) {
+	  T_num r2 = iter.r2();
+	  if( r2 <= cutoff2 ) {
+	    int i1 = Base::data(iter.first()), i2 = Base::data(iter.second());
+	    indexPairs.push_back(i1 > i2 ? IPair(i1,i2) : IPair(i2,i1));
+	    distanceP2.push_back(r2);
+	  }
+	}
+
+      }
+
+      // Search for close pairs of points between the supplied set of points and already
+      // inserted points. New points are not inserted.
+
+      void search(const Vvect& points,VIPair& indexPairs, fvect& distanceP2) {
+
+	indexPairs.clear();
+	distanceP2.clear();
+
+	T_num cutoff2 = Base::getCutoffP2();
+
+	typename Base::CellIndex cellInd;
+
+	for( int i_point =0; i_point < points.size(); i_point++ ) {
+
+	  const vect& v_i = points(i_point);
+	  Base::getCellIndex(v_i,cellInd);
+	  for(typename Base::SubDomainIter iterNeighb = cellInd.getNeighbors(); 
+	      iterNeighb.not_end(); 
+	      iterNeighb.next()) {
+	    T_num r2 = Base::r2(iterNeighb.pos(),v_i);
+	    if( r2 <= cutoff2 ) 
+	      { 
+		indexPairs.push_back(IPair(i_point,*iterNeighb));
+		distanceP2.push_back(r2);
+	      }
+	  }
+
+	}
+
+      }
+
+      void zapPoints() {
+	Base::zapPoints();
+	firstSetInserted = false;
+      }
+
+    };
+
+
     // Take two sets of points vv1,vv2,
     // return in ind1,ind2 indices of points in each set
     // that have at least one point in other set closer than 'cutoff'.
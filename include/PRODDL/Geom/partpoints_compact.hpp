@@ -0,0 +1,655 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#ifndef AT_GEOM_PARTPOINTS_COMPACT_H__
+#define AT_GEOM_PARTPOINTS_COMPACT_H__
+
+// Compact alternative to PartitionedPoints (partpoints.hpp).
+//
+// PartitionedPoints keeps a separate std::vector for each grid cell. Here, all
+// points are stored in a few contiguous arrays sorted by cell: PointData objects
+// and point coordinates (one array per dimension). Cell 'c' owns the elements
+// [cellStart[c], cellStart[c+1]). Cells are numbered in Morton (Z-) order, so
+// that cells close in space are also close in memory.
+//
+// Because of that layout, points cannot be added to an already built structure
+// one at a time. The points are first collected with insert(), and then the
+// structure is built in O(N) by counting sort when build() is called. Points
+// inserted after that become visible after the next call to build().
+// Neighbor lookup has the same interface as in PartitionedPoints:
+//
+// PartPoints partPoints(lowerBound,upperBound,cutoff);
+// for(int i_point = 0; i_point < aPoints.size(); i_point++) {
+//   partPoints.insert(aPoints(i_point),i_point);
+// }
+// partPoints.build();
+// PartPoints::CellIndex cellInd = partPoints.getCellIndex(point);
+// for(PartPoints::SubDomainIter iterNeighb = cellInd.getNeighbors(); iterNeighb.not_end(); iterNeighb.next()) {
+//   int i_point_other = *iterNeighb;
+//   if( blitz_ext::dotSelf(point - iterNeighb.point()) < cutoffP2 ) {
+//   ...
+//   }
+// }
+//
+// To find pairs within one set of points, use HalfShellIter, which visits each
+// pair of points from the same or adjacent cells exactly once:
+//
+// for(PartPoints::HalfShellIter iter(partPoints); iter.not_end(); iter.next()) {
+//   if( iter.r2() < cutoffP2 ) {
+//     ... use partPoints.data(iter.first()) and partPoints.data(iter.second()) ...
+//   }
+// }
+
+#include <vector>
+#include <algorithm>
+
+#include <cmath>
+
+#include <blitz/tinyvec2.h>
+
+#include "PRODDL/Common/bz_vect_ext.hpp"
+
+#include "PRODDL/Common/nd_index_iter.hpp"
+
+#include "PRODDL/Common/logger.hpp"
+
+namespace PRODDL { namespace Geom { namespace Points {
+
+  // Template parameters have the same meaning as for PartitionedPoints.
+
+  template<typename _T_num,class _PointData,int _n_dim>
+  class PartitionedPointsCompact {
+
+  public:
+
+    enum { N_dim = _n_dim };
+    typedef _T_num T_num;
+    typedef _PointData PointData;
+
+    // N_dim points in space
+    typedef blitz::TinyVector<T_num,N_dim> Point;
+
+    // Logical (integer) cell coordinates
+    typedef blitz::TinyVector<int,N_dim> Index;
+
+    typedef PartitionedPointsCompact<T_num,PointData,N_dim> Self;
+
+
+    // Iterates over all points in a block of cells, same as
+    // PartitionedPoints::SubDomainIter. The iterator also provides
+    // position of the current point in the sorted storage, which
+    // can be used to read the coordinates from owner's arrays.
+
+    class SubDomainIter {
+
+    protected:
+      typedef ::PRODDL::index_mover<N_dim> ind_mover;
+
+    public:
+
+      typedef const PointData& reference;
+      typedef const PointData* pointer;
+
+      SubDomainIter():
+	pOwner(0), iCurr(0), iEnd(0)
+      {}
+
+      // create iterator object for cells' cube with side=2*radius+1 centered at indCenter cell
+
+      SubDomainIter(const Self& owner, const Index& indCenter,const int radius=1):
+	pOwner(&owner) {
+	init(indCenter,radius);
+      }
+
+      void init(const Index& indCenter,const int radius=1) {
+	for(int i = 0; i < N_dim; i++) {
+	  indLow(i) = std::max(indCenter(i) - radius,0);
+	  indUp(i) = std::min(indCenter(i) + radius,pOwner->m_nCells(i) - 1) + 1;
+	}
+	ind_mover::before_first(indCurr,indLow);
+	iCurr = iEnd = 0;
+      }
+
+      bool not_end() {
+	if( iCurr < iEnd ) {
+	  return true;
+	}
+	while( ind_mover::next(indCurr,indLow,indUp) ) {
+	  int cellId = pOwner->cellId(indCurr);
+	  iCurr = pOwner->m_cellStart[cellId];
+	  iEnd = pOwner->m_cellStart[cellId+1];
+	  if( iCurr < iEnd ) {
+	    return true;
+	  }
+	}
+	return false;
+      }
+
+      void next() {
+	++iCurr;
+      }
+
+      reference operator*() const {
+	return pOwner->m_data[iCurr];
+      }
+
+      pointer operator->() const {
+	return &pOwner->m_data[iCurr];
+      }
+
+      // position of the current element in owner's sorted storage
+
+      int pos() const {
+	return iCurr;
+      }
+
+      Point point() const {
+	return pOwner->point(iCurr);
+      }
+
+    protected:
+
+      const Self *pOwner;
+      Index indLow, indUp, indCurr;
+      int iCurr, iEnd;
+
+    }; // class SubDomainIter
+
+
+    // Cell to which a given point would belong
+
+    class CellIndex {
+
+    public:
+
+      CellIndex(): _pOwner(0), _cellId(0) {}
+
+      const Index& getIndex() const { return _ind_cell; }
+
+      // dense cell number in Morton order
+      int getCellId() const { return _cellId; }
+
+      // range of this cell's points in owner's sorted storage
+      int begin() const { return _pOwner->m_cellStart[_cellId]; }
+      int end() const { return _pOwner->m_cellStart[_cellId+1]; }
+
+      // all points that might be within cutoff distance
+      // from any point assigned to this cell
+
+      SubDomainIter getNeighbors() const {
+	return SubDomainIter(*_pOwner,_ind_cell);
+      }
+
+    public:
+
+      // implementation specific, should not be accessed by user code
+
+      const Self *_pOwner;
+      Index _ind_cell;
+      int _cellId;
+
+    }; // class CellIndex
+
+
+    // Iterates once over each unordered pair of points located in the same
+    // or in adjacent cells, using half of the neighbor cells' stencil
+    // (the cell itself and the neighbors with lexicographically positive offsets).
+    // first() and second() return positions in owner's sorted storage.
+
+    class HalfShellIter {
+
+    public:
+
+      HalfShellIter(const Self& owner):
+	pOwner(&owner)
+      {
+	rank = -1;
+	k = int(pOwner->m_halfShell.size());
+	i = iBegin = iEnd = 0;
+	j = jBegin = jEnd = 0;
+      }
+
+      bool not_end() {
+	while( j >= jEnd ) {
+	  if( i + 1 < iEnd ) {
+	    ++i;
+	    j = (k == 0) ? i + 1 : jBegin;
+	    continue;
+	  }
+	  if( ! nextStencil() ) {
+	    return false;
+	  }
+	}
+	return true;
+      }
+
+      void next() {
+	++j;
+      }
+
+      int first() const {
+	return i;
+      }
+
+      int second() const {
+	return j;
+      }
+
+      T_num r2() const {
+	return pOwner->r2(i,j);
+      }
+
+    protected:
+
+      // Advance to the next non-empty (cell, stencil offset) combination.
+      // Stencil number 0 is the cell itself.
+
+      bool nextStencil() {
+	const int nHalf = pOwner->m_halfShell.size();
+	const int nCells = pOwner->numCells();
+	while( true ) {
+	  if( ++k > nHalf ) {
+	    if( ++rank >= nCells ) {
+	      rank = nCells;
+	      k = nHalf;
+	      i = iEnd;
+	      j = jEnd;
+	      return false;
+	    }
+	    iBegin = pOwner->m_cellStart[rank];
+	    iEnd = pOwner->m_cellStart[rank+1];
+	    if( iBegin == iEnd ) {
+	      k = nHalf;
+	      continue;
+	    }
+	    k = 0;
+	  }
+	  if( k == 0 ) {
+	    jBegin = iBegin;
+	    jEnd = iEnd;
+	  }
+	  else {
+	    Index indNb = pOwner->m_cellIndex[rank] + pOwner->m_halfShell[k-1];
+	    if( ! pOwner->isInside(indNb) ) {
+	      continue;
+	    }
+	    int cellNb = pOwner->cellId(indNb);
+	    jBegin = pOwner->m_cellStart[cellNb];
+	    jEnd = pOwner->m_cellStart[cellNb+1];
+	    if( jBegin == jEnd ) {
+	      continue;
+	    }
+	  }
+	  i = iBegin;
+	  j = (k == 0) ? i + 1 : jBegin;
+	  return true;
+	}
+      }
+
+    protected:
+
+      const Self *pOwner;
+      int rank, k;
+      int i, iBegin, iEnd;
+      int j, jBegin, jEnd;
+
+    }; // class HalfShellIter
+
+
+    friend class SubDomainIter;
+    friend class CellIndex;
+    friend class HalfShellIter;
+
+
+  public:
+
+    // Default ctor creates empty object, which must be intialized later by
+    // a call to init(...) method.
+
+    PartitionedPointsCompact(): m_isBuilt(false) {}
+
+    // See PartitionedPoints ctor for description of arguments.
+    // Points outside of [lBoundS,uBoundS] are assigned to the nearest border cell.
+
+    PartitionedPointsCompact(const Point& lBoundS,const Point& uBoundS, T_num cutoff) {
+      init(lBoundS, uBoundS, cutoff);
+    }
+
+    // reinitialize the object - all content is erased
+
+    void init(Point lBoundS, Point uBoundS, T_num cutoff) {
+
+      for(int i = 0; i < N_dim; i++) {
+	if(uBoundS(i) - lBoundS(i) <= cutoff) {
+	  uBoundS(i) += cutoff/2.;
+	  lBoundS(i) -= cutoff/2.;
+	}
+      }
+
+      m_lBound = lBoundS;
+      m_cutoff = cutoff;
+      m_invCutoff = T_num(1)/cutoff;
+
+      int nCells = 1;
+      for(int i = 0; i < N_dim; i++) {
+	m_nCells(i) = std::max(1,int(std::ceil((uBoundS(i) - lBoundS(i))*m_invCutoff)));
+	nCells *= m_nCells(i);
+      }
+
+      initMortonOrder(nCells);
+
+      initHalfShell();
+
+      m_cellStart.assign(nCells+1,0);
+
+      zapPoints();
+
+    }
+
+    // Clear all data about previously accumulated points.
+    // Grid structure and allocated memory are kept.
+
+    void zapPoints() {
+      m_stageData.clear();
+      m_stagePos.clear();
+      m_data.clear();
+      for(int i = 0; i < N_dim; i++) {
+	m_coord[i].clear();
+      }
+      std::fill(m_cellStart.begin(),m_cellStart.end(),0);
+      m_isBuilt = true;
+    }
+
+    void reserve(int nPoints) {
+      m_stageData.reserve(nPoints);
+      m_stagePos.reserve(nPoints);
+    }
+
+    T_num getCutoff() const {
+      return m_cutoff;
+    }
+
+    T_num getCutoffP2() const {
+      return m_cutoff*m_cutoff;
+    }
+
+    // Queue PointData object with a given position for insertion.
+    // It becomes visible to the queries after the next build().
+
+    void insert(const Point& pos, const PointData& x) {
+      m_stageData.push_back(x);
+      m_stagePos.push_back(pos);
+      m_isBuilt = false;
+    }
+
+    // Sort all inserted points by cell.
+    // Points already in the structure are kept.
+
+    void build() {
+
+      if( m_isBuilt ) {
+	return;
+      }
+
+      const int nOld = m_data.size();
+      const int nNew = m_stageData.size();
+      const int n = nOld + nNew;
+      const int nCells = numCells();
+
+      // Move already sorted points to the staging area, so that
+      // there is only one code path below
+
+      for(int i = 0; i < nOld; i++) {
+	m_stageData.push_back(m_data[i]);
+	m_stagePos.push_back(point(i));
+      }
+
+      // cell of each point, stored temporarily in m_stageCell
+
+      m_stageCell.resize(n);
+      std::fill(m_cellStart.begin(),m_cellStart.end(),0);
+      for(int i = 0; i < n; i++) {
+	int cellId = this->cellId(cellIndex(m_stagePos[i]));
+	m_stageCell[i] = cellId;
+	m_cellStart[cellId+1]++;
+      }
+
+      for(int c = 0; c < nCells; c++) {
+	m_cellStart[c+1] += m_cellStart[c];
+      }
+
+      m_data.resize(n);
+      for(int d = 0; d < N_dim; d++) {
+	m_coord[d].resize(n);
+      }
+
+      // stable scatter with one insertion cursor per cell
+
+      m_cursor.assign(m_cellStart.begin(),m_cellStart.end()-1);
+      for(int i = 0; i < n; i++) {
+	int pos = m_cursor[m_stageCell[i]]++;
+	m_data[pos] = m_stageData[i];
+	const Point& p = m_stagePos[i];
+	for(int d = 0; d < N_dim; d++) {
+	  m_coord[d][pos] = p(d);
+	}
+      }
+
+      m_stageData.clear();
+      m_stagePos.clear();
+
+      m_isBuilt = true;
+
+    }
+
+    bool isBuilt() const {
+      return m_isBuilt;
+    }
+
+    // Return the CellIndex corresponding to the cell into which
+    // Point 'point' is projected. The structure must be built.
+
+    CellIndex getCellIndex(const Point& point) const {
+      CellIndex cell_ind;
+      getCellIndex(point,cell_ind);
+      return cell_ind;
+    }
+
+    void getCellIndex(const Point& point,CellIndex& cell_ind) const {
+      ATLOG_ASSERT_1(m_isBuilt);
+      cell_ind._pOwner = this;
+      cell_ind._ind_cell = cellIndex(point);
+      cell_ind._cellId = cellId(cell_ind._ind_cell);
+    }
+
+    int numPoints() const {
+      return m_data.size();
+    }
+
+    int numCells() const {
+      return int(m_cellStart.size()) - 1;
+    }
+
+    // Access to the sorted storage by position
+
+    const PointData& data(int pos) const {
+      return m_data[pos];
+    }
+
+    T_num coord(int pos, int dim) const {
+      return m_coord[dim][pos];
+    }
+
+    Point point(int pos) const {
+      Point p;
+      for(int d = 0; d < N_dim; d++) {
+	p(d) = m_coord[d][pos];
+      }
+      return p;
+    }
+
+    // contiguous coordinate array along dimension 'dim'
+
+    const T_num* coords(int dim) const {
+      return m_coord[dim].empty() ? 0 : &m_coord[dim][0];
+    }
+
+    T_num r2(int pos1, int pos2) const {
+      T_num r2 = 0;
+      for(int d = 0; d < N_dim; d++) {
+	T_num x = m_coord[d][pos1] - m_coord[d][pos2];
+	r2 += x*x;
+      }
+      return r2;
+    }
+
+    T_num r2(int pos, const Point& p) const {
+      T_num r2 = 0;
+      for(int d = 0; d < N_dim; d++) {
+	T_num x = m_coord[d][pos] - p(d);
+	r2 += x*x;
+      }
+      return r2;
+    }
+
+    // Logical cell coordinates for a point, cropped to the grid
+
+    Index cellIndex(const Point& point) const {
+      Index ind;
+      for(int d = 0; d < N_dim; d++) {
+	int i = int(std::floor((point(d) - m_lBound(d))*m_invCutoff));
+	ind(d) = std::min(std::max(i,0),m_nCells(d)-1);
+      }
+      return ind;
+    }
+
+    // Dense cell number (Morton rank) for the logical cell coordinates
+
+    int cellId(const Index& ind) const {
+      int lin = ind(0);
+      for(int d = 1; d < N_dim; d++) {
+	lin = lin*m_nCells(d) + ind(d);
+      }
+      return m_cellRank[lin];
+    }
+
+    bool isInside(const Index& ind) const {
+      for(int d = 0; d < N_dim; d++) {
+	if( ind(d) < 0 || ind(d) >= m_nCells(d) ) {
+	  return false;
+	}
+      }
+      return true;
+    }
+
+  protected:
+
+    // Number cells in the order of their Morton codes
+
+    void initMortonOrder(int nCells) {
+
+      int nBits = 0;
+      for(int d = 0; d < N_dim; d++) {
+	while( (1 << nBits) < m_nCells(d) ) {
+	  nBits++;
+	}
+      }
+
+      typedef std::pair<unsigned long long,int> CodeLin;
+      std::vector<CodeLin> codes(nCells);
+
+      Index ind, indLow, indUp;
+      indLow = 0;
+      indUp = m_nCells;
+
+      int lin = 0;
+      for(::PRODDL::index_mover<N_dim>::before_first(ind,indLow);
+	  ::PRODDL::index_mover<N_dim>::next(ind,indLow,indUp);
+	  lin++) {
+	unsigned long long code = 0;
+	for(int b = 0; b < nBits; b++) {
+	  for(int d = 0; d < N_dim; d++) {
+	    code |= (unsigned long long)((ind(d) >> b) & 1) << (b*N_dim + (N_dim - 1 - d));
+	  }
+	}
+	codes[lin] = CodeLin(code,lin);
+      }
+
+      std::sort(codes.begin(),codes.end());
+
+      m_cellRank.resize(nCells);
+      m_cellIndex.resize(nCells);
+
+      for(int rank = 0; rank < nCells; rank++) {
+	int lin = codes[rank].second;
+	m_cellRank[lin] = rank;
+	Index& indRank = m_cellIndex[rank];
+	for(int d = N_dim - 1; d >= 0; d--) {
+	  indRank(d) = lin % m_nCells(d);
+	  lin /= m_nCells(d);
+	}
+      }
+
+    }
+
+    // Offsets in {-1,0,1}^N_dim whose first non-zero component is positive
+
+    void initHalfShell() {
+      m_halfShell.clear();
+      Index ind, indLow, indUp;
+      indLow = -1;
+      indUp = 2;
+      for(::PRODDL::index_mover<N_dim>::before_first(ind,indLow);
+	  ::PRODDL::index_mover<N_dim>::next(ind,indLow,indUp); ) {
+	for(int d = 0; d < N_dim; d++) {
+	  if( ind(d) != 0 ) {
+	    if( ind(d) > 0 ) {
+	      m_halfShell.push_back(ind);
+	    }
+	    break;
+	  }
+	}
+      }
+    }
+
+  protected:
+
+    Point m_lBound;
+    T_num m_cutoff, m_invCutoff;
+    Index m_nCells;
+
+    // Morton rank of each cell by its row-major linear index
+    std::vector<int> m_cellRank;
+    // logical coordinates of each cell by its Morton rank
+    std::vector<Index> m_cellIndex;
+
+    std::vector<Index> m_halfShell;
+
+    // elements of cell 'c' are [m_cellStart[c],m_cellStart[c+1])
+    std::vector<int> m_cellStart;
+
+    // sorted storage
+    std::vector<PointData> m_data;
+    std::vector<T_num> m_coord[N_dim];
+
+    // points inserted since the last build()
+    std::vector<PointData> m_stageData;
+    std::vector<Point> m_stagePos;
+
+    // work arrays for build()
+    std::vector<int> m_stageCell;
+    std::vector<int> m_cursor;
+
+    bool m_isBuilt;
+
+  }; // class PartitionedPointsCompact
+
+
+} } } // namespace PRODDL::Geom::Points
+
+#endif // AT_GEOM_PARTPOINTS_COMPACT_H__
@@ -0,0 +1,242 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#ifndef PRODDL_GEOM_POSE_CLUSTER_H__
+#define PRODDL_GEOM_POSE_CLUSTER_H__
+
+#include "PRODDL/types.hpp"
+#include "PRODDL/Geom/cluster.hpp"
+#include "PRODDL/Common/parallel.hpp"
+#include "PRODDL/External/nr/nr_arr.hpp"
+#include "PRODDL/External/nr/nr.hpp"
+
+#include <cmath>
+#include <vector>
+
+// Clustering of rigid body poses of one ligand by the ligand RMSD.
+//
+// For the ligand atoms x_i with the centroid c and the covariance matrix
+// with eigenvalues l_k and eigenvectors e_k, the RMSD between two poses
+// (R1,t1) and (R2,t2) is
+//   RMSD^2 = |T1(c) - T2(c)|^2 + sum_k l_k |(R1 - R2) e_k|^2
+// Thus, each pose is represented by N_feat = 12 numbers: T(c) and
+// R(sqrt(l_k) e_k) for k = 0,1,2, and the RMSD is exactly the Euclidean
+// distance between those vectors. ClusterMatrix then clusters them, hashing
+// the first M_hash columns (the centroid and the largest principal axis),
+// in O(N) time for poses spread around the receptor, instead of computing
+// the O(N^2) matrix of pairwise RMSD.
+
+namespace PRODDL {
+
+  template<typename T_num>
+  class PoseClusterer {
+
+  public:
+
+    typedef Types<T_num> TypesT;
+    typedef typename TypesT::Point Point;
+    typedef typename TypesT::Points Points;
+    typedef typename TypesT::Matrix Matrix;
+    typedef typename TypesT::Floats Floats;
+    typedef typename TypesT::Ints Ints;
+    typedef typename TypesT::RotationTranslation RotationTranslation;
+
+    enum { N_feat = 12, M_hash = 4 };
+
+    typedef typename common_types::point_type<T_num,N_feat>::Type Feature;
+
+    typedef ClusterMatrix<T_num,M_hash> ClusterMatrixT;
+
+    struct Cluster {
+
+      // index of the representative pose (the best scoring one among
+      // those not within the cutoff of a better cluster)
+      int iRep;
+
+      int size;
+
+      // score of the representative
+      T_num value;
+
+    };
+
+    typedef std::vector<Cluster> Clusters;
+
+  public:
+
+    // 'lig' - ligand atoms in the frame to which the poses are applied
+
+    explicit PoseClusterer(const Points& lig) {
+
+      int n = lig.size();
+
+      ATALWAYS(n > 0,"PoseClusterer: empty ligand");
+
+      typedef Geom::SpaceTraits<double>::Matrix3x3 Matrix3D;
+      typedef Geom::SpaceTraits<double>::Point3 PointD;
+
+      PointD cm(0.);
+
+      for(int i = lig.lbound(0); i <= lig.ubound(0); i++) {
+	for(int j = 0; j < 3; j++) {
+	  cm(j) += lig(i)(j);
+	}
+      }
+
+      cm /= n;
+
+      Matrix3D cov;
+
+      for(int j = 0; j < 3; j++) {
+	for(int k = 0; k < 3; k++) {
+	  double s = 0;
+	  for(int i = lig.lbound(0); i <= lig.ubound(0); i++) {
+	    s += (lig(i)(j) - cm(j))*(lig(i)(k) - cm(k));
+	  }
+	  cov(j,k) = s/n;
+	}
+      }
+
+      // eigenvectors in columns of 'vec', largest eigenvalue first
+
+      Matrix3D vec;
+      PointD eigenVal;
+      int nrot;
+      nr::MatrixAdaptor<double> cov_nrc(cov.dataFirst(),1,3,1,3), vec_nrc(vec.dataFirst(),1,3,1,3);
+      nr::jacobi(cov_nrc.rowPointers(),3,eigenVal.dataFirst()-1,vec_nrc.rowPointers(),&nrot);
+      nr::eigsrt(eigenVal.dataFirst()-1,vec_nrc.rowPointers(),3,false);
+
+      for(int j = 0; j < 3; j++) {
+	center(j) = T_num(cm(j));
+      }
+
+      for(int k = 0; k < 3; k++) {
+	double scale = std::sqrt(std::max(eigenVal(k),0.));
+	for(int j = 0; j < 3; j++) {
+	  axes[k](j) = T_num(vec(j,k)*scale);
+	}
+      }
+
+    }
+
+    // Representation of the pose 'tr' (see the comment at the top)
+
+    Feature features(const RotationTranslation& tr) const {
+
+      Feature f;
+
+      Point c = tr(center);
+
+      for(int j = 0; j < 3; j++) {
+	f(j) = c(j);
+      }
+
+      for(int k = 0; k < 3; k++) {
+	Point a = tr(Point(center + axes[k])) - c;
+	for(int j = 0; j < 3; j++) {
+	  f(3*(k+1) + j) = a(j);
+	}
+      }
+
+      return f;
+
+    }
+
+    // Cluster 'n' poses from the random access range starting at 'start'
+    // (with 'tran' and 'value' members, like RotTranValue; lower values
+    // are better) with the RMSD cutoff 'rmsdCutoff'. The features of the
+    // poses are computed by 'nThreads' threads; the assignment of leaders
+    // is inherently sequential (from the best score down), but it only
+    // looks at the neighbors in the hash.
+
+    template<class RandomIter>
+    void cluster(RandomIter start, int n, T_num rmsdCutoff, int nThreads = 1) {
+
+      clusters.clear();
+
+      membership.assign(n,-1);
+
+      if( n == 0 ) {
+	return;
+      }
+
+      Matrix m(n,int(N_feat));
+
+      Floats weights(n);
+
+      Parallel::forRanges(Parallel::resolveThreads(nThreads),n,[&](int i_thr, int begin, int end) {
+	  for(int i = begin; i < end; i++) {
+	    Feature f = features(start[i].tran);
+	    for(int j = 0; j < N_feat; j++) {
+	      m(i,j) = f(j);
+	    }
+	    weights(i) = start[i].value;
+	  }
+	});
+
+      // ClusterMatrix compares the squared distance with
+      // the squared cutoff times the number of columns
+
+      ClusterMatrixT clust;
+
+      clust.cluster(m,weights,rmsdCutoff/std::sqrt(T_num(N_feat)));
+
+      int nClust = clust.numClusters();
+
+      Ints rowInd(nClust);
+      Floats clustDens(nClust);
+
+      clust.getClusters(rowInd,clustDens);
+
+      // cluster index of each leader, best cluster first
+
+      clusters.resize(nClust);
+
+      for(int i_cl = 0; i_cl < nClust; i_cl++) {
+	Cluster& cl = clusters[i_cl];
+	cl.iRep = rowInd(i_cl);
+	cl.size = 0;
+	cl.value = weights(cl.iRep);
+	membership[cl.iRep] = i_cl;
+      }
+
+      const Ints& leader = clust.getLeader();
+
+      for(int i = 0; i < n; i++) {
+	int i_cl = membership[leader(i)];
+	membership[i] = i_cl;
+	clusters[i_cl].size++;
+      }
+
+    }
+
+    const Clusters& getClusters() const {
+      return clusters;
+    }
+
+    // cluster index of each pose passed to the last call to cluster()
+
+    const std::vector<int>& getMembership() const {
+      return membership;
+    }
+
+  protected:
+
+    Point center;
+
+    Point axes[3];
+
+    Clusters clusters;
+
+    std::vector<int> membership;
+
+  }; // class PoseClusterer
+
+} // namespace PRODDL
+
+#endif // PRODDL_GEOM_POSE_CLUSTER_H__
@@ -0,0 +1,332 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#ifndef AT_GEOM_RIGID_KERNEL_H__
+#define AT_GEOM_RIGID_KERNEL_H__
+
+// Application of rigid body transforms x' = R x + t to many points at once.
+//
+// The coefficients of the transform are held in plain scalars, and the
+// points are either in SoA buffers (SoAPoints: separate x[], y[] and z[]
+// arrays) or in the usual AoS Points arrays. The inner loops have no
+// aliasing and no dependencies between iterations, so that the compiler
+// vectorizes them (and contracts the products and sums into FMA where the
+// target has it). The SoA layout gives unit stride loads for every
+// coordinate; the AoS version is there for the code that keeps Points.
+//
+// applyEnsemble() applies many transforms to the same point set (e.g.
+// all poses of a ligand, as in the pose ensemble export of export_models)
+// in blocks of points small enough to stay in the L1 cache while every
+// transform is applied to them.
+//
+// This header does not depend on transformation.hpp, so that the
+// Rotation and RotationTranslation classes can use it for their
+// operator()(Points&).
+
+#include "PRODDL/Geom/traits.hpp"
+
+#include <algorithm>
+
+#include <vector>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PRODDL_RESTRICT __restrict__
+#elif defined(_MSC_VER)
+#define PRODDL_RESTRICT __restrict
+#else
+#define PRODDL_RESTRICT
+#endif
+
+namespace PRODDL { namespace Geom {
+
+
+  // Coordinates of 'size()' points in three separate arrays.
+  // The arrays are padded to a multiple of 'padding' elements (the padding
+  // is zero filled), so that vectorized loops can run over 'sizePadded()'
+  // without a scalar remainder.
+
+  template<typename T_num>
+  class SoAPoints {
+
+  public:
+
+    typedef typename SpaceTraits<T_num>::Point3 Point;
+    typedef typename SpaceTraits<T_num>::VPoint3 Points;
+
+    enum { padding = 8 };
+
+    SoAPoints():
+      n(0)
+    {}
+
+    explicit SoAPoints(int _n) {
+      resize(_n);
+    }
+
+    explicit SoAPoints(const Points& points) {
+      assign(points);
+    }
+
+    void resize(int _n) {
+      n = _n;
+      int nPad = (n + padding - 1) / padding * padding;
+      for(int j = 0; j < 3; j++) {
+	coords[j].assign(nPad,T_num(0));
+      }
+    }
+
+    int size() const {
+      return n;
+    }
+
+    int sizePadded() const {
+      return int(coords[0].size());
+    }
+
+    T_num* x() { return coords[0].data(); }
+    T_num* y() { return coords[1].data(); }
+    T_num* z() { return coords[2].data(); }
+
+    const T_num* x() const { return coords[0].data(); }
+    const T_num* y() const { return coords[1].data(); }
+    const T_num* z() const { return coords[2].data(); }
+
+    Point operator() (int i) const {
+      return Point(coords[0][i],coords[1][i],coords[2][i]);
+    }
+
+    // Adapters from and to Points
+
+    void assign(const Points& points) {
+      resize(points.size());
+      int i = 0;
+      for(int k = points.lbound(0); k <= points.ubound(0); k++, i++) {
+	const Point& p = points(k);
+	coords[0][i] = p(0);
+	coords[1][i] = p(1);
+	coords[2][i] = p(2);
+      }
+    }
+
+    void copyTo(Points& points) const {
+      if( points.size() != n ) {
+	points.resize(n);
+      }
+      int i = 0;
+      for(int k = points.lbound(0); k <= points.ubound(0); k++, i++) {
+	points(k) = Point(coords[0][i],coords[1][i],coords[2][i]);
+      }
+    }
+
+  protected:
+
+    int n;
+
+    std::vector<T_num> coords[3];
+
+  }; // class SoAPoints
+
+
+  // Rigid body transform x' = R x + t as twelve scalars
+
+  template<typename T_num>
+  class RigidKernel {
+
+  public:
+
+    typedef typename SpaceTraits<T_num>::Point3 Point;
+    typedef typename SpaceTraits<T_num>::Matrix3x3 Matrix3;
+    typedef typename SpaceTraits<T_num>::VPoint3 Points;
+
+    // points of a block in applyEnsemble(): 3 arrays of 512 doubles
+    // for the input and 3 for the output take 24K
+    enum { blockSize = 512 };
+
+    RigidKernel() {
+      for(int j = 0; j < 3; j++) {
+	for(int k = 0; k < 3; k++) {
+	  r[j][k] = (j == k);
+	}
+	t[j] = 0;
+      }
+    }
+
+    RigidKernel(const Matrix3& tensor, const Point& vector) {
+      set(tensor,vector);
+    }
+
+    // pure rotation
+
+    explicit RigidKernel(const Matrix3& tensor) {
+      set(tensor,Point(0.));
+    }
+
+    void set(const Matrix3& tensor, const Point& vector) {
+      for(int j = 0; j < 3; j++) {
+	for(int k = 0; k < 3; k++) {
+	  r[j][k] = tensor(j,k);
+	}
+	t[j] = vector(j);
+      }
+    }
+
+    Point operator() (const Point& p) const {
+      return Point(r[0][0]*p(0) + r[0][1]*p(1) + r[0][2]*p(2) + t[0],
+		   r[1][0]*p(0) + r[1][1]*p(1) + r[1][2]*p(2) + t[1],
+		   r[2][0]*p(0) + r[2][1]*p(1) + r[2][2]*p(2) + t[2]);
+    }
+
+    // Transform 'n' points from the SoA arrays 'x','y','z' into 'xo','yo','zo'.
+    // The input and output arrays must not overlap.
+
+    void apply(const T_num* PRODDL_RESTRICT x, const T_num* PRODDL_RESTRICT y, const T_num* PRODDL_RESTRICT z,
+	       T_num* PRODDL_RESTRICT xo, T_num* PRODDL_RESTRICT yo, T_num* PRODDL_RESTRICT zo,
+	       int n) const {
+      const T_num r00 = r[0][0], r01 = r[0][1], r02 = r[0][2],
+	r10 = r[1][0], r11 = r[1][1], r12 = r[1][2],
+	r20 = r[2][0], r21 = r[2][1], r22 = r[2][2],
+	t0 = t[0], t1 = t[1], t2 = t[2];
+      for(int i = 0; i < n; i++) {
+	const T_num xi = x[i], yi = y[i], zi = z[i];
+	xo[i] = r00*xi + r01*yi + r02*zi + t0;
+	yo[i] = r10*xi + r11*yi + r12*zi + t1;
+	zo[i] = r20*xi + r21*yi + r22*zi + t2;
+      }
+    }
+
+    void apply(const SoAPoints<T_num>& in, SoAPoints<T_num>& out) const {
+      if( out.size() != in.size() ) {
+	out.resize(in.size());
+      }
+      apply(in.x(),in.y(),in.z(),out.x(),out.y(),out.z(),in.sizePadded());
+    }
+
+    // Transform 'points' in place. The contiguous case goes through
+    // the raw array, so that the inner loop has no Blitz indexing in it.
+
+    void apply(Points& points) const {
+      if( points.isStorageContiguous() && points.stride(0) == 1 ) {
+	applyAoS(reinterpret_cast<T_num*>(points.dataFirst()),points.size());
+      }
+      else {
+	for(int k = points.lbound(0); k <= points.ubound(0); k++) {
+	  points(k) = operator()(points(k));
+	}
+      }
+    }
+
+    // Transform 'in' into 'out', which is resized when needed.
+    // 'in' and 'out' must not share the data.
+
+    void apply(const Points& in, Points& out) const {
+      if( out.size() != in.size() ) {
+	out.resize(in.size());
+      }
+      if( in.isStorageContiguous() && in.stride(0) == 1 &&
+	  out.isStorageContiguous() && out.stride(0) == 1 ) {
+	applyAoS(reinterpret_cast<const T_num*>(in.dataFirst()),
+		 reinterpret_cast<T_num*>(out.dataFirst()),
+		 in.size());
+      }
+      else {
+	for(int k = 0; k < in.size(); k++) {
+	  out(out.lbound(0) + k) = operator()(in(in.lbound(0) + k));
+	}
+      }
+    }
+
+    // Apply 'nTr' transforms 'kernels' to the same points 'in', with
+    // the result of the transform 'i' going to 'outs[i]'. Works over
+    // blocks of points, so that each block is loaded from memory once
+    // for all transforms.
+
+    static void applyEnsemble(const RigidKernel* kernels, int nTr,
+			      const SoAPoints<T_num>& in, SoAPoints<T_num>* outs) {
+      int nPad = in.sizePadded();
+      for(int i_tr = 0; i_tr < nTr; i_tr++) {
+	if( outs[i_tr].size() != in.size() ) {
+	  outs[i_tr].resize(in.size());
+	}
+      }
+      for(int begin = 0; begin < nPad; begin += blockSize) {
+	int nBlock = std::min(int(blockSize),nPad - begin);
+	for(int i_tr = 0; i_tr < nTr; i_tr++) {
+	  SoAPoints<T_num>& out = outs[i_tr];
+	  kernels[i_tr].apply(in.x() + begin,in.y() + begin,in.z() + begin,
+			      out.x() + begin,out.y() + begin,out.z() + begin,
+			      nBlock);
+	}
+      }
+    }
+
+    // Same as above, but instead of storing all transformed points, calls
+    // 'visit(i_tr,begin,n,block)' for every transform 'i_tr' and every block,
+    // where 'block' holds the transformed points [begin,begin+n) of 'in'.
+    // The memory use does not grow with 'nTr', which suits the consumers
+    // that reduce the coordinates (scores, RMSD, bounds).
+
+    template<class Visitor>
+    static void applyEnsemble(const RigidKernel* kernels, int nTr,
+			      const SoAPoints<T_num>& in, Visitor visit) {
+      int n = in.size();
+      int nPad = in.sizePadded();
+      SoAPoints<T_num> block(std::min(int(blockSize),nPad));
+      for(int begin = 0; begin < nPad; begin += blockSize) {
+	int nBlock = std::min(int(blockSize),nPad - begin);
+	if( nBlock != block.sizePadded() ) {
+	  block.resize(nBlock);
+	}
+	for(int i_tr = 0; i_tr < nTr; i_tr++) {
+	  kernels[i_tr].apply(in.x() + begin,in.y() + begin,in.z() + begin,
+			      block.x(),block.y(),block.z(),
+			      nBlock);
+	  visit(i_tr,begin,std::min(nBlock,n - begin),block);
+	}
+      }
+    }
+
+  protected:
+
+    // AoS loops over interleaved x,y,z triplets
+
+    void applyAoS(T_num* PRODDL_RESTRICT p, int n) const {
+      const T_num r00 = r[0][0], r01 = r[0][1], r02 = r[0][2],
+	r10 = r[1][0], r11 = r[1][1], r12 = r[1][2],
+	r20 = r[2][0], r21 = r[2][1], r22 = r[2][2],
+	t0 = t[0], t1 = t[1], t2 = t[2];
+      for(int i = 0; i < n; i++, p += 3) {
+	const T_num xi = p[0], yi = p[1], zi = p[2];
+	p[0] = r00*xi + r01*yi + r02*zi + t0;
+	p[1] = r10*xi + r11*yi + r12*zi + t1;
+	p[2] = r20*xi + r21*yi + r22*zi + t2;
+      }
+    }
+
+    void applyAoS(const T_num* PRODDL_RESTRICT p, T_num* PRODDL_RESTRICT po, int n) const {
+      const T_num r00 = r[0][0], r01 = r[0][1], r02 = r[0][2],
+	r10 = r[1][0], r11 = r[1][1], r12 = r[1][2],
+	r20 = r[2][0], r21 = r[2][1], r22 = r[2][2],
+	t0 = t[0], t1 = t[1], t2 = t[2];
+      for(int i = 0; i < n; i++, p += 3, po += 3) {
+	const T_num xi = p[0], yi = p[1], zi = p[2];
+	po[0] = r00*xi + r01*yi + r02*zi + t0;
+	po[1] = r10*xi + r11*yi + r12*zi + t1;
+	po[2] = r20*xi + r21*yi + r22*zi + t2;
+      }
+    }
+
+    T_num r[3][3];
+
+    T_num t[3];
+
+  }; // class RigidKernel
+
+
+} } // namespace PRODDL::Geom
+
+#endif // AT_GEOM_RIGID_KERNEL_H__
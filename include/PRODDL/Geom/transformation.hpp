@@ -13,6 +13,8 @@
 
 #include "PRODDL/Geom/euler.hpp"
 
+#include "PRODDL/Geom/rigid_kernel.hpp"
+
 #include <iostream> // for debugging printouts
 
 /*
@@ -216,10 +218,13 @@ public:
   }
 
   void operator() (Points& points) const {
-    for(int i = 0; i < points.size(); i++) {
-      Point& other = points(i);
-      other = operator()(other);
-    }
+    RigidKernel<T_num>(tensor).apply(points);
+  }
+
+  // Rotate 'in' into 'out' (resized when needed), which must not share the data with 'in'
+
+  void operator() (const Points& in, Points& out) const {
+    RigidKernel<T_num>(tensor).apply(in,out);
   }
 
   Rotation rotation() const {
@@ -332,10 +337,13 @@ public:
   }
 
   void operator() (Points& points) const {
-    for(int i = 0; i < points.size(); i++) {
-      Point& point = points(i);
-      point = operator()(point);
-    }
+    RigidKernel<T_num>(tensor,vector).apply(points);
+  }
+
+  // Transform 'in' into 'out' (resized when needed), which must not share the data with 'in'
+
+  void operator() (const Points& in, Points& out) const {
+    RigidKernel<T_num>(tensor,vector).apply(in,out);
   }
 
   Rotation<T_num> rotation() const {
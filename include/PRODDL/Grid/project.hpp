@@ -91,7 +91,10 @@ namespace PRODDL { namespace Grid {
 
 	// potentially crop the region to make sure all indices within it are for valid grid cells
       
-	grid.cropSubDomain(region);
+	if( ! grid.cropSubDomain(region) ) {
+	  // no intersection with the grid - make the region empty
+	  region(uBound) = region(lBound) - 1;
+	}
 
 	region(uBound) += 1; // index_mover needs open range
 
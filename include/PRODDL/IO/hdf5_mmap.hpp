@@ -0,0 +1,204 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#ifndef PRODDL_IO_HDF5_MMAP_H__
+#define PRODDL_IO_HDF5_MMAP_H__
+
+// Blitz views of HDF5 datasets memory-mapped straight from the file.
+//
+// A dataset can be mapped when it has contiguous (not chunked, not compressed)
+// layout and is stored with the native representation of the element type.
+// This is what both h5py and HDF5File::setArray() write by default.
+// The whole file is mapped read-only: all processes on a node that read
+// the same file share its pages in the page cache. Writing into a view
+// faults, so a caller that modifies an array must take its own .copy().
+//
+// Mapped files are kept in a process-wide registry and are never unmapped,
+// so the views (created with neverDeleteData) stay valid until the process
+// exits. Repeated loads of the same file reuse the mapping.
+
+#include <map>
+#include <string>
+#include <sstream>
+#include <mutex>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <hdf5.h>
+
+#include "PRODDL/IO/hdf5.hpp"
+
+#include "PRODDL/Common/debug.hpp"
+
+namespace PRODDL {
+
+
+  // HDF5 memory type that matches the C++ type T
+
+  template<typename T> struct Hdf5NativeType;
+
+  template<> struct Hdf5NativeType<int> {
+    static hid_t get() { return H5T_NATIVE_INT; }
+  };
+
+  template<> struct Hdf5NativeType<float> {
+    static hid_t get() { return H5T_NATIVE_FLOAT; }
+  };
+
+  template<> struct Hdf5NativeType<double> {
+    static hid_t get() { return H5T_NATIVE_DOUBLE; }
+  };
+
+
+  class Hdf5MappedFile : boost::noncopyable {
+
+  public:
+
+    typedef boost::shared_ptr<Hdf5MappedFile> Ptr;
+
+    // Mapping of 'fileName' from the registry, created on the first call
+
+    static Ptr open(const std::string& fileName) {
+      static std::mutex mtx;
+      static std::map<std::string,Ptr> registry;
+      struct stat st;
+      ATALWAYS(::stat(fileName.c_str(),&st) == 0,"Unable to stat HDF5 file: " + fileName);
+      // a file rewritten since the last call gets a new mapping
+      std::ostringstream key;
+      key << fileName << ':' << st.st_ino << ':' << st.st_size << ':' << st.st_mtime;
+      std::lock_guard<std::mutex> lock(mtx);
+      Ptr& p = registry[key.str()];
+      if( ! p ) {
+	p.reset(new Hdf5MappedFile(fileName));
+      }
+      return p;
+    }
+
+    ~Hdf5MappedFile() {
+      if( m_fileId >= 0 ) {
+	H5Fclose(m_fileId);
+      }
+      // the mapping is deliberately not released, see the comment at the top
+    }
+
+    // Make 'arr' a read-only view of the dataset 'path'. Return false (and
+    // leave 'arr' untouched) if the dataset can not be mapped; the caller
+    // should then read it the usual way.
+
+    template<typename T, int N>
+    bool mapArray(const std::string& path, blitz::Array<T,N>& arr) const {
+
+      hid_t dset = H5Dopen2(m_fileId,path.c_str(),H5P_DEFAULT);
+
+      ATALWAYS(dset >= 0,"Unable to open dataset " + path + " in HDF5 file " + m_fileName);
+
+      hid_t dcpl = H5Dget_create_plist(dset);
+      hid_t ftype = H5Dget_type(dset);
+      hid_t space = H5Dget_space(dset);
+
+      bool ok = H5Pget_layout(dcpl) == H5D_CONTIGUOUS &&
+	H5Tequal(ftype,Hdf5NativeType<T>::get()) > 0 &&
+	H5Sget_simple_extent_ndims(space) == N;
+
+      blitz::TinyVector<int,N> shape;
+      size_t nElem = 1;
+
+      if( ok ) {
+	hsize_t dims[N];
+	H5Sget_simple_extent_dims(space,dims,0);
+	for(int i = 0; i < N; i++) {
+	  shape(i) = int(dims[i]);
+	  nElem *= dims[i];
+	}
+      }
+
+      haddr_t offset = ok ? H5Dget_offset(dset) : HADDR_UNDEF;
+
+      H5Sclose(space);
+      H5Tclose(ftype);
+      H5Pclose(dcpl);
+      H5Dclose(dset);
+
+      // storage is not allocated for empty datasets, and misaligned data
+      // would have to be accessed through unaligned loads
+
+      if( ! ok || offset == HADDR_UNDEF ||
+	  offset % sizeof(T) != 0 ||
+	  offset + nElem * sizeof(T) > m_size ) {
+	return false;
+      }
+
+      T *data = reinterpret_cast<T*>(static_cast<char*>(m_data) + offset);
+
+      arr.reference(blitz::Array<T,N>(data,shape,blitz::neverDeleteData));
+
+      return true;
+
+    }
+
+    bool isMapped() const {
+      return m_data != 0;
+    }
+
+    const std::string& fileName() const {
+      return m_fileName;
+    }
+
+  protected:
+
+    explicit Hdf5MappedFile(const std::string& fileName):
+      m_fileName(fileName),
+      m_fileId(-1),
+      m_data(0),
+      m_size(0)
+    {
+
+      int fd = ::open(fileName.c_str(),O_RDONLY);
+
+      ATALWAYS(fd >= 0,"Unable to open HDF5 file: " + fileName);
+
+      struct stat st;
+
+      ATALWAYS(::fstat(fd,&st) == 0,"Unable to stat HDF5 file: " + fileName);
+
+      m_size = size_t(st.st_size);
+
+      void *p = ::mmap(0,m_size,PROT_READ,MAP_SHARED,fd,0);
+
+      ::close(fd);
+
+      ATALWAYS(p != MAP_FAILED,"Unable to memory-map HDF5 file: " + fileName);
+
+      m_data = p;
+
+      m_fileId = H5Fopen(fileName.c_str(),H5F_ACC_RDONLY,H5P_DEFAULT);
+
+      ATALWAYS(m_fileId >= 0,"Unable to open HDF5 file: " + fileName);
+
+    }
+
+    std::string m_fileName;
+
+    hid_t m_fileId;
+
+    void *m_data;
+
+    size_t m_size;
+
+  }; // class Hdf5MappedFile
+
+
+} // namespace PRODDL
+
+#endif // PRODDL_IO_HDF5_MMAP_H__
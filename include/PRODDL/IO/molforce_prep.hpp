@@ -0,0 +1,447 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#ifndef PRODDL_IO_MOLFORCE_PREP_H__
+#define PRODDL_IO_MOLFORCE_PREP_H__
+
+// Preparation of the molforce HDF5 file (the input of load_from_hdf5() in
+// docking_io_hdf5.hpp) directly from PDB files, without IMP.
+//
+// Atoms get the CHARMM22 heavy atom types of the standard amino acids
+// (top_heav.lib), with the NTER/CTER patches applied to the first and last
+// residue of every chain, and the nonbonded parameters of those types
+// (par_all22_prot), which is what IMP get_heavy_atom_CHARMM_parameters()
+// provides to force_field_fft.py. The parameters are converted the same way
+// as in force_field_fft.py:
+//   eps   = -4.184 * eps_charmm      (kcal/mol to kJ/mol, positive well depth)
+//   sigma = 2 * 2^(-1/6) * rmin_half
+//
+// Unlike IMP, missing atoms are not rebuilt from the internal coordinates.
+// Hydrogens and alternative locations other than the first are skipped, as
+// are atoms that are not in the topology of a standard residue. Atoms of
+// other residues get the type from their element (C, N, O or S). HETATM
+// records are read along with ATOM records, so that modified residues such
+// as MSE stay in the molecule (water is skipped).
+//
+// File layout:
+//   /mol_offsets - int[nMol][2], [start,end) atom range of each molecule
+//   /pos         - T_num[nAtoms][3]
+//   /mass, /eps, /sigma, /alpha - T_num[nAtoms]
+// Attribute "mix" of "/" is 1 (geometric mean combination of sigma, which
+// is what ljComp in FFT needs).
+
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "PRODDL/types.hpp"
+
+#include "PRODDL/exceptions.hpp"
+
+#include "PRODDL/Common/debug.hpp"
+
+#include "PRODDL/IO/hdf5.hpp"
+
+#include "PRODDL/IO/pdb_models.hpp"
+
+namespace PRODDL {
+
+
+  // Nonbonded parameters of one CHARMM22 atom type as in the parameter file:
+  // well depth (kcal/mol, negative) and half of the minimum energy distance
+
+  struct CharmmAtomType {
+    const char *name;
+    double eps;
+    double rMinHalf;
+    double mass;
+  };
+
+
+  // Map of (residue name, atom name) to the CHARMM22 heavy atom type
+
+  class CharmmHeavyAtoms {
+
+  public:
+
+    enum Terminus { midChain = 0, nTerm = 1, cTerm = 2 };
+
+    CharmmHeavyAtoms() {
+
+      for(int i = 0; i < nTypes(); i++) {
+	m_typeInd[types()[i].name] = i;
+      }
+
+      // residue name followed by (atom name, type name) pairs, the backbone
+      // N, CA, C and O are added for every residue below
+      static const char *residues[][24] = {
+	{"ALA","CB","CT3",0},
+	{"ARG","CB","CT2","CG","CT2","CD","CT2","NE","NC2","CZ","C","NH1","NC2","NH2","NC2",0},
+	{"ASN","CB","CT2","CG","CC","OD1","O","ND2","NH2",0},
+	{"ASP","CB","CT2","CG","CC","OD1","OC","OD2","OC",0},
+	{"CYS","CB","CT2","SG","S",0},
+	{"GLN","CB","CT2","CG","CT2","CD","CC","OE1","O","NE2","NH2",0},
+	{"GLU","CB","CT2","CG","CT2","CD","CC","OE1","OC","OE2","OC",0},
+	{"GLY",0},
+	// HSD, the default CHARMM tautomer for HIS
+	{"HIS","CB","CT2","CG","CPH1","ND1","NR1","CE1","CPH2","NE2","NR2","CD2","CPH1",0},
+	// PDB CD1 is CD in CHARMM
+	{"ILE","CB","CT1","CG2","CT3","CG1","CT2","CD1","CT3","CD","CT3",0},
+	{"LEU","CB","CT2","CG","CT1","CD1","CT3","CD2","CT3",0},
+	{"LYS","CB","CT2","CG","CT2","CD","CT2","CE","CT2","NZ","NH3",0},
+	{"MET","CB","CT2","CG","CT2","SD","S","CE","CT3",0},
+	{"PHE","CB","CT2","CG","CA","CD1","CA","CD2","CA","CE1","CA","CE2","CA","CZ","CA",0},
+	{"PRO","CB","CP2","CG","CP2","CD","CP3",0},
+	{"SER","CB","CT2","OG","OH1",0},
+	{"THR","CB","CT1","OG1","OH1","CG2","CT3",0},
+	{"TRP","CB","CT2","CG","CY","CD1","CA","NE1","NY","CE2","CPT","CD2","CPT",
+	 "CE3","CA","CZ3","CA","CZ2","CA","CH2","CA",0},
+	{"TYR","CB","CT2","CG","CA","CD1","CA","CE1","CA","CZ","CA","OH","OH1","CD2","CA","CE2","CA",0},
+	{"VAL","CB","CT1","CG1","CT3","CG2","CT3",0}
+      };
+
+      for(size_t i_res = 0; i_res < sizeof(residues)/sizeof(residues[0]); i_res++) {
+	const char * const *r = residues[i_res];
+	std::string resName = r[0];
+	bool isGly = resName == "GLY", isPro = resName == "PRO";
+	addAtom(resName,"N",isPro ? "N" : "NH1");
+	addAtom(resName,"CA",isGly ? "CT2" : (isPro ? "CP1" : "CT1"));
+	addAtom(resName,"C","C");
+	addAtom(resName,"O","O");
+	for(int i = 1; r[i] != 0; i += 2) {
+	  addAtom(resName,r[i],r[i+1]);
+	}
+      }
+
+    }
+
+    static int nTypes() {
+      return 26;
+    }
+
+    static const CharmmAtomType* types() {
+      static const CharmmAtomType t[] = {
+	{"C",    -0.110,  2.000,  12.011},
+	{"CA",   -0.070,  1.9924, 12.011},
+	{"CC",   -0.070,  2.000,  12.011},
+	{"CP1",  -0.020,  2.275,  12.011},
+	{"CP2",  -0.055,  2.175,  12.011},
+	{"CP3",  -0.055,  2.175,  12.011},
+	{"CPH1", -0.050,  1.800,  12.011},
+	{"CPH2", -0.050,  1.800,  12.011},
+	{"CPT",  -0.099,  1.860,  12.011},
+	{"CT1",  -0.020,  2.275,  12.011},
+	{"CT2",  -0.055,  2.175,  12.011},
+	{"CT3",  -0.080,  2.060,  12.011},
+	{"CY",   -0.073,  1.990,  12.011},
+	{"N",    -0.200,  1.850,  14.007},
+	{"NC2",  -0.200,  1.850,  14.007},
+	{"NH1",  -0.200,  1.850,  14.007},
+	{"NH2",  -0.200,  1.850,  14.007},
+	{"NH3",  -0.200,  1.850,  14.007},
+	{"NP",   -0.200,  1.850,  14.007},
+	{"NR1",  -0.200,  1.850,  14.007},
+	{"NR2",  -0.200,  1.850,  14.007},
+	{"NY",   -0.200,  1.850,  14.007},
+	{"O",    -0.120,  1.700,  15.999},
+	{"OC",   -0.120,  1.700,  15.999},
+	{"OH1",  -0.1521, 1.770,  15.999},
+	{"S",    -0.450,  2.000,  32.060}
+      };
+      return t;
+    }
+
+    // Index of the type of atom 'atomName' (no leading or trailing spaces)
+    // in residue 'resName' at the chain position 'term', or -1 if the atom
+    // is not in the topology of the residue. Atoms of unknown residues get
+    // the type from their element.
+
+    int typeIndex(const std::string& resName, const std::string& atomName, int term) const {
+
+      if( term & nTerm ) {
+	if( atomName == "N" ) {
+	  return typeIndex(resName == "PRO" ? "NP" : "NH3");
+	}
+      }
+
+      if( term & cTerm ) {
+	if( atomName == "C" ) {
+	  return typeIndex("CC");
+	}
+	if( atomName == "O" || atomName == "OXT" || atomName == "OT1" || atomName == "OT2" ) {
+	  return typeIndex("OC");
+	}
+      }
+
+      AtomTypes::const_iterator p = m_atomType.find(resName + ":" + atomName);
+
+      if( p != m_atomType.end() ) {
+	return p->second;
+      }
+
+      if( isStandard(resName) ) {
+	return -1;
+      }
+
+      switch( atomName[0] ) {
+      case 'C': return typeIndex("CT2");
+      case 'N': return typeIndex("NH1");
+      case 'O': return typeIndex("O");
+      case 'S': return typeIndex("S");
+      default: return -1;
+      }
+
+    }
+
+    bool isStandard(const std::string& resName) const {
+      return m_residues.count(resName) > 0;
+    }
+
+    int typeIndex(const std::string& typeName) const {
+      std::map<std::string,int>::const_iterator p = m_typeInd.find(typeName);
+      ATALWAYS(p != m_typeInd.end(),"Unknown CHARMM atom type: " + typeName);
+      return p->second;
+    }
+
+  protected:
+
+    void addAtom(const std::string& resName, const std::string& atomName, const std::string& typeName) {
+      m_atomType[resName + ":" + atomName] = typeIndex(typeName);
+      m_residues[resName] = 1;
+    }
+
+    typedef std::map<std::string,int> AtomTypes;
+
+    AtomTypes m_atomType;
+
+    std::map<std::string,int> m_residues;
+
+    std::map<std::string,int> m_typeInd;
+
+  }; // class CharmmHeavyAtoms
+
+
+  // Accumulates the atoms of one or more molecules and writes them
+  // as a molforce file
+
+  template<typename T_num>
+  class MolForcePrep {
+
+  public:
+
+    typedef typename Types<T_num>::Points Points;
+
+    explicit MolForcePrep(T_num alpha):
+      m_alpha(alpha),
+      m_nSkipped(0),
+      m_nByElement(0)
+    {}
+
+    // Add a molecule from the ATOM and HETATM records 'records'. Return the number
+    // of atoms that made it into the molecule.
+
+    int addMolecule(const std::vector<PDBPP::PDB>& records) {
+
+      int start = numAtoms();
+
+      int n = int(records.size());
+
+      // first and last residue of each chain get the terminal patches
+
+      std::vector<int> term(n,int(CharmmHeavyAtoms::midChain));
+
+      int i_first = 0;
+
+      for(int i = 0; i <= n; i++) {
+	if( i == n || records[i].atom.residue.chainId != records[i_first].atom.residue.chainId ) {
+	  if( i > i_first ) {
+	    markResidue(records,term,i_first,i_first,i,CharmmHeavyAtoms::nTerm);
+	    markResidue(records,term,i-1,i_first,i,CharmmHeavyAtoms::cTerm);
+	  }
+	  i_first = i;
+	}
+      }
+
+      for(int i = 0; i < n; i++) {
+
+	const PDBPP::PDB::Atom& atom = records[i].atom;
+
+	if( ! ( atom.altLoc == ' ' || atom.altLoc == 'A' || atom.altLoc == '\0' ) ) {
+	  continue;
+	}
+
+	std::string atomName = trim(atom.name), resName = trim(atom.residue.name);
+
+	if( atomName.empty() || isHydrogen(atom.name) || resName == "HOH" || resName == "WAT" ) {
+	  continue;
+	}
+
+	int iType = m_ff.typeIndex(resName,atomName,term[i]);
+
+	if( iType < 0 ) {
+	  m_nSkipped++;
+	  ATLOG_OUT_2("Skipping atom not in the topology: " << resName << " " << atomName);
+	  continue;
+	}
+
+	if( ! m_ff.isStandard(resName) ) {
+	  m_nByElement++;
+	}
+
+	const CharmmAtomType& t = CharmmHeavyAtoms::types()[iType];
+
+	for(int k = 0; k < 3; k++) {
+	  m_pos.push_back(T_num(atom.xyz[k]));
+	}
+	m_mass.push_back(T_num(t.mass));
+	m_eps.push_back(T_num(-4.184 * t.eps));
+	m_sigma.push_back(T_num(2. * std::pow(2.,-1./6) * t.rMinHalf));
+
+      }
+
+      m_offsets.push_back(start);
+      m_offsets.push_back(numAtoms());
+
+      return numAtoms() - start;
+
+    }
+
+    int addPdbFile(const std::string& fileName) {
+      std::vector<PDBPP::PDB> records;
+      Points coords;
+      loadPdbAtoms<T_num>(fileName,records,coords,true);
+      int n = addMolecule(records);
+      ATALWAYS(n > 0,"No atoms with force field parameters in PDB file: " + fileName);
+      return n;
+    }
+
+    int numMolecules() const {
+      return int(m_offsets.size()/2);
+    }
+
+    int numAtoms() const {
+      return int(m_mass.size());
+    }
+
+    // atoms dropped because they are not in the topology of their residue
+    int numSkipped() const {
+      return m_nSkipped;
+    }
+
+    // atoms of non-standard residues typed by their element
+    int numByElement() const {
+      return m_nByElement;
+    }
+
+    void write(const std::string& fileName) const {
+
+      using namespace blitz;
+
+      int n = numAtoms(), nMol = numMolecules();
+
+      Array<int,2> offsets(nMol,2);
+      for(int i = 0; i < nMol; i++) {
+	offsets(i,0) = m_offsets[2*i];
+	offsets(i,1) = m_offsets[2*i+1];
+      }
+
+      Array<T_num,2> pos(n,3);
+      Array<T_num,1> mass(n), eps(n), sigma(n), alpha(n);
+
+      for(int i = 0; i < n; i++) {
+	for(int k = 0; k < 3; k++) {
+	  pos(i,k) = m_pos[3*i+k];
+	}
+	mass(i) = m_mass[i];
+	eps(i) = m_eps[i];
+	sigma(i) = m_sigma[i];
+      }
+
+      alpha = m_alpha;
+
+      Hdf5::HDF5File out(fileName,Hdf5::HDF5File::trunc);
+
+      out.setAttribute("/","mix",int(1));
+      out.setArray("mol_offsets",offsets);
+      out.setArray("pos",pos);
+      out.setArray("mass",mass);
+      out.setArray("eps",eps);
+      out.setArray("sigma",sigma);
+      out.setArray("alpha",alpha);
+
+    }
+
+  protected:
+
+    static std::string trim(const char *s) {
+      while( *s == ' ' ) {
+	s++;
+      }
+      std::string ret(s);
+      while( ! ret.empty() && ret[ret.size()-1] == ' ' ) {
+	ret.erase(ret.size()-1);
+      }
+      return ret;
+    }
+
+    // Pdb++ keeps the leading space of the atom name, so the element
+    // starts at the first character (after a digit in the old "1HB" style
+    // names) - " HA", "1HB", "HG21"
+
+    static bool isHydrogen(const char *name) {
+      const char *s = name;
+      while( *s == ' ' || std::isdigit(*s) ) {
+	s++;
+      }
+      return *s == 'H' || *s == 'D';
+    }
+
+    // Set 'flag' on the atoms of the residue of 'i_atom'. The atoms of a
+    // residue are contiguous, so only the neighbours of 'i_atom' within
+    // the chain [i_begin,i_end) are looked at.
+
+    static void markResidue(const std::vector<PDBPP::PDB>& records,
+			    std::vector<int>& term,
+			    int i_atom,
+			    int i_begin,
+			    int i_end,
+			    int flag) {
+      const PDBPP::PDB::Residue& res = records[i_atom].atom.residue;
+      for(int i = i_atom; i >= i_begin && sameResidue(records[i].atom.residue,res); i--) {
+	term[i] |= flag;
+      }
+      for(int i = i_atom + 1; i < i_end && sameResidue(records[i].atom.residue,res); i++) {
+	term[i] |= flag;
+      }
+    }
+
+    static bool sameResidue(const PDBPP::PDB::Residue& r1, const PDBPP::PDB::Residue& r2) {
+      return r1.chainId == r2.chainId && r1.seqNum == r2.seqNum && r1.insertCode == r2.insertCode;
+    }
+
+    CharmmHeavyAtoms m_ff;
+
+    T_num m_alpha;
+
+    std::vector<int> m_offsets;
+
+    std::vector<T_num> m_pos, m_mass, m_eps, m_sigma;
+
+    int m_nSkipped;
+
+    int m_nByElement;
+
+  }; // class MolForcePrep
+
+
+} // namespace PRODDL
+
+#endif // PRODDL_IO_MOLFORCE_PREP_H__
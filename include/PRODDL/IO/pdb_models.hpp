@@ -0,0 +1,432 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#ifndef PRODDL_IO_PDB_MODELS_H__
+#define PRODDL_IO_PDB_MODELS_H__
+
+// Fast writer of rigid body docking models as multi-model (NMR style) PDB files.
+//
+// The text of every receptor and ligand record is formatted only once with the
+// Pdb++ writer and kept as a template. For each model, only the coordinate
+// columns of the ligand atoms are overwritten with a fixed-point formatter.
+// Models are formatted in parallel into separate buffers, which are then
+// written out in the model order.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <fstream>
+#include <mutex>
+#include <condition_variable>
+
+#include "PRODDL/types.hpp"
+
+#include "PRODDL/exceptions.hpp"
+
+#include "PRODDL/Common/debug.hpp"
+
+#include "PRODDL/Common/parallel.hpp"
+
+#include "PRODDL/External/Pdb++/pdb++.hpp"
+
+namespace PRODDL {
+
+
+  // Write 'x' into exactly 8 characters at 'dst' the way printf("%8.3f") does,
+  // including the sign of negative zero and of negative values that round to zero.
+  // Rounding is done on x*1000 in double precision, so a value lying
+  // exactly half way between two decimals can come out one unit in the last
+  // digit different from printf.
+  // Returns false (and leaves 'dst' untouched) if the value does not fit
+  // into the field.
+
+  inline bool formatPdbCoord(char *dst, double x) {
+
+    bool neg = std::signbit(x);
+
+    double ax = std::fabs(x);
+
+    // also catches NaN
+    if( ! (ax < 1e7) ) {
+      return false;
+    }
+
+    long long m = (long long)(ax * 1000. + 0.5);
+
+    if( m >= (neg ? 1000000LL : 10000000LL) ) {
+      return false;
+    }
+
+    char tmp[8];
+
+    int pos = 8;
+
+    for(int k = 0; k < 3; k++) {
+      tmp[--pos] = char('0' + m % 10);
+      m /= 10;
+    }
+
+    tmp[--pos] = '.';
+
+    do {
+      tmp[--pos] = char('0' + m % 10);
+      m /= 10;
+    } while( m > 0 );
+
+    if( neg ) {
+      tmp[--pos] = '-';
+    }
+
+    while( pos > 0 ) {
+      tmp[--pos] = ' ';
+    }
+
+    std::memcpy(dst,tmp,8);
+
+    return true;
+
+  }
+
+
+  // Read ATOM records of a PDB file (up to the first END record) into
+  // 'records', and their coordinates into 'coords'. HETATM records are
+  // read too if 'withHetatm' is true.
+
+  template<typename T_num>
+  void loadPdbAtoms(const std::string& fileName,
+		    std::vector<PDBPP::PDB>& records,
+		    typename Types<T_num>::Points& coords,
+		    bool withHetatm = false) {
+
+    typedef typename Types<T_num>::Point Point;
+
+    records.clear();
+
+    std::ifstream file_in(fileName.c_str());
+
+    ATALWAYS( file_in.good(),"Unable to open input pdb file: " + fileName);
+
+    PDBPP::PDB record;
+
+    bool cont = true;
+
+    while (cont && file_in >> record) {
+      switch (record.type()) {
+
+      case PDBPP::PDB::ATOM:
+	records.push_back(record);
+	break;
+
+      case PDBPP::PDB::HETATM:
+	if( withHetatm ) {
+	  records.push_back(record);
+	}
+	break;
+
+      case PDBPP::PDB::END:
+	//allow for format extensions that add stuff after the END (e.g. Rosetta)
+	cont = false;
+	break;
+
+      default:
+	break;
+      }
+    }
+
+    coords.resize(records.size());
+
+    for(int i = 0; i < int(records.size()); i++) {
+
+      const PDBPP::PDB& r = records[i];
+
+      Point& c = coords(i);
+
+      c(0) = r.atom.xyz[0];
+      c(1) = r.atom.xyz[1];
+      c(2) = r.atom.xyz[2];
+
+    }
+
+  }
+
+
+  // Number residues of 'records' sequentially from 0, in the order they
+  // appear. A new residue starts where the chain, sequence number or
+  // insertion code changes. Return the number of residues.
+
+  inline int pdbResidueIndex(const std::vector<PDBPP::PDB>& records,
+			     common_types::num_vector_type<int>::Type& resInd) {
+
+    resInd.resize(records.size());
+
+    int n = 0;
+
+    for(int i = 0; i < int(records.size()); i++) {
+      const PDBPP::PDB::Residue& r = records[i].atom.residue;
+      if( i > 0 ) {
+	const PDBPP::PDB::Residue& p = records[i-1].atom.residue;
+	if( r.chainId != p.chainId || r.seqNum != p.seqNum || r.insertCode != p.insertCode ) {
+	  n++;
+	}
+      }
+      resInd(i) = n;
+    }
+
+    return records.empty() ? 0 : n + 1;
+
+  }
+
+
+  template<typename T_num>
+  class PdbModelWriter {
+
+  public:
+
+    typedef Types<T_num> TypesT;
+    typedef typename TypesT::Point Point;
+    typedef typename TypesT::Points Points;
+    typedef typename TypesT::RotationTranslation RotationTranslation;
+    typedef typename TypesT::RotTranValue RotTranValue;
+
+    // First column of the X coordinate in ATOM/HETATM records (0-based)
+
+    enum { COORD_COL = 30, COORD_WIDTH = 8 };
+
+  public:
+
+    // 'recordsRec' and 'recordsLig' are ATOM (or HETATM) records of the receptor
+    // and ligand. Ligand coordinates for the models are computed from 'coordsLig'
+    // (not from the records), so that the rounding of the input file does not
+    // accumulate.
+
+    PdbModelWriter(const std::vector<PDBPP::PDB>& recordsRec,
+		   const std::vector<PDBPP::PDB>& recordsLig,
+		   const Points& coordsLig) {
+
+      ATALWAYS(coordsLig.rows() == int(recordsLig.size()),
+	       "Number of ligand coordinates does not match the number of records");
+
+      m_coordsLig.reference(coordsLig.copy());
+
+      // receptor coordinates are never patched, so its records are taken as they are
+
+      makeTemplate(recordsRec,m_recText);
+
+      makeTemplate(recordsLig,m_ligText,&m_ligCoordPos);
+
+    }
+
+    // Text of the receptor records followed by TER
+
+    const std::string& receptorText() const {
+      return m_recText;
+    }
+
+    // Append the text of one model to 'buf'. The receptor records are
+    // included only if 'withReceptor' is true.
+
+    void formatModel(int modelNum,
+		     const RotationTranslation& tran,
+		     bool withReceptor,
+		     std::string& buf) const {
+
+      char head[32];
+
+      int nHead = std::sprintf(head,"MODEL    %5d\n",modelNum);
+
+      buf.append(head,nHead);
+
+      if( withReceptor ) {
+	buf += m_recText;
+      }
+
+      size_t start = buf.size();
+
+      buf += m_ligText;
+
+      char *text = &buf[start];
+
+      for(int i_at = 0; i_at < m_coordsLig.rows(); i_at++) {
+	Point c = tran(m_coordsLig(i_at));
+	char *field = text + m_ligCoordPos[i_at];
+	for(int k = 0; k < 3; k++) {
+	  if( ! formatPdbCoord(field + k*COORD_WIDTH, c(k)) ) {
+	    throw io_error("Model coordinate does not fit into PDB format field");
+	  }
+	}
+      }
+
+      buf += "ENDMDL\n";
+
+    }
+
+    // Write models 'models[0,nModels)' numbered from 'modelNumStart'.
+    // The models are split into chunks of 'chunkSize', and chunk 'i' is
+    // formatted by thread 'i % nThreads' into its own buffer. The threads are
+    // started once; each one writes its buffer to 'out' when the previous
+    // chunk has been written, so the output is in the model order and does
+    // not depend on the number of threads. Only one chunk per thread is held
+    // in memory.
+
+    void writeModels(std::ostream& out,
+		     const std::vector<RotTranValue>& models,
+		     int modelNumStart,
+		     bool withReceptor,
+		     int nThreads,
+		     int chunkSize = 64) const {
+
+      int nModels = models.size();
+
+      int nChunks = (nModels + chunkSize - 1) / chunkSize;
+
+      nThreads = std::max(1,std::min(Parallel::resolveThreads(nThreads),nChunks));
+
+      size_t modelSize = m_ligText.size() + (withReceptor ? m_recText.size() : 0) + 32;
+
+      std::mutex mtx;
+
+      std::condition_variable written;
+
+      // next chunk to write, and whether any thread has failed
+
+      int nextChunk = 0;
+
+      bool failed = false;
+
+      Parallel::runThreads(nThreads,[&](int i_thr) {
+
+	  std::string buf;
+
+	  buf.reserve(modelSize*chunkSize);
+
+	  try {
+
+	    for(int i_chunk = i_thr; i_chunk < nChunks; i_chunk += nThreads) {
+
+	      buf.clear();
+
+	      int i_start = i_chunk*chunkSize;
+	      int i_end = std::min(i_start + chunkSize,nModels);
+
+	      for(int i_mod = i_start; i_mod < i_end; i_mod++) {
+		formatModel(modelNumStart + i_mod,models[i_mod].tran,withReceptor,buf);
+	      }
+
+	      std::unique_lock<std::mutex> lock(mtx);
+
+	      written.wait(lock,[&]() { return failed || nextChunk == i_chunk; });
+
+	      if( failed ) {
+		return;
+	      }
+
+	      out.write(buf.data(),buf.size());
+
+	      if( ! out ) {
+		throw io_error("Error when writing PDB models");
+	      }
+
+	      nextChunk++;
+
+	      written.notify_all();
+
+	    }
+
+	  }
+	  catch(...) {
+	    // release the threads waiting for the chunks of this one
+	    std::lock_guard<std::mutex> lock(mtx);
+	    failed = true;
+	    written.notify_all();
+	    throw;
+	  }
+
+	});
+
+    }
+
+  protected:
+
+    // Format 'records' followed by a TER record into 'text'. If 'coordPos'
+    // is given, store there the offset of the coordinate field of each record,
+    // after checking that the coordinates are where formatModel() patches them.
+
+    static void makeTemplate(const std::vector<PDBPP::PDB>& records,
+			     std::string& text,
+			     std::vector<int> *coordPos = 0) {
+
+      text.clear();
+
+      if( coordPos ) {
+	coordPos->resize(records.size());
+      }
+
+      for(size_t i_rec = 0; i_rec < records.size(); i_rec++) {
+
+	const PDBPP::PDB& r = records[i_rec];
+
+	std::string line(r.chars());
+
+	if( coordPos ) {
+
+	  // Columns can shift if some field overflows its width (e.g. serial
+	  // number over 99999), in which case we cannot patch this record
+
+	  bool ok = line.size() >= COORD_COL + 3*COORD_WIDTH;
+
+	  for(int k = 0; ok && k < 3; k++) {
+	    std::string field = line.substr(COORD_COL + k*COORD_WIDTH,COORD_WIDTH);
+	    char *end = 0;
+	    double x = std::strtod(field.c_str(),&end);
+	    ok = ( end != field.c_str() && std::abs(x - r.atom.xyz[k]) < 1e-3 );
+	  }
+
+	  if( ! ok ) {
+	    throw io_error("PDB record has non-standard column layout: " + line);
+	  }
+
+	  (*coordPos)[i_rec] = text.size() + COORD_COL;
+
+	}
+
+	text += line;
+	text += '\n';
+
+      }
+
+      if( ! records.empty() ) {
+	PDBPP::PDB rec_ter(PDBPP::PDB::TER);
+	const PDBPP::PDB& r = records.back();
+	rec_ter.ter.serialNum = r.atom.serialNum;
+	rec_ter.ter.residue = r.atom.residue;
+	text += rec_ter.chars();
+	text += '\n';
+      }
+
+    }
+
+  protected:
+
+    std::string m_recText;
+
+    std::string m_ligText;
+
+    std::vector<int> m_ligCoordPos;
+
+    Points m_coordsLig;
+
+  }; // class PdbModelWriter
+
+
+} // namespace PRODDL
+
+#endif // PRODDL_IO_PDB_MODELS_H__
@@ -0,0 +1,387 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#ifndef PRODDL_IO_POSE_ENSEMBLE_H__
+#define PRODDL_IO_POSE_ENSEMBLE_H__
+
+// Binary stream of ligand poses (a trajectory-like file).
+//
+// Layout (native byte order, like the IORigid binary format):
+//
+//   Int_IO    signature
+//   Int_IO    version
+//   Int_IO    nAtoms
+//   Int_IO    nFrames
+//   long long topologySize
+//   char      topology[topologySize]   - PDB text of the ligand records
+//   padding to a multiple of FRAME_ALIGN bytes
+//   nFrames x frame, where frame is
+//     T_IO_num value                    - score of the pose
+//     T_IO_num ang[3], xyz[3]           - transformation as in IORigid
+//     T_IO_num coords[nAtoms][3]        - transformed ligand coordinates
+//     padding to a multiple of FRAME_ALIGN bytes
+//
+// All frames have the same size, so frame i starts at the FRAME_ALIGN
+// aligned offset framesOffset() + i*frameSize() and can be read (or mapped)
+// directly.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "PRODDL/types.hpp"
+
+#include "PRODDL/exceptions.hpp"
+
+namespace PRODDL {
+
+
+  template<typename T_num>
+  class PoseEnsembleFormat {
+
+  public:
+
+    enum { SIGNATURE = 2013061701, VERSION = 2, FRAME_ALIGN = 16, FRAME_HEAD = 7 };
+
+    typedef float T_IO_num;
+
+    typedef int Int_IO;
+
+    typedef Types<T_num> TypesT;
+
+    typedef typename TypesT::Point Point;
+
+    typedef typename TypesT::Points Points;
+
+    typedef typename TypesT::RotationTranslation RotationTranslation;
+
+    static long long headerSize(long long topologySize) {
+      return 4*sizeof(Int_IO) + sizeof(long long) + topologySize;
+    }
+
+    static long long framesOffset(long long topologySize) {
+      long long size = headerSize(topologySize);
+      return (size + FRAME_ALIGN - 1) / FRAME_ALIGN * FRAME_ALIGN;
+    }
+
+    // Size of a frame with its padding
+
+    static long long frameSize(int nAtoms) {
+      long long size = (FRAME_HEAD + 3*(long long)nAtoms) * sizeof(T_IO_num);
+      return (size + FRAME_ALIGN - 1) / FRAME_ALIGN * FRAME_ALIGN;
+    }
+
+  }; // class PoseEnsembleFormat
+
+
+  template<typename T_num>
+  class PoseEnsembleWriter : public PoseEnsembleFormat<T_num> {
+
+  public:
+
+    typedef PoseEnsembleFormat<T_num> Format;
+    typedef typename Format::T_IO_num T_IO_num;
+    typedef typename Format::Int_IO Int_IO;
+    typedef typename Format::Point Point;
+    typedef typename Format::Points Points;
+    typedef typename Format::RotationTranslation RotationTranslation;
+
+    // Size of the stdio buffer - frames are written sequentially
+    // in large blocks
+
+    enum { BUFFER_SIZE = 1 << 22 };
+
+  public:
+
+    PoseEnsembleWriter() : m_f(0), m_nAtoms(0), m_nFrames(0), m_nWritten(0) {}
+
+    ~PoseEnsembleWriter() {
+      if( m_f ) {
+	std::fclose(m_f);
+      }
+    }
+
+    // Create the file and write the header. Exactly 'nFrames' frames
+    // must be written before calling close().
+
+    void open(const std::string& fileName,
+	      const std::string& topology,
+	      int nAtoms,
+	      int nFrames) {
+
+      m_fileName = fileName;
+
+      m_f = std::fopen(fileName.c_str(), "wb");
+
+      if( ! m_f ) {
+	throw io_error("Cannot open file for writing: " + fileName);
+      }
+
+      m_buffer.resize(BUFFER_SIZE);
+
+      std::setvbuf(m_f,&m_buffer[0],_IOFBF,m_buffer.size());
+
+      m_nAtoms = nAtoms;
+      m_nFrames = nFrames;
+      m_nWritten = 0;
+
+      Int_IO head[4] = { Int_IO(Format::SIGNATURE), Int_IO(Format::VERSION),
+			 Int_IO(nAtoms), Int_IO(nFrames) };
+
+      long long topologySize = topology.size();
+
+      _write(head,sizeof(head));
+
+      _write(&topologySize,sizeof(topologySize));
+
+      _write(topology.data(),topology.size());
+
+      long long nPad = Format::framesOffset(topologySize) - Format::headerSize(topologySize);
+
+      char pad[Format::FRAME_ALIGN] = { 0 };
+
+      _write(pad,nPad);
+
+      // the elements past the coordinates are the padding, and stay zero
+
+      m_frame.assign(Format::frameSize(nAtoms) / sizeof(T_IO_num),T_IO_num(0));
+
+    }
+
+    // Write one pose. 'coords' are the already transformed coordinates.
+
+    void writeFrame(T_num value, const RotationTranslation& tran, const Points& coords) {
+
+      if( coords.rows() != m_nAtoms ) {
+	throw size_error("Number of atoms in a pose does not match the header of: " + m_fileName);
+      }
+
+      if( m_nWritten >= m_nFrames ) {
+	throw size_error("More frames than declared in the header of: " + m_fileName);
+      }
+
+      Point ang, xyz;
+
+      tran.anglesAndDisplacement(ang,xyz);
+
+      T_IO_num *p = &m_frame[0];
+
+      *p++ = T_IO_num(value);
+
+      for(int k = 0; k < 3; k++) {
+	*p++ = T_IO_num(ang(k));
+      }
+
+      for(int k = 0; k < 3; k++) {
+	*p++ = T_IO_num(xyz(k));
+      }
+
+      for(int i_at = 0; i_at < m_nAtoms; i_at++) {
+	const Point& c = coords(i_at);
+	*p++ = T_IO_num(c(0));
+	*p++ = T_IO_num(c(1));
+	*p++ = T_IO_num(c(2));
+      }
+
+      _write(&m_frame[0],m_frame.size()*sizeof(T_IO_num));
+
+      m_nWritten++;
+
+    }
+
+    void close() {
+
+      if( ! m_f ) {
+	return;
+      }
+
+      int status = std::fclose(m_f);
+
+      m_f = 0;
+
+      if( status != 0 ) {
+	throw io_error("Error when closing file: " + m_fileName);
+      }
+
+      if( m_nWritten != m_nFrames ) {
+	throw size_error("Number of written frames does not match the header of: " + m_fileName);
+      }
+
+    }
+
+  protected:
+
+    void _write(const void *data, size_t size) {
+      if( size > 0 && std::fwrite(data,1,size,m_f) != size ) {
+	throw io_error("Error when writing to file: " + m_fileName);
+      }
+    }
+
+  protected:
+
+    std::FILE *m_f;
+
+    std::string m_fileName;
+
+    std::vector<char> m_buffer;
+
+    std::vector<T_IO_num> m_frame;
+
+    int m_nAtoms, m_nFrames, m_nWritten;
+
+  }; // class PoseEnsembleWriter
+
+
+  template<typename T_num>
+  class PoseEnsembleReader : public PoseEnsembleFormat<T_num> {
+
+  public:
+
+    typedef PoseEnsembleFormat<T_num> Format;
+    typedef typename Format::T_IO_num T_IO_num;
+    typedef typename Format::Int_IO Int_IO;
+    typedef typename Format::Point Point;
+    typedef typename Format::Points Points;
+    typedef typename Format::RotationTranslation RotationTranslation;
+
+  public:
+
+    PoseEnsembleReader() : m_f(0), m_nAtoms(0), m_nFrames(0), m_framesOffset(0) {}
+
+    ~PoseEnsembleReader() {
+      if( m_f ) {
+	std::fclose(m_f);
+      }
+    }
+
+    void open(const std::string& fileName) {
+
+      m_fileName = fileName;
+
+      m_f = std::fopen(fileName.c_str(), "rb");
+
+      if( ! m_f ) {
+	throw io_error("Cannot open file for reading: " + fileName);
+      }
+
+      Int_IO head[4];
+
+      long long topologySize = 0;
+
+      _read(head,sizeof(head));
+
+      if( head[0] != Int_IO(Format::SIGNATURE) || head[1] != Int_IO(Format::VERSION) ) {
+	throw io_error("Format signature mismatch for pose ensemble file: " + fileName);
+      }
+
+      m_nAtoms = head[2];
+      m_nFrames = head[3];
+
+      _read(&topologySize,sizeof(topologySize));
+
+      if( m_nAtoms < 0 || m_nFrames < 0 || topologySize < 0 ) {
+	throw io_error("Corrupted header of pose ensemble file: " + fileName);
+      }
+
+      m_topology.resize(topologySize);
+
+      if( topologySize > 0 ) {
+	_read(&m_topology[0],topologySize);
+      }
+
+      m_framesOffset = Format::framesOffset(topologySize);
+
+      m_frame.resize(Format::frameSize(m_nAtoms) / sizeof(T_IO_num));
+
+    }
+
+    int nAtoms() const {
+      return m_nAtoms;
+    }
+
+    int nFrames() const {
+      return m_nFrames;
+    }
+
+    const std::string& topology() const {
+      return m_topology;
+    }
+
+    // Byte offset of the frame 'i' in the file
+
+    long long frameOffset(int i) const {
+      return m_framesOffset + i * Format::frameSize(m_nAtoms);
+    }
+
+    void readFrame(int i, T_num& value, RotationTranslation& tran, Points& coords) {
+
+      if( i < 0 || i >= m_nFrames ) {
+	throw size_error("Frame index is out of range for file: " + m_fileName);
+      }
+
+      if( std::fseek(m_f,frameOffset(i),SEEK_SET) != 0 ) {
+	throw io_error("Error when seeking in file: " + m_fileName);
+      }
+
+      _read(&m_frame[0],m_frame.size()*sizeof(T_IO_num));
+
+      const T_IO_num *p = &m_frame[0];
+
+      value = *p++;
+
+      Point ang, xyz;
+
+      for(int k = 0; k < 3; k++) {
+	ang(k) = *p++;
+      }
+
+      for(int k = 0; k < 3; k++) {
+	xyz(k) = *p++;
+      }
+
+      tran = RotationTranslation(ang,xyz);
+
+      coords.resize(m_nAtoms);
+
+      for(int i_at = 0; i_at < m_nAtoms; i_at++) {
+	Point& c = coords(i_at);
+	c(0) = *p++;
+	c(1) = *p++;
+	c(2) = *p++;
+      }
+
+    }
+
+  protected:
+
+    void _read(void *data, size_t size) {
+      if( std::fread(data,1,size,m_f) != size ) {
+	throw io_error("Error when reading from file: " + m_fileName);
+      }
+    }
+
+  protected:
+
+    std::FILE *m_f;
+
+    std::string m_fileName;
+
+    std::string m_topology;
+
+    std::vector<T_IO_num> m_frame;
+
+    int m_nAtoms, m_nFrames;
+
+    long long m_framesOffset;
+
+  }; // class PoseEnsembleReader
+
+
+} // namespace PRODDL
+
+#endif // PRODDL_IO_POSE_ENSEMBLE_H__
@@ -0,0 +1,265 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#ifndef PRODDL_IO_POSE_ENSEMBLE_HDF5_H__
+#define PRODDL_IO_POSE_ENSEMBLE_HDF5_H__
+
+// HDF5 version of the pose ensemble (see pose_ensemble.hpp).
+// Layout:
+//   /topology  - string, PDB text of the ligand records
+//   /score     - float[nFrames]
+//   /transform - float[nFrames][6], angles and displacement as in IORigid
+//   /coords    - float[nFrames][nAtoms][3], transformed ligand coordinates
+// Attributes of "/": nAtoms, nFrames.
+// The number of frames is known in open(), so the datasets are created with
+// their final size and contiguous layout. Frames are buffered and written in
+// blocks of about 'blockBytes' (constructor argument, 4M by default) of
+// coordinates, one hyperslab per dataset and block, instead of extending the
+// datasets one frame at a time.
+
+#include <string>
+#include <algorithm>
+
+#include <hdf5.h>
+
+#include "PRODDL/IO/hdf5.hpp"
+
+#include "PRODDL/IO/hdf5_mmap.hpp"
+
+#include "PRODDL/IO/pose_ensemble.hpp"
+
+namespace PRODDL {
+
+
+  template<typename T_num>
+  class PoseEnsembleHdf5Writer {
+
+  public:
+
+    typedef PoseEnsembleFormat<T_num> Format;
+    typedef typename Format::T_IO_num T_IO_num;
+    typedef typename Format::Point Point;
+    typedef typename Format::Points Points;
+    typedef typename Format::RotationTranslation RotationTranslation;
+
+  public:
+
+    explicit PoseEnsembleHdf5Writer(long blockBytes = 4 << 20) :
+      m_fileId(-1), m_blockBytes(blockBytes),
+      m_nAtoms(0), m_nFrames(0), m_nWritten(0), m_nBuffered(0), m_blockFrames(0) {
+      for(int i = 0; i < nDsets; i++) {
+	m_dsetId[i] = -1;
+      }
+    }
+
+    ~PoseEnsembleHdf5Writer() {
+      closeHandles();
+    }
+
+    // Same contract as PoseEnsembleWriter::open()
+
+    void open(const std::string& fileName,
+	      const std::string& topology,
+	      int nAtoms,
+	      int nFrames) {
+
+      m_fileName = fileName;
+
+      m_nAtoms = nAtoms;
+      m_nFrames = nFrames;
+      m_nWritten = 0;
+      m_nBuffered = 0;
+
+      {
+	Hdf5::HDF5File out(fileName,Hdf5::HDF5File::trunc);
+
+	out.set("topology",topology);
+
+	out.setAttribute("/","nAtoms",nAtoms);
+
+	out.setAttribute("/","nFrames",nFrames);
+      }
+
+      m_fileId = H5Fopen(fileName.c_str(),H5F_ACC_RDWR,H5P_DEFAULT);
+
+      if( m_fileId < 0 ) {
+	throw io_error("Cannot open file for writing: " + fileName);
+      }
+
+      hsize_t dims[3] = { hsize_t(nFrames), hsize_t(nAtoms), 3 };
+
+      createDataset(iScore,"score",dims,1);
+
+      dims[1] = 6;
+
+      createDataset(iTransform,"transform",dims,2);
+
+      dims[1] = hsize_t(nAtoms);
+
+      createDataset(iCoords,"coords",dims,3);
+
+      long frameBytes = long(3*sizeof(T_IO_num))*std::max(1,nAtoms);
+
+      m_blockFrames = int(std::max(1L,std::min(long(nFrames),m_blockBytes / frameBytes)));
+
+      m_score.resize(m_blockFrames);
+
+      m_transform.resize(m_blockFrames,6);
+
+      m_coords.resize(m_blockFrames,nAtoms,3);
+
+    }
+
+    void writeFrame(T_num value, const RotationTranslation& tran, const Points& coords) {
+
+      if( coords.rows() != m_nAtoms ) {
+	throw size_error("Number of atoms in a pose does not match the header of: " + m_fileName);
+      }
+
+      if( m_nWritten + m_nBuffered >= m_nFrames ) {
+	throw size_error("More frames than declared in the header of: " + m_fileName);
+      }
+
+      Point ang, xyz;
+
+      tran.anglesAndDisplacement(ang,xyz);
+
+      int i_buf = m_nBuffered;
+
+      m_score(i_buf) = T_IO_num(value);
+
+      for(int k = 0; k < 3; k++) {
+	m_transform(i_buf,k) = T_IO_num(ang(k));
+	m_transform(i_buf,k+3) = T_IO_num(xyz(k));
+      }
+
+      for(int i_at = 0; i_at < m_nAtoms; i_at++) {
+	for(int k = 0; k < 3; k++) {
+	  m_coords(i_buf,i_at,k) = T_IO_num(coords(i_at)(k));
+	}
+      }
+
+      if( ++m_nBuffered == m_blockFrames ) {
+	flush();
+      }
+
+    }
+
+    void close() {
+
+      if( m_fileId < 0 ) {
+	return;
+      }
+
+      flush();
+
+      if( ! closeHandles() ) {
+	throw io_error("Error when closing file: " + m_fileName);
+      }
+
+      if( m_nWritten != m_nFrames ) {
+	throw size_error("Number of written frames does not match the header of: " + m_fileName);
+      }
+
+    }
+
+  protected:
+
+    enum { iScore, iTransform, iCoords, nDsets };
+
+    void createDataset(int iDset, const char *name, const hsize_t *dims, int rank) {
+      hid_t space = H5Screate_simple(rank,dims,0);
+      m_dsetId[iDset] = H5Dcreate2(m_fileId,name,Hdf5NativeType<T_IO_num>::get(),space,
+				   H5P_DEFAULT,H5P_DEFAULT,H5P_DEFAULT);
+      H5Sclose(space);
+      if( m_dsetId[iDset] < 0 ) {
+	throw io_error(std::string("Cannot create dataset ") + name + " in file: " + m_fileName);
+      }
+    }
+
+    // Write the rows [0,m_nBuffered) of 'buf' into the rows starting
+    // at m_nWritten of the dataset 'iDset'
+
+    template<int N>
+    void writeBlock(int iDset, const blitz::Array<T_IO_num,N>& buf) {
+      hsize_t start[N], count[N];
+      for(int i = 0; i < N; i++) {
+	start[i] = 0;
+	count[i] = hsize_t(buf.extent(i));
+      }
+      start[0] = hsize_t(m_nWritten);
+      count[0] = hsize_t(m_nBuffered);
+      hid_t fileSpace = H5Dget_space(m_dsetId[iDset]);
+      hid_t memSpace = H5Screate_simple(N,count,0);
+      herr_t status = H5Sselect_hyperslab(fileSpace,H5S_SELECT_SET,start,0,count,0);
+      if( status >= 0 ) {
+	status = H5Dwrite(m_dsetId[iDset],Hdf5NativeType<T_IO_num>::get(),memSpace,fileSpace,
+			  H5P_DEFAULT,buf.data());
+      }
+      H5Sclose(memSpace);
+      H5Sclose(fileSpace);
+      if( status < 0 ) {
+	throw io_error("Error when writing to file: " + m_fileName);
+      }
+    }
+
+    // The buffers are C-ordered with the frames in the first dimension,
+    // so the first m_nBuffered frames are contiguous
+
+    void flush() {
+      if( m_nBuffered == 0 ) {
+	return;
+      }
+      writeBlock(iScore,m_score);
+      writeBlock(iTransform,m_transform);
+      writeBlock(iCoords,m_coords);
+      m_nWritten += m_nBuffered;
+      m_nBuffered = 0;
+    }
+
+    bool closeHandles() {
+      bool ok = true;
+      for(int i = 0; i < nDsets; i++) {
+	if( m_dsetId[i] >= 0 ) {
+	  ok = H5Dclose(m_dsetId[i]) >= 0 && ok;
+	  m_dsetId[i] = -1;
+	}
+      }
+      if( m_fileId >= 0 ) {
+	ok = H5Fclose(m_fileId) >= 0 && ok;
+	m_fileId = -1;
+      }
+      return ok;
+    }
+
+    hid_t m_fileId;
+
+    hid_t m_dsetId[nDsets];
+
+    long m_blockBytes;
+
+    std::string m_fileName;
+
+    blitz::Array<T_IO_num,1> m_score;
+
+    blitz::Array<T_IO_num,2> m_transform;
+
+    blitz::Array<T_IO_num,3> m_coords;
+
+    int m_nAtoms, m_nFrames, m_nWritten;
+
+    // frames held in the buffers, and their capacity
+
+    int m_nBuffered, m_blockFrames;
+
+  }; // class PoseEnsembleHdf5Writer
+
+
+} // namespace PRODDL
+
+#endif // PRODDL_IO_POSE_ENSEMBLE_HDF5_H__
@@ -0,0 +1,279 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#ifndef AT_MATH_FFT_SHAPE_H_
+#define AT_MATH_FFT_SHAPE_H_
+
+// Choice of the 3D FFT grid shape by the cost of the transforms rather than
+// by the first FFTW-friendly size along each axis (FFTW_Size::findBestSize()).
+//
+// A slightly larger size can be much faster (e.g. 64 vs 54 on some machines),
+// and because the last axis of a real-to-complex transform is halved,
+// it also matters which axis of the box goes last.
+
+#include <algorithm>
+
+#include <cmath>
+
+#include <fstream>
+
+#include <map>
+
+#include <string>
+
+#include <tuple>
+
+#include <vector>
+
+#include "PRODDL/Math/fft.hpp"
+
+#include "PRODDL/Common/common_types.hpp"
+
+#include "PRODDL/Common/debug.hpp"
+
+namespace PRODDL { namespace Math {
+
+
+  // Cost of a pair of forward and inverse in-place real-to-complex 3D FFTs
+  // (C order, the last axis is the halved one).
+  // Costs measured on this machine (seconds) are used as is. Other shapes
+  // get the cost from a rough model of the operation count (modelCost()),
+  // scaled by the median ratio of the measured to the model costs, so that
+  // the two kinds can be compared. Without any measurements, the cost is
+  // just the model one.
+
+  class FFTShapeCost {
+
+  public:
+
+    typedef common_types::point_type<int,3>::Type Shape;
+
+    FFTShapeCost():
+      scale(1)
+    {}
+
+    // Model cost of a 1D transform of length 'n' per point: the sum
+    // of the costs of its radix passes. The costs per prime radix are
+    // roughly log2(p) with a penalty for larger (less optimized) radices.
+
+    static double axisCost(int n) {
+      static const int primes[] = {2,3,5,7,11,13};
+      static const double weights[] = {1.,1.75,2.65,3.5,5.5,6.5};
+      double c = 0;
+      for(int i = 0; i < 6; i++) {
+	while( n > 1 && n % primes[i] == 0 ) {
+	  c += weights[i];
+	  n /= primes[i];
+	}
+      }
+      // other primes go through the generic O(n^2) codelet
+      if( n > 1 ) {
+	c += n;
+      }
+      return c;
+    }
+
+    // Model cost of the shape 'n' in the units of a radix-2 pass per point.
+    // The complex transforms along the first two axes run over the halved
+    // complex array, the real transform along the last one is about half
+    // the cost of a complex one. Each axis also adds a pass over memory.
+
+    static double modelCost(const Shape& n) {
+      double nCompl = double(n(0))*n(1)*(n(2)/2+1);
+      double nReal = double(n(0))*n(1)*n(2);
+      return nCompl*(axisCost(n(0)) + axisCost(n(1)) + 2*memPassCost) +
+	nReal*(axisCost(n(2))/2 + memPassCost);
+    }
+
+    void addMeasured(const Shape& n, double sec) {
+      measured[key(n)] = sec;
+      updateScale();
+    }
+
+    bool isMeasured(const Shape& n) const {
+      return measured.find(key(n)) != measured.end();
+    }
+
+    int nMeasured() const {
+      return int(measured.size());
+    }
+
+    double cost(const Shape& n) const {
+      Table::const_iterator p = measured.find(key(n));
+      if( p != measured.end() ) {
+	return p->second;
+      }
+      return scale*modelCost(n);
+    }
+
+    // Read the measured costs from a text file with lines 'nx ny nz seconds'.
+    // A missing file is not an error (there is nothing measured yet).
+    // Return the number of entries read.
+
+    int load(const std::string& fileName) {
+      std::ifstream inp(fileName.c_str());
+      int nRead = 0;
+      Shape n;
+      double sec;
+      while( inp >> n(0) >> n(1) >> n(2) >> sec ) {
+	measured[key(n)] = sec;
+	nRead++;
+      }
+      updateScale();
+      return nRead;
+    }
+
+    // Append one measured cost to the text file read by load()
+
+    static void append(const std::string& fileName, const Shape& n, double sec) {
+      std::ofstream out(fileName.c_str(),std::ios::app);
+      out << n(0) << " " << n(1) << " " << n(2) << " " << sec << "\n";
+      ATALWAYS(out.good(),("Failed to write FFT cost table: " + fileName).c_str());
+    }
+
+  protected:
+
+    typedef std::tuple<int,int,int> Key;
+
+    typedef std::map<Key,double> Table;
+
+    static Key key(const Shape& n) {
+      return Key(n(0),n(1),n(2));
+    }
+
+    void updateScale() {
+      std::vector<double> ratios;
+      for(Table::const_iterator p = measured.begin(); p != measured.end(); ++p) {
+	Shape n(std::get<0>(p->first),std::get<1>(p->first),std::get<2>(p->first));
+	ratios.push_back(p->second/modelCost(n));
+      }
+      if( ratios.empty() ) {
+	scale = 1;
+	return;
+      }
+      std::sort(ratios.begin(),ratios.end());
+      scale = ratios[ratios.size()/2];
+    }
+
+    static const int memPassCost = 2;
+
+    Table measured;
+
+    double scale;
+
+  }; // class FFTShapeCost
+
+
+  // One candidate FFT shape for a box
+
+  struct FFTShapePlan {
+
+    FFTShapeCost::Shape size;
+
+    // Cyclic shift of the box axes: axis j of 'size' covers
+    // axis (j + shift) % 3 of the original box. A cyclic permutation
+    // is a proper rotation, so the molecules can be rotated to match it.
+    int shift;
+
+    double cost;
+
+  };
+
+  typedef std::vector<FFTShapePlan> FFTShapePlans;
+
+
+  class FFTShapePlanner {
+
+  public:
+
+    typedef FFTShapeCost::Shape Shape;
+
+    // FFTW-friendly sizes (see FFTW_Size) from 'minN' up to 'minN*(1+maxGrowth)',
+    // at most 'maxCand' of them. The first FFTW-friendly size is always included.
+
+    static std::vector<int> candidateSizes(int minN, double maxGrowth, int maxCand) {
+      std::vector<int> sizes;
+      int n;
+      FFTW_Size::findBestSize(minN,n);
+      sizes.push_back(n);
+      int endN = int(std::ceil(minN*(1.+maxGrowth))) + 1;
+      int exponents[6];
+      while( int(sizes.size()) < maxCand &&
+	     FFTW_Size::findFirstPrimeFactoring(n+1,endN,exponents,n) ) {
+	sizes.push_back(n);
+      }
+      return sizes;
+    }
+
+    static Shape permute(const Shape& n, int shift) {
+      Shape ret;
+      for(int j = 0; j < 3; j++) {
+	ret(j) = n((j + shift) % 3);
+      }
+      return ret;
+    }
+
+    // All shapes not smaller than 'minSize', and with 'allowPermute' also
+    // for the cyclic permutations of the box axes. The costs are not set.
+
+    static FFTShapePlans candidates(const Shape& minSize, double maxGrowth, int maxCand, bool allowPermute) {
+      FFTShapePlans plans;
+      int nShifts = allowPermute ? 3 : 1;
+      for(int shift = 0; shift < nShifts; shift++) {
+	Shape minSizePerm = permute(minSize,shift);
+	std::vector<int> sizes[3];
+	for(int j = 0; j < 3; j++) {
+	  sizes[j] = candidateSizes(minSizePerm(j),maxGrowth,maxCand);
+	}
+	for(size_t i0 = 0; i0 < sizes[0].size(); i0++) {
+	  for(size_t i1 = 0; i1 < sizes[1].size(); i1++) {
+	    for(size_t i2 = 0; i2 < sizes[2].size(); i2++) {
+	      FFTShapePlan plan;
+	      plan.size = Shape(sizes[0][i0],sizes[1][i1],sizes[2][i2]);
+	      plan.shift = shift;
+	      plan.cost = 0;
+	      plans.push_back(plan);
+	    }
+	  }
+	}
+      }
+      return plans;
+    }
+
+    // Set the costs of 'plans' and sort them by the cost (ties go to the
+    // smaller volume and then to the lexicographically smaller shape, so
+    // that the same shape wins regardless of the order of candidates).
+
+    static void rank(FFTShapePlans& plans, const FFTShapeCost& cost) {
+      for(FFTShapePlans::iterator p = plans.begin(); p != plans.end(); ++p) {
+	p->cost = cost.cost(p->size);
+      }
+      std::sort(plans.begin(),plans.end(),less);
+    }
+
+  protected:
+
+    static bool less(const FFTShapePlan& x, const FFTShapePlan& y) {
+      if( x.cost != y.cost ) {
+	return x.cost < y.cost;
+      }
+      double vx = double(x.size(0))*x.size(1)*x.size(2);
+      double vy = double(y.size(0))*y.size(1)*y.size(2);
+      if( vx != vy ) {
+	return vx < vy;
+      }
+      return std::make_tuple(x.size(0),x.size(1),x.size(2)) <
+	std::make_tuple(y.size(0),y.size(1),y.size(2));
+    }
+
+  }; // class FFTShapePlanner
+
+
+} } // namespace PRODDL::Math
+
+#endif // AT_MATH_FFT_SHAPE_H_
@@ -52,11 +52,11 @@ namespace PRODDL {
 
       }
 
+      // no tracing here and in execute() - they are on the hot path
+
       Plan&
       get() {
 
-	dbg::trace t1(DBG_HERE);
-
 	return plan;
 
       }
@@ -65,8 +65,6 @@ namespace PRODDL {
       Plan&
       get() const {
 
-	dbg::trace t1(DBG_HERE);
-
 	return plan;
 
       }
@@ -101,8 +99,6 @@ namespace PRODDL {
     void
     execute() {
 
-      dbg::trace t1(DBG_HERE);
-
       fftwf_execute(ptrPlan->get());
 
     }
@@ -13,25 +13,42 @@
 
 #include "PRODDL/Mpi/tags.hpp"
 
+#include "PRODDL/exceptions.hpp"
+
 #include <unordered_map>
 
+#include <sstream>
+
 namespace PRODDL {
 
   namespace Mpi {
 
+// Dispatcher waits for the next incoming message and calls the method
+// of the handler object registered for the message tag. The handler is
+// given the status of the probed message and must receive the message itself.
+
 template < class HandlerClass >
 class Dispatcher {
 
 public:
 
-  typedef void (HandlerClass::* HandlerMethod) (OOMPI_Status&);
+  typedef void (HandlerClass::* HandlerMethod) (MPI_Status&);
 
 protected:
 
-  typedef unordered_map<int, HandlerMethod> HandlerMap;
+  typedef std::unordered_map<int, HandlerMethod> HandlerMap;
 
 public:
 
+  Dispatcher(MPI_Comm _comm = MPI_COMM_WORLD, int _source = MPI_ANY_SOURCE):
+    p_handler(0),
+    comm(_comm),
+    source(_source)
+  {}
+
+  virtual
+  ~Dispatcher() {}
+
   void setHandlerObject(HandlerClass& x) {
 
     p_handler = &x;
@@ -50,15 +67,45 @@ public:
 
   }
 
+  // Block until the next message arrives and handle it
+
+  void dispatchOne() {
+
+    MPI_Status status;
+
+    MPI_Probe(source,MPI_ANY_TAG,comm,&status);
+
+    handleMessage(status.MPI_TAG,status);
+
+  }
+
+  // Handle messages until the handler object reports that it is done
 
   virtual
-  void run() = 0;
+  void run() {
+
+    while( ! p_handler->isDone() ) {
+
+      dispatchOne();
+
+    }
+
+  }
 
 protected:
 
-  void handleMessage(int tag, OOMPI_Status& status) {
+  void handleMessage(int tag, MPI_Status& status) {
 
-    
+    typename HandlerMap::iterator p_method = handlerMap.find(tag);
+
+    if( p_method == handlerMap.end() ) {
+      std::ostringstream msg;
+      msg << "Mpi::Dispatcher: no handler for message tag " << tag
+	  << " from rank " << status.MPI_SOURCE;
+      throw not_supported_error(msg.str());
+    }
+
+    (p_handler->*(p_method->second))(status);
 
   }
 
@@ -68,10 +115,15 @@ protected:
 
   HandlerMap handlerMap;
 
+  MPI_Comm comm;
+
+  int source;
 
 }; // class Dispatcher
 
 
+// Worker only listens to the foreman
+
 template < class HandlerClass >
 class WorkerDispatcher : public Dispatcher<HandlerClass> {
 
@@ -79,16 +131,15 @@ public:
 
   typedef Dispatcher<HandlerClass> Base;
 
-  virtual
-  void run() {
-
-    this->handleMessage(tag,status);
-
-  }
+  WorkerDispatcher(MPI_Comm _comm = MPI_COMM_WORLD, int rankForeman = 0):
+    Base(_comm,rankForeman)
+  {}
 
 }; // class WorkerDispatcher
 
 
+// Foreman listens to all workers
+
 template < class HandlerClass >
 class ForemanDispatcher : public Dispatcher<HandlerClass> {
 
@@ -96,6 +147,9 @@ public:
 
   typedef Dispatcher<HandlerClass> Base;
 
+  ForemanDispatcher(MPI_Comm _comm = MPI_COMM_WORLD):
+    Base(_comm,MPI_ANY_SOURCE)
+  {}
 
 }; // class ForemanDispatcher
 
@@ -9,6 +9,9 @@
 #ifndef PRODDL_MPI_MPI_H__
 #define PRODDL_MPI_MPI_H__
 
-#include "oompi.h"
+// The message passing code uses the MPI C API. Only the Blitz
+// datatype helpers in Mpi/blitz.hpp depend on the OOMPI C++ wrapper.
+
+#include <mpi.h>
 
 #endif // PRODDL_MPI_MPI_H__
@@ -18,6 +18,7 @@
 #include "PRODDL/Mpi/mpi.hpp"
 
 #include <sstream>
+#include <iomanip>
 
 namespace PRODDL {
 
@@ -32,11 +33,15 @@ namespace PRODDL {
     void
     postInit() {
 
+      int rank = 0;
+
+      MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+
       std::ostringstream out;
 
       out << "R"
 	  << std::setw(3) << std::setprecision(3) 
-	  << std::setfill('0') << OOMPI_COMM_WORLD.Rank() << ' ' << std::ends;
+	  << std::setfill('0') << rank << ' ' << std::ends;
 
       // set prefix to the Rank of this process
       dbg::set_prefix(out.str().c_str());
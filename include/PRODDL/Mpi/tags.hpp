@@ -24,6 +24,9 @@ namespace PRODDL {
     const int TAG_ARRAY_STRUCT =           TAG_START + 4;
     const int TAG_ROTATION =               TAG_START + 5;
     const int TAG_TRANVALUES =             TAG_START + 6;
+    const int TAG_WORK_REQUEST =           TAG_START + 7;
+    const int TAG_WORK_CHUNK =             TAG_START + 8;
+    const int TAG_RESULT =                 TAG_START + 9;
 
     
 
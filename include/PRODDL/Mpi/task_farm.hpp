@@ -0,0 +1,362 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#ifndef PRODDL_MPI_TASK_FARM_H__
+#define PRODDL_MPI_TASK_FARM_H__
+
+// Foreman/worker farm of independent tasks numbered [0,nTasks).
+//
+// Protocol (rank 0 is the foreman, all other ranks are workers):
+//   worker  -> foreman  TAG_WORK_REQUEST  (empty)
+//   foreman -> worker   TAG_WORK_CHUNK    int[2] = [begin,end) of task indices
+//                    or TAG_EXIT          (empty) when no tasks are left
+//   worker  -> foreman  TAG_RESULT        int task index followed by the result bytes
+//
+// Chunks are handed out on request, so faster workers take more of them.
+// The chunk size shrinks as the work runs out (remaining / (chunkDiv * nWorkers),
+// but not less than minChunk), which keeps the stragglers at the end short.
+// A worker asks for its next chunk as soon as it gets the current one, so
+// it never waits for the foreman between chunks. Results are sent with
+// non-blocking sends as soon as a chunk is done, and the foreman passes
+// them to its collector in the order of arrival.
+
+#include "PRODDL/Mpi/dispatcher.hpp"
+
+#include "PRODDL/exceptions.hpp"
+
+#include <vector>
+#include <list>
+#include <algorithm>
+#include <functional>
+#include <cstring>
+
+namespace PRODDL {
+
+  namespace Mpi {
+
+
+class TaskFarmForeman {
+
+public:
+
+  // collect(iTask, data, size) receives the result of one task
+
+  typedef std::function<void (int, const char*, int)> Collector;
+
+public:
+
+  TaskFarmForeman(int _nTasks,
+		  int _minChunk = 1,
+		  int _chunkDiv = 2,
+		  MPI_Comm _comm = MPI_COMM_WORLD):
+    nTasks(_nTasks),
+    minChunk(std::max(1,_minChunk)),
+    chunkDiv(std::max(1,_chunkDiv)),
+    comm(_comm),
+    nextTask(0),
+    nResults(0),
+    nExitsSent(0),
+    dispatcher(_comm)
+  {
+
+    MPI_Comm_size(comm,&nWorkers);
+
+    nWorkers -= 1;
+
+    if( nWorkers < 1 ) {
+      throw not_supported_error("TaskFarmForeman: at least one worker rank is required");
+    }
+
+    dispatcher.setHandlerObject(*this);
+    dispatcher.setHandlerMethod(TAG_WORK_REQUEST,&TaskFarmForeman::onWorkRequest);
+    dispatcher.setHandlerMethod(TAG_RESULT,&TaskFarmForeman::onResult);
+
+  }
+
+  void run(Collector _collect) {
+
+    collect = _collect;
+
+    dispatcher.run();
+
+  }
+
+  // All results are received and all workers are told to exit
+
+  bool isDone() const {
+
+    return nResults == nTasks && nExitsSent == nWorkers;
+
+  }
+
+  int getNWorkers() const {
+
+    return nWorkers;
+
+  }
+
+protected:
+
+  int nextChunkSize() const {
+
+    int nLeft = nTasks - nextTask;
+
+    return std::min(nLeft,std::max(minChunk,nLeft/(chunkDiv*nWorkers)));
+
+  }
+
+  void onWorkRequest(MPI_Status& status) {
+
+    int worker = status.MPI_SOURCE;
+
+    MPI_Recv(0,0,MPI_INT,worker,TAG_WORK_REQUEST,comm,MPI_STATUS_IGNORE);
+
+    if( nextTask < nTasks ) {
+
+      int chunk[2];
+
+      chunk[0] = nextTask;
+      chunk[1] = nextTask + nextChunkSize();
+
+      nextTask = chunk[1];
+
+      MPI_Send(chunk,2,MPI_INT,worker,TAG_WORK_CHUNK,comm);
+
+    }
+    else {
+
+      MPI_Send(0,0,MPI_INT,worker,TAG_EXIT,comm);
+
+      nExitsSent++;
+
+    }
+
+  }
+
+  void onResult(MPI_Status& status) {
+
+    int size = 0;
+
+    MPI_Get_count(&status,MPI_BYTE,&size);
+
+    if( size < int(sizeof(int)) ) {
+      throw size_error("TaskFarmForeman: result message is too short");
+    }
+
+    buffer.resize(size);
+
+    MPI_Recv(&buffer[0],size,MPI_BYTE,status.MPI_SOURCE,TAG_RESULT,comm,MPI_STATUS_IGNORE);
+
+    int iTask;
+
+    std::memcpy(&iTask,&buffer[0],sizeof(int));
+
+    collect(iTask,&buffer[0] + sizeof(int),size - int(sizeof(int)));
+
+    nResults++;
+
+  }
+
+protected:
+
+  int nTasks;
+
+  int minChunk;
+
+  int chunkDiv;
+
+  MPI_Comm comm;
+
+  int nWorkers;
+
+  int nextTask;
+
+  int nResults;
+
+  int nExitsSent;
+
+  Collector collect;
+
+  std::vector<char> buffer;
+
+  ForemanDispatcher<TaskFarmForeman> dispatcher;
+
+}; // class TaskFarmForeman
+
+
+class TaskFarmWorker {
+
+public:
+
+  // process(begin, end) must do tasks [begin,end) and call sendResult()
+  // once for each of them
+
+  typedef std::function<void (int, int)> Processor;
+
+public:
+
+  TaskFarmWorker(MPI_Comm _comm = MPI_COMM_WORLD, int _rankForeman = 0):
+    comm(_comm),
+    rankForeman(_rankForeman),
+    haveChunk(false),
+    done(false),
+    dispatcher(_comm,_rankForeman)
+  {
+
+    dispatcher.setHandlerObject(*this);
+    dispatcher.setHandlerMethod(TAG_WORK_CHUNK,&TaskFarmWorker::onWorkChunk);
+    dispatcher.setHandlerMethod(TAG_EXIT,&TaskFarmWorker::onExit);
+
+  }
+
+  ~TaskFarmWorker() {
+
+    // normally, run() has already waited for all sends
+    waitSends(false);
+
+  }
+
+  void run(Processor process) {
+
+    requestWork();
+
+    dispatcher.dispatchOne();
+
+    while( haveChunk ) {
+
+      int begin = chunk[0], end = chunk[1];
+
+      haveChunk = false;
+
+      // prefetch the next chunk while processing this one
+
+      requestWork();
+
+      process(begin,end);
+
+      waitSends(true);
+
+      dispatcher.dispatchOne();
+
+    }
+
+    waitSends(false);
+
+  }
+
+  // Send the result of task 'iTask' without blocking.
+  // 'data' is copied, so it can be reused right after the call.
+
+  void sendResult(int iTask, const void *data, int size) {
+
+    pending.push_back(PendingSend());
+
+    PendingSend& p = pending.back();
+
+    p.buffer.resize(sizeof(int) + size);
+
+    std::memcpy(&p.buffer[0],&iTask,sizeof(int));
+
+    if( size > 0 ) {
+      std::memcpy(&p.buffer[0] + sizeof(int),data,size);
+    }
+
+    MPI_Isend(&p.buffer[0],int(p.buffer.size()),MPI_BYTE,rankForeman,TAG_RESULT,comm,&p.request);
+
+  }
+
+  bool isDone() const {
+
+    return done;
+
+  }
+
+protected:
+
+  struct PendingSend {
+
+    std::vector<char> buffer;
+
+    MPI_Request request;
+
+  };
+
+  void requestWork() {
+
+    MPI_Send(0,0,MPI_INT,rankForeman,TAG_WORK_REQUEST,comm);
+
+  }
+
+  void onWorkChunk(MPI_Status& status) {
+
+    MPI_Recv(chunk,2,MPI_INT,rankForeman,TAG_WORK_CHUNK,comm,MPI_STATUS_IGNORE);
+
+    haveChunk = true;
+
+  }
+
+  void onExit(MPI_Status& status) {
+
+    MPI_Recv(0,0,MPI_INT,rankForeman,TAG_EXIT,comm,MPI_STATUS_IGNORE);
+
+    done = true;
+
+  }
+
+  // Free the buffers of completed sends. If 'onlyCompleted' is false, wait
+  // for all of them.
+
+  void waitSends(bool onlyCompleted) {
+
+    for(std::list<PendingSend>::iterator p = pending.begin(); p != pending.end(); ) {
+
+      int flag = 0;
+
+      if( onlyCompleted ) {
+	MPI_Test(&p->request,&flag,MPI_STATUS_IGNORE);
+      }
+      else {
+	MPI_Wait(&p->request,MPI_STATUS_IGNORE);
+	flag = 1;
+      }
+
+      if( flag ) {
+	p = pending.erase(p);
+      }
+      else {
+	++p;
+      }
+
+    }
+
+  }
+
+protected:
+
+  MPI_Comm comm;
+
+  int rankForeman;
+
+  int chunk[2];
+
+  bool haveChunk;
+
+  bool done;
+
+  // std::list keeps buffers in place while sends are in flight
+
+  std::list<PendingSend> pending;
+
+  WorkerDispatcher<TaskFarmWorker> dispatcher;
+
+}; // class TaskFarmWorker
+
+
+  }} // namespace PRODDL::Mpi
+
+#endif // PRODDL_MPI_TASK_FARM_H__
@@ -0,0 +1,415 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#ifndef AT_OPTIM_LBFGSB_H__
+#define AT_OPTIM_LBFGSB_H__
+
+// Limited memory quasi-Newton minimizer with simple bound constraints.
+//
+// This is a projected variant of L-BFGS: the active set is identified from the
+// projected gradient at the current point, the two-loop recursion is applied
+// to the free variables only, and the step is found by backtracking along the
+// projection of the search direction onto the box. It does not implement the
+// generalized Cauchy point of the original L-BFGS-B, which is not needed for
+// the small, well-scaled problems (rigid body refinement with 6 variables) it
+// is used for.
+//
+// Both the number of variables and the history length are compile time
+// constants, so the object does not allocate any memory and can be reused
+// for any number of consecutive optimize() calls.
+
+#include "PRODDL/Optim/optim_except.hpp"
+
+// for 'noncopyable'
+#include <boost/utility.hpp>
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+namespace PRODDL { namespace Optim {
+
+
+  // Parameters and stopping criteria of LbfgsB, combined in one struct
+  // to provide easy initialization to default values
+
+  struct LbfgsParams {
+
+    int maxIter;
+    int maxFuncEvals;
+    // stop when infinity norm of projected gradient falls below this
+    double gTol;
+    // stop when relative decrease of function value falls below this
+    double fTol;
+    // maximum infinity norm of a step in variable space
+    double maxStep;
+    // maximum number of backtracking steps within one line search
+    int maxLineSearch;
+
+    LbfgsParams():
+      maxIter(200),
+      maxFuncEvals(400),
+      gTol(1e-5),
+      fTol(1e-9),
+      maxStep(1.),
+      maxLineSearch(20)
+    {}
+
+  };
+
+
+  // Minimizer of a function of N_dim variables constrained by lower <= x <= upper.
+  // TargetFunc passed to optimize() must have method
+  // T_num fg(const T_num x[], T_num g[])
+  // that returns function value at x and stores its gradient into g.
+
+  template<typename T_num, int N_dim, int M_hist = 6>
+  class LbfgsB : public boost::noncopyable {
+
+  public:
+
+    enum {StopUnknown=0,StopSmallGrad,StopSmallFuncChange,StopLimitIter,StopLimitFuncEvals,StopLineSearch,StopEnd};
+
+    enum { n_dim = N_dim, m_hist = M_hist };
+
+  public:
+
+    LbfgsB(const LbfgsParams& params = LbfgsParams()):
+      m_params(params),
+      m_reasonStop(StopUnknown),
+      m_nIter(0),
+      m_nFuncEvals(0)
+    {
+      for(int i = 0; i < N_dim; i++) {
+	m_lower[i] = -std::numeric_limits<T_num>::max();
+	m_upper[i] = std::numeric_limits<T_num>::max();
+      }
+    }
+
+    void setBounds(const T_num lower[], const T_num upper[]) {
+      for(int i = 0; i < N_dim; i++) {
+	if( lower[i] > upper[i] ) {
+	  throw optim_param_error("LbfgsB::setBounds(): lower bound is above upper bound");
+	}
+	m_lower[i] = lower[i];
+	m_upper[i] = upper[i];
+      }
+    }
+
+    LbfgsParams& params() {
+      return m_params;
+    }
+
+    // Minimize starting from x[], which is projected into the bounds first.
+    // On return, x[] contains the best point found, and the function value
+    // at that point is returned.
+
+    template<class TargetFunc>
+    T_num optimize(TargetFunc& func, T_num x[]) {
+
+      m_nIter = 0;
+      m_nFuncEvals = 0;
+      m_reasonStop = StopUnknown;
+      m_nHist = 0;
+      m_iHist = 0;
+
+      project(x);
+
+      T_num f = evaluate(func,x,m_g);
+
+      // when line search fails with quasi-Newton direction, we retry
+      // once from steepest descent before giving up
+      bool isReset = false;
+
+      while( true ) {
+
+	if( projGradNorm(x,m_g) <= m_params.gTol ) {
+	  m_reasonStop = StopSmallGrad;
+	  break;
+	}
+
+	if( m_nIter >= m_params.maxIter ) {
+	  m_reasonStop = StopLimitIter;
+	  break;
+	}
+
+	if( m_nFuncEvals >= m_params.maxFuncEvals ) {
+	  m_reasonStop = StopLimitFuncEvals;
+	  break;
+	}
+
+	setFree(x,m_g);
+
+	T_num gd = direction(m_g,m_d);
+
+	if( ! (gd < 0) ) {
+	  // not a descent direction - drop the history
+	  m_nHist = 0;
+	  gd = direction(m_g,m_d);
+	  if( ! (gd < 0) ) {
+	    m_reasonStop = StopSmallGrad;
+	    break;
+	  }
+	}
+
+	// limit step length; on the first iteration (or after a reset)
+	// the direction is unscaled gradient, so this also
+	// provides the initial step size
+
+	T_num dMax = 0;
+	for(int i = 0; i < N_dim; i++) {
+	  dMax = std::max(dMax,T_num(std::abs(m_d[i])));
+	}
+	if( dMax > m_params.maxStep ) {
+	  T_num scale = T_num(m_params.maxStep) / dMax;
+	  for(int i = 0; i < N_dim; i++) {
+	    m_d[i] *= scale;
+	  }
+	}
+
+	T_num fNew = 0;
+
+	bool isAccepted = lineSearch(func,x,f,m_g,m_d,fNew);
+
+	if( ! isAccepted ) {
+	  if( m_nHist > 0 && ! isReset ) {
+	    m_nHist = 0;
+	    isReset = true;
+	    continue;
+	  }
+	  m_reasonStop = m_nFuncEvals >= m_params.maxFuncEvals ? StopLimitFuncEvals : StopLineSearch;
+	  break;
+	}
+
+	isReset = false;
+
+	m_nIter++;
+
+	// curvature pair s = x_new - x, y = g_new - g
+
+	T_num *s = m_s + m_iHist*N_dim;
+	T_num *y = m_y + m_iHist*N_dim;
+	T_num sy = 0, yy = 0;
+	for(int i = 0; i < N_dim; i++) {
+	  s[i] = m_xNew[i] - x[i];
+	  y[i] = m_gNew[i] - m_g[i];
+	  sy += s[i]*y[i];
+	  yy += y[i]*y[i];
+	}
+
+	// skip the update when curvature condition does not hold
+
+	if( sy > std::numeric_limits<T_num>::epsilon() * yy ) {
+	  m_rho[m_iHist] = T_num(1) / sy;
+	  m_iHist = (m_iHist + 1) % M_hist;
+	  m_nHist = std::min(m_nHist + 1, int(M_hist));
+	}
+
+	T_num fOld = f;
+
+	f = fNew;
+	for(int i = 0; i < N_dim; i++) {
+	  x[i] = m_xNew[i];
+	  m_g[i] = m_gNew[i];
+	}
+
+	if( fOld - f <= m_params.fTol * std::max(std::max(std::abs(fOld),std::abs(f)),T_num(1)) ) {
+	  m_reasonStop = StopSmallFuncChange;
+	  break;
+	}
+
+      }
+
+      return f;
+
+    }
+
+    int whyStopped() const {
+      return m_reasonStop;
+    }
+
+    const char* whyStoppedStr() const {
+      static const char* stopStr[] = { "Unknown", "SmallGrad", "SmallFuncChange",
+				       "LimitIter", "LimitFuncEvals", "LineSearch" };
+      int iwhy = whyStopped();
+      if( iwhy < 0 || iwhy >= StopEnd ) {
+	iwhy = StopUnknown;
+      }
+      return stopStr[iwhy];
+    }
+
+    int numIter() const {
+      return m_nIter;
+    }
+
+    int numFuncEvals() const {
+      return m_nFuncEvals;
+    }
+
+  protected:
+
+    template<class TargetFunc>
+    T_num evaluate(TargetFunc& func, const T_num x[], T_num g[]) {
+      m_nFuncEvals++;
+      return func.fg(x,g);
+    }
+
+    void project(T_num x[]) const {
+      for(int i = 0; i < N_dim; i++) {
+	x[i] = std::min(std::max(x[i],m_lower[i]),m_upper[i]);
+      }
+    }
+
+    // Infinity norm of the projected gradient
+
+    T_num projGradNorm(const T_num x[], const T_num g[]) const {
+      T_num norm = 0;
+      for(int i = 0; i < N_dim; i++) {
+	T_num gp = x[i] - g[i];
+	gp = std::min(std::max(gp,m_lower[i]),m_upper[i]) - x[i];
+	norm = std::max(norm,T_num(std::abs(gp)));
+      }
+      return norm;
+    }
+
+    // Mark variables that sit on a bound with gradient pointing outside as fixed
+
+    void setFree(const T_num x[], const T_num g[]) {
+      for(int i = 0; i < N_dim; i++) {
+	m_free[i] = ! ( ( x[i] <= m_lower[i] && g[i] > 0 ) ||
+			( x[i] >= m_upper[i] && g[i] < 0 ) );
+      }
+    }
+
+    // Two-loop recursion restricted to the free variables.
+    // Sets d = -H*g and returns directional derivative g.d
+
+    T_num direction(const T_num g[], T_num d[]) {
+
+      for(int i = 0; i < N_dim; i++) {
+	d[i] = m_free[i] ? -g[i] : T_num(0);
+      }
+
+      int iLast = (m_iHist + M_hist - 1) % M_hist;
+
+      for(int k = 0, j = iLast; k < m_nHist; k++, j = (j + M_hist - 1) % M_hist) {
+	const T_num *s = m_s + j*N_dim;
+	const T_num *y = m_y + j*N_dim;
+	T_num sd = 0;
+	for(int i = 0; i < N_dim; i++) {
+	  if( m_free[i] ) sd += s[i]*d[i];
+	}
+	m_alpha[j] = m_rho[j] * sd;
+	for(int i = 0; i < N_dim; i++) {
+	  if( m_free[i] ) d[i] -= m_alpha[j]*y[i];
+	}
+      }
+
+      if( m_nHist > 0 ) {
+	// initial Hessian scaling gamma = s.y/y.y from the latest pair
+	const T_num *y = m_y + iLast*N_dim;
+	T_num yy = 0;
+	for(int i = 0; i < N_dim; i++) {
+	  yy += y[i]*y[i];
+	}
+	T_num gamma = T_num(1) / (m_rho[iLast] * yy);
+	for(int i = 0; i < N_dim; i++) {
+	  d[i] *= gamma;
+	}
+      }
+
+      for(int k = 0, j = (m_iHist + M_hist - m_nHist) % M_hist; k < m_nHist; k++, j = (j + 1) % M_hist) {
+	const T_num *s = m_s + j*N_dim;
+	const T_num *y = m_y + j*N_dim;
+	T_num yd = 0;
+	for(int i = 0; i < N_dim; i++) {
+	  if( m_free[i] ) yd += y[i]*d[i];
+	}
+	T_num beta = m_rho[j] * yd;
+	for(int i = 0; i < N_dim; i++) {
+	  if( m_free[i] ) d[i] += (m_alpha[j] - beta)*s[i];
+	}
+      }
+
+      T_num gd = 0;
+      for(int i = 0; i < N_dim; i++) {
+	if( ! m_free[i] ) d[i] = 0;
+	gd += g[i]*d[i];
+      }
+      return gd;
+    }
+
+    // Backtracking (Armijo) search along the projected path x(a) = P(x + a*d).
+    // On success, the new point and gradient are left in m_xNew and m_gNew.
+
+    template<class TargetFunc>
+    bool lineSearch(TargetFunc& func, const T_num x[], T_num f, const T_num g[], const T_num d[], T_num& fNew) {
+
+      const T_num c1 = 1e-4;
+
+      T_num a = 1;
+
+      for(int i_ls = 0; i_ls < m_params.maxLineSearch; i_ls++) {
+
+	if( m_nFuncEvals >= m_params.maxFuncEvals ) {
+	  return false;
+	}
+
+	T_num gs = 0;
+	bool isMoved = false;
+	for(int i = 0; i < N_dim; i++) {
+	  m_xNew[i] = std::min(std::max(x[i] + a*d[i],m_lower[i]),m_upper[i]);
+	  T_num s = m_xNew[i] - x[i];
+	  gs += g[i]*s;
+	  isMoved = isMoved || s != 0;
+	}
+
+	if( ! isMoved ) {
+	  return false;
+	}
+
+	fNew = evaluate(func,m_xNew,m_gNew);
+
+	if( fNew <= f + c1*gs ) {
+	  return true;
+	}
+
+	a *= T_num(0.5);
+
+      }
+
+      return false;
+    }
+
+  protected:
+
+    LbfgsParams m_params;
+
+    T_num m_lower[N_dim], m_upper[N_dim];
+
+    // current gradient, search direction, trial point and its gradient
+    T_num m_g[N_dim], m_d[N_dim], m_xNew[N_dim], m_gNew[N_dim];
+
+    bool m_free[N_dim];
+
+    // circular buffer of curvature pairs
+    T_num m_s[M_hist*N_dim], m_y[M_hist*N_dim];
+    T_num m_rho[M_hist], m_alpha[M_hist];
+    // number of pairs stored and position for the next one
+    int m_nHist, m_iHist;
+
+    int m_reasonStop;
+    int m_nIter;
+    int m_nFuncEvals;
+
+  }; // class LbfgsB
+
+
+} } // namespace PRODDL::Optim
+
+#endif // AT_OPTIM_LBFGSB_H__
@@ -12,6 +12,7 @@
 // Exception classes for objects in geom namespace
 
 #include <exception>
+#include <string>
 
 namespace PRODDL { namespace Optim {
 
@@ -0,0 +1,113 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#ifndef PRODDL_OS_MAPPED_BUFFER_H__
+#define PRODDL_OS_MAPPED_BUFFER_H__
+
+// Scratch memory backed by a temporary file.
+//
+// The file is created in the given directory, memory-mapped shared and
+// unlinked right away, so it disappears when the buffer is destroyed or the
+// process exits. Pages of the buffer live in the page cache: the kernel
+// writes them back to the file and drops them under memory pressure, so the
+// buffer can be much larger than the memory available to the process.
+// The file is sparse, and disk space is only used for the pages written.
+
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+#include <boost/noncopyable.hpp>
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "PRODDL/Common/debug.hpp"
+
+namespace PRODDL {
+
+
+  class MappedTempBuffer : boost::noncopyable {
+
+  public:
+
+    MappedTempBuffer(size_t size, const std::string& dir):
+      m_data(0),
+      m_size(size)
+    {
+
+      ATALWAYS(size > 0,"MappedTempBuffer: zero size");
+
+      std::string path = (dir.empty() ? std::string(".") : dir) + "/proddl_buf_XXXXXX";
+
+      std::vector<char> name(path.begin(),path.end());
+      name.push_back('\0');
+
+      int fd = ::mkstemp(&name[0]);
+
+      ATALWAYS(fd >= 0,"Unable to create temporary file in " + dir + ": " + std::strerror(errno));
+
+      ::unlink(&name[0]);
+
+      bool ok = ::ftruncate(fd,off_t(size)) == 0;
+
+      void *p = ok ? ::mmap(0,size,PROT_READ | PROT_WRITE,MAP_SHARED,fd,0) : MAP_FAILED;
+
+      int err = errno;
+
+      ::close(fd);
+
+      ATALWAYS(ok,"Unable to extend temporary file in " + dir + ": " + std::strerror(err));
+
+      ATALWAYS(p != MAP_FAILED,"Unable to memory-map temporary file in " + dir + ": " + std::strerror(err));
+
+      m_data = p;
+
+    }
+
+    ~MappedTempBuffer() {
+      if( m_data ) {
+	::munmap(m_data,m_size);
+      }
+    }
+
+    void *data() const {
+      return m_data;
+    }
+
+    size_t size() const {
+      return m_size;
+    }
+
+    // Hint that bytes [offset,offset+len) will be read soon, so that the
+    // kernel starts reading them back from the file
+
+    void willNeed(size_t offset, size_t len) const {
+      size_t page = size_t(::sysconf(_SC_PAGESIZE));
+      size_t start = offset / page * page;
+      if( start < m_size ) {
+	::madvise(static_cast<char*>(m_data) + start,std::min(len + (offset - start),m_size - start),MADV_WILLNEED);
+      }
+    }
+
+  protected:
+
+    void *m_data;
+
+    size_t m_size;
+
+  }; // class MappedTempBuffer
+
+
+} // namespace PRODDL
+
+#endif // PRODDL_OS_MAPPED_BUFFER_H__
@@ -0,0 +1,229 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#ifndef PRODDL_TESTING_BENCH_H__
+#define PRODDL_TESTING_BENCH_H__
+
+// Minimal harness for timing benchmarks of the computational kernels.
+//
+// Each benchmark is a callable that is run once untimed (to warm up caches,
+// FFTW plans and lazily allocated buffers) and then repeatedly, until both
+// minReps repetitions and minSeconds of timed work are done (but no more
+// than maxReps repetitions). The median time of one repetition is what is
+// compared against a baseline - it is less sensitive to the occasional
+// context switch than the mean.
+//
+// Usage:
+//   Bench::Runner runner;
+//   Bench::Params params; params["nAtoms"] = points.size();
+//   runner.run("project/atoms1000",params,[&]() { proj.projectFields(fields,points); },points.size());
+
+#include <algorithm>
+
+#include <chrono>
+
+#include <map>
+
+#include <string>
+
+#include <vector>
+
+#include "PRODDL/Common/logger.hpp"
+
+namespace PRODDL { namespace Bench {
+
+
+  // Free form numeric description of the benchmark input (number of atoms, FFT size etc)
+
+  typedef std::map<std::string,double> Params;
+
+  struct Result {
+
+    std::string name;
+
+    Params params;
+
+    int nReps;
+
+    // time of one repetition (s)
+    double secMedian;
+    double secMin;
+
+    // work items (atoms, rotations, records...) processed by one repetition
+    double nItems;
+
+    Result():
+      nReps(0),
+      secMedian(0),
+      secMin(0),
+      nItems(1)
+    {}
+
+    double itemsPerSec() const {
+      return secMedian > 0 ? nItems / secMedian : 0.;
+    }
+
+  }; // struct Result
+
+  typedef std::vector<Result> Results;
+
+
+  class Runner {
+
+  public:
+
+    typedef std::chrono::steady_clock Clock;
+
+    Runner(double _minSeconds = 1., int _minReps = 3, int _maxReps = 1000,
+	   const std::string& _filter = std::string()):
+      minSeconds(_minSeconds),
+      minReps(_minReps),
+      maxReps(std::max(_minReps,_maxReps)),
+      filter(_filter)
+    {}
+
+    // True if the benchmark 'name' was selected to run. Check this before
+    // doing an expensive setup for the benchmark.
+
+    bool enabled(const std::string& name) const {
+      return filter.empty() || name.find(filter) != std::string::npos;
+    }
+
+    // Time 'fn'. 'prepare' is called before each repetition outside of the
+    // timed region, e.g. to restore the input that 'fn' overwrites.
+
+    template<class Prepare, class Fn>
+    void run(const std::string& name, const Params& params, Prepare prepare, Fn fn, double nItems = 1) {
+
+      if( ! enabled(name) ) {
+	return;
+      }
+
+      prepare();
+      fn();
+
+      std::vector<double> times;
+
+      double total = 0;
+
+      while( int(times.size()) < maxReps &&
+	     ( int(times.size()) < minReps || total < minSeconds ) ) {
+	prepare();
+	Clock::time_point start = Clock::now();
+	fn();
+	double sec = std::chrono::duration<double>(Clock::now() - start).count();
+	times.push_back(sec);
+	total += sec;
+      }
+
+      std::sort(times.begin(),times.end());
+
+      Result res;
+
+      res.name = name;
+      res.params = params;
+      res.nReps = int(times.size());
+      res.secMin = times.front();
+      res.secMedian = times[times.size()/2];
+      res.nItems = nItems;
+
+      ATLOG_OUT_1("Bench: " << name << " median " << res.secMedian << " s min " << res.secMin
+		  << " s reps " << res.nReps << " items/s " << res.itemsPerSec());
+
+      results.push_back(res);
+
+    }
+
+    template<class Fn>
+    void run(const std::string& name, const Params& params, Fn fn, double nItems = 1) {
+      run(name,params,[](){},fn,nItems);
+    }
+
+    const Results& getResults() const {
+      return results;
+    }
+
+  protected:
+
+    double minSeconds;
+
+    int minReps;
+
+    int maxReps;
+
+    std::string filter;
+
+    Results results;
+
+  }; // class Runner
+
+
+  struct Comparison {
+
+    std::string name;
+
+    double secMedian;
+
+    double secBaseline;
+
+    // secMedian / secBaseline
+    double ratio;
+
+    bool regressed;
+
+  };
+
+  typedef std::vector<Comparison> Comparisons;
+
+  // Match 'results' with 'baseline' by benchmark name. A benchmark has
+  // regressed if its median time exceeds the baseline one by more than
+  // the fraction 'tolerance'. Benchmarks missing from either side are
+  // not compared.
+
+  inline Comparisons compare(const Results& results, const Results& baseline, double tolerance) {
+
+    std::map<std::string,const Result*> base;
+
+    for(Results::const_iterator p = baseline.begin(); p != baseline.end(); ++p) {
+      base[p->name] = &*p;
+    }
+
+    Comparisons comps;
+
+    for(Results::const_iterator p = results.begin(); p != results.end(); ++p) {
+      std::map<std::string,const Result*>::const_iterator p_base = base.find(p->name);
+      if( p_base == base.end() || p_base->second->secMedian <= 0 ) {
+	continue;
+      }
+      Comparison comp;
+      comp.name = p->name;
+      comp.secMedian = p->secMedian;
+      comp.secBaseline = p_base->second->secMedian;
+      comp.ratio = comp.secMedian / comp.secBaseline;
+      comp.regressed = comp.ratio > 1. + tolerance;
+      comps.push_back(comp);
+    }
+
+    return comps;
+
+  }
+
+  inline int countRegressed(const Comparisons& comps) {
+    int n = 0;
+    for(Comparisons::const_iterator p = comps.begin(); p != comps.end(); ++p) {
+      if( p->regressed ) {
+	n++;
+      }
+    }
+    return n;
+  }
+
+
+}} // namespace PRODDL::Bench
+
+#endif // PRODDL_TESTING_BENCH_H__
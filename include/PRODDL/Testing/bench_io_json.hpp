@@ -0,0 +1,31 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#ifndef PRODDL_BENCH_IO_JSON_H__
+#define PRODDL_BENCH_IO_JSON_H__
+
+/*
+*
+Methods to save benchmark results as JSON and to load them back
+(e.g. as a baseline to compare a new run against).
+*
+*/
+
+#include "PRODDL/Testing/bench.hpp"
+
+#include <string>
+
+namespace PRODDL {
+
+	void save_bench_results_to_json_file(const Bench::Results& results,std::string out_file);
+
+	void load_bench_results_from_json_file(std::string inp_file,Bench::Results& results);
+
+} // namespace PRODDL
+
+#endif // PRODDL_BENCH_IO_JSON_H__
@@ -19,6 +19,8 @@
 
 #include "PRODDL/Math/fftw.hpp"
 
+#include "PRODDL/Math/fft_shape.hpp"
+
 #include "PRODDL/Common/queue.hpp"
 
 #include "PRODDL/Common/math.hpp"
@@ -26,6 +28,7 @@
 #include "PRODDL/Common/bz_cast.hpp"
 
 #include "PRODDL/Geom/bounding.hpp"
+#include "PRODDL/Geom/bounding_cache.hpp"
 
 #include "PRODDL/Geom/symmetry.hpp"
 
@@ -33,6 +36,8 @@
 
 #include "PRODDL/Geom/cluster.hpp"
 
+#include "PRODDL/Geom/pose_cluster.hpp"
+
 #include "PRODDL/potentials.hpp"
 
 #include "PRODDL/Common/g_options.hpp"
@@ -41,16 +46,43 @@
 
 #include "PRODDL/Common/common_algor.hpp"
 
+#include "PRODDL/Common/parallel.hpp"
+
+#include "PRODDL/Common/prof.hpp"
+
 #include "PRODDL/IO/hdf5.hpp"
 
+#include "PRODDL/IO/hdf5_mmap.hpp"
+
 #include "PRODDL/IO/rigid.hpp"
 
+#include "PRODDL/Os/mapped_buffer.hpp"
+
 #include <deque>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <mutex>
+#include <tuple>
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <sstream>
+#include <bitset>
+#include <string>
+#include <complex>
+#include <utility>
 #include <iterator>
 #include <algorithm>
 #include <cstddef>
+#include <cstring>
 #include <boost/scoped_ptr.hpp>
 #include <boost/noncopyable.hpp>
+#include <boost/filesystem.hpp>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace PRODDL {
 
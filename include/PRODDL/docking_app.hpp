@@ -49,23 +49,7 @@ public:
 
 		ATLOG_OUT_4("pmolStruct initialized"); 
 
-		std::string potentialName;
-
-		gOptions.getdefault("potentialName",potentialName,"ljComp");
-
-		MolForce * p_mf = 0;
-
-		if( potentialName == "ljComp" ) {
-			p_mf = new MolForceLJComp(mfParams);
-		}
-		else if( potentialName == "ljAvg" ) {
-			p_mf = new MolForceLJ(mfParams);
-		}
-		else {
-			throw not_supported_error("Unknown 'potentialName' parameter value: " + potentialName);
-		}
-
-		pmolForce.reset(p_mf);
+		pmolForce.reset(newMolForce(mfParams));
 
 		ATLOG_OUT_2("Using potential defined on " << pmolForce->nGrids() << " grids.");
 
@@ -89,6 +73,35 @@ public:
 
 	virtual bool isForeman() const = 0;
 
+	// Create MolForce object for the potential selected by 'potentialName' option
+
+	static MolForce* newMolForce(const MolForceParams& mfParams) {
+
+		std::string potentialName;
+
+		gOptions.getdefault("potentialName",potentialName,"ljComp");
+
+		MolForce * p_mf = 0;
+
+		if( potentialName == "ljComp" ) {
+			p_mf = new MolForceLJCompSum(mfParams);
+		}
+		else if( potentialName == "ljCompTree" ) {
+			// same potential as "ljComp", computed through the generic composition
+			// of MolForce objects (one inverse FFT per component)
+			p_mf = new MolForceLJComp(mfParams);
+		}
+		else if( potentialName == "ljAvg" ) {
+			p_mf = new MolForceLJ(mfParams);
+		}
+		else {
+			throw not_supported_error("Unknown 'potentialName' parameter value: " + potentialName);
+		}
+
+		return p_mf;
+
+	}
+
 
 protected:
 
@@ -165,6 +178,14 @@ public:
 
 		gOptions.getdefault("maxNRigidMatches",maxNRigidMatches,20000);
 
+		resetResults();
+
+	}
+
+	// Discard all collected results
+
+	void resetResults() {
+
 		rtvalQueue.init(maxNRigidMatches,T_num(1e16));
 
 		resultsInOriginalFrame = false;
@@ -181,34 +202,8 @@ public:
 
 		while(nextCollectRotTranVals()) {
 
+			collectRotTranVals(doneRot,tranValues);
 
-			int nTranValues = tranValues.size();
-
-			ATLOG_OUT_4("Received results for one rotation: " <<  \
-				ATLOGVAR(nTranValues));
-
-			for(int iTranVal = 0; iTranVal < nTranValues; iTranVal++) {
-
-				const TranValue& tranVal = tranValues(iTranVal);
-
-				RotTranValue rtVal;
-
-				rtVal.tran = tranVal.tran * doneRot;
-
-				rtVal.value = tranVal.value;
-
-				rtvalQueue.push(rtVal);
-
-				// DEBUG:
-				if( iTranVal >= ( nTranValues - 4 ) ) {
-
-					ATLOG_OUT_4(ATLOGVAR(iTranVal) \
-						<< ATLOGVAR(rtVal.tran) \
-						<< ATLOGVAR(rtVal.value));
-
-				}
-
-			}
 		}
 
 		finishCollectRotTranVals();
@@ -236,7 +231,12 @@ public:
 	bool nextCollectRotTranVals() {
 		ATLOG_TRACE_3;
 		ATALWAYS(m_io_rot_scan_coll.get(),"Input object does not exist");
-		return m_io_rot_scan_coll->read_record(doneRot,tranValues);
+		Prof::ScopedTimer t(Prof::PH_IO);
+		bool status = m_io_rot_scan_coll->read_record(doneRot,tranValues);
+		if( status ) {
+			Prof::count(Prof::CNT_BYTES_READ,RotFftScanIO_Bin::record_size(tranValues.size()));
+		}
+		return status;
 	}
 
 	void finishCollectRotTranVals() {
@@ -245,6 +245,50 @@ public:
 		m_io_rot_scan_coll.reset();
 	}
 
+	// Push translations found for the ligand rotation 'rot' into the queue
+
+	void collectRotTranVals(const Rotation& rot, const TranValues& tranVals) {
+
+		int nTranValues = tranVals.size();
+
+		ATLOG_OUT_4("Received results for one rotation: " <<  \
+			ATLOGVAR(nTranValues));
+
+		for(int iTranVal = 0; iTranVal < nTranValues; iTranVal++) {
+
+			const TranValue& tranVal = tranVals(iTranVal);
+
+			RotTranValue rtVal;
+
+			rtVal.tran = tranVal.tran * rot;
+
+			rtVal.value = tranVal.value;
+
+			bool full = rtvalQueue.size() >= rtvalQueue.getSizeLimit();
+
+			if( rtvalQueue.push(rtVal) ) {
+
+				Prof::count(Prof::CNT_RESULTS_PUSHED);
+
+				if( full ) {
+					Prof::count(Prof::CNT_QUEUE_EVICTIONS);
+				}
+
+			}
+
+			// DEBUG:
+			if( iTranVal >= ( nTranValues - 4 ) ) {
+
+				ATLOG_OUT_4(ATLOGVAR(iTranVal) \
+					<< ATLOGVAR(rtVal.tran) \
+					<< ATLOGVAR(rtVal.value));
+
+			}
+
+		}
+
+	}
+
 	const ResultsContainerType& getResults() {
 		ATLOG_TRACE_3;
 
@@ -272,6 +316,8 @@ public:
 
 			const ResultsContainerType& results = getResults();
 
+			Prof::ScopedTimer t(Prof::PH_IO);
+
 			IORigid<T_num> io;
 
 			io.writeCoords(fileName,results.begin(),results.size(),format);
@@ -280,6 +326,69 @@ public:
 
 	}
 
+	// Cluster the results by the ligand RMSD (option 'poseClusterRmsd', 4 A by default,
+	// see PoseClusterer) and write a tab-separated file with one line per cluster,
+	// best first: cluster size, index of the representative in the results
+	// (as written by writeResults()), its value, rotation angles and displacement.
+
+	void
+		writeClusters(const std::string& fileName) {
+			ATLOG_TRACE_3;
+
+			const ResultsContainerType& results = getResults();
+
+			T_num rmsdCutoff;
+			gOptions.getdefault("poseClusterRmsd",rmsdCutoff,T_num(4.0));
+
+			int nThreads;
+			gOptions.getdefault("nThreads",nThreads,0);
+
+			PoseClusterer<T_num> clusterer(this->pmolStruct->getPosIni(iLig));
+
+			{
+				Prof::ScopedTimer t(Prof::PH_POSE_CLUSTER);
+				clusterer.cluster(results.begin(),int(results.size()),rmsdCutoff,nThreads);
+			}
+
+			const typename PoseClusterer<T_num>::Clusters& clusters = clusterer.getClusters();
+
+			ATLOG_OUT_1("Found " << clusters.size() << " clusters among " << results.size() \
+				<< " poses with RMSD cutoff " << rmsdCutoff);
+
+			Prof::ScopedTimer t(Prof::PH_IO);
+
+			std::ofstream out(fileName.c_str());
+
+			ATALWAYS(out.good(),"Unable to open output cluster file: " + fileName);
+
+			out << "#size\tindex\tvalue\tang0\tang1\tang2\tx\ty\tz\n";
+
+			for(size_t i_cl = 0; i_cl < clusters.size(); i_cl++) {
+
+				const typename PoseClusterer<T_num>::Cluster& cl = clusters[i_cl];
+
+				Point ang, xyz;
+
+				results[cl.iRep].tran.anglesAndDisplacement(ang,xyz);
+
+				out << cl.size << "\t" << cl.iRep << "\t" << cl.value;
+
+				for(int j = 0; j < N_dim; j++) {
+					out << "\t" << ang(j);
+				}
+
+				for(int j = 0; j < N_dim; j++) {
+					out << "\t" << xyz(j);
+				}
+
+				out << "\n";
+
+			}
+
+			ATALWAYS(out.good(),"Error when writing cluster file: " + fileName);
+
+	}
+
 
 protected:
 
@@ -313,286 +422,1603 @@ protected:
 };
 
 
-class Worker : public App {
+// Classes of the FFT box by the orientation of the ligand.
+// MolStruct pads the receptor box on every side by the ligand radius, but
+// a rotated elongated ligand extends along some axes much less than that.
+// Padding by the extent of the rotated ligand along each axis is enough to
+// avoid the wrap-around of the correlation, so the rotations are binned by
+// those extents into a few classes, and each class is scanned on its own
+// (smaller) FFT grid. The classes are chosen greedily to minimize the total
+// model cost of the FFTs (Math::FFTShapeCost) over a sample of the whole
+// rotational grid, so that every task of a run bins a given rotation in the
+// same way. Class 0 is always the full box of MolStruct; it also takes
+// the rotations that do not fit any other class.
 
-public:
+class BoxClasses {
 
-	typedef App Base;
-	typedef Worker Self;
+public:
 
+	struct BoxClass {
 
-public:
+		// padding by the ligand along each axis, used instead of
+		// MolStruct::getLigPadding()
+		Point ligPadding;
 
-	void init(const MolForceParams& mfParams) {
+		PointPair box;
 
-		ATLOG_TRACE_3;
+		IntPoint sizeFft;
 
-		Base::init(mfParams);
+		// model cost of the FFT of sizeFft
+		double cost;
 
-		std::string anglesFile;
-		gOptions.get("anglesFile",anglesFile);
+		// fraction of the sampled rotations that fall into this class
+		double share;
 
-		rotGrid.reference(Geom::loadRotationalGrid<T_num>(anglesFile));
+	};
 
-		rotToRun.clear();
+	BoxClasses() {}
 
-		int fft_rot_grid_start = 0;
-		gOptions.get("fft_rot_grid_start",fft_rot_grid_start);
+	// Choose at most 'maxNClasses' classes for the ligand of 'molStruct'
+	// from every k-th rotation of 'rotations', such that at most
+	// 'maxNSample' rotations are sampled. With 'maxNClasses' < 2 (or no
+	// rotations), there is only the full box.
 
-		ATALWAYS(fft_rot_grid_start >= 0 && fft_rot_grid_start < rotGrid.size(),\
-			"Rotation start index is out of bound");
+	void init(MolStruct& molStruct, const Rotations& rotations, T_num gridStep,
+		int maxNClasses, int maxNSample = 5000) {
 
-		int fft_rot_grid_end = 0;
-		gOptions.get("fft_rot_grid_end",fft_rot_grid_end);
+		ATLOG_TRACE_3;
 
-		ATALWAYS(fft_rot_grid_end >= fft_rot_grid_start,\
-			"rotation end index is out of bound");
+		T_num ligPadFull = molStruct.getLigPadding();
 
-		 if(fft_rot_grid_end > rotGrid.size()) {
-			 fft_rot_grid_end = rotGrid.size();
-		 }
+		classes.clear();
 
-		for( int i = fft_rot_grid_start; i < fft_rot_grid_end; i++) 
-			rotToRun.push_back(rotGrid(i));
+		classes.push_back(makeClass(molStruct,Point(ligPadFull),gridStep));
 
+		classes[0].share = 1;
 
-		//TODO: some intelligent estimate for default
-		//values of maxNTrans and maxValCorr
+		int nRot = rotations.size();
 
-		T_num maxValCorr;
-		gOptions.getdefault("maxValCorr",maxValCorr,T_num(0));
-		pfft.reset(new FFTCorrelators(this->pmolStruct->getMinBox(),this->gridStep,this->pmolForce->nGrids()));
+		if( maxNClasses < 2 || nRot == 0 ) {
+			return;
+		}
 
-		prepareReceptor();
-		Grid& corrGrid = *(pfft->getGridTot());
+		// Quantize the extents of the sampled rotations up to the grid step,
+		// and count the rotations with the same quantized extents
 
-		bool doClusterTranslations;
-		gOptions.getdefault("doClusterTranslations",doClusterTranslations,false);
+		int qMax = int(std::ceil(ligPadFull/gridStep));
 
-		int maxNTransInp;
+		std::map<std::tuple<int,int,int>,int> counts;
 
-		gOptions.getdefault("maxNTransInp",maxNTransInp,this->maxNTrans*100);
+		int stepSample = std::max(1,nRot/maxNSample);
 
-		if( doClusterTranslations ) {
+		int nSample = 0;
 
-			T_num clusterRadiusTrans;
-			gOptions.getdefault("clusterRadiusTrans",clusterRadiusTrans,5.0);
+		for(int i_rot = 0; i_rot < nRot; i_rot += stepSample) {
 
-			pTranClust.reset(new TranClust(maxNTransInp, this->maxNTrans, clusterRadiusTrans));
+			Points posRot(molStruct.getPosLigand().copy());
 
-		}
+			rotations(i_rot)(posRot);
 
-		int nMultimer;
-		gOptions.getdefault("nMultimer",nMultimer,0);
+			Point ext = halfExtent(posRot);
 
-		if( nMultimer > 1 ) {
+			IntPoint q;
 
-			T_num maxRmsdSymm;
+			for(int j = 0; j < N_dim; j++) {
+				q(j) = std::min(int(std::ceil(ext(j)/gridStep)),qMax);
+			}
 
-			gOptions.getdefault("maxRmsdSymm",maxRmsdSymm,8.0);
+			counts[std::make_tuple(q(0),q(1),q(2))]++;
 
-			pTranSymm.reset(new TranSymm(nMultimer, maxRmsdSymm, this->pmolStruct->getSizeLigand()/2,
-				this->pmolStruct->getToOriginalFrameTransformer()));
+			nSample++;
 
 		}
 
+		std::vector<BoxClass> cands;
 
-		fftProc.init(corrGrid, maxNTransInp, maxValCorr);
+		std::vector<int> candCounts;
 
-		resetLigPosRot();
+		for(typename std::map<std::tuple<int,int,int>,int>::const_iterator p = counts.begin(); p != counts.end(); ++p) {
 
-	}
+			IntPoint q(std::get<0>(p->first),std::get<1>(p->first),std::get<2>(p->first));
 
-	void prepareReceptor() {
+			Point ligPadding;
 
-		ATLOG_TRACE_3;
+			for(int j = 0; j < N_dim; j++) {
+				ligPadding(j) = std::min(q(j)*gridStep,ligPadFull);
+			}
 
-		VPRawGrid& recGrid = pfft->getGridsRec();
-		this->pmolForce->projectMol(iRec,this->pmolStruct->getPosReceptor(),recGrid);
+			cands.push_back(makeClass(molStruct,ligPadding,gridStep));
 
-		pfft->preprocessReceptor();
+			candCounts.push_back(p->second);
 
-	}
+		}
 
-	void findTranslationalMinima() {
+		int nCand = cands.size();
 
-		ATTRACE_SWITCH_3(dbg::trace t1(DBG_HERE));
+		// cost of the sampled rotations of each candidate in the cheapest
+		// chosen class that covers them
 
-		VPRawGrid& ligGrid = pfft->getGridsLig();
+		std::vector<double> assignedCost(nCand,classes[0].cost);
 
-		this->pmolForce->projectMol(iLig,ligPosRot,ligGrid);
+		std::vector<bool> chosen(nCand,false);
 
-		pfft->correlate();
+		double totalCost = classes[0].cost*nSample;
 
-		this->pmolForce->collectTotal(pfft->getGridsOut(),pfft->getGridTot());
+		while( int(classes.size()) < maxNClasses ) {
 
-		fftProc.selectFromFFT();
+			int iBest = -1;
 
-		if( pTranSymm ) {
+			double gainBest = 0;
 
-			pTranSymm->init(currentRot);
+			for(int i_cand = 0; i_cand < nCand; i_cand++) {
 
-			fftProc.postProcess(pTranSymm);
+				if( chosen[i_cand] ) {
+					continue;
+				}
 
-		}
+				double gain = 0;
 
-		if( pTranClust ) {
+				for(int i_rot = 0; i_rot < nCand; i_rot++) {
+					if( covers(cands[i_cand],cands[i_rot]) && cands[i_cand].cost < assignedCost[i_rot] ) {
+						gain += (assignedCost[i_rot] - cands[i_cand].cost)*candCounts[i_rot];
+					}
+				}
 
-			fftProc.postProcess(pTranClust);
+				if( gain > gainBest ) {
+					gainBest = gain;
+					iBest = i_cand;
+				}
 
-		}
+			}
 
-		//dbg::out(dbg::info) << dbg::indent() << ATLOGVAR(ligGrid.getGridArray()) << '\n';
+			// not worth the memory of another set of grids
 
-	}
+			if( iBest < 0 || gainBest < 0.02*totalCost ) {
+				break;
+			}
 
+			chosen[iBest] = true;
 
-	void scanRotation() {
+			classes.push_back(cands[iBest]);
 
-		ATTRACE_SWITCH_3(dbg::trace t1(DBG_HERE));
+			for(int i_rot = 0; i_rot < nCand; i_rot++) {
+				if( covers(cands[iBest],cands[i_rot]) ) {
+					assignedCost[i_rot] = std::min(assignedCost[i_rot],cands[iBest].cost);
+				}
+			}
 
-		resetLigPosRot();
+			totalCost -= gainBest;
 
-		currentRot(ligPosRot);
+		}
 
-		findTranslationalMinima();
+		// shares of the classes as select() would assign the sampled rotations
 
-		TranValues tranVals = fftProc.getTranValuesFilled(this->maxNTrans);
+		for(size_t i_cl = 0; i_cl < classes.size(); i_cl++) {
+			classes[i_cl].share = 0;
+		}
 
-		ATLOG_OUT_4("Output translations: " << ATLOGVAR(tranVals.size()));
+		for(int i_rot = 0; i_rot < nCand; i_rot++) {
+			classes[select(cands[i_rot].ligPadding)].share += double(candCounts[i_rot])/nSample;
+		}
 
-		outputScannedRotation(currentRot,tranVals);
+		ATLOG_OUT_1("FFT box classes: " << classes.size() << ", model cost relative to the full box: " \
+			<< totalCost/(classes[0].cost*nSample));
 
-	}
+		for(size_t i_cl = 0; i_cl < classes.size(); i_cl++) {
+			ATLOG_OUT_2("FFT box class " << i_cl << ": " << ATLOGVAR(classes[i_cl].ligPadding) \
+				<< ATLOGVAR(classes[i_cl].sizeFft) << ATLOGVAR(classes[i_cl].share));
+		}
 
-	void outputScannedRotation(const Rotation& rot, const TranValues& tranVals) {
-		ATLOG_TRACE_3;
-		ATALWAYS(m_io_rot_scan->write_record(rot,tranVals),"Output failed");
 	}
 
-	void startOutputScannedRotations() {
-		ATLOG_TRACE_3;
-		std::string file_name;
-		gOptions.get("fft_rot_scan_res",file_name);
-		ATALWAYS(m_io_rot_scan.get() == 0,"Output object already exists");
-		m_io_rot_scan.reset(new RotFftScanIO_Bin(file_name,std::fstream::out));
+	int size() const {
+		return classes.size();
 	}
 
-	void finishOutputScannedRotations() {
-		ATLOG_TRACE_3;
-		ATALWAYS(m_io_rot_scan.get(),"Output object does not exist");
-		m_io_rot_scan.reset();
+	const BoxClass& operator[](int i_cl) const {
+		return classes[i_cl];
 	}
 
-	void run() {
+	// Cheapest class that fits the ligand with the half extents 'ext'
 
-		ATTRACE_SWITCH_3(dbg::trace t1(DBG_HERE));
+	int select(const Point& ext) const {
 
-		ATLOG_STD_EXCEPTIONS_TRY();
+		int iBest = 0;
 
-		startOutputScannedRotations();
+		for(int i_cl = 1; i_cl < int(classes.size()); i_cl++) {
+			if( blitz::all(ext <= classes[i_cl].ligPadding) && classes[i_cl].cost < classes[iBest].cost ) {
+				iBest = i_cl;
+			}
+		}
 
-		//process all rotations
-		while(! rotToRun.empty()) {
+		return iBest;
 
-			currentRot = rotToRun.front();
+	}
 
-			ATLOG_OUT_3(ATLOGVAR(currentRot.eulerAngles()));
-			scanRotation();
+	// Maximum absolute coordinate along each axis
 
-			rotToRun.pop_front();
+	static Point halfExtent(const Points& pos) {
 
-			ATLOG_OUT_3(ATLOGVAR(rotToRun.size()));
+		Point ext(0.);
 
+		for(int i = pos.lbound(0); i <= pos.ubound(0); i++) {
+			for(int j = 0; j < N_dim; j++) {
+				ext(j) = std::max(ext(j),T_num(std::abs(pos(i)(j))));
+			}
 		}
 
-		finishOutputScannedRotations();
-
-		ATLOG_STD_EXCEPTIONS_CATCH();
+		return ext;
 
 	}
 
+protected:
 
-	bool isForeman() const {
+	static BoxClass makeClass(MolStruct& molStruct, const Point& ligPadding, T_num gridStep) {
 
-		return false;
+		BoxClass cl;
 
-	}
+		cl.ligPadding = ligPadding;
 
+		const PointPair& boxFull = molStruct.getMinBox();
 
-	// This method must be used for testing only if
-	// called from Python, because I did not have time to figure out
-	// the life time and copy semantics of returned 
-	// smart pointer in Boost Python library.
+		Point shrink = molStruct.getLigPadding() - ligPadding;
 
-	PFFTCorrelator getFFTCorrelator(int iFft) {
-		return pfft->getFfts()(iFft);
-	}
+		cl.box(0) = boxFull(0) + shrink;
 
-	// This testing function will leave projections
-	// of receptor and ligand in corresponding grids
-	// of 'fft' object.
+		cl.box(1) = boxFull(1) - shrink;
 
-	void testProjection() {
+		cl.sizeFft = FFTCorrelator::sizeFor(cl.box,gridStep);
 
-		ATTRACE_SWITCH_3(dbg::trace t1(DBG_HERE));
+		cl.cost = Math::FFTShapeCost::modelCost(cl.sizeFft);
 
-		VPRawGrid& recGrid = pfft->getGridsRec();
-		this->pmolForce->projectMol(iRec,this->pmolStruct->getPosReceptor(),recGrid);
+		cl.share = 0;
 
-		VPRawGrid& ligGrid = pfft->getGridsLig();
-		this->pmolForce->projectMol(iLig,ligPosRot,ligGrid);
+		return cl;
 
-		//DEBUG:
-		//Checking for overflow. If everything is fine,
-		//correlation with a single 1 point should  give
-		//the orginal receptor grid.
-		//GridArray& recArr = recGrid.getGridArray();
-		//recArr = blitz::where(recArr > 100,100,recArr);
-		//ligGrid = 0;
-		//ligGrid(Point(0,0,0)) = 1;
+	}
 
+	static bool covers(const BoxClass& x, const BoxClass& y) {
+		return blitz::all(y.ligPadding <= x.ligPadding);
 	}
 
+	std::vector<BoxClass> classes;
 
-protected:
+};
 
-	void resetLigPosRot() {
-		ATLOG_TRACE_3;
-		ligPosRot.reference(this->pmolStruct->getPosLigand().copy());
-	}
 
-protected:
+// Scan of ligand rotations for one set of FFT grids.
+// It holds all state that changes from rotation to rotation (FFT grids
+// and plans, translation selection and post-processing), and only reads
+// the MolStruct and MolForce objects passed to init(). Thus, several
+// scanners sharing the same MolStruct and MolForce can scan different
+// rotations concurrently, as long as each one is used by a single thread.
+// init() projects the receptor and creates FFTW plans, and neither of those
+// is thread-safe, so all scanners must be initialized from one thread.
+// The MolForce object used to project the receptor in init() can differ
+// from the one that projects the ligand (see setLigand()).
 
-	// all rotations, forming a grid with a defined angle step
-	Rotations rotGrid;
+class RotScanner : public boost::noncopyable {
 
+public:
 
-	// rotations to process during docking
+	RotScanner():
+	  pmolStruct(0),
+	  pmolForce(0),
+	  maxNTrans(0),
+	  nMultimer(0),
+	  maxRmsdSymm(0)
+	  {}
+
+	// If 'pRecFrom' is given, the transformed receptor is copied from
+	// that (already initialized) scanner instead of being computed again.
+	// If 'pBoxClasses' is given, each class of the FFT box gets its own
+	// set of FFT grids, and every rotation is scanned on the grids of
+	// its class. 'pRecFrom' must then have the same classes.
+	// With the 'fftMaxMemoryMb' option, the classes whose FFT grids take
+	// more memory than that are correlated in slabs (see FFTSlabCorrelators),
+	// with the receptor spectra kept in a temporary file in 'fftSlabDir'.
+
+	void init(MolStruct& molStruct, MolForce& molForce, T_num gridStep, int _maxNTrans,
+		const RotScanner *pRecFrom = 0, const BoxClasses *pBoxClasses = 0) {
 
-	DequeRotations rotToRun;
+		ATLOG_TRACE_3;
+
+		pmolStruct = &molStruct;
+
+		pmolForce = &molForce;
+
+		maxNTrans = _maxNTrans;
+
+		minBox = molStruct.getMinBox();
+
+		//TODO: some intelligent estimate for default
+		//values of maxNTrans and maxValCorr
+
+		T_num maxValCorr;
+		gOptions.getdefault("maxValCorr",maxValCorr,T_num(0));
+
+		if( pBoxClasses ) {
+			boxClasses = *pBoxClasses;
+		}
+		else {
+			boxClasses.init(molStruct,Rotations(),gridStep,1);
+		}
+
+		bool doClusterTranslations;
+		gOptions.getdefault("doClusterTranslations",doClusterTranslations,false);
+
+		int maxNTransInp;
+
+		gOptions.getdefault("maxNTransInp",maxNTransInp,maxNTrans*100);
+
+		if( doClusterTranslations ) {
+
+			T_num clusterRadiusTrans;
+			gOptions.getdefault("clusterRadiusTrans",clusterRadiusTrans,5.0);
+
+			pTranClust.reset(new TranClust(maxNTransInp, maxNTrans, clusterRadiusTrans));
+
+		}
+
+		gOptions.getdefault("nMultimer",nMultimer,0);
+
+		gOptions.getdefault("maxRmsdSymm",maxRmsdSymm,T_num(8.0));
+
+		std::string restraintsFile;
+		gOptions.getdefault("restraintsFile",restraintsFile,std::string());
+
+		if( ! restraintsFile.empty() ) {
+
+			int restraintMinSatisfied;
+			gOptions.getdefault("restraintMinSatisfied",restraintMinSatisfied,-1);
+
+			T_num restraintPenalty;
+			gOptions.getdefault("restraintPenalty",restraintPenalty,T_num(0));
+
+			pRestraints.reset(new TranRestraints());
+
+			pRestraints->load(restraintsFile,restraintMinSatisfied,restraintPenalty);
+
+		}
+
+		int fftMaxMemoryMb;
+		gOptions.getdefault("fftMaxMemoryMb",fftMaxMemoryMb,0);
+
+		std::string fftSlabDir;
+		gOptions.getdefault("fftSlabDir",fftSlabDir,std::string("."));
+
+		double maxMemory = double(fftMaxMemoryMb)*1024*1024;
+
+		int nClasses = boxClasses.size();
+
+		ATALWAYS(pRecFrom == 0 || int(pRecFrom->classFfts.size()) == nClasses,
+			"Receptor is copied from a scanner with different FFT box classes");
+
+		classFfts.resize(nClasses);
+
+		classSlabs.resize(nClasses);
+
+		classProcs.resize(nClasses);
+
+		for(int i_cl = 0; i_cl < nClasses; i_cl++) {
+
+			const typename BoxClasses::BoxClass& cl = boxClasses[i_cl];
+
+			bool useSlabs = fftMaxMemoryMb > 0 &&
+				FFTCorrelators::memoryFor(cl.sizeFft,pmolForce->nGrids()) > maxMemory;
+
+			if( useSlabs ) {
+
+				ATALWAYS(! pRestraints,"Restraints are not supported with the fftMaxMemoryMb option");
+
+				// rotations of the first class can extend the ligand up to
+				// its largest distance from the origin
+
+				T_num ligExtent = cl.ligPadding(0);
+
+				if( i_cl == 0 ) {
+					const Points& ligPos = molStruct.getPosLigand();
+					for(int i = ligPos.lbound(0); i <= ligPos.ubound(0); i++) {
+						ligExtent = std::max(ligExtent,T_num(std::sqrt(blitz::dot(ligPos(i),ligPos(i)))));
+					}
+				}
+
+				classSlabs[i_cl].reset(new FFTSlabCorrelators(cl.box,gridStep,pmolForce->nGrids(),
+					pmolForce->isSpectralSum(),ligExtent,maxMemory,fftSlabDir));
+
+			}
+			else {
+
+				classFfts[i_cl].reset(new FFTCorrelators(cl.box,gridStep,pmolForce->nGrids(),
+					pmolForce->isSpectralSum()));
+
+			}
+
+			classProcs[i_cl].reset(new CorrelationProcessor());
+
+			selectClass(i_cl);
+
+			if( pRecFrom ) {
+				ATALWAYS(bool(pRecFrom->classSlabs[i_cl]) == useSlabs,
+					"Receptor is copied from a scanner with a different FFT memory limit");
+				if( pslab ) {
+					pslab->copyReceptor(*pRecFrom->classSlabs[i_cl]);
+				}
+				else {
+					pfft->copyReceptor(*pRecFrom->classFfts[i_cl]);
+				}
+			}
+			else {
+				prepareReceptor();
+			}
+
+			if( pslab ) {
+				pfftProc->initSlabs(*(pslab->getGridTot()), pslab->sizeFft(), maxNTransInp, maxValCorr);
+			}
+			else {
+				pfftProc->init(*(pfft->getGridTot()), maxNTransInp, maxValCorr);
+			}
+
+		}
+
+		selectClass(0);
+
+		setLigand(molStruct,molForce);
+
+	}
+
+	// Switch to another ligand. 'molStruct' must have the same receptor
+	// box as the one passed to init(), and 'molForce' must be of the same
+	// type as the one passed to init().
+
+	void setLigand(MolStruct& molStruct, MolForce& molForce) {
+
+		ATLOG_TRACE_3;
+
+		ATALWAYS(blitz::all(molStruct.getMinBox()(0) == minBox(0)) &&
+			blitz::all(molStruct.getMinBox()(1) == minBox(1)),
+			"Receptor box of the ligand does not match the FFT grid");
+
+		ATALWAYS(molForce.isSpectralSum() == (pslab ? pslab->sumsSpectra() : pfft->sumsSpectra()),
+			"Potential of the ligand does not match the FFT correlators");
+
+		ATALWAYS(boxClasses.size() == 1 || &molStruct == pmolStruct,
+			"FFT box classes are made for the ligand passed to init()");
+
+		pmolStruct = &molStruct;
+
+		pmolForce = &molForce;
+
+		if( nMultimer > 1 ) {
+
+			pTranSymm.reset(new TranSymm(nMultimer, maxRmsdSymm, pmolStruct->getSizeLigand()/2,
+				pmolStruct->getToOriginalFrameTransformer()));
+
+		}
+
+		if( pRestraints ) {
+			pRestraints->setMolecules(pmolStruct->getPosReceptor(),pmolStruct->getPosLigand().size());
+		}
+
+		resetLigPosRot();
+
+	}
+
+	// Find the best translations of the ligand rotated by 'rot'.
+	// 'tranVals' receives its own copy of at most maxNTrans values.
+
+	void scan(const Rotation& rot, TranValues& tranVals) {
+
+		ATTRACE_SWITCH_3(dbg::trace t1(DBG_HERE));
+
+		Prof::count(Prof::CNT_ROTATIONS);
+
+		currentRot = rot;
+
+		currentRot(pmolStruct->getPosLigand(),ligPosRot);
+
+		if( boxClasses.size() > 1 ) {
+			selectClass(boxClasses.select(BoxClasses::halfExtent(ligPosRot)));
+		}
+
+		findTranslationalMinima();
+
+		tranVals.reference(pfftProc->getTranValuesFilled(maxNTrans).copy());
+
+	}
+
+	PFFTCorrelator getFFTCorrelator(int iFft) {
+		ATALWAYS(pfft,"FFT grids are split into slabs");
+		return pfft->getFfts()(iFft);
+	}
+
+	// Relative cost of scanning one rotation: total number of points
+	// in the FFT grids (averaged over the box classes). Each grid takes
+	// one forward and one inverse transform per rotation, and that
+	// dominates everything else. The grids of a class split into slabs
+	// are counted for every slab.
+
+	double costUnits() const {
+		double units = 0;
+		for(int i_cl = 0; i_cl < boxClasses.size(); i_cl++) {
+			double nPoints;
+			if( classSlabs[i_cl] ) {
+				IntPoint n = classSlabs[i_cl]->sizeFftSlab();
+				nPoints = double(n(0))*n(1)*n(2)*classSlabs[i_cl]->nSlabs();
+			}
+			else {
+				IntPoint n = classFfts[i_cl]->sizeFft();
+				nPoints = double(n(0))*n(1)*n(2);
+			}
+			units += boxClasses[i_cl].share*nPoints*nGrids();
+		}
+		return units;
+	}
+
+	// FFT size of the full box
+
+	IntPoint sizeFft() const {
+		return classSlabs[0] ? classSlabs[0]->sizeFft() : classFfts[0]->sizeFft();
+	}
+
+	int nBoxClasses() const {
+		return boxClasses.size();
+	}
+
+	int nGrids() const {
+		return pslab ? pslab->size() : pfft->size();
+	}
+
+	void testProjection() {
+
+		ATTRACE_SWITCH_3(dbg::trace t1(DBG_HERE));
+
+		ATALWAYS(pfft,"FFT grids are split into slabs");
+
+		VPRawGrid& recGrid = pfft->getGridsRec();
+		pmolForce->projectMol(iRec,pmolStruct->getPosReceptor(),recGrid);
+
+		VPRawGrid& ligGrid = pfft->getGridsLig();
+		pmolForce->projectMol(iLig,ligPosRot,ligGrid);
+
+	}
+
+protected:
+
+	void prepareReceptor() {
+
+		ATLOG_TRACE_3;
+
+		if( pslab ) {
+			for(int i_slab = 0; i_slab < pslab->nSlabs(); i_slab++) {
+				VPRawGrid& recGrid = pslab->getGridsRec(i_slab);
+				{
+					Prof::ScopedTimer t(Prof::PH_PROJECT);
+					pmolForce->projectMol(iRec,pmolStruct->getPosReceptor(),recGrid);
+				}
+				pslab->preprocessReceptor(i_slab);
+			}
+			return;
+		}
+
+		VPRawGrid& recGrid = pfft->getGridsRec();
+		{
+			Prof::ScopedTimer t(Prof::PH_PROJECT);
+			pmolForce->projectMol(iRec,pmolStruct->getPosReceptor(),recGrid);
+		}
+
+		pfft->preprocessReceptor();
+
+	}
+
+	void findTranslationalMinima() {
+
+		ATTRACE_SWITCH_3(dbg::trace t1(DBG_HERE));
+
+		if( pslab ) {
+			scanSlabs();
+		}
+		else {
+
+			VPRawGrid& ligGrid = pfft->getGridsLig();
+
+			{
+				Prof::ScopedTimer t(Prof::PH_PROJECT);
+				pmolForce->projectMol(iLig,ligPosRot,ligGrid);
+			}
+
+			pfft->correlate();
+
+			if( ! pfft->sumsSpectra() ) {
+				Prof::ScopedTimer t(Prof::PH_COLLECT_TOTAL);
+				pmolForce->collectTotal(pfft->getGridsOut(),pfft->getGridTot());
+			}
+
+			if( pRestraints ) {
+				pfftProc->setRestraints(*pRestraints,ligPosRot);
+			}
+
+			pfftProc->selectFromFFT();
+
+		}
+
+		if( pTranSymm ) {
+
+			Prof::ScopedTimer t(Prof::PH_SYMMETRY);
+
+			pTranSymm->init(currentRot);
+
+			pfftProc->postProcess(pTranSymm);
+
+		}
+
+		if( pTranClust ) {
+
+			Prof::ScopedTimer t(Prof::PH_CLUSTER);
+
+			pfftProc->postProcess(pTranClust);
+
+		}
+
+		//dbg::out(dbg::info) << dbg::indent() << ATLOGVAR(ligGrid.getGridArray()) << '\n';
+
+	}
+
+	// Translations of the current rotation from the FFT slabs
+
+	void scanSlabs() {
+
+		ATALWAYS(pslab->fitsLigand(ligPosRot),"Ligand does not fit into the FFT slabs");
+
+		VPRawGrid& ligGrid = pslab->getGridsLig();
+
+		{
+			Prof::ScopedTimer t(Prof::PH_PROJECT);
+			pmolForce->projectMol(iLig,ligPosRot,ligGrid);
+		}
+
+		pslab->transformLigand();
+
+		pfftProc->beginSlabs();
+
+		for(int i_slab = 0; i_slab < pslab->nSlabs(); i_slab++) {
+
+			pslab->correlate(i_slab);
+
+			if( ! pslab->sumsSpectra() ) {
+				Prof::ScopedTimer t(Prof::PH_COLLECT_TOTAL);
+				pmolForce->collectTotal(pslab->getGridsOut(),pslab->getGridTot());
+			}
+
+			pfftProc->selectFromSlab(pslab->slabWidth(i_slab),pslab->slabOffset(i_slab));
+
+		}
+
+		pfftProc->endSlabs();
+
+	}
+
+	void resetLigPosRot() {
+		ATLOG_TRACE_3;
+		ligPosRot.reference(pmolStruct->getPosLigand().copy());
+	}
+
+	void selectClass(int i_cl) {
+		pfft = classFfts[i_cl];
+		pslab = classSlabs[i_cl];
+		pfftProc = classProcs[i_cl];
+	}
+
+protected:
+
+	MolStruct *pmolStruct;
+
+	MolForce *pmolForce;
+
+	int maxNTrans;
+
+	int nMultimer;
+
+	T_num maxRmsdSymm;
+
+	// receptor box for which the FFT grids were created
+
+	PointPair minBox;
+
+	BoxClasses boxClasses;
+
+	// FFT grids and translation selection for each box class
+
+	std::vector<PFFTCorrelators> classFfts;
+
+	// FFT slabs instead of classFfts for the classes over the memory limit
+
+	std::vector<PFFTSlabCorrelators> classSlabs;
+
+	std::vector<PCorrelationProcessor> classProcs;
+
+	// those of the class of the current rotation (only one of pfft and
+	// pslab is set)
 
 	PFFTCorrelators pfft;
 
-	CorrelationProcessor fftProc;
+	PFFTSlabCorrelators pslab;
+
+	PCorrelationProcessor pfftProc;
 
 	PTranProcessor pTranClust;
 
 	PTranSymm pTranSymm;
 
+	PTranRestraints pRestraints;
+
 	// ligand atomic coordinates for the current rotation
 
 	Points ligPosRot;
 
-
 	// current rotation as Rotation object
 
 	Rotation currentRot;
 
-	/// IO object for IPC
+};
+
+typedef boost::shared_ptr<RotScanner> PRotScanner;
+
+
+// Scan of a range of rotations, written into a file for the 'gather' task.
+// The worker can split off the unfinished tail of its range, either when
+// it receives SIGUSR1 or when it runs longer than 'scanTimeLimit' seconds.
+// It then writes the results for the rotations already scanned, and the
+// tail range [start,end) into the file 'fft_rot_scan_tail', from where the
+// 'gather' task picks it up (see Gatherer). The tail file is always written
+// (with an empty range if the scan is complete). Without that option,
+// split requests are ignored.
+// The output file is checkpointed every 'checkpointSec' seconds (default 60,
+// negative to disable) into the sidecar file '<fft_rot_scan_res>.ckpt'
+// (see RotFftScanIO_Checkpointed). A task restarted with the same range of
+// rotations continues from the next rotation after the checkpoint.
+
+class Worker : public App {
+
+public:
+
+	typedef App Base;
+	typedef Worker Self;
+
+	typedef std::chrono::steady_clock Clock;
+
+
+public:
+
+	void init(const MolForceParams& mfParams) {
+
+		ATLOG_TRACE_3;
+
+		Base::init(mfParams);
+
+		std::string anglesFile;
+		gOptions.get("anglesFile",anglesFile);
+
+		rotGrid.reference(Geom::loadRotationalGrid<T_num>(anglesFile));
+
+		rotToRun.clear();
+
+		int fft_rot_grid_start = 0;
+		gOptions.get("fft_rot_grid_start",fft_rot_grid_start);
+
+		ATALWAYS(fft_rot_grid_start >= 0 && fft_rot_grid_start < rotGrid.size(),\
+			"Rotation start index is out of bound");
+
+		int fft_rot_grid_end = 0;
+		gOptions.get("fft_rot_grid_end",fft_rot_grid_end);
+
+		ATALWAYS(fft_rot_grid_end >= fft_rot_grid_start,\
+			"rotation end index is out of bound");
+
+		 if(fft_rot_grid_end > rotGrid.size()) {
+			 fft_rot_grid_end = rotGrid.size();
+		 }
+
+		for( int i = fft_rot_grid_start; i < fft_rot_grid_end; i++) 
+			rotToRun.push_back(rotGrid(i));
+
+		rotStart = fft_rot_grid_start;
+
+		rotEnd = fft_rot_grid_end;
+
+		gOptions.getdefault("scanTimeLimit",scanTimeLimit,0.);
+
+		gOptions.getdefault("checkpointSec",checkpointSec,60.);
+
+		canSplit = gOptions.has_option("fft_rot_scan_tail");
+
+		if( canSplit ) {
+			splitSignaled() = 0;
+#ifdef SIGUSR1
+			std::signal(SIGUSR1,&Self::onSplitSignal);
+#endif
+		}
+
+		int nBoxClasses;
+		gOptions.getdefault("fftBoxClasses",nBoxClasses,1);
+
+		BoxClasses boxClasses;
+		boxClasses.init(*this->pmolStruct,rotGrid,this->gridStep,nBoxClasses);
+
+		scanner.init(*this->pmolStruct,*this->pmolForce,this->gridStep,this->maxNTrans,0,&boxClasses);
+
+	}
+
+	// Self-benchmark for planning the split of the rotational grid into tasks.
+	// Scans the first rotation of the range as a warm-up, then times
+	// the next 'nRot' ones. Returns seconds per rotation.
+
+	double timeRotations(int nRot) {
+
+		ATLOG_TRACE_3;
+
+		ATALWAYS(nRot > 0 && int(rotToRun.size()) > nRot,"Not enough rotations to benchmark");
+
+		TranValues tranVals;
+
+		scanner.scan(rotToRun[0],tranVals);
+
+		Clock::time_point start = Clock::now();
+
+		for(int i_rot = 1; i_rot <= nRot; i_rot++) {
+			scanner.scan(rotToRun[i_rot],tranVals);
+		}
+
+		return std::chrono::duration<double>(Clock::now() - start).count() / nRot;
+
+	}
+
+	const RotScanner& getScanner() const {
+		return scanner;
+	}
+
+	int getNRotGrid() const {
+		return rotGrid.size();
+	}
+
+	void scanRotation() {
+
+		ATTRACE_SWITCH_3(dbg::trace t1(DBG_HERE));
+
+		TranValues tranVals;
+
+		scanner.scan(currentRot,tranVals);
+
+		ATLOG_OUT_4("Output translations: " << ATLOGVAR(tranVals.size()));
+
+		outputScannedRotation(currentRot,tranVals);
+
+	}
+
+	void outputScannedRotation(const Rotation& rot, const TranValues& tranVals) {
+		ATLOG_TRACE_3;
+		Prof::ScopedTimer t(Prof::PH_IO);
+		ATALWAYS(m_io_rot_scan.write_record(rot,tranVals),"Output failed");
+		Prof::count(Prof::CNT_BYTES_WRITTEN,RotFftScanIO_Bin::record_size(tranVals.size()));
+	}
+
+	// Open the output file, resuming from the checkpoint if there is a valid one.
+	// Rotations found in the checkpoint are removed from rotToRun.
+
+	void startOutputScannedRotations() {
+		ATLOG_TRACE_3;
+		std::string resFile;
+		gOptions.get("fft_rot_scan_res",resFile);
+		int nDone = m_io_rot_scan.open(resFile,rotStart,rotEnd,rotToRun,checkpointSec >= 0);
+		if( nDone > 0 ) {
+			ATLOG_OUT_1("Resuming " << resFile << " after " << nDone << " rotations");
+			rotToRun.erase(rotToRun.begin(),rotToRun.begin() + nDone);
+		}
+	}
+
+	void finishOutputScannedRotations() {
+		ATLOG_TRACE_3;
+		m_io_rot_scan.close();
+	}
+
+	void writeCheckpoint() {
+		ATLOG_TRACE_3;
+		Prof::ScopedTimer t(Prof::PH_IO);
+		m_io_rot_scan.write_checkpoint();
+	}
+
+	void run() {
+
+		ATTRACE_SWITCH_3(dbg::trace t1(DBG_HERE));
+
+		ATLOG_STD_EXCEPTIONS_TRY();
+
+		startOutputScannedRotations();
+
+		Clock::time_point start = Clock::now();
+
+		Clock::time_point lastCkpt = start;
+
+		//process all rotations
+		while(! rotToRun.empty()) {
+
+			currentRot = rotToRun.front();
+
+			ATLOG_OUT_3(ATLOGVAR(currentRot.eulerAngles()));
+			scanRotation();
+
+			rotToRun.pop_front();
+
+			ATLOG_OUT_3(ATLOGVAR(rotToRun.size()));
+
+			if( checkpointSec >= 0 && ! rotToRun.empty() &&
+				std::chrono::duration<double>(Clock::now() - lastCkpt).count() >= checkpointSec ) {
+
+				writeCheckpoint();
+
+				lastCkpt = Clock::now();
+
+			}
+
+			if( canSplit && ! rotToRun.empty() && splitRequested(start) ) {
+
+				ATLOG_OUT_1("Splitting off the tail of " << rotToRun.size() << " rotations");
+
+				break;
+
+			}
+
+		}
+
+		finishOutputScannedRotations();
+
+		if( canSplit ) {
+			writeTail(rotEnd - int(rotToRun.size()),rotEnd);
+		}
+
+		ATLOG_STD_EXCEPTIONS_CATCH();
+
+	}
+
+
+	bool isForeman() const {
+
+		return false;
+
+	}
+
+
+	// This method must be used for testing only if
+	// called from Python, because I did not have time to figure out
+	// the life time and copy semantics of returned 
+	// smart pointer in Boost Python library.
+
+	PFFTCorrelator getFFTCorrelator(int iFft) {
+		return scanner.getFFTCorrelator(iFft);
+	}
+
+	// This testing function will leave projections
+	// of receptor and ligand in corresponding grids
+	// of 'fft' object.
+
+	void testProjection() {
+
+		scanner.testProjection();
+
+		//DEBUG:
+		//Checking for overflow. If everything is fine,
+		//correlation with a single 1 point should  give
+		//the orginal receptor grid.
+		//GridArray& recArr = recGrid.getGridArray();
+		//recArr = blitz::where(recArr > 100,100,recArr);
+		//ligGrid = 0;
+		//ligGrid(Point(0,0,0)) = 1;
+
+	}
+
+
+protected:
+
+	static volatile std::sig_atomic_t& splitSignaled() {
+		static volatile std::sig_atomic_t flag = 0;
+		return flag;
+	}
+
+	static void onSplitSignal(int) {
+		splitSignaled() = 1;
+	}
+
+	bool splitRequested(const Clock::time_point& start) const {
+		return splitSignaled() ||
+			( scanTimeLimit > 0 &&
+			std::chrono::duration<double>(Clock::now() - start).count() > scanTimeLimit );
+	}
+
+	void writeTail(int tailStart, int tailEnd) {
+		ATLOG_TRACE_3;
+		std::string file_name;
+		gOptions.get("fft_rot_scan_tail",file_name);
+		std::ofstream out(file_name.c_str());
+		out << tailStart << ' ' << tailEnd << '\n';
+		ATALWAYS(out.good(),"Unable to write rotation tail file: " + file_name);
+	}
+
+protected:
+
+	// all rotations, forming a grid with a defined angle step
+	Rotations rotGrid;
+
+
+	// rotations to process during docking
+
+	DequeRotations rotToRun;
+
+	// range [rotStart,rotEnd) of rotGrid for this task
+
+	int rotStart;
+
+	int rotEnd;
+
+	// checkpoint interval (s), negative if disabled
+
+	double checkpointSec;
+
+	// split off the tail of the range after this time (s), if positive
+
+	double scanTimeLimit;
+
+	bool canSplit;
+
+	RotScanner scanner;
+
+	// current rotation as Rotation object
+
+	Rotation currentRot;
+
+	/// IO object for IPC
+
+	RotFftScanIO_Checkpointed m_io_rot_scan;
+
+
+};
+
+
+// Complete rotational scan within one process: the rotations are
+// scanned by several threads, and the results are collected
+// directly into the Foreman's queue without any intermediate files.
+// Each thread has its own RotScanner, while MolStruct and MolForce
+// are shared by all of them.
+// The results are merged in the order of rotations, and are therefore
+// identical to those of the 'rot-scan' tasks followed by 'gather' over
+// the same range of rotations, regardless of the number of threads.
+
+class Docker : public Foreman {
+
+public:
+
+	typedef Foreman Base;
+	typedef Docker Self;
+
+public:
+
+	void init(const MolForceParams& mfParams) {
+
+		ATLOG_TRACE_3;
+
+		Base::init(mfParams);
+
+		initRotations();
+
+		initScanners(*this->pmolStruct,*this->pmolForce);
+
+	}
+
+	void run() {
+
+		ATLOG_TRACE_3;
+
+		ATLOG_STD_EXCEPTIONS_TRY();
+
+		scanAndCollect();
+
+		this->rtvalQueue.sort();
+
+		ATLOG_STD_EXCEPTIONS_CATCH();
+
+	}
+
+protected:
+
+	// Load the rotational grid and select the range of rotations to scan.
+	// Also sets the number of threads.
+
+	void initRotations() {
+
+		ATLOG_TRACE_3;
+
+		std::string anglesFile;
+		gOptions.get("anglesFile",anglesFile);
+
+		rotGrid.reference(Geom::loadRotationalGrid<T_num>(anglesFile));
+
+		int nRotGrid = rotGrid.size();
+
+		int fft_rot_grid_start;
+		gOptions.getdefault("fft_rot_grid_start",fft_rot_grid_start,0);
+
+		int fft_rot_grid_end;
+		gOptions.getdefault("fft_rot_grid_end",fft_rot_grid_end,nRotGrid);
+
+		if( this->testMode ) {
+			int testMaxRot;
+			gOptions.getdefault("testMaxRot",testMaxRot,nRotGrid);
+			fft_rot_grid_end = std::min(fft_rot_grid_end,fft_rot_grid_start + testMaxRot);
+		}
+
+		ATALWAYS(fft_rot_grid_start >= 0 && fft_rot_grid_start < nRotGrid,\
+			"Rotation start index is out of bound");
+
+		ATALWAYS(fft_rot_grid_end >= fft_rot_grid_start,\
+			"rotation end index is out of bound");
+
+		rotStart = fft_rot_grid_start;
+
+		rotEnd = std::min(fft_rot_grid_end,nRotGrid);
+
+		gOptions.getdefault("nThreads",nThreads,0);
+
+		nThreads = std::max(1,std::min(Parallel::resolveThreads(nThreads),rotEnd - rotStart));
+
+		ATLOG_OUT_1("Scanning " << (rotEnd - rotStart) << " rotations with " << nThreads << " threads");
+
+	}
+
+	// Create one scanner per thread. The receptor is projected and
+	// transformed only by the first one, the others copy it.
+	// Serial, see the comment to RotScanner.
+	// With 'byLigOrientation', the FFT box is split into classes
+	// (see BoxClasses) when the option 'fftBoxClasses' is above 1.
+	// That requires the ligand of the scanners to stay the same.
+
+	void initScanners(MolStruct& molStruct, MolForce& molForce, bool byLigOrientation = true) {
+
+		ATLOG_TRACE_3;
+
+		int nBoxClasses;
+		gOptions.getdefault("fftBoxClasses",nBoxClasses,1);
+
+		BoxClasses boxClasses;
+		boxClasses.init(molStruct,rotGrid,this->gridStep,byLigOrientation ? nBoxClasses : 1);
+
+		scanners.clear();
+
+		scanners.resize(nThreads);
+
+		for(int i_thr = 0; i_thr < nThreads; i_thr++) {
+
+			scanners[i_thr].reset(new RotScanner());
+
+			scanners[i_thr]->init(molStruct,molForce,this->gridStep,this->maxNTrans,
+				i_thr > 0 ? scanners[0].get() : 0,&boxClasses);
+
+		}
+
+	}
+
+	// Scan all selected rotations with the current ligand of the
+	// scanners, and push the results into the queue
+
+	void scanAndCollect() {
+
+		std::vector<TranValues> rotResults;
+
+		scanRotations(rotStart,rotEnd,rotResults);
+
+		for(int i_rot = rotStart; i_rot < rotEnd; i_rot++) {
+
+			this->collectRotTranVals(rotGrid(i_rot),rotResults[i_rot - rotStart]);
+
+		}
+
+	}
+
+	// Scan rotations [begin,end) of rotGrid with all scanners.
+	// 'rotResults[i]' receives the translations for the rotation 'begin + i'.
+
+	void scanRotations(int begin, int end, std::vector<TranValues>& rotResults) {
+
+		int nRot = end - begin;
+
+		// The cost of every rotation is about the same, but threads still
+		// take the next rotation from the shared counter to even out the
+		// difference in the speed of cores
+
+		rotResults.clear();
+
+		rotResults.resize(nRot);
+
+		std::atomic<int> nextRot(0);
+
+		int nThr = std::min(int(scanners.size()),nRot);
+
+		Parallel::runThreads(nThr,[&](int i_thr) {
+
+			RotScanner& scanner = *scanners[i_thr];
+
+			for(int i_rot = nextRot++; i_rot < nRot; i_rot = nextRot++) {
+
+				scanner.scan(rotGrid(begin + i_rot),rotResults[i_rot]);
+
+			}
+
+		});
+
+	}
+
+protected:
+
+	// all rotations, forming a grid with a defined angle step
+	Rotations rotGrid;
+
+	// range [rotStart,rotEnd) of rotGrid to scan
+
+	int rotStart;
+
+	int rotEnd;
+
+	int nThreads;
+
+	// one scanner per thread
+
+	std::vector<PRotScanner> scanners;
+
+};
+
+
+// 'gather' task: collects the results of the 'rot-scan' tasks (as Foreman
+// does), and then scans, with the threads of this process, the tail
+// ranges that the tasks split off (see Worker). The tail files are listed
+// in the file 'fft_rot_tail_list' (optional). The scanners are created only
+// if some tail is not empty.
+
+class Gatherer : public Docker {
+
+public:
+
+	typedef Docker Base;
+	typedef Gatherer Self;
+
+public:
+
+	void init(const MolForceParams& mfParams) {
+
+		ATLOG_TRACE_3;
+
+		Foreman::init(mfParams);
+
+	}
+
+	void run() {
+
+		ATLOG_TRACE_3;
+
+		ATLOG_STD_EXCEPTIONS_TRY();
+
+		this->startCollectRotTranVals();
+
+		while(this->nextCollectRotTranVals()) {
+
+			this->collectRotTranVals(this->doneRot,this->tranValues);
+
+		}
+
+		this->finishCollectRotTranVals();
+
+		std::vector<std::pair<int,int> > tails;
+
+		readTails(tails);
+
+		if( ! tails.empty() ) {
+
+			this->initRotations();
+
+			this->initScanners(*this->pmolStruct,*this->pmolForce);
+
+			std::vector<TranValues> rotResults;
+
+			for(size_t i_tail = 0; i_tail < tails.size(); i_tail++) {
+
+				int begin = tails[i_tail].first, end = tails[i_tail].second;
+
+				ATALWAYS(begin >= 0 && end <= int(this->rotGrid.size()),"Rotation tail is out of bound");
+
+				ATLOG_OUT_1("Scanning rotation tail [" << begin << "," << end << ")");
+
+				this->scanRotations(begin,end,rotResults);
+
+				for(int i_rot = begin; i_rot < end; i_rot++) {
+
+					this->collectRotTranVals(this->rotGrid(i_rot),rotResults[i_rot - begin]);
+
+				}
+
+			}
+
+		}
+
+		this->rtvalQueue.sort();
+
+		ATLOG_STD_EXCEPTIONS_CATCH();
+
+	}
+
+protected:
+
+	// Non-empty ranges from the tail files
+
+	void readTails(std::vector<std::pair<int,int> >& tails) {
+
+		ATLOG_TRACE_3;
+
+		tails.clear();
+
+		if( ! gOptions.has_option("fft_rot_tail_list") ) {
+			return;
+		}
+
+		std::string fft_rot_tail_list;
+		gOptions.get("fft_rot_tail_list",fft_rot_tail_list);
+
+		std::ifstream list_in(fft_rot_tail_list.c_str());
+
+		ATALWAYS(list_in.good(),"Unable to open rotation tail list file: " + fft_rot_tail_list);
+
+		std::string file_name;
+
+		while( std::getline(list_in,file_name) ) {
+
+			if( file_name.empty() ) {
+				continue;
+			}
+
+			std::ifstream tail_in(file_name.c_str());
+
+			int begin = 0, end = 0;
+
+			tail_in >> begin >> end;
+
+			ATALWAYS(! tail_in.fail(),"Unable to read rotation tail file: " + file_name);
+
+			if( end > begin ) {
+				tails.push_back(std::make_pair(begin,end));
+			}
+
+		}
+
+	}
+
+};
+
+
+// Screening of many ligands against one receptor.
+// The ligands are split into classes that share the receptor side of the
+// calculation: the FFT box (the receptor box is padded by a ligand size
+// rounded up to 'screenLigSizeStep') and the receptor fields (they depend on
+// the ligand average LJ parameters, rounded to 'screenSigmaStep' and
+// 'screenEpsStep'; a zero step means no rounding).
+// The receptor is projected and transformed once per class, and all ligands
+// of the class are then scanned with the same set of per-thread scanners.
+// Results for each ligand are written with IORigid into its own file.
+// Ligands are processed class by class, in the order of the first ligand
+// of each class.
+
+class Screener : public Docker {
+
+public:
+
+	typedef Docker Base;
+	typedef Screener Self;
+
+protected:
+
+	// (box ligand size, ligand sigma, ligand eps)
+
+	typedef blitz::TinyVector<T_num,3> ClassKey;
+
+	struct cmp_class_key : public std::binary_function<ClassKey,ClassKey,bool> {
+
+		bool operator()(const ClassKey& x, const ClassKey& y) const {
+
+			return std::lexicographical_compare(x.begin(),x.end(),y.begin(),y.end());
+
+		}
+
+	};
+
+public:
+
+	// Element 'i' of 'ligParams' holds the receptor and ligand 'i' (see load_from_hdf5()),
+	// 'resFiles[i]' is the output file for ligand 'i'. Only ligands in the range
+	// given by options 'screen_lig_start' and 'screen_lig_end' are docked.
+
+	void init(const std::vector<MolForceParams>& _ligParams, const std::vector<std::string>& _resFiles) {
+
+		ATLOG_TRACE_3;
+
+		ATALWAYS(_ligParams.size() > 0,"No ligands to screen");
+
+		ATALWAYS(_ligParams.size() == _resFiles.size(),"Number of result files does not match the number of ligands");
+
+		Foreman::init(_ligParams[0]);
+
+		pligParams = &_ligParams;
+
+		resFiles = _resFiles;
+
+		int nLig = _ligParams.size();
+
+		gOptions.getdefault("screen_lig_start",ligStart,0);
+
+		gOptions.getdefault("screen_lig_end",ligEnd,nLig);
+
+		ligEnd = std::min(ligEnd,nLig);
+
+		ATALWAYS(ligStart >= 0 && ligStart <= ligEnd,"Ligand start index is out of bound");
+
+		gOptions.getdefault("screenLigSizeStep",ligSizeStep,T_num(8));
+
+		gOptions.getdefault("screenSigmaStep",sigmaStep,T_num(0.05));
+
+		gOptions.getdefault("screenEpsStep",epsStep,T_num(0.01));
+
+		initRotations();
+
+	}
+
+	void run() {
+
+		ATLOG_TRACE_3;
+
+		ATLOG_STD_EXCEPTIONS_TRY();
+
+		const std::vector<MolForceParams>& ligParams = *pligParams;
+
+		// group ligands into classes
+
+		std::vector<ClassKey> keys;
+
+		std::map<ClassKey,int,cmp_class_key> keyToClass;
+
+		std::vector<std::vector<int> > classLigs;
+
+		for(int i_lig = ligStart; i_lig < ligEnd; i_lig++) {
+
+			ClassKey key = classKey(ligParams[i_lig]);
+
+			typename std::map<ClassKey,int,cmp_class_key>::iterator p_key = keyToClass.find(key);
+
+			if( p_key == keyToClass.end() ) {
+				p_key = keyToClass.insert(std::make_pair(key,int(keys.size()))).first;
+				keys.push_back(key);
+				classLigs.push_back(std::vector<int>());
+			}
+
+			classLigs[p_key->second].push_back(i_lig);
+
+		}
+
+		ATLOG_OUT_1("Screening " << (ligEnd - ligStart) << " ligands in " << keys.size() << " receptor classes");
+
+		for(int i_class = 0; i_class < int(keys.size()); i_class++) {
+
+			const ClassKey& key = keys[i_class];
+
+			const std::vector<int>& ligs = classLigs[i_class];
+
+			ATLOG_OUT_2("Receptor class " << i_class << ": " << ATLOGVAR(key) << ATLOGVAR(ligs.size()));
+
+			// Receptor fields are computed from the parameters where the ligand
+			// is replaced by one atom with the LJ parameters of the class
+
+			MolForceParams recParams;
+
+			recParams.reference(ligParams[ligs[0]]);
+
+			recParams.sigma(iLig).reference(Floats(1));
+			recParams.sigma(iLig) = key(1);
+
+			recParams.eps(iLig).reference(Floats(1));
+			recParams.eps(iLig) = key(2);
+
+			PMolForce recForce(this->newMolForce(recParams));
+
+			PMolStruct firstStruct(new MolStruct(ligParams[ligs[0]],key(0)));
+
+			// all ligands of the class share the scanners
+			initScanners(*firstStruct,*recForce,false);
+
+			for(size_t i = 0; i < ligs.size(); i++) {
+
+				int i_lig = ligs[i];
+
+				if( i == 0 ) {
+					this->pmolStruct = firstStruct;
+				}
+				else {
+					this->pmolStruct.reset(new MolStruct(ligParams[i_lig],key(0)));
+				}
+
+				this->pmolForce.reset(this->newMolForce(ligParams[i_lig]));
+
+				for(size_t i_thr = 0; i_thr < this->scanners.size(); i_thr++) {
+
+					this->scanners[i_thr]->setLigand(*this->pmolStruct,*this->pmolForce);
+
+				}
+
+				this->resetResults();
+
+				scanAndCollect();
+
+				this->rtvalQueue.sort();
+
+				this->writeResults(resFiles[i_lig],'b');
+
+				ATLOG_OUT_1("Done ligand " << i_lig << " -> " << resFiles[i_lig]);
+
+			}
+
+			// release the scanners before the objects they point to
+
+			this->scanners.clear();
+
+		}
+
+		ATLOG_STD_EXCEPTIONS_CATCH();
+
+	}
+
+protected:
+
+	static T_num roundToStep(T_num x, T_num step) {
+
+		return step > 0 ? std::floor(x/step + T_num(0.5))*step : x;
+
+	}
+
+	ClassKey classKey(const MolForceParams& params) const {
+
+		T_num ligSize = Geom::Bounding::DescriptorCache<T_num>::get(params.pos(iLig))->getDiameter().getSize();
+
+		T_num boxLigSize = ligSize;
+
+		if( ligSizeStep > 0 ) {
+			boxLigSize = std::ceil(ligSize/ligSizeStep)*ligSizeStep;
+		}
+
+		return ClassKey(boxLigSize,
+			roundToStep(blitz::mean(params.sigma(iLig)),sigmaStep),
+			roundToStep(blitz::mean(params.eps(iLig)),epsStep));
+
+	}
+
+protected:
+
+	const std::vector<MolForceParams> *pligParams;
+
+	std::vector<std::string> resFiles;
+
+	// range [ligStart,ligEnd) of ligands to dock
+
+	int ligStart;
+
+	int ligEnd;
+
+	T_num ligSizeStep;
 
-	boost::scoped_ptr<RotFftScanIO_Bin> m_io_rot_scan;
+	T_num sigmaStep;
 
+	T_num epsStep;
 
 };
 
@@ -233,6 +233,252 @@ protected:
 typedef boost::shared_ptr<TranSymm> PTranSymm;
 
 
+// Distance restraints between receptor and ligand atoms (e.g. from mutagenesis
+// or crosslinks), applied to the translational search before the best
+// translations are selected (see CorrelationProcessor::setRestraints()).
+//
+// A restraint has a set of receptor atoms, a set of ligand atoms and a maximum
+// distance. It is satisfied if any receptor-ligand pair from the sets is within
+// that distance. For a given orientation of the ligand, the translations that
+// bring ligand atom b within distance d of receptor atom a fill the sphere of
+// radius d around (a - b). The spheres are drawn over the correlation grid for
+// every rotation, which costs about (number of atom pairs)*(sphere volume in grid
+// cells), so the atom sets should be small (e.g. CA or CB of the restrained residues).
+//
+// Restraints file has one restraint per line, '#' starts a comment:
+//   <max distance> <receptor atoms> : <ligand atoms>
+// where atoms are 0-based indices of the atoms of each molecule in the molforce file,
+// separated by spaces.
+// Options:
+// restraintsFile - the restraints file; restraints are not used without it
+// restraintMinSatisfied - translations that satisfy fewer restraints are
+// skipped (all restraints by default, none if restraintPenalty is set)
+// restraintPenalty - added to the score for each restraint that is not satisfied (0)
+
+class TranRestraints : public boost::noncopyable {
+
+public:
+
+  enum { maxRestraints = 32 };
+
+  // bit 'i' is set if restraint 'i' is satisfied
+  typedef unsigned int Mask;
+
+  struct Restraint {
+
+    T_num maxDist;
+
+    std::vector<int> iRec;
+
+    std::vector<int> iLig;
+
+  };
+
+  TranRestraints():
+    m_minSatisfied(0),
+    m_penalty(0)
+  {}
+
+  void load(const std::string& fileName, int minSatisfied, T_num penalty) {
+
+    std::ifstream in(fileName.c_str());
+
+    ATALWAYS(in.good(),"Unable to open restraints file: " + fileName);
+
+    m_restraints.clear();
+
+    std::string line;
+
+    while( std::getline(in,line) ) {
+
+      std::istringstream inLine(line.substr(0,line.find('#')));
+
+      std::string tok;
+
+      if( ! (inLine >> tok) ) {
+	continue;
+      }
+
+      Restraint r;
+
+      r.maxDist = T_num(parseNumber(tok,line));
+
+      std::vector<int> *pAtoms = &r.iRec;
+
+      while( inLine >> tok ) {
+	if( tok == ":" ) {
+	  ATALWAYS(pAtoms == &r.iRec,"More than one ':' in restraint: " + line);
+	  pAtoms = &r.iLig;
+	}
+	else {
+	  pAtoms->push_back(int(parseNumber(tok,line)));
+	}
+      }
+
+      ATALWAYS(r.maxDist > 0 && ! r.iRec.empty() && ! r.iLig.empty(),
+	       "Restraint must have a positive distance, receptor and ligand atoms: " + line);
+
+      m_restraints.push_back(r);
+
+    }
+
+    ATALWAYS(size() <= int(maxRestraints),"Too many restraints in file: " + fileName);
+
+    m_penalty = penalty;
+
+    if( minSatisfied < 0 ) {
+      minSatisfied = penalty > 0 ? 0 : size();
+    }
+
+    m_minSatisfied = std::min(minSatisfied,size());
+
+    ATLOG_OUT_1("Loaded " << size() << " restraints from " << fileName << ATLOGVAR(m_minSatisfied) << ATLOGVAR(m_penalty));
+
+  }
+
+  // Keep a reference to the receptor atoms, and check the atom indices against the molecules
+
+  void setMolecules(const Points& posRec, int nLig) {
+
+    for(int i_r = 0; i_r < size(); i_r++) {
+      const Restraint& r = m_restraints[i_r];
+      for(size_t i = 0; i < r.iRec.size(); i++) {
+	ATALWAYS(r.iRec[i] >= 0 && r.iRec[i] < posRec.size(),"Restraint receptor atom index is out of range");
+      }
+      for(size_t i = 0; i < r.iLig.size(); i++) {
+	ATALWAYS(r.iLig[i] >= 0 && r.iLig[i] < nLig,"Restraint ligand atom index is out of range");
+      }
+    }
+
+    m_posRec.reference(posRec);
+
+  }
+
+  // Set in 'mask' (one element per point of 'grid', in its storage order) the
+  // restraints satisfied by the translation of the ligand atoms 'ligPos' that
+  // corresponds to each point. The grid holds correlation values, so that its
+  // logical index is the wrapped displacement (see Math::WrappedIndex::unwrap()).
+
+  void draw(const Grid& grid, const IntPoint& stride, const Points& ligPos, std::vector<Mask>& mask) const {
+
+    Prof::ScopedTimer t(Prof::PH_RESTRAINTS);
+
+    mask.assign(grid.getGridArray().size(),Mask(0));
+
+    const Point& h = grid.getGeometry().spatialStep();
+
+    IntPoint size = grid.getLogicalShape();
+
+    // range of the unwrapped displacements
+    IntPoint lowN = -1 * (size/2);
+
+    IntPoint upN = lowN + size - 1;
+
+    for(int i_r = 0; i_r < this->size(); i_r++) {
+
+      const Restraint& r = m_restraints[i_r];
+
+      Mask bit = Mask(1) << i_r;
+
+      T_num d = r.maxDist;
+
+      T_num d2 = d*d;
+
+      for(size_t i_a = 0; i_a < r.iRec.size(); i_a++) {
+
+	for(size_t i_b = 0; i_b < r.iLig.size(); i_b++) {
+
+	  Point c = m_posRec(r.iRec[i_a]) - ligPos(r.iLig[i_b]);
+
+	  IntPoint lo, up;
+
+	  bool empty = false;
+
+	  for(int dim = 0; dim < N_dim; dim++) {
+	    lo(dim) = std::max(int(std::ceil((c(dim) - d)/h(dim))),lowN(dim));
+	    up(dim) = std::min(int(std::floor((c(dim) + d)/h(dim))),upN(dim));
+	    empty = empty || lo(dim) > up(dim);
+	  }
+
+	  if( empty ) {
+	    continue;
+	  }
+
+	  // displacement 'n' is stored at the wrapped index '-n'
+
+	  for(int n0 = lo(0); n0 <= up(0); n0++) {
+	    T_num x0 = n0*h(0) - c(0);
+	    T_num r0 = x0*x0;
+	    int off0 = wrap(n0,size(0))*stride(0);
+	    for(int n1 = lo(1); n1 <= up(1); n1++) {
+	      T_num x1 = n1*h(1) - c(1);
+	      T_num r1 = r0 + x1*x1;
+	      if( r1 > d2 ) {
+		continue;
+	      }
+	      int off1 = off0 + wrap(n1,size(1))*stride(1);
+	      for(int n2 = lo(2); n2 <= up(2); n2++) {
+		T_num x2 = n2*h(2) - c(2);
+		if( r1 + x2*x2 <= d2 ) {
+		  mask[off1 + wrap(n2,size(2))*stride(2)] |= bit;
+		}
+	      }
+	    }
+	  }
+
+	}
+
+      }
+
+    }
+
+  }
+
+  static int numSatisfied(Mask m) {
+    return int(std::bitset<maxRestraints>(m).count());
+  }
+
+  int size() const {
+    return int(m_restraints.size());
+  }
+
+  int minSatisfied() const {
+    return m_minSatisfied;
+  }
+
+  T_num penalty() const {
+    return m_penalty;
+  }
+
+protected:
+
+  static int wrap(int n, int size) {
+    return n > 0 ? size - n : -n;
+  }
+
+  static double parseNumber(const std::string& tok, const std::string& line) {
+    std::istringstream in(tok);
+    double x;
+    ATALWAYS((in >> x) && in.eof(),"Invalid number '" + tok + "' in restraint: " + line);
+    return x;
+  }
+
+protected:
+
+  std::vector<Restraint> m_restraints;
+
+  Points m_posRec;
+
+  int m_minSatisfied;
+
+  T_num m_penalty;
+
+}; // class TranRestraints
+
+
+typedef boost::shared_ptr<TranRestraints> PTranRestraints;
+
+
 class CorrelationProcessor {
 
 protected:
@@ -274,7 +520,8 @@ protected:
 public:
 
 
-  CorrelationProcessor()
+  CorrelationProcessor():
+    pRestraints(0)
   {
     ATLOG_TRACE_3;
     clear();
@@ -309,6 +556,134 @@ public:
 
     corrTranResults.resize(maxInpN);
 
+    maxVal = maxInpVal;
+
+  }
+
+  // Select from the slabs of FFTSlabCorrelators instead of a full grid.
+  // 'gridSlab' is their total grid, and 'sizeFull' is the size of the full
+  // FFT grid. For each rotation, call beginSlabs(), then selectFromSlab()
+  // after each FFTSlabCorrelators::correlate(), and endSlabs(). The result
+  // is the same as selectFromFFT() on the full grid would give.
+
+  void initSlabs(Grid& gridSlab, const IntPoint& sizeFull, int maxInpN, T_num maxInpVal) {
+
+    init(gridSlab,maxInpN,maxInpVal);
+
+    // unwraps the last two axes, which the slabs have in full
+
+    wrappedIndex = WrappedIndexType(sizeFull);
+
+  }
+
+  void beginSlabs() {
+
+    clear();
+
+    slabVals.clear();
+
+    slabDisps.clear();
+
+    slabLimit = maxVal;
+
+  }
+
+  // Select from the translations [0,width) along the first axis of the slab
+  // grid; 'offset' is added to them to get the translations of the full grid
+  // (see FFTSlabCorrelators::slabWidth() and slabOffset())
+
+  void selectFromSlab(int width, int offset) {
+
+    Prof::ScopedTimer t(Prof::PH_SELECT);
+
+    ATALWAYS(pRestraints == 0,"Restraints are not supported with FFT slabs");
+
+    int maxInpN = corrTranResults.size();
+
+    queue.init(maxInpN,slabLimit,cmp(gridRawData),cmp(gridRawData));
+
+    IntPoint shape = p_grid->getLogicalShape();
+
+    for(int d0 = 0; d0 < width; d0++) {
+
+      // wrapped index of the translation d0 >= 0, see WrappedIndex::unwrap()
+
+      int t0 = (d0 == 0) ? 0 : shape(0) - d0;
+
+      for(int t1 = 0; t1 < shape(1); t1++) {
+
+	int offset01 = t0*stride(0) + t1*stride(1);
+
+	for(int t2 = 0; t2 < shape(2); t2++) {
+
+	  queue.push(offset01 + t2*stride(2));
+
+	}
+      }
+    }
+
+    for(size_t i = 0; i < queue.data().size(); i++) {
+
+      int ind = queue.data()[i];
+
+      slabVals.push_back(gridRawData[ind]);
+
+      IntPoint indN;
+      for(int dim = 0; dim < N_dim; dim++) {
+	indN(dim) = ind/stride(dim);
+	ind %= stride(dim);
+      }
+
+      IntPoint disp = wrappedIndex.unwrap(indN);
+
+      disp(0) = ((indN(0) == 0) ? 0 : shape(0) - indN(0)) + offset;
+
+      slabDisps.push_back(disp);
+
+    }
+
+    // the next slabs only need to beat the current best maxInpN
+
+    if( int(slabVals.size()) >= maxInpN ) {
+      keepBestSlabCands(maxInpN);
+      slabLimit = slabVals.back();
+    }
+
+  }
+
+  void endSlabs() {
+
+    keepBestSlabCands(corrTranResults.size());
+
+    int n_cand = slabVals.size();
+
+    for(int i = 0; i < n_cand; i++) {
+
+      TranValue& corrTranResult = corrTranResults(i);
+
+      corrTranResult.tran = Translation(p_grid->getGeometry().toSpatialDiff(slabDisps[i]));
+
+      corrTranResult.value = slabVals[i];
+
+    }
+
+    nOut = n_cand;
+
+    Prof::count(Prof::CNT_CANDIDATES,n_cand);
+
+  }
+
+  // Apply 'restraints' to the next call of selectFromFFT(), for the ligand
+  // atoms at 'ligPos' (rotated, but not yet translated). Translations are
+  // skipped or penalized there before they enter the queue, so that they
+  // do not take the places of the ones that satisfy the restraints.
+
+  void setRestraints(const TranRestraints& restraints, const Points& ligPos) {
+
+    restraints.draw(*p_grid,stride,ligPos,restrMask);
+
+    pRestraints = &restraints;
+
   }
 
 
@@ -318,6 +693,8 @@ public:
 
     ATLOG_TRACE_4;
 
+    Prof::ScopedTimer t(Prof::PH_SELECT);
+
     selectIntoQueue();
 
     if( do_sort )
@@ -340,6 +717,8 @@ public:
 
     nOut = n_queue;
 
+    Prof::count(Prof::CNT_CANDIDATES,n_queue);
+
     ATLOG_OUT_4(ATLOGVAR(nOut) << ATLOGVAR(queue.getSizeLimit()));
 
   }
@@ -448,6 +827,37 @@ public:
 
 protected:
 
+  // Keep the 'n' lowest values of the slab candidates, sorted
+
+  void keepBestSlabCands(int n) {
+
+    if( slabVals.empty() ) {
+      return;
+    }
+
+    std::vector<int> order(slabVals.size());
+
+    for(size_t i = 0; i < order.size(); i++) {
+      order[i] = i;
+    }
+
+    std::stable_sort(order.begin(),order.end(),cmp(&slabVals[0]));
+
+    order.resize(std::min(n,int(order.size())));
+
+    std::vector<T_num> vals(order.size());
+    std::vector<IntPoint> disps(order.size());
+
+    for(size_t i = 0; i < order.size(); i++) {
+      vals[i] = slabVals[order[i]];
+      disps[i] = slabDisps[order[i]];
+    }
+
+    slabVals.swap(vals);
+    slabDisps.swap(disps);
+
+  }
+
   void
   selectIntoQueue() {
 
@@ -457,6 +867,14 @@ protected:
 
     //This code will exclude padded part of the array.
 
+    if( pRestraints ) {
+
+      selectIntoQueueRestrained();
+
+      return;
+
+    }
+
     for(IntPoint ind = wrappedIndex.before_first(); wrappedIndex.next(ind); ) {
 	  
       queue.push(rawLogicalCoordsToOffset(ind));
@@ -467,6 +885,48 @@ protected:
 
   }
 
+  // The penalty is added to the grid values themselves, so that the queue
+  // and the selected translations see the penalized scores.
+
+  void
+  selectIntoQueueRestrained() {
+
+    int minSatisfied = pRestraints->minSatisfied();
+
+    int nRestraints = pRestraints->size();
+
+    T_num penalty = pRestraints->penalty();
+
+    int nSkipped = 0;
+
+    for(IntPoint ind = wrappedIndex.before_first(); wrappedIndex.next(ind); ) {
+
+      int offset = rawLogicalCoordsToOffset(ind);
+
+      int nSatisfied = TranRestraints::numSatisfied(restrMask[offset]);
+
+      if( nSatisfied < minSatisfied ) {
+	nSkipped++;
+	continue;
+      }
+
+      if( nSatisfied < nRestraints && penalty != 0 ) {
+	gridRawData[offset] += penalty*(nRestraints - nSatisfied);
+      }
+
+      queue.push(offset);
+
+    }
+
+    // the mask is only valid for the ligand orientation it was drawn for
+    pRestraints = 0;
+
+    Prof::count(Prof::CNT_RESTRAINED,nSkipped);
+
+    ATLOG_OUT_4(ATLOGVAR(queue.size()) << ATLOGVAR(nSkipped));
+
+  }
+
 
 protected:
 
@@ -474,12 +934,31 @@ protected:
 
   const Grid *p_grid;
 
-  const T_num *gridRawData;
+  T_num *gridRawData;
 
   WrappedIndexType wrappedIndex;
 
   IntPoint stride;
 
+  // restraints for the next selection, and the restraints satisfied
+  // at each grid point
+
+  const TranRestraints *pRestraints;
+
+  std::vector<typename TranRestraints::Mask> restrMask;
+
+  T_num maxVal;
+
+  // candidates from the slabs selected so far (see selectFromSlab()),
+  // with their translations in points of the full grid, and the value
+  // the next candidates must be below
+
+  std::vector<T_num> slabVals;
+
+  std::vector<IntPoint> slabDisps;
+
+  T_num slabLimit;
+
   // output array for finally selected translations with values
 
   TranValues corrTranResults;
@@ -492,43 +971,238 @@ protected:
 };
 
 
+typedef boost::shared_ptr<CorrelationProcessor> PCorrelationProcessor;
 
-// The sequence of calls to methods of this class is:
-// FFTCorrelator corr;
-// corr.init(...)
-// Grid& recGrid = corr.getGrid(iGridRec);
-// ... project receptor ...
-// corr.preprocessReceptor(); // does the direct FFT of receptor
-// Grid& ligGrid = corr.getGrid(iGridLig);
-// while(rotations) {
-//    ... project ligand ...
-//    corr.correlate(); // correlation function is in ligGrid
-//    ... select best correlation points ...
-// }
 
-class FFTCorrelator {
+// Choice of the FFT grid size by the cost of the transforms (see Math::FFTShapeCost).
+// It is enabled by the 'fftCostTable' option that names a file with the costs
+// measured on this machine; without it, FFTCorrelator takes the first size preferred
+// by FFTW along each axis. Other options:
+// fftMaxSizeGrowth - candidate sizes exceed the minimum by at most this fraction (0.25)
+// fftMaxCandSizes - at most this many candidate sizes per axis (4)
+// fftPermuteAxes - also consider rotating the box so that another axis goes last (1)
+// fftMeasureTop - time this many best candidates that are not in the table yet,
+// and append them to the table (0; set it for a calibration run, e.g. the 'estimate' task)
+// The plan for a given minimum size is fixed at the first request, so that
+// MolStruct and all correlators of a run agree on the grid even if the table
+// grows in between.
+// The plan of the whole receptor box also decides the frame in which the poses
+// are stored, so all processes of one scan must use the same one. The 'estimate'
+// task writes it into its output, and it is passed to the 'rot-scan' and 'gather'
+// tasks as the 'fftPlan' option block {"size0","size1","size2","shift"}; with it,
+// planBox() does not consult the table. Such a block also enables the planner.
+
+class FFTSizePlanner : public boost::noncopyable {
 
 public:
 
-  enum GridIndex { iGridRec, iGridLig };
+  typedef Math::FFTShapeCost::Shape Shape;
 
-  enum { N_grids = 2 };
+  static FFTSizePlanner& instance() {
+    static FFTSizePlanner planner;
+    return planner;
+  }
 
-  // ligand grid will hold data for reciprocal transform
+  bool isEnabled() const {
+    return ! costTable.empty() || hasFixedPlan;
+  }
 
-  enum { iGridC2R = iGridLig, iGridOut = iGridC2R };
+  bool permutesAxes() const {
+    return permuteAxes;
+  }
 
-  // small array of Grids
+  // Best grid size for a box that needs at least 'minSize' grid points.
+  // With 'allowPermute', the returned plan can require a cyclic permutation
+  // of the box axes. With 'doMeasure', missing costs of the best candidates
+  // are measured first.
 
-  typedef typename common_types::point_type<Grid,N_grids>::Type GridsSet;
+  Math::FFTShapePlan plan(const IntPoint& minSize, bool allowPermute, bool doMeasure) {
 
-  typedef typename common_types::point_type<GridArrayC,N_grids>::Type GridArraysCSet;
+    std::lock_guard<std::mutex> lock(mutex);
 
-  typedef FftwPlan<T_num> FftwPlanType;
+    PlanKey key(minSize(0),minSize(1),minSize(2),allowPermute);
 
-  typedef typename FftwPlanType::T_complex FftwComplex;
+    typename Plans::const_iterator p_plan = plans.find(key);
+    if( p_plan != plans.end() ) {
+      return p_plan->second;
+    }
 
-  typedef typename common_types::point_type<FftwPlanType,N_grids>::Type FftwPlansSet;
+    Math::FFTShapePlans cands = Math::FFTShapePlanner::candidates(minSize,maxSizeGrowth,maxCandSizes,allowPermute);
+
+    Math::FFTShapePlanner::rank(cands,cost);
+
+    if( doMeasure ) {
+      int nMeasured = 0;
+      for(int i_cand = 0; i_cand < int(cands.size()) && i_cand < measureTop; i_cand++) {
+	const Shape& size = cands[i_cand].size;
+	if( ! cost.isMeasured(size) ) {
+	  double sec = FFTCorrelator::timeTransforms(size);
+	  ATLOG_OUT_2("FFT cost measured for size " << size << ": " << sec << " s");
+	  cost.addMeasured(size,sec);
+	  Math::FFTShapeCost::append(costTable,size,sec);
+	  nMeasured++;
+	}
+      }
+      if( nMeasured > 0 ) {
+	Math::FFTShapePlanner::rank(cands,cost);
+      }
+    }
+
+    const Math::FFTShapePlan& best = cands.front();
+
+    // the size that would be used without the planner
+
+    Shape sizeFirst;
+    Math::FFTW_Size::findBestSize<N_dim>(minSize,sizeFirst);
+
+    ATLOG_OUT_2("FFT size planned for minimum size " << minSize << ": " << best.size \
+		<< " axis shift " << best.shift << " cost " << best.cost \
+		<< " (first FFTW size " << sizeFirst << ": " << cost.cost(sizeFirst) << ")");
+
+    plans[key] = best;
+
+    // the grid of the permuted box must come out the same when asked for later
+    Math::FFTShapePlan bestNoPerm = best;
+    bestNoPerm.shift = 0;
+    Shape minSizePerm = Math::FFTShapePlanner::permute(minSize,best.shift);
+    plans[PlanKey(minSizePerm(0),minSizePerm(1),minSizePerm(2),false)] = bestNoPerm;
+
+    return best;
+
+  }
+
+  // Plan of the whole receptor box (see MolStruct::orientMinBoxForFft()),
+  // taken from the 'fftPlan' option block if it is given.
+
+  Math::FFTShapePlan planBox(const IntPoint& minSize) {
+
+    if( ! hasFixedPlan ) {
+      boxPlan = plan(minSize,permuteAxes,true);
+      return boxPlan;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Shape minSizePerm = Math::FFTShapePlanner::permute(minSize,fixedPlan.shift);
+
+    ATALWAYS(blitz::all(minSizePerm <= fixedPlan.size),"The FFT size of the 'fftPlan' option is too small for the receptor box");
+
+    ATLOG_OUT_2("FFT size fixed by the options for minimum size " << minSize << ": " << fixedPlan.size \
+		<< " axis shift " << fixedPlan.shift);
+
+    plans[PlanKey(minSize(0),minSize(1),minSize(2),permuteAxes)] = fixedPlan;
+
+    Math::FFTShapePlan fixedNoPerm = fixedPlan;
+    fixedNoPerm.shift = 0;
+    plans[PlanKey(minSizePerm(0),minSizePerm(1),minSizePerm(2),false)] = fixedNoPerm;
+
+    boxPlan = fixedPlan;
+    return boxPlan;
+
+  }
+
+  // The last plan returned by planBox(); the 'estimate' task writes it out
+
+  const Math::FFTShapePlan& getBoxPlan() const {
+    return boxPlan;
+  }
+
+protected:
+
+  FFTSizePlanner() {
+    gOptions.getdefault("fftCostTable",costTable,std::string());
+    gOptions.getdefault("fftMaxSizeGrowth",maxSizeGrowth,0.25);
+    gOptions.getdefault("fftMaxCandSizes",maxCandSizes,4);
+    int _permuteAxes;
+    gOptions.getdefault("fftPermuteAxes",_permuteAxes,1);
+    permuteAxes = (_permuteAxes != 0);
+    gOptions.getdefault("fftMeasureTop",measureTop,0);
+    hasFixedPlan = gOptions.has_block("fftPlan");
+    if( hasFixedPlan ) {
+      const Options& optPlan = gOptions.getBlock("fftPlan");
+      optPlan.get("size0",fixedPlan.size(0));
+      optPlan.get("size1",fixedPlan.size(1));
+      optPlan.get("size2",fixedPlan.size(2));
+      optPlan.get("shift",fixedPlan.shift);
+      fixedPlan.cost = 0;
+      ATALWAYS(fixedPlan.shift >= 0 && fixedPlan.shift < N_dim,"Invalid axis shift in the 'fftPlan' option");
+      ATALWAYS(fixedPlan.shift == 0 || permuteAxes,"Axis shift in the 'fftPlan' option while 'fftPermuteAxes' is off");
+    }
+    boxPlan.size = 0;
+    boxPlan.shift = 0;
+    boxPlan.cost = 0;
+    if( ! costTable.empty() ) {
+      int nRead = cost.load(costTable);
+      ATLOG_OUT_1("Loaded " << nRead << " measured FFT costs from " << costTable);
+    }
+  }
+
+  typedef std::tuple<int,int,int,bool> PlanKey;
+
+  typedef std::map<PlanKey,Math::FFTShapePlan> Plans;
+
+  std::string costTable;
+
+  double maxSizeGrowth;
+
+  int maxCandSizes;
+
+  bool permuteAxes;
+
+  int measureTop;
+
+  bool hasFixedPlan;
+
+  Math::FFTShapePlan fixedPlan;
+
+  Math::FFTShapePlan boxPlan;
+
+  Math::FFTShapeCost cost;
+
+  Plans plans;
+
+  std::mutex mutex;
+
+};
+
+
+
+// The sequence of calls to methods of this class is:
+// FFTCorrelator corr;
+// corr.init(...)
+// Grid& recGrid = corr.getGrid(iGridRec);
+// ... project receptor ...
+// corr.preprocessReceptor(); // does the direct FFT of receptor
+// Grid& ligGrid = corr.getGrid(iGridLig);
+// while(rotations) {
+//    ... project ligand ...
+//    corr.correlate(); // correlation function is in ligGrid
+//    ... select best correlation points ...
+// }
+
+class FFTCorrelator {
+
+public:
+
+  enum GridIndex { iGridRec, iGridLig };
+
+  enum { N_grids = 2 };
+
+  // ligand grid will hold data for reciprocal transform
+
+  enum { iGridC2R = iGridLig, iGridOut = iGridC2R };
+
+  // small array of Grids
+
+  typedef typename common_types::point_type<Grid,N_grids>::Type GridsSet;
+
+  typedef typename common_types::point_type<GridArrayC,N_grids>::Type GridArraysCSet;
+
+  typedef FftwPlan<T_num> FftwPlanType;
+
+  typedef typename FftwPlanType::T_complex FftwComplex;
+
+  typedef typename common_types::point_type<FftwPlanType,N_grids>::Type FftwPlansSet;
 
 public:
 
@@ -536,14 +1210,10 @@ public:
 
     ATTRACE_SWITCH_3(dbg::trace t1(DBG_HERE));
 
-    // find the smallest size for FFT grid
-
     Point grStep(gridStep);
     typename Grid::Geom gridGeom(grStep,boxDiag(0));
 
-
-    Math::FFTW_Size::findBestSize<N_dim>(gridGeom.toLogical(boxDiag(1)),
-					 fftSize);
+    fftSize = sizeFor(boxDiag,gridStep);
 
     ATLOG_SWITCH_3(dbg::out(dbg::info) << dbg::indent() \
 		   << ATLOGVAR(boxDiag) \
@@ -605,6 +1275,65 @@ public:
 
   }
 
+  // Size of the FFT grid that init() creates for 'boxDiag'
+
+  static IntPoint sizeFor(const PointPair& boxDiag, T_num gridStep) {
+
+    typename Grid::Geom gridGeom(Point(gridStep),boxDiag(0));
+
+    IntPoint minSize = gridGeom.toLogical(boxDiag(1));
+
+    IntPoint size;
+
+    FFTSizePlanner& sizePlanner = FFTSizePlanner::instance();
+
+    if( sizePlanner.isEnabled() ) {
+      // the box is already oriented by MolStruct, so no permutation here
+      size = sizePlanner.plan(minSize,false,false).size;
+    }
+    else {
+      Math::FFTW_Size::findBestSize<N_dim>(minSize,size);
+    }
+
+    return size;
+
+  }
+
+  // Seconds for one forward and one inverse in-place transform of 'size'
+  // with FFTW_MEASURE plans. This calibrates FFTSizePlanner - the run itself
+  // uses FFTW_PATIENT plans, which are too slow to make for many sizes.
+
+  static double timeTransforms(const IntPoint& size, int nRep = 3) {
+
+    IntPoint n = size;
+    IntPoint complPhysSize = size;
+    complPhysSize(2) = size(2)/2 + 1;
+
+    GridArrayC arr(complPhysSize);
+
+    T_num * pReal = reinterpret_cast<T_num*>(arr.dataFirst());
+    FftwComplex *pCompl = reinterpret_cast<FftwComplex*>(arr.dataFirst());
+
+    FftwPlanType planR2C, planC2R;
+    planR2C.dft_r2c(n.length(),n.dataFirst(),pReal,pCompl,FFTW_MEASURE);
+    planC2R.dft_c2r(n.length(),n.dataFirst(),pCompl,pReal,FFTW_MEASURE);
+
+    // planning overwrites the array
+    arr = 0;
+
+    planR2C.execute();
+    planC2R.execute();
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    for(int i_rep = 0; i_rep < nRep; i_rep++) {
+      planR2C.execute();
+      planC2R.execute();
+    }
+    return std::chrono::duration<double>(Clock::now() - start).count() / nRep;
+
+  }
+
   Grid& getGrid(int ind) {
 
     return grids(ind);
@@ -613,16 +1342,63 @@ public:
 
   void preprocessReceptor() {
 
+    Prof::ScopedTimer t(Prof::PH_R2C);
+
     fftwPlansR2C(iGridRec).execute();
 
   }
 
+  // Take the already transformed receptor from 'x' instead of
+  // calling preprocessReceptor(). Both must have the same FFT size.
+
+  void copyReceptor(const FFTCorrelator& x) {
+
+    ATALWAYS(blitz::all(fftSize == x.fftSize),"FFT sizes of correlators do not match");
+
+    arraysC(iGridRec) = x.arraysC(iGridRec);
+
+  }
+
   // The programm will spend most of its time here
 
   void correlate() {
 
+    transformLigand();
+    multiplySpectra();
+    transformInverse();
+
+  }
+
+  // Steps of correlate(). FFTCorrelators also uses them to sum the
+  // correlations of several grids before a single inverse transform.
+
+  void transformLigand() {
+
+    Prof::ScopedTimer t(Prof::PH_R2C);
     fftwPlansR2C(iGridLig).execute();
+
+  }
+
+  void multiplySpectra() {
+
+    Prof::ScopedTimer t(Prof::PH_MULTIPLY);
     arraysC(iGridLig) *= blitz::conj(arraysC(iGridRec));
+
+  }
+
+  // Add the product of the spectra of this object to the ligand spectrum of 'x'
+  // (after x.multiplySpectra() was called). Both must have the same FFT size.
+
+  void addProductTo(FFTCorrelator& x) const {
+
+    Prof::ScopedTimer t(Prof::PH_MULTIPLY);
+    x.arraysC(iGridLig) += arraysC(iGridLig) * blitz::conj(arraysC(iGridRec));
+
+  }
+
+  void transformInverse() {
+
+    Prof::ScopedTimer t(Prof::PH_C2R);
     fftwPlanC2R.execute();
     //TODO:
     // Maybe optimize for speed by moving normalization to after the selection stage,
@@ -768,7 +1544,13 @@ class FFTCorrelators : public boost::noncopyable {
 
 public:
       
-  FFTCorrelators(const PointPair& boxDiag, T_num gridStep, int nFfts) {
+  // If 'sumSpectra' is true, correlate() adds up the products of the spectra
+  // of all grids and does one inverse FFT, so the total correlation is
+  // in getGridTot() and nothing is left in the other output grids
+  // (see MolForce::isSpectralSum()).
+
+  FFTCorrelators(const PointPair& boxDiag, T_num gridStep, int nFfts, bool _sumSpectra = false):
+    sumSpectra(_sumSpectra) {
 
     ATLOG_ASSERT_1(nFfts >= 1);
 
@@ -809,13 +1591,52 @@ public:
     }
   }
 
-  void correlate() {
+  void copyReceptor(const FFTCorrelators& x) {
+
+    ATALWAYS(x.size() == this->size(),"Number of correlators does not match");
 
     for( int i = 0; i < this->size(); i++ ) {
+
+      ffts(i)->copyReceptor(*x.ffts(i));
+
+    }
+  }
+
+  void correlate() {
+
+    if( sumSpectra ) {
+
+      for( int i = 0; i < this->size(); i++ ) {
+
+	ffts(i)->transformLigand();
+
+      }
+
+      ffts(0)->multiplySpectra();
+
+      for( int i = 1; i < this->size(); i++ ) {
+
+	ffts(i)->addProductTo(*ffts(0));
+
+      }
+
+      ffts(0)->transformInverse();
+
+    }
+    else {
+
+      for( int i = 0; i < this->size(); i++ ) {
 	  
-      ffts(i)->correlate();
+	ffts(i)->correlate();
+
+      }
+    }
+  }
+
+  bool sumsSpectra() const {
+
+    return sumSpectra;
 
-    }	
   }
 
 
@@ -825,6 +1646,15 @@ public:
 
   }
 
+  // Bytes taken by the arrays of 'nFfts' correlators of FFT size 'size'
+  // (two complex arrays per correlator)
+
+  static double memoryFor(const IntPoint& size, int nFfts) {
+
+    return 2. * nFfts * size(0) * size(1) * (size(2)/2 + 1) * sizeof(std::complex<T_num>);
+
+  }
+
   VPFFTCorrelator& getFfts() {
 
     return ffts;
@@ -880,6 +1710,8 @@ protected:
 
   PRawGrid   gridT;
 
+  bool sumSpectra;
+
 };
 
 
@@ -887,5 +1719,490 @@ typedef boost::shared_ptr<FFTCorrelators> PFFTCorrelators;
 
 
 
+// Correlators for a receptor whose full FFT grid does not fit into memory
+// (the 'fftMaxMemoryMb' option of RotScanner).
+//
+// The translations along the first axis are split into slabs (overlap-save).
+// All grids here have the full size of the FFT box along the other two axes,
+// but only M0 < N0 points along the first one:
+// - the receptor of slab k is projected onto the window [s_k,s_k+M0) of the
+//   full grid;
+// - the ligand is projected onto the fixed window [c,c+M0) that holds the
+//   ligand in any orientation, i.e. the atoms within 'ligExtent' of the
+//   origin along the first axis.
+// The circular correlation of the two windows equals the correlation over
+// the full grid for the W = M0 - (ligand length in grid points) + 1
+// consecutive translations that keep the ligand inside the window, and
+// the slabs are placed W points apart to cover all translations of the
+// full grid. Unlike the full grid, the translations that move the ligand
+// across the border of the box along the first axis are not wrapped around;
+// the ligand is far from the receptor there anyway.
+//
+// The receptor spectra of all slabs are computed once and kept in a buffer
+// backed by a temporary file in 'dir' (see MappedTempBuffer), which the
+// kernel pages in and out as the slabs are correlated. Correlators set up
+// with copyReceptor() share that buffer. Apart from it, the memory taken is
+// FFTCorrelators::memoryFor() of the slab size.
+//
+// The sequence of calls is:
+// for(i_slab in [0,nSlabs())) {
+//    ... project receptor onto getGridsRec(i_slab) ...
+//    preprocessReceptor(i_slab);
+// }
+// while(rotations) {
+//    ... project ligand onto getGridsLig() ...
+//    transformLigand();
+//    for(i_slab in [0,nSlabs())) {
+//       correlate(i_slab);
+//       ... collect the total grid unless sumsSpectra() ...
+//       ... select translations [0,slabWidth()) of getGridTot(),
+//           see CorrelationProcessor::selectFromSlab() ...
+//    }
+// }
+
+class FFTSlabCorrelators : public boost::noncopyable {
+
+public:
+
+  typedef FftwPlan<T_num> FftwPlanType;
+
+  typedef typename FftwPlanType::T_complex FftwComplex;
+
+  typedef std::complex<T_num> Complex;
+
+  typedef boost::shared_ptr<MappedTempBuffer> PMappedTempBuffer;
+
+public:
+
+  // 'maxMemory' - bytes for the grids (not counting the receptor spectra),
+  // which determines the length of the slabs.
+  // 'dir' - directory for the file with the receptor spectra.
+
+  FFTSlabCorrelators(const PointPair& boxDiag, T_num gridStep, int nFfts, bool _sumSpectra,
+		     T_num ligExtent, double maxMemory, const std::string& _dir):
+    sumSpectra(_sumSpectra),
+    dir(_dir)
+  {
+
+    ATLOG_TRACE_3;
+
+    ATLOG_ASSERT_1(nFfts >= 1);
+
+    sizeFull = FFTCorrelator::sizeFor(boxDiag,gridStep);
+
+    geomFull = typename Grid::Geom(Point(gridStep),sizeFull);
+
+    // ligand window along the first axis
+
+    ligOffset = geomFull.toLogical(Point(-ligExtent))(0);
+
+    int ligLast = geomFull.toLogical(Point(ligExtent))(0);
+
+    ATALWAYS(ligOffset >= 0 && ligLast < sizeFull(0),"Ligand does not fit into the FFT box");
+
+    ligLength = ligLast - ligOffset + 1;
+
+    sizeSlab = sizeFull;
+
+    sizeSlab(0) = slabLength(sizeFull,nFfts,ligLength,maxMemory);
+
+    int width = sizeSlab(0) - ligLength + 1;
+
+    // translations (in grid points) of the full grid along the first axis
+
+    int dLo = -(sizeFull(0)/2);
+    int dHi = sizeFull(0) - 1 - sizeFull(0)/2;
+
+    for(int d = dLo; d <= dHi; d += width) {
+      // a translation 'd' moves the ligand window [c,c+M0) to the receptor
+      // window that starts at 'd + c'
+      slabShifts.push_back(d + ligOffset);
+      slabWidths.push_back(std::min(width,dHi + 1 - d));
+    }
+
+    ATLOG_OUT_1("FFT grid " << sizeFull << " is split into " << nSlabs() << " slabs of size " << sizeSlab \
+		<< ", " << width << " translations each");
+
+    geomLig = slabGeometry(ligOffset);
+
+    nCompl = size_t(sizeSlab(0)) * sizeSlab(1) * (sizeSlab(2)/2 + 1);
+
+    IntPoint complPhysSize = sizeSlab;
+    complPhysSize(2) = sizeSlab(2)/2 + 1;
+
+    realPhysSize = complPhysSize;
+    realPhysSize(2) *= 2;
+
+    arraysLig.resize(nFfts);
+    arraysOut.resize(nFfts);
+    gridsLigObj.resize(nFfts);
+    gridsOutObj.resize(nFfts);
+    gridsRecObj.resize(nFfts);
+    plansLigR2C.resize(nFfts);
+    plansOutR2C.resize(nFfts);
+    plansOutC2R.resize(nFfts);
+
+    gridsL.resize(nFfts);
+    gridsO.resize(nFfts);
+    gridsR.resize(nFfts);
+
+    for(int i = 0; i < nFfts; i++) {
+
+      arraysLig[i].reference(GridArrayC(complPhysSize));
+      arraysLig[i] = 0;
+      arraysOut[i].reference(GridArrayC(complPhysSize));
+      arraysOut[i] = 0;
+
+      gridsLigObj[i].init(geomLig,sizeSlab,realView(arraysLig[i]));
+      gridsOutObj[i].init(geomLig,sizeSlab,realView(arraysOut[i]));
+
+      gridsL(i) = &gridsLigObj[i];
+      gridsO(i) = &gridsOutObj[i];
+      gridsR(i) = &gridsRecObj[i];
+
+      plansLigR2C[i].dft_r2c(sizeSlab.length(),sizeSlab.dataFirst(),
+			     realView(arraysLig[i]).dataFirst(),complexPtr(arraysLig[i]),
+			     FFTW_PATIENT);
+
+      plansOutR2C[i].dft_r2c(sizeSlab.length(),sizeSlab.dataFirst(),
+			     realView(arraysOut[i]).dataFirst(),complexPtr(arraysOut[i]),
+			     FFTW_PATIENT);
+
+      plansOutC2R[i].dft_c2r(sizeSlab.length(),sizeSlab.dataFirst(),
+			     complexPtr(arraysOut[i]),realView(arraysOut[i]).dataFirst(),
+			     FFTW_PATIENT);
+
+    }
+
+    gridT = gridsO(0);
+
+  }
+
+  // Length of the slabs along the first axis: the largest FFT size
+  // that keeps the grids of 'nFfts' correlators within 'maxMemory' bytes.
+  // Throws if even the shortest useful slab does not fit.
+
+  static int slabLength(const IntPoint& sizeFull, int nFfts, int ligLength, double maxMemory) {
+
+    IntPoint sizeUnit = sizeFull;
+    sizeUnit(0) = 1;
+
+    int maxLength = int(std::min(maxMemory / FFTCorrelators::memoryFor(sizeUnit,nFfts),double(sizeFull(0))));
+
+    int length = -1;
+
+    for(int m = ligLength + 1; m <= maxLength; m++) {
+      int n;
+      Math::FFTW_Size::findBestSize(m,n);
+      if( n > maxLength ) {
+	break;
+      }
+      length = n;
+      m = n;
+    }
+
+    ATALWAYS_BEGIN(length > 0);
+    ATDBGERR << "FFT memory limit of " << maxMemory/(1024*1024) << " MB is too small for slabs of the FFT grid " \
+	     << sizeFull << ": at least " << FFTCorrelators::memoryFor(sizeUnit,nFfts)*(ligLength + 1)/(1024*1024) \
+	     << " MB are needed\n";
+    ATALWAYS_END;
+
+    return length;
+
+  }
+
+  int size() const {
+
+    return arraysOut.size();
+
+  }
+
+  int nSlabs() const {
+
+    return slabShifts.size();
+
+  }
+
+  bool sumsSpectra() const {
+
+    return sumSpectra;
+
+  }
+
+  // Size of the full FFT grid, which defines the translations
+
+  IntPoint sizeFft() const {
+
+    return sizeFull;
+
+  }
+
+  IntPoint sizeFftSlab() const {
+
+    return sizeSlab;
+
+  }
+
+  // Receptor grids positioned over slab 'i_slab'. They share memory
+  // with the output grids.
+
+  VPRawGrid& getGridsRec(int i_slab) {
+
+    typename Grid::Geom geom = slabGeometry(slabShifts[i_slab]);
+
+    for(int i = 0; i < size(); i++) {
+      gridsRecObj[i].init(geom,sizeSlab,realView(arraysOut[i]));
+    }
+
+    return gridsR;
+
+  }
+
+  // Transform the receptor projected onto getGridsRec(i_slab) and store
+  // its spectrum. The spectra of all slabs must be stored before any
+  // call to correlate().
+
+  void preprocessReceptor(int i_slab) {
+
+    Prof::ScopedTimer t(Prof::PH_R2C);
+
+    if( ! recSpectra ) {
+      recSpectra.reset(new MappedTempBuffer(nCompl*sizeof(Complex)*size()*nSlabs(),dir));
+    }
+
+    for(int i = 0; i < size(); i++) {
+      plansOutR2C[i].execute();
+      GridArrayC spec = recSpectrum(i_slab,i);
+      spec = arraysOut[i];
+    }
+
+  }
+
+  // Share the receptor spectra of 'x' instead of computing them.
+  // Both must have the same slabs.
+
+  void copyReceptor(const FFTSlabCorrelators& x) {
+
+    ATALWAYS(blitz::all(sizeSlab == x.sizeSlab) && slabShifts == x.slabShifts && size() == x.size(),
+	     "Slabs of FFT correlators do not match");
+
+    recSpectra = x.recSpectra;
+
+  }
+
+  VPRawGrid& getGridsLig() {
+
+    return gridsL;
+
+  }
+
+  // True if all atoms of 'ligPos' are projected inside the ligand window
+
+  bool fitsLigand(const Points& ligPos) const {
+
+    for(int i = ligPos.lbound(0); i <= ligPos.ubound(0); i++) {
+      int ind = geomLig.toLogical(ligPos(i))(0);
+      if( ind < 0 || ind >= ligLength ) {
+	return false;
+      }
+    }
+
+    return true;
+
+  }
+
+  // Forward FFT of the ligand grids, used for all slabs
+
+  void transformLigand() {
+
+    Prof::ScopedTimer t(Prof::PH_R2C);
+
+    for(int i = 0; i < size(); i++) {
+      plansLigR2C[i].execute();
+    }
+
+  }
+
+  // Correlation of the ligand with the receptor of slab 'i_slab' into
+  // the output grids (or only into getGridTot() if sumsSpectra())
+
+  void correlate(int i_slab) {
+
+    ATALWAYS(recSpectra,"Receptor spectra of the FFT slabs were not computed");
+
+    Prof::count(Prof::CNT_SLABS);
+
+    if( i_slab + 1 < nSlabs() ) {
+      recSpectra->willNeed(spectrumOffset(i_slab + 1,0)*sizeof(Complex),nCompl*sizeof(Complex)*size());
+    }
+
+    {
+      Prof::ScopedTimer t(Prof::PH_MULTIPLY);
+
+      if( sumSpectra ) {
+	arraysOut[0] = arraysLig[0] * blitz::conj(recSpectrum(i_slab,0));
+	for(int i = 1; i < size(); i++) {
+	  arraysOut[0] += arraysLig[i] * blitz::conj(recSpectrum(i_slab,i));
+	}
+      }
+      else {
+	for(int i = 0; i < size(); i++) {
+	  arraysOut[i] = arraysLig[i] * blitz::conj(recSpectrum(i_slab,i));
+	}
+      }
+    }
+
+    Prof::ScopedTimer t(Prof::PH_C2R);
+
+    int N = blitz::product(sizeSlab);
+
+    int nOut = sumSpectra ? 1 : size();
+
+    for(int i = 0; i < nOut; i++) {
+      plansOutC2R[i].execute();
+      gridsOutObj[i].getGridArray() /= N;
+    }
+
+  }
+
+  // Translations along the first axis held by getGridTot() after correlate(i_slab),
+  // in grid points of the slab: [0,slabWidth()). Translation 'd' of the
+  // slab is translation 'd + slabOffset(i_slab)' of the full grid.
+
+  int slabWidth(int i_slab) const {
+
+    return slabWidths[i_slab];
+
+  }
+
+  int slabOffset(int i_slab) const {
+
+    return slabShifts[i_slab] - ligOffset;
+
+  }
+
+  VPRawGrid& getGridsOut() {
+
+    return gridsO;
+
+  }
+
+  PRawGrid getGridTot() {
+
+    return gridT;
+
+  }
+
+protected:
+
+  // Geometry of the window of the full grid that starts at 'shift' along the first axis
+
+  typename Grid::Geom slabGeometry(int shift) const {
+
+    Point zero = geomFull.spatialZero();
+
+    zero(0) += shift*geomFull.spatialStep()(0);
+
+    return typename Grid::Geom(geomFull.spatialStep(),zero);
+
+  }
+
+  GridArray realView(GridArrayC& arr) const {
+
+    return GridArray(reinterpret_cast<T_num*>(arr.dataFirst()),realPhysSize,blitz::neverDeleteData);
+
+  }
+
+  static FftwComplex* complexPtr(GridArrayC& arr) {
+
+    return reinterpret_cast<FftwComplex*>(arr.dataFirst());
+
+  }
+
+  size_t spectrumOffset(int i_slab, int i_fft) const {
+
+    return (size_t(i_slab)*size() + i_fft)*nCompl;
+
+  }
+
+  GridArrayC recSpectrum(int i_slab, int i_fft) const {
+
+    Complex *p = static_cast<Complex*>(recSpectra->data()) + spectrumOffset(i_slab,i_fft);
+
+    return GridArrayC(p,arraysOut[0].shape(),blitz::neverDeleteData);
+
+  }
+
+protected:
+
+  bool sumSpectra;
+
+  std::string dir;
+
+  IntPoint sizeFull;
+
+  IntPoint sizeSlab;
+
+  IntPoint realPhysSize;
+
+  typename Grid::Geom geomFull;
+
+  typename Grid::Geom geomLig;
+
+  // start and length of the ligand window along the first axis,
+  // in points of the full grid
+
+  int ligOffset;
+
+  int ligLength;
+
+  // start of the receptor window of each slab in points of the full grid,
+  // and the number of translations along the first axis it is used for
+
+  std::vector<int> slabShifts;
+
+  std::vector<int> slabWidths;
+
+  // number of complex values in the spectrum of one slab grid
+
+  size_t nCompl;
+
+  std::vector<GridArrayC> arraysLig;
+
+  std::vector<GridArrayC> arraysOut;
+
+  std::vector<Grid> gridsLigObj;
+
+  std::vector<Grid> gridsOutObj;
+
+  // receptor grids of the current slab, over arraysOut
+
+  std::vector<Grid> gridsRecObj;
+
+  std::vector<FftwPlanType> plansLigR2C;
+
+  std::vector<FftwPlanType> plansOutR2C;
+
+  std::vector<FftwPlanType> plansOutC2R;
+
+  VPRawGrid gridsL;
+
+  VPRawGrid gridsO;
+
+  VPRawGrid gridsR;
+
+  PRawGrid gridT;
+
+  // receptor spectra of all slabs, slab by slab
+
+  PMappedTempBuffer recSpectra;
+
+};
+
+
+typedef boost::shared_ptr<FFTSlabCorrelators> PFFTSlabCorrelators;
+
+
+
 #endif // PRODDL_DOCKING_FFT_H__
 
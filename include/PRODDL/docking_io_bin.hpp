@@ -52,6 +52,24 @@ public:
 		return false;
 	}
 
+	// Size of a record with 'n' translations in the file
+
+	static std::streamoff record_size(std::size_t n) {
+		return sizeof(int) + sizeof(Rotation) + sizeof(std::size_t) + n*sizeof(typename TranValues::T_numtype);
+	}
+
+	// Position after the last record read
+
+	std::streamoff tell_read() {
+		return m_io->tellg();
+	}
+
+	// Push the written records to the OS
+
+	void flush() {
+		m_io->flush();
+	}
+
 	bool write_record(const Rotation& rot, const TranValues& tran_vals) {
 		ATLOG_TRACE_3;
 		if (m_io->good()) {
@@ -75,6 +93,193 @@ protected:
 	std::iostream *m_io;
 };
 
+// Output of the 'rot-scan' task with checkpoints. writeCheckpoint() syncs
+// the records written so far to disk, and then saves their number and the
+// size of the file holding them into the sidecar file '<file_name>.ckpt',
+// which is replaced atomically. open() for the same range of rotations
+// validates the records listed in the sidecar, drops anything written after
+// them, and appends from there. close() removes the sidecar.
+
+class RotFftScanIO_Checkpointed : boost::noncopyable {
+public:
+	enum { CKPT_SIGNATURE = 2014011402 };
+
+	RotFftScanIO_Checkpointed():
+		m_n_rot(0),
+		m_size(0)
+	{}
+
+	// Open 'file_name' for the rotations 'rot_to_run' of the range [rot_start,rot_end)
+	// of the rotational grid, resuming from a valid checkpoint if 'resume' is true.
+	// Return the number of rotations from the front of 'rot_to_run' that are
+	// already in the file.
+
+	int open(const std::string& file_name, int rot_start, int rot_end,
+		const std::deque<Rotation>& rot_to_run, bool resume) {
+		ATLOG_TRACE_3;
+		ATALWAYS(m_io.get() == 0,"Output object already exists");
+		m_file_name = file_name;
+		m_ckpt_file_name = file_name + ".ckpt";
+		m_rot_start = rot_start;
+		m_rot_end = rot_end;
+		m_n_rot = 0;
+		m_size = 0;
+		if( resume && resume_from_checkpoint(rot_to_run) ) {
+			m_io.reset(new RotFftScanIO_Bin(m_file_name,std::fstream::out | std::fstream::app));
+		}
+		else {
+			m_io.reset(new RotFftScanIO_Bin(m_file_name,std::fstream::out));
+		}
+		return m_n_rot;
+	}
+
+	bool write_record(const Rotation& rot, const TranValues& tran_vals) {
+		ATALWAYS(m_io.get(),"Output object does not exist");
+		if( ! m_io->write_record(rot,tran_vals) ) {
+			return false;
+		}
+		m_n_rot++;
+		m_size += RotFftScanIO_Bin::record_size(tran_vals.size());
+		return true;
+	}
+
+	// Make the records written so far durable, and then record their
+	// number and size in the sidecar
+
+	void write_checkpoint() {
+		ATLOG_TRACE_3;
+		ATALWAYS(m_io.get(),"Output object does not exist");
+		m_io->flush();
+		sync_file(m_file_name);
+		std::string tmp_file_name = m_ckpt_file_name + ".tmp";
+		{
+			std::ofstream out(tmp_file_name.c_str());
+			out << CKPT_SIGNATURE << ' ' << m_rot_start << ' ' << m_rot_end << ' '
+				<< m_n_rot << ' ' << m_size << '\n';
+			ATALWAYS(out.good(),"Unable to write checkpoint file: " + tmp_file_name);
+		}
+		sync_file(tmp_file_name);
+		boost::filesystem::rename(tmp_file_name,m_ckpt_file_name);
+		// the new directory entry is only durable once the directory is synced
+		sync_file(parent_dir(m_ckpt_file_name));
+	}
+
+	// Close the complete output and remove the checkpoint
+
+	void close() {
+		ATLOG_TRACE_3;
+		ATALWAYS(m_io.get(),"Output object does not exist");
+		m_io.reset();
+		boost::filesystem::remove(m_ckpt_file_name);
+	}
+
+	// Number and total size of the records in the file
+
+	int n_records() const {
+		return m_n_rot;
+	}
+
+	long long size() const {
+		return m_size;
+	}
+
+protected:
+
+	// Check the sidecar against the range and the records of the output file.
+	// On success, truncate the file after the checkpointed records, set
+	// m_n_rot and m_size, and return true.
+
+	bool resume_from_checkpoint(const std::deque<Rotation>& rot_to_run) {
+
+		ATLOG_TRACE_3;
+
+		namespace fs = boost::filesystem;
+
+		if( ! ( fs::exists(m_ckpt_file_name) && fs::exists(m_file_name) ) ) {
+			return false;
+		}
+
+		int signature = 0, start = -1, end = -1, n_done = -1;
+
+		long long size = -1;
+
+		{
+			std::ifstream inp(m_ckpt_file_name.c_str());
+			inp >> signature >> start >> end >> n_done >> size;
+			if( inp.fail() || signature != CKPT_SIGNATURE ||
+				start != m_rot_start || end != m_rot_end ||
+				n_done < 0 || n_done > int(rot_to_run.size()) ||
+				size < 0 || (long long)fs::file_size(m_file_name) < size ) {
+				ATLOG_OUT_1("Ignoring checkpoint that does not match this task: " << m_ckpt_file_name);
+				return false;
+			}
+		}
+
+		{
+			RotFftScanIO_Bin io(m_file_name,std::fstream::in);
+
+			Rotation rot;
+
+			TranValues tran_vals;
+
+			for(int i_rot = 0; i_rot < n_done; i_rot++) {
+				if( ! io.read_record(rot,tran_vals) ||
+					std::memcmp(&rot,&rot_to_run[i_rot],sizeof(Rotation)) != 0 ) {
+					ATLOG_OUT_1("Ignoring checkpoint that does not match the records of: " << m_file_name);
+					return false;
+				}
+			}
+
+			if( (long long)io.tell_read() != size ) {
+				ATLOG_OUT_1("Ignoring checkpoint that does not match the size of: " << m_file_name);
+				return false;
+			}
+		}
+
+		fs::resize_file(m_file_name,size);
+
+		m_n_rot = n_done;
+
+		m_size = size;
+
+		return true;
+
+	}
+
+	static std::string parent_dir(const std::string& file_name) {
+		std::string dir = boost::filesystem::path(file_name).parent_path().string();
+		return dir.empty() ? std::string(".") : dir;
+	}
+
+	// fsync() a file or a directory
+
+	static void sync_file(const std::string& file_name) {
+#if defined(__unix__) || defined(__APPLE__)
+		int fd = ::open(file_name.c_str(),O_RDONLY);
+		if( fd >= 0 ) {
+			::fsync(fd);
+			::close(fd);
+		}
+#endif
+	}
+
+	boost::scoped_ptr<RotFftScanIO_Bin> m_io;
+
+	std::string m_file_name;
+
+	std::string m_ckpt_file_name;
+
+	// range [m_rot_start,m_rot_end) of the rotational grid
+
+	int m_rot_start;
+
+	int m_rot_end;
+
+	int m_n_rot;
+
+	long long m_size;
+};
+
 // Reader to iterate over multiple instances of RotFftScanIO
 
 template<class IO>
@@ -95,16 +300,19 @@ public:
 		    ATLOG_OUT_5("Trying to read next fft scan record");
 			status = m_io->read_record(rot,tran_vals);
 		}
-		if(! status) {
+		// skip files without records (e.g. from an empty range of rotations)
+		while(! status) {
 		    ATLOG_OUT_5("Could not read next fft scan record, checking next input file");
-			if( m_io_list->good() ) {
-                std::string file_name;
-				if(std::getline(*m_io_list,file_name)) {
-					m_io.reset(new IO(file_name,std::ios::in));
-		            ATLOG_OUT_5("Opened new input file: " << file_name);
-					status = m_io->read_record(rot,tran_vals);
-				}
+            std::string file_name;
+			if( ! ( m_io_list->good() && std::getline(*m_io_list,file_name) ) ) {
+				break;
 			}
+			if( file_name.empty() ) {
+				continue;
+			}
+			m_io.reset(new IO(file_name,std::ios::in));
+            ATLOG_OUT_5("Opened new input file: " << file_name);
+			status = m_io->read_record(rot,tran_vals);
 		}
 		ATLOG_OUT_5("Record status: " << status);
 		return status;
@@ -16,55 +16,164 @@
 
 /// HDF5 IO module for docking data structures
 
+// Datasets of a molforce file. Where the layout of the datasets allows it,
+// the arrays are views of the memory-mapped file (see IO/hdf5_mmap.hpp)
+// that stay valid for the life of the process ('posMapped' tells if 'pos' is).
+// The views are read-only, and the users of MolForceParams only read them.
+
+struct MolForceArrays {
+
+	int mix;
+	blitz::Array<int,2> mol_offsets;
+	blitz::Array<T_num,2> pos;
+	blitz::Array<T_num,1> mass, eps, sigma, alpha;
+	bool posMapped;
+
+	void load(const std::string& file_name) {
+
+		using namespace Hdf5;
+
+		HDF5File inp(file_name, HDF5File::in);
+		inp.getAttribute("/","mix",mix);
+
+		// mapping is on by default, molforceMmap=0 reads the datasets instead
+		int use_mmap = 1;
+		gOptions.getdefault("molforceMmap",use_mmap,1);
+
+		Hdf5MappedFile::Ptr mf;
+		if( use_mmap ) {
+			mf = Hdf5MappedFile::open(file_name);
+		}
+
+		int n_mapped = read(inp,mf,"mol_offsets",mol_offsets);
+		n_mapped += (posMapped = read(inp,mf,"pos",pos));
+		n_mapped += read(inp,mf,"mass",mass);
+		n_mapped += read(inp,mf,"eps",eps);
+		n_mapped += read(inp,mf,"sigma",sigma);
+		n_mapped += read(inp,mf,"alpha",alpha);
+
+		ATALWAYS(mol_offsets.rows() >= N_mol && mol_offsets.columns() == 2,"mol_offsets must be Nx2 matrix");
+
+		ATLOG_OUT_3("Loaded molforce file " << file_name << ", " << n_mapped << " of 6 datasets memory-mapped");
+
+	}
+
+	// Return true if 'arr' is mapped
+
+	template<typename T, int N>
+	static bool read(Hdf5::HDF5File& inp, const Hdf5MappedFile::Ptr& mf,
+		const std::string& path, blitz::Array<T,N>& arr) {
+		if( mf && mf->mapArray(path,arr) ) {
+			return true;
+		}
+		arr.reference(inp.readArray<T,N>(path));
+		return false;
+	}
+
+};
+
+// Set molecule 'i_mol' of 'self' from the atoms in row 'i_row' of 'mol_offsets'
+
+static
+void set_mol_from_arrays(MolForceParams& self,
+			 int i_mol,
+			 const blitz::Array<int,2>& mol_offsets,
+			 int i_row,
+			 const blitz::Array<T_num,2>& pos,
+			 const blitz::Array<T_num,1>& mass,
+			 const blitz::Array<T_num,1>& eps,
+			 const blitz::Array<T_num,1>& sigma,
+			 const blitz::Array<T_num,1>& alpha,
+			 bool copyPos = true) {
+
+	using namespace blitz;
+
+	int start = mol_offsets(i_row,0);
+	int end = mol_offsets(i_row,1);
+	Range range(start,end-1); //Blitz::Range is a closed range
+
+	ATALWAYS(end <= alpha.ubound(0) + 1 && start >= alpha.lbound(0),\
+		"Molecule offset is past array boundaries");
+
+	// The folded view does not keep 'pos' alive, so it is copied unless
+	// 'pos' is a view of the memory-mapped file
+	Points posView(viewWithFoldedComponent<TinyVector<T_num,N_dim> >
+		(pos(range,Range::all())));
+	self.pos(i_mol).reference(copyPos ? posView.copy() : posView);
+	self.mass(i_mol).reference(mass(range));
+	self.eps(i_mol).reference(eps(range));
+	self.sigma(i_mol).reference(sigma(range));
+	self.alpha(i_mol).reference(alpha(range));
+
+	int n = self.pos(i_mol).size();
+
+	ATALWAYS(self.mass(i_mol).size() == n && 
+		self.mass(i_mol).size() == n &&
+		self.eps(i_mol).size()  == n &&
+		self.sigma(i_mol).size()== n &&
+		self.alpha(i_mol).size()== n,
+		"Atom parameter arrays have different lengths");
+
+	ATLOG_OUT_3(ATLOGVAR(self.pos(i_mol).size()) \
+		<< ATLOGVAR(self.mass(i_mol).size()) \
+		<< ATLOGVAR(self.eps(i_mol).size()) \
+		<< ATLOGVAR(self.sigma(i_mol).size()) \
+		<< ATLOGVAR(self.alpha(i_mol).size()) \
+		<< ATLOGVAR(i_mol) << ATLOGVAR(i_row));
+
+}
+
 static
 void load_from_hdf5(const std::string& file_name, MolForceParams& self) {
 	ATLOG_TRACE_3;
-	using namespace Hdf5;
-	using namespace blitz;
-	HDF5File::mode_t flag = HDF5File::in;
-	HDF5File inp(file_name, flag);      
-	inp.getAttribute("/","mix",self.mix);
-	Array<int,2> mol_offsets(inp.readArray<int,2>("mol_offsets"));
-	ATALWAYS(mol_offsets.rows() >= N_mol && mol_offsets.columns() == 2,"mol_offsets must be Nx2 matrix");
-	Array<T_num,2> pos(inp.readArray<T_num,2>("pos"));
-	Array<T_num,1> mass(inp.readArray<T_num,1>("mass"));
-	Array<T_num,1> eps(inp.readArray<T_num,1>("eps"));
-	Array<T_num,1> sigma(inp.readArray<T_num,1>("sigma"));
-	Array<T_num,1> alpha(inp.readArray<T_num,1>("alpha"));
+	MolForceArrays a;
+	a.load(file_name);
+	self.mix = a.mix;
 
 	for(int i_mol = 0; i_mol < N_mol; i_mol++) {
 
-		int start = mol_offsets(i_mol,0);
-		int end = mol_offsets(i_mol,1);
-		Range range(start,end-1); //Blitz::Range is a closed range
-
-		ATALWAYS(end <= alpha.ubound(0) + 1 && start >= alpha.lbound(0),\
-			"Molecule offset is past array boundaries");
-
-		self.pos(i_mol).reference( 
-			viewWithFoldedComponent<TinyVector<T_num,N_dim> >
-			(pos(range,Range::all()))
-			.copy());
-		self.mass(i_mol).reference(mass(range));
-		self.eps(i_mol).reference(eps(range));
-		self.sigma(i_mol).reference(sigma(range));
-		self.alpha(i_mol).reference(alpha(range));
-
-		int n = self.pos(i_mol).size();
-
-		ATALWAYS(self.mass(i_mol).size() == n && 
-			self.mass(i_mol).size() == n &&
-			self.eps(i_mol).size()  == n &&
-			self.sigma(i_mol).size()== n &&
-			self.alpha(i_mol).size()== n,
-			"Atom parameter arrays have different lengths");
-
-		ATLOG_OUT_3(ATLOGVAR(self.pos(i_mol).size()) \
-			<< ATLOGVAR(self.mass(i_mol).size()) \
-			<< ATLOGVAR(self.eps(i_mol).size()) \
-			<< ATLOGVAR(self.sigma(i_mol).size()) \
-			<< ATLOGVAR(self.alpha(i_mol).size()) \
-			<< ATLOGVAR(i_mol));
+		set_mol_from_arrays(self,i_mol,a.mol_offsets,i_mol,a.pos,a.mass,a.eps,a.sigma,a.alpha,! a.posMapped);
+
+	}
+
+}
+
+/// Load a screening set: the first molecule in the file is the receptor,
+/// and each of the following molecules is a ligand. Element 'i' of 'pairs'
+/// gets the receptor and the ligand 'i'. The receptor arrays are shared
+/// by all elements.
+
+static
+void load_from_hdf5(const std::string& file_name, std::vector<MolForceParams>& pairs) {
+	ATLOG_TRACE_3;
+	MolForceArrays a;
+	a.load(file_name);
+
+	int n_lig = a.mol_offsets.rows() - 1;
+
+	// Elements are never copied after this point, see MolForceParams::reference()
+	pairs.clear();
+	pairs.resize(n_lig);
+
+	for(int i_lig = 0; i_lig < n_lig; i_lig++) {
+
+		MolForceParams& self = pairs[i_lig];
+
+		self.mix = a.mix;
+
+		if( i_lig == 0 ) {
+			set_mol_from_arrays(self,iRec,a.mol_offsets,0,a.pos,a.mass,a.eps,a.sigma,a.alpha,! a.posMapped);
+		}
+		else {
+			const MolForceParams& first = pairs[0];
+			self.pos(iRec).reference(first.pos(iRec));
+			self.mass(iRec).reference(first.mass(iRec));
+			self.eps(iRec).reference(first.eps(iRec));
+			self.sigma(iRec).reference(first.sigma(iRec));
+			self.alpha(iRec).reference(first.alpha(iRec));
+		}
+
+		set_mol_from_arrays(self,iLig,a.mol_offsets,i_lig+1,a.pos,a.mass,a.eps,a.sigma,a.alpha,! a.posMapped);
 
 	}
 
@@ -31,6 +31,26 @@ public:
 
 	int mix;
 
+	// Make this object share all arrays with 'x'.
+	// Blitz arrays inside TinyVector are not copied by reference
+	// with the default assignment operator, so this must be used instead.
+
+	void reference(const MolForceParams& x) {
+
+		for(int i_mol = 0; i_mol < N_mol; i_mol++) {
+
+			pos(i_mol).reference(x.pos(i_mol));
+			mass(i_mol).reference(x.mass(i_mol));
+			alpha(i_mol).reference(x.alpha(i_mol));
+			eps(i_mol).reference(x.eps(i_mol));
+			sigma(i_mol).reference(x.sigma(i_mol));
+
+		}
+
+		mix = x.mix;
+
+	}
+
 };
 
 
@@ -82,6 +102,17 @@ public:
 	virtual
 		int nGrids() const = 0;
 
+	// True if the total potential is the plain sum of the correlations of
+	// all grids. The FFT correlator then sums the products of the spectra and
+	// does a single inverse FFT into the total grid, and collectTotal() is not called.
+
+	virtual
+		bool isSpectralSum() const {
+
+			return false;
+
+	}
+
 
 	// The next methods are made public only for implementation
 	// purposes (so that MolForceComp class can access them), and
@@ -345,6 +376,11 @@ class MolForceRadial : public MolForceRadialR<TRadialFieldR> {
 
 public:
 
+	const Floats& getFieldsL() const {
+
+		return fieldsL;
+
+	}
 
 protected:
 
@@ -602,6 +638,102 @@ public:
 }; // class MolForceLJComp
 
 
+// Sum of two MolForceRadial components, composed at compile time.
+// Ligand atoms are snapped to the grid once for both components, and
+// the total potential is obtained with one inverse FFT of the summed
+// spectra (see isSpectralSum()), so this is only valid when the
+// components are simply added together.
+
+template<class TMolForce0, class TMolForce1>
+class MolForceRadialSum : public MolForce {
+
+public:
+
+	MolForceRadialSum(const MolForceParams& params):
+	  mf0(params),
+	  mf1(params)
+	  {}
+
+	virtual
+		int nGrids() const {
+
+			return 2;
+
+	}
+
+	virtual
+		bool isSpectralSum() const {
+
+			return true;
+
+	}
+
+	virtual
+		int projectReceptor(const Points& positions, VPRawGrid& grids, int iGridFirst) {
+
+			ATLOG_TRACE_4;
+
+			iGridFirst = static_cast<MolForce&>(mf0).projectReceptor(positions,grids,iGridFirst);
+
+			return static_cast<MolForce&>(mf1).projectReceptor(positions,grids,iGridFirst);
+
+	}
+
+	virtual
+		int projectLigand(const Points& positions, VPRawGrid& grids, int iGridFirst) {
+
+			ATLOG_TRACE_4;
+
+			Grid& grid0 = *grids(iGridFirst);
+			Grid& grid1 = *grids(iGridFirst + 1);
+
+			// both grids come from the same correlator set and have the same geometry
+
+			GridArray& arr0 = grid0.getGridArray();
+			GridArray& arr1 = grid1.getGridArray();
+
+			arr0 = 0.;
+			arr1 = 0.;
+
+			const Floats& fieldsL0 = mf0.getFieldsL();
+			const Floats& fieldsL1 = mf1.getFieldsL();
+
+			for(int i_atom = 0; i_atom < positions.size(); i_atom++) {
+
+				IntPoint ind(grid0.getGeometry().toLogical(positions(i_atom)));
+
+				arr0(ind) += fieldsL0(i_atom);
+				arr1(ind) += fieldsL1(i_atom);
+
+			}
+
+			return iGridFirst + 2;
+
+	}
+
+	// The sum is already in the first output grid (which is the total grid)
+
+	virtual
+		int collectTotal(VPRawGrid& gridsOut, int iGridFirst, PRawGrid gridTot) {
+
+			ATLOG_TRACE_4;
+
+			return iGridFirst + 2;
+
+	}
+
+protected:
+
+	TMolForce0 mf0;
+
+	TMolForce1 mf1;
+
+}; // class MolForceRadialSum
+
+
+typedef MolForceRadialSum<MolForceLJRep,MolForceLJAttr> MolForceLJCompSum;
+
+
 // Potential to test correctness of implementation:
 // Just adds two copies of a full LJ potential -
 // Must provide same coordinates in results file
@@ -57,7 +57,13 @@ class MolStruct {
 public:
 
 
-	MolStruct(const MolForceParams& params) {
+	// If 'boxLigSize' is positive, it is used instead of the ligand diameter
+	// when padding the receptor box. Then all ligands with the diameter
+	// not exceeding 'boxLigSize' get the same box for the same receptor.
+
+	MolStruct(const MolForceParams& params, T_num _boxLigSize = -1):
+	boxLigSize(_boxLigSize)
+	{
 
 		ATLOG_TRACE_3;
 
@@ -71,9 +77,12 @@ public:
 		for(int i_mol = 0; i_mol < N_mol; i_mol++) {
 
 			// Positions are an independent copy because we
-			// modify them
+			// modify them (the ones in 'params' can be a read-only
+			// view of the memory-mapped molforce file)
 			pos(i_mol).reference(params.pos(i_mol).copy());
 
+			posIni(i_mol).reference(params.pos(i_mol));
+
 			mass(i_mol).reference(params.mass(i_mol));
 
 		}
@@ -90,9 +99,7 @@ public:
 
 		ATTRACE_SWITCH_3(dbg::trace t1(DBG_HERE));
 
-		Geom::Bounding::Diameter<T_num> diamLig(getPosLigand());
-
-		ligSize = diamLig.getSize();
+		ligSize = Geom::Bounding::DescriptorCache<T_num>::get(getPosLigand())->getDiameter().getSize();
 
 		T_num angDegReal = (grid_step/(ligSize/2))*(180/3.14);
 
@@ -130,6 +137,14 @@ public:
 
 	}
 
+	// Positions passed to the constructor (the frame of toOriginalFrame())
+
+	const Points& getPosIni(int i_mol) const {
+		ATLOG_TRACE_3;
+		return posIni(i_mol);
+
+	}
+
 	Point centerOfMass(int i_mol) const {
 		ATLOG_TRACE_3;
 
@@ -153,6 +168,15 @@ public:
 
 	}
 
+	// Part of the padding of the min box on each side that accounts
+	// for the ligand (half of the ligand diameter or of 'boxLigSize')
+
+	T_num getLigPadding() const {
+		ATLOG_TRACE_3;
+		return ligPadding;
+
+	}
+
 	// Return ligand size (diameter)
 
 	const T_num getSizeLigand() const {
@@ -200,7 +224,25 @@ protected:
 
 		ATLOG_TRACE_3;
 
-		Geom::Bounding::Box<T_num> boxRec(getPosReceptor());
+		typedef Geom::Bounding::DescriptorCache<T_num> BoundingCache;
+
+		typename BoundingCache::Ptr descRec = BoundingCache::get(getPosReceptor());
+
+		typename BoundingCache::Ptr descLig = BoundingCache::get(getPosLigand());
+
+		// compute the receptor box and the ligand diameter concurrently;
+		// both are cached for the later calls with the same coordinates
+
+		Parallel::runThreads(2,[&](int i_thr) {
+				if( i_thr == 0 ) {
+					descRec->getBox();
+				}
+				else {
+					descLig->getDiameter();
+				}
+			});
+
+		Geom::Bounding::Box<T_num> boxRec = descRec->getBox();
 
 		RotationTranslation trBox = boxRec.moveToBoundCoordinates();
 
@@ -212,7 +254,12 @@ protected:
 
 		}
 
-		Geom::Bounding::Diameter<T_num> diamLig(getPosLigand());
+		// the diameter moves with the ligand, so the one found for the
+		// original ligand coordinates can be reused
+
+		Geom::Bounding::Diameter<T_num> diamLig = descLig->getDiameter();
+
+		diamLig.applyTransformation(trBox);
 
 		// move ligand such that a center of its diameter is at the coordinate
 		// origin
@@ -233,7 +280,21 @@ protected:
 
 		gOptions.get("gridStep",gridStep);
 
-		T_num recPadding = gridStep*2. + ligSize/2. + cutOffFft;
+		T_num padLigSize = ligSize;
+
+		if( boxLigSize > 0 ) {
+
+			// small excess is covered by the grid step margin
+
+			ATALWAYS(ligSize <= boxLigSize + gridStep,"Ligand does not fit into the requested box size");
+
+			padLigSize = boxLigSize;
+
+		}
+
+		ligPadding = padLigSize/2.;
+
+		T_num recPadding = gridStep*2. + ligPadding + cutOffFft;
 
 		PointPair diag = boxRec.getDiagonal();
 
@@ -245,6 +306,66 @@ protected:
 	}
 
 
+	// If FFTSizePlanner finds that the FFT grid is cheaper with another axis
+	// of the box going last (that axis is halved by the real-to-complex
+	// transform), rotate both molecules by the cyclic permutation of axes
+	// and return the correspondingly permuted box.
+
+	PointPair orientMinBoxForFft(const PointPair& box) {
+
+		ATLOG_TRACE_3;
+
+		FFTSizePlanner& sizePlanner = FFTSizePlanner::instance();
+
+		if( ! sizePlanner.isEnabled() ) {
+			return box;
+		}
+
+		T_num gridStep;
+
+		gOptions.get("gridStep",gridStep);
+
+		typename Grid::Geom gridGeom(Point(gridStep),box(0));
+
+		Math::FFTShapePlan plan = sizePlanner.planBox(gridGeom.toLogical(box(1)));
+
+		if( plan.shift == 0 ) {
+			return box;
+		}
+
+		ATLOG_OUT_2("Rotating the box by the cyclic shift " << plan.shift << " of axes for FFT size " << plan.size);
+
+		typename RotationTranslation::Matrix3 m;
+
+		for(int i = 0; i < N_dim; i++) {
+			for(int j = 0; j < N_dim; j++) {
+				m(i,j) = ( j == (i + plan.shift) % N_dim ) ? 1 : 0;
+			}
+		}
+
+		RotationTranslation trPerm(m,Point(0.));
+
+		for(int i_mol = 0; i_mol < N_mol; i_mol++) {
+
+			trPerm(getPos(i_mol));
+
+			trFromIni(i_mol) = trPerm*trFromIni(i_mol);
+
+		}
+
+		PointPair ret;
+
+		for(int k = 0; k < 2; k++) {
+			for(int j = 0; j < N_dim; j++) {
+				ret(k)(j) = box(k)((j + plan.shift) % N_dim);
+			}
+		}
+
+		return ret;
+
+	}
+
+
 	void randomizeLigandOrientation() {
 
 		ATLOG_TRACE_3;
@@ -274,6 +395,8 @@ protected:
 
 		PointPair ret = moveIntoMinBox();
 
+		ret = orientMinBoxForFft(ret);
+
 		toOrigFrameTransformer = ToOriginalFrameTransformer(trFromIni(iRec),trFromIni(iLig));
 
 		return ret;
@@ -284,6 +407,8 @@ protected:
 
 	PointsMolSet pos;
 
+	PointsMolSet posIni;
+
 	TransformsMolSet trFromIni;
 
 	FloatsMolSet mass;
@@ -292,6 +417,10 @@ protected:
 
 	T_num ligSize;
 
+	T_num boxLigSize;
+
+	T_num ligPadding;
+
 	ToOriginalFrameTransformer toOrigFrameTransformer;
 
 }; // class MolStruct
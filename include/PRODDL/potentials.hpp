@@ -21,8 +21,16 @@
 
 #include "PRODDL/Common/logger.hpp"
 
+#include "PRODDL/Common/parallel.hpp"
+
 #include <vector>
 
+#include <algorithm>
+
+#include <utility>
+
+#include <unordered_map>
+
 #ifdef PRODDL_CONTRIB
 #   include "PRODDL/Contrib/potential_step.hpp"
 #endif
@@ -47,6 +55,7 @@ namespace PRODDL {
     typedef typename Types<T_num>::Uints Uints;
     typedef T_num Float;
     typedef typename Types<T_num>::Floats Floats;
+    typedef typename Types<T_num>::RotationTranslation RotationTranslation;
     typedef Geom::Points::Neighbors<T_num,3> NeighborsType;
     typedef typename NeighborsType::PartitionedPoints2 PartPoints;
 
@@ -60,6 +60,34 @@ protected:
 
 	Options m_opts;
 
+	// Cache for incremental evaluation of rigid moves of points2 (see setRigidReference()).
+	// Candidate neighbors from points1 are stored once per distinct partition cell
+	// occupied by points2 at the last accepted pose, in CSR layout.
+
+	typedef typename PartPoints::Cell PartCell;
+
+	typedef typename PartPoints::CellIndex PartCellIndex;
+
+	// points2 in the reference frame
+	Points m_rigRef;
+
+	// last accepted pose
+	RotationTranslation m_rigPose;
+
+	// cache slot for each point of m_rigRef
+	Ints m_rigSlot;
+
+	// partition cell for each slot
+	std::vector<const PartCell*> m_rigCell;
+
+	// candidate indices in points1 for slot i are
+	// m_rigNbInd[m_rigNbStart[i]] to m_rigNbInd[m_rigNbStart[i+1]-1]
+	std::vector<int> m_rigNbStart, m_rigNbInd;
+
+	// buffers to rebuild the cache above without reallocating
+	std::vector<const PartCell*> m_rigCellNew;
+	std::vector<int> m_rigNbStartNew, m_rigNbIndNew;
+
 public:
 
 	PotTotalNonBonded() {}
@@ -154,6 +182,12 @@ public:
 
 		partPoints.insert(points1);
 
+		if( m_rigRef.size() > 0 ) {
+			// candidate lists point into the old cells
+			m_rigCell.clear();
+			_rigidRebuild(m_rigPose);
+		}
+
 	}
 
 	T_num f(const Points& points2) {
@@ -282,6 +316,127 @@ public:
 
 	}
 
+	// Value and gradient from a single neighbor search, for optimizers
+	// that always need both (such as L-BFGS)
+
+	T_num fg(const Points& points2,Points& grad2) {
+
+		VIPair indexPairs;
+		fvect distanceP2;
+
+		partPoints.search(points2,indexPairs,distanceP2);
+
+		int n_pairs = distanceP2.size();
+
+		T_num f_total = 0;
+
+		grad2 = 0;
+
+#ifdef PRODDL_CONTRIB
+		int doCustomEnergy;
+		m_opts.getdefault("doCustomEnergy",doCustomEnergy,0);
+		if( doCustomEnergy ) {
+			throw not_supported_error("We do not expect CustomEnergy to implement gradient calculation.");
+		}
+#endif
+
+		for(int i_pair=0; i_pair < n_pairs; i_pair++) {
+			const IPair& ind_pair = indexPairs[i_pair];
+			T_num rP2 = distanceP2[i_pair];
+			//ATTENTION: ind_pair(0) is for points2, ind_pair(1) -- points1
+			Point p = points2(ind_pair(0)) - points1(ind_pair(1));
+			const SoftCoreLJ& lj = _parNBTableEntry(ind_pair(1),ind_pair(0)).softCoreLJ;
+			f_total += lj.f2(rP2);
+			grad2(ind_pair(0)) += lj.g2(rP2,p);
+			if( rP2 < m_aceCutoff2 ) {
+				T_num aceVal = aceValue(ind_pair(1),ind_pair(0));
+				f_total += aceVal * potAce.f2(rP2);
+				grad2(ind_pair(0)) += aceVal * potAce.g2(rP2,p);
+			}
+		}
+
+		if( harmonicBasinUse ) {
+			for(int i_point = 0; i_point < points2.size(); i_point++) {
+				Point p = points2(i_point) - points1Center;
+				f_total += harmonicBasin.f2(Math::dotSelf(p));
+				grad2(i_point) += harmonicBasin.g2(p);
+			}
+		}
+
+		return f_total;
+
+	}
+
+	// Incremental evaluation for rigid moves.
+	// Set reference coords of points2 that will be moved as a rigid body by 
+	// transformations passed to fRigid()/fgRigid(), and the starting pose.
+	// Neighbor candidates are cached for the partition cells occupied by
+	// points2 at the starting pose. The transformed points2 are never
+	// stored. A point that has moved into another cell is looked up in
+	// the partition grid directly, until acceptRigid() refreshes the cache.
+
+	void setRigidReference(const Points& points2Ref,
+		const RotationTranslation& pose = RotationTranslation()) {
+
+#ifdef PRODDL_CONTRIB
+		int doCustomEnergy;
+		m_opts.getdefault("doCustomEnergy",doCustomEnergy,0);
+		if( doCustomEnergy ) {
+			throw not_supported_error("CustomEnergy is not implemented for incremental rigid moves.");
+		}
+#endif
+
+		m_rigRef.reference(points2Ref.copy());
+
+		m_rigSlot.resize(m_rigRef.size());
+
+		m_rigCell.clear();
+
+		_rigidRebuild(pose);
+
+	}
+
+	// Make 'pose' the one for which neighbor candidates are cached.
+	// Call this when an optimizer accepts a new point (e.g. new best value),
+	// so that the cache follows the trajectory.
+
+	void acceptRigid(const RotationTranslation& pose) {
+
+		PartCellIndex cellInd;
+
+		for(int i2 = 0; i2 < m_rigRef.size(); i2++) {
+			partPoints.getCellIndex(pose(m_rigRef(i2)),cellInd);
+			if( &cellInd.getCell() != m_rigCell[m_rigSlot(i2)] ) {
+				_rigidRebuild(pose);
+				return;
+			}
+		}
+
+		// no point has crossed a cell boundary
+		m_rigPose = pose;
+
+	}
+
+	// Same as f(points2) where points2 is 'pose' applied to the reference coords
+
+	T_num fRigid(const RotationTranslation& pose) {
+
+		return _fRigid(pose,0);
+
+	}
+
+	// Same as fg(points2,grad2) where points2 is 'pose' applied to the reference coords
+
+	T_num fgRigid(const RotationTranslation& pose,Points& grad2) {
+
+		ATLOG_ASSERT_1(grad2.size() == m_rigRef.size());
+
+		grad2 = 0;
+
+		return _fRigid(pose,&grad2);
+
+	}
+
 	T_num fDoubleLoop(const Points& points2) {
 
 
@@ -348,6 +503,152 @@ protected:
 		return m_aceMatr(fParAtom1.aceType(indAtom1),fParAtom2.aceType(indAtom2));
 	}
 
+	// Energy of one pair, and, if pGrad is not null, its gradient
+	// added to *pGrad. 'p' is point2 - point1.
+
+	T_num _pairFG(int indAtom1,int indAtom2,T_num rP2,const Point& p,Point *pGrad) {
+		const SoftCoreLJ& lj = _parNBTableEntry(indAtom1,indAtom2).softCoreLJ;
+		T_num f = lj.f2(rP2);
+		if( pGrad ) {
+			*pGrad += lj.g2(rP2,p);
+		}
+		if( rP2 < m_aceCutoff2 ) {
+			T_num aceVal = aceValue(indAtom1,indAtom2);
+			f += aceVal * potAce.f2(rP2);
+			if( pGrad ) {
+				*pGrad += aceVal * potAce.g2(rP2,p);
+			}
+		}
+		return f;
+	}
+
+	T_num _fRigid(const RotationTranslation& pose,Points *pGrad2) {
+
+		ATLOG_ASSERT_1(m_rigRef.size() > 0);
+
+		const T_num cutoffP2 = partPoints.getCutoffP2();
+
+		T_num f_total = 0;
+
+		PartCellIndex cellInd;
+
+		for(int i2 = 0; i2 < m_rigRef.size(); i2++) {
+
+			const Point p2 = pose(m_rigRef(i2));
+
+			Point *pGrad = pGrad2 ? &(*pGrad2)(i2) : 0;
+
+			partPoints.getCellIndex(p2,cellInd);
+
+			int slot = m_rigSlot(i2);
+
+			if( &cellInd.getCell() == m_rigCell[slot] ) {
+				const int *nb = &m_rigNbInd[0];
+				for(int k = m_rigNbStart[slot]; k < m_rigNbStart[slot+1]; k++) {
+					int i1 = nb[k];
+					Point p = p2 - points1(i1);
+					T_num rP2 = Math::dotSelf(p);
+					if( rP2 <= cutoffP2 ) {
+						f_total += _pairFG(i1,i2,rP2,p,pGrad);
+					}
+				}
+			}
+			else {
+				for(typename PartPoints::SubDomainIter iterNeighb = cellInd.getNeighbors(); 
+					iterNeighb.not_end(); 
+					iterNeighb.next()) {
+						int i1 = (*iterNeighb).index;
+						Point p = p2 - points1(i1);
+						T_num rP2 = Math::dotSelf(p);
+						if( rP2 <= cutoffP2 ) {
+							f_total += _pairFG(i1,i2,rP2,p,pGrad);
+						}
+				}
+			}
+
+			if( harmonicBasinUse ) {
+				Point p = p2 - points1Center;
+				f_total += harmonicBasin.f2(Math::dotSelf(p));
+				if( pGrad ) {
+					*pGrad += harmonicBasin.g2(p);
+				}
+			}
+
+		}
+
+		return f_total;
+
+	}
+
+	// Rebuild cached neighbor candidates for 'pose'. Lists for cells that
+	// were already cached are copied, only cells newly entered by points2
+	// are looked up in the partition grid.
+
+	void _rigidRebuild(const RotationTranslation& pose) {
+
+		std::unordered_map<const PartCell*,int> oldSlots, newSlots;
+
+		for(int slot = 0; slot < m_rigCell.size(); slot++) {
+			oldSlots[m_rigCell[slot]] = slot;
+		}
+
+		m_rigCellNew.clear();
+		m_rigNbStartNew.clear();
+		m_rigNbIndNew.clear();
+		m_rigNbStartNew.push_back(0);
+
+		PartCellIndex cellInd;
+
+		for(int i2 = 0; i2 < m_rigRef.size(); i2++) {
+
+			partPoints.getCellIndex(pose(m_rigRef(i2)),cellInd);
+
+			const PartCell *pCell = &cellInd.getCell();
+
+			typename std::unordered_map<const PartCell*,int>::const_iterator 
+				iterSlot = newSlots.find(pCell);
+
+			if( iterSlot != newSlots.end() ) {
+				m_rigSlot(i2) = iterSlot->second;
+				continue;
+			}
+
+			int slot = m_rigCellNew.size();
+			newSlots[pCell] = slot;
+			m_rigSlot(i2) = slot;
+			m_rigCellNew.push_back(pCell);
+
+			iterSlot = oldSlots.find(pCell);
+
+			if( iterSlot != oldSlots.end() ) {
+				int oldSlot = iterSlot->second;
+				m_rigNbIndNew.insert(m_rigNbIndNew.end(),
+					m_rigNbInd.begin() + m_rigNbStart[oldSlot],
+					m_rigNbInd.begin() + m_rigNbStart[oldSlot+1]);
+			}
+			else {
+				for(typename PartPoints::SubDomainIter iterNeighb = cellInd.getNeighbors(); 
+					iterNeighb.not_end(); 
+					iterNeighb.next()) {
+						m_rigNbIndNew.push_back((*iterNeighb).index);
+				}
+			}
+
+			m_rigNbStartNew.push_back(m_rigNbIndNew.size());
+
+		}
+
+		// keep a valid element for &m_rigNbInd[0] when all lists are empty
+		m_rigNbIndNew.push_back(-1);
+
+		m_rigCell.swap(m_rigCellNew);
+		m_rigNbStart.swap(m_rigNbStartNew);
+		m_rigNbInd.swap(m_rigNbIndNew);
+
+		m_rigPose = pose;
+
+	}
+
 };
 
 
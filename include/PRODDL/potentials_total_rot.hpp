@@ -34,6 +34,49 @@
 		    ACT_INS_NO = ~ ACT_INS,
 		    ACT_DFL = ACT_CALC_INS };
 
+    typedef typename PartPointsFast::GridCut PartGrid;
+    typedef typename PartPointsFast::Index PartIndex;
+
+    // Group-group energy matrix in compressed sparse row form.
+    // Row i holds columns col[rowStart[i],rowStart[i+1]) in ascending
+    // order with the values in val[...]. Only non-zero elements are stored.
+
+    struct SparseMatrix {
+
+      std::vector<int> rowStart;
+
+      std::vector<int> col;
+
+      std::vector<T_num> val;
+
+      int rows() const {
+	return rowStart.empty() ? 0 : int(rowStart.size()) - 1;
+      }
+
+      int nnz() const {
+	return col.size();
+      }
+
+      // y += A * x
+
+      void multAdd(const Floats& x, Floats& y) const {
+	int nRows = rows();
+	for(int i = 0; i < nRows; i++) {
+	  T_num s = 0;
+	  for(int k = rowStart[i]; k < rowStart[i+1]; k++) {
+	    s += val[k] * x(col[k]);
+	  }
+	  y(i) += s;
+	}
+      }
+
+    };
+
+    // Upper triangle of the group-group matrix keyed by i_gr*nGroups + j_gr,
+    // i_gr <= j_gr. Diagonal elements hold half of the matrix value.
+
+    typedef std::unordered_map<long,T_num> GroupPairMap;
+
   protected:
 
 
@@ -57,6 +100,17 @@
 
     Matrix m_fMatr;
 
+    int m_nGroups;
+
+    // If true, the energy is accumulated into m_fMap instead of the
+    // dense m_fMatr, which is then not allocated. The memory is
+    // proportional to the number of interacting group pairs rather than
+    // to nGroups^2.
+
+    bool m_sparse;
+
+    GroupPairMap m_fMap;
+
     // This data is held by reference,
     // the calling code can change values (but not size)
     // between energy evaluations.
@@ -88,6 +142,41 @@
 
     IntMatrix m_ignMatr;
 
+    // Number of threads used by f(). With one thread, the original
+    // serial insert-and-query loop is used.
+
+    int m_nThreads;
+
+    // Sequence number under which each point was inserted since the last
+    // resetPoints(), or -1. A point interacts only with the points inserted
+    // before it, and the parallel code uses these numbers to reproduce
+    // that order without actually following it.
+
+    Ints m_insOrder;
+
+    int m_insCount;
+
+    // Value of m_insCount at the moment each point was queried
+
+    Ints m_qryStamp;
+
+    // Work data of fParallel(), kept between calls to avoid reallocation.
+    // Queried points are sorted by (grid cell, point index), and each thread
+    // accumulates the upper triangle of the group-group matrix in its own
+    // copy (nThreads x nGroups^2 memory in the dense mode). Dense copies
+    // that would take more than m_maxThreadBufMb are replaced by maps
+    // as in the sparse mode.
+
+    double m_maxThreadBufMb;
+
+    std::vector<std::pair<long,int> > m_qry;
+
+    std::vector<SpIter> m_iterThr;
+
+    std::vector<Matrix> m_fMatrThr;
+
+    std::vector<GroupPairMap> m_fMapThr;
+
   public:
     
     PotTotalNonBondedRot() {}
@@ -150,7 +239,16 @@
 
       setIgnorePairs(listIgnoreGroupPairs);
 
-      m_fMatr.reference(Matrix(nGroups,nGroups));
+      m_nGroups = nGroups;
+
+      options.getdefault("sparseF",m_sparse,false);
+
+      if( m_sparse ) {
+	m_fMatr.free();
+      }
+      else {
+	m_fMatr.reference(Matrix(nGroups,nGroups));
+      }
 
       //TODO: in order to keep the existing MolForceParams class,
       //we just expect all atoms parameters to be in 'molecule' with 
@@ -173,19 +271,44 @@
 
       m_iterSphere = SpIter(m_partPoints,PosExtractor(m_points));
 
+      options.getdefault("nThreads",m_nThreads,1);
+
+      options.getdefault("maxThreadBufMb",m_maxThreadBufMb,1024.);
+
+      m_nThreads = Parallel::resolveThreads(m_nThreads);
+
+      m_insOrder.resize(m_points.rows());
+
+      m_qryStamp.resize(m_points.rows());
+
+      m_iterThr.clear();
+
+      m_fMatrThr.clear();
+
+      m_fMapThr.clear();
+
       resetF();
 
+      resetPoints();
+
     }
 
 
     // Clear the result energy matrix
 
     void resetF() {
-      m_fMatr = 0;
+      if( m_sparse ) {
+	m_fMap.clear();
+      }
+      else {
+	m_fMatr = 0;
+      }
     }
 
     void resetPoints() {
       m_partPoints.zapPoints();
+      m_insOrder = -1;
+      m_insCount = 0;
     }
 
     void resetCycle() {
@@ -200,12 +323,131 @@
     // the matrix can be quite large, so we are trying to
     // minimize the number of working copies
 
+    // Only available if the object was not initialized with the 'sparseF' option.
+
     Matrix& getF() {
+      ATALWAYS(! m_sparse,"Dense energy matrix is not available in sparse mode");
       return m_fMatr;
     }
 
+    // Copy the accumulated group-group energies into CSR matrix 'fSparse'.
+    // Works in either mode; in the dense mode this is a scan of the whole matrix.
+
+    void getFSparse(SparseMatrix& fSparse) const {
+
+      std::vector<int>& rowStart = fSparse.rowStart;
+      std::vector<int>& col = fSparse.col;
+      std::vector<T_num>& val = fSparse.val;
+
+      rowStart.assign(m_nGroups+1,0);
+
+      if( ! m_sparse ) {
+	for(int i_gr = 0; i_gr < m_nGroups; i_gr++) {
+	  for(int j_gr = 0; j_gr < m_nGroups; j_gr++) {
+	    if( m_fMatr(i_gr,j_gr) != 0 ) {
+	      rowStart[i_gr+1]++;
+	    }
+	  }
+	}
+	for(int i_gr = 0; i_gr < m_nGroups; i_gr++) {
+	  rowStart[i_gr+1] += rowStart[i_gr];
+	}
+	col.resize(rowStart[m_nGroups]);
+	val.resize(rowStart[m_nGroups]);
+	for(int i_gr = 0, k = 0; i_gr < m_nGroups; i_gr++) {
+	  for(int j_gr = 0; j_gr < m_nGroups; j_gr++) {
+	    T_num f = m_fMatr(i_gr,j_gr);
+	    if( f != 0 ) {
+	      col[k] = j_gr;
+	      val[k] = f;
+	      k++;
+	    }
+	  }
+	}
+	return;
+      }
+
+      // Sorted upper triangle. Visiting it in order fills every row with
+      // the mirrored elements (columns < row) first and then with its own
+      // elements (columns >= row), so columns come out ascending.
+
+      std::vector<std::pair<long,T_num> > upper;
+
+      upper.reserve(m_fMap.size());
+
+      for(typename GroupPairMap::const_iterator it = m_fMap.begin(); it != m_fMap.end(); ++it) {
+	if( it->second != 0 ) {
+	  upper.push_back(*it);
+	}
+      }
+
+      std::sort(upper.begin(),upper.end());
+
+      for(size_t k = 0; k < upper.size(); k++) {
+	int i_gr = int(upper[k].first / m_nGroups);
+	int j_gr = int(upper[k].first % m_nGroups);
+	rowStart[i_gr+1]++;
+	if( j_gr != i_gr ) {
+	  rowStart[j_gr+1]++;
+	}
+      }
+
+      for(int i_gr = 0; i_gr < m_nGroups; i_gr++) {
+	rowStart[i_gr+1] += rowStart[i_gr];
+      }
+
+      col.resize(rowStart[m_nGroups]);
+      val.resize(rowStart[m_nGroups]);
+
+      std::vector<int> pos(rowStart.begin(),rowStart.end()-1);
+
+      for(size_t k = 0; k < upper.size(); k++) {
+	int i_gr = int(upper[k].first / m_nGroups);
+	int j_gr = int(upper[k].first % m_nGroups);
+	T_num f = upper[k].second;
+	if( j_gr != i_gr ) {
+	  col[pos[i_gr]] = j_gr;
+	  val[pos[i_gr]++] = f;
+	  col[pos[j_gr]] = i_gr;
+	  val[pos[j_gr]++] = f;
+	}
+	else {
+	  col[pos[i_gr]] = i_gr;
+	  val[pos[i_gr]++] = 2*f;
+	}
+      }
+
+    }
+
+    // Add a symmetric matrix (e.g. one previously obtained from getFSparse())
+    // to the accumulated energies.
+
+    void addF(const SparseMatrix& fSparse) {
+      for(int i_gr = 0; i_gr < fSparse.rows(); i_gr++) {
+	for(int k = fSparse.rowStart[i_gr]; k < fSparse.rowStart[i_gr+1]; k++) {
+	  int j_gr = fSparse.col[k];
+	  T_num f = fSparse.val[k];
+	  if( m_sparse ) {
+	    if( j_gr > i_gr ) {
+	      m_fMap[_pairKey(i_gr,j_gr)] += f;
+	    }
+	    else if( j_gr == i_gr ) {
+	      m_fMap[_pairKey(i_gr,i_gr)] += f/2;
+	    }
+	  }
+	  else {
+	    m_fMatr(i_gr,j_gr) += f;
+	  }
+	}
+      }
+    }
+
+    bool isSparse() const {
+      return m_sparse;
+    }
+
     int getNGroups() const {
-      return m_fMatr.rows();
+      return m_nGroups;
     }
 
 
@@ -243,7 +485,37 @@
 
     }
 
+    // Accumulate group-group energies of the points flagged in m_indAct
+    // into the matrix returned by getF().
+
     void f() {
+      if( m_nThreads > 1 || m_sparse ) {
+	fParallel(m_nThreads);
+      }
+      else {
+	fSerial();
+      }
+    }
+
+    int getNThreads() const {
+      return m_nThreads;
+    }
+
+    // Memory in Mb of 'n' dense group-group matrices
+
+    double denseMatrixMb(int n) const {
+      return double(n) * m_nGroups * m_nGroups * sizeof(T_num) / (1024.*1024.);
+    }
+
+    double getMaxThreadBufMb() const {
+      return m_maxThreadBufMb;
+    }
+
+    void setNThreads(int nThreads) {
+      m_nThreads = Parallel::resolveThreads(nThreads);
+    }
+
+    void fSerial() {
 
       //TODO: think how avoid looping over group-group interactions
       //between rotamers of the same residue. So far the only solution
@@ -290,16 +562,239 @@
 	  }
 	  if( i_act & ACT_INS ) {
 	    m_iterSphere.insert(i_point);
+	    m_insOrder(i_point) = m_insCount++;
 	  }
 	}
       }
     }
 
+    // Same result as fSerial() up to the order of floating point summation.
+    // Insertion is done serially first, then the queried points are sorted
+    // by grid cell and split into 'nThreads' contiguous blocks that do not
+    // cut through cells. Each thread accumulates into its own matrix, and
+    // the matrices are summed in the fixed thread order, so the result
+    // does not change from run to run for the same number of threads.
+    // This is also the only implementation of the sparse mode.
+
+    void fParallel(int nThreads) {
+
+      PartGrid& grid = m_partPoints._getGrid();
+
+      PartIndex ind;
+
+      m_qry.clear();
+
+      for(int i_point = 0; i_point < m_points.rows(); i_point++) {
+	unsigned i_act = m_indAct(i_point);
+	if( ! (i_act & ACT_IGN) )  {
+	  const Point& point_i = m_points(i_point);
+	  if( i_act & ACT_CALC ) {
+	    m_qryStamp(i_point) = m_insCount;
+	    grid.indAt(point_i,ind);
+	    m_qry.push_back(std::make_pair(_cellKey(ind),i_point));
+	  }
+	  if( i_act & ACT_INS ) {
+	    m_partPoints.insert(point_i,i_point);
+	    m_insOrder(i_point) = m_insCount++;
+	  }
+	}
+      }
+
+      int nQry = m_qry.size();
+
+      nThreads = std::max(1,std::min(nThreads,nQry));
+
+      std::sort(m_qry.begin(),m_qry.end());
+
+      std::vector<int> qryStart(nThreads+1);
+
+      for(int i_thr = 0; i_thr < nThreads; i_thr++) {
+	int begin, end;
+	Parallel::blockRange(nQry,nThreads,i_thr,begin,end);
+	if( i_thr > 0 ) {
+	  begin = std::max(begin,qryStart[i_thr-1]);
+	}
+	while( begin > 0 && begin < nQry && m_qry[begin].first == m_qry[begin-1].first ) {
+	  begin++;
+	}
+	qryStart[i_thr] = begin;
+      }
+
+      qryStart[nThreads] = nQry;
+
+      int nGroups = getNGroups();
+
+      // allocate in this thread - copying SpIter and blitz arrays is not
+      // something we want to do concurrently
+
+      while( int(m_iterThr.size()) < nThreads ) {
+	m_iterThr.push_back(m_iterSphere);
+      }
+
+      if( m_sparse || denseMatrixMb(nThreads) > m_maxThreadBufMb ) {
+
+	m_fMatrThr.clear();
+
+	if( int(m_fMapThr.size()) < nThreads ) {
+	  m_fMapThr.resize(nThreads);
+	}
+
+	Parallel::runThreads(nThreads,[this,&qryStart](int i_thr) {
+	    GroupPairMap& fMap = m_fMapThr[i_thr];
+	    fMap.clear();
+	    AccSparse acc(fMap,m_nGroups);
+	    _fRange(m_iterThr[i_thr],acc,qryStart[i_thr],qryStart[i_thr+1]);
+	  });
+
+	// every key gets its contributions in the fixed thread order
+
+	for(int i_thr = 0; i_thr < nThreads; i_thr++) {
+	  const GroupPairMap& fMap = m_fMapThr[i_thr];
+	  for(typename GroupPairMap::const_iterator it = fMap.begin(); it != fMap.end(); ++it) {
+	    if( m_sparse ) {
+	      m_fMap[it->first] += it->second;
+	    }
+	    else {
+	      int i_gr = int(it->first / nGroups);
+	      int j_gr = int(it->first % nGroups);
+	      if( j_gr != i_gr ) {
+		m_fMatr(i_gr,j_gr) += it->second;
+		m_fMatr(j_gr,i_gr) += it->second;
+	      }
+	      else {
+		m_fMatr(i_gr,i_gr) += 2*it->second;
+	      }
+	    }
+	  }
+	}
+
+	return;
+      }
+
+      m_fMapThr.clear();
+
+      if( int(m_fMatrThr.size()) < nThreads ) {
+	m_fMatrThr.resize(nThreads);
+      }
+
+      for(int i_thr = 0; i_thr < nThreads; i_thr++) {
+	if( m_fMatrThr[i_thr].rows() != nGroups ) {
+	  m_fMatrThr[i_thr].resize(nGroups,nGroups);
+	}
+      }
+
+      Parallel::runThreads(nThreads,[this,&qryStart](int i_thr) {
+	  Matrix& fMatr = m_fMatrThr[i_thr];
+	  fMatr = 0;
+	  AccDense acc(fMatr);
+	  _fRange(m_iterThr[i_thr],acc,qryStart[i_thr],qryStart[i_thr+1]);
+	});
+
+      // Rows are reduced in parallel: row block [begin,end) writes the elements
+      // (i,j) and (j,i) with j >= i, which never overlap between blocks.
+
+      Parallel::forRanges(nThreads,nGroups,[this,nThreads,nGroups](int,int begin,int end) {
+	  for(int i_gr = begin; i_gr < end; i_gr++) {
+	    for(int j_gr = i_gr; j_gr < nGroups; j_gr++) {
+	      T_num f = 0;
+	      for(int i_thr = 0; i_thr < nThreads; i_thr++) {
+		f += m_fMatrThr[i_thr](i_gr,j_gr);
+	      }
+	      if( f != 0 ) {
+		if( j_gr != i_gr ) {
+		  m_fMatr(i_gr,j_gr) += f;
+		  m_fMatr(j_gr,i_gr) += f;
+		}
+		else {
+		  m_fMatr(i_gr,i_gr) += 2*f;
+		}
+	      }
+	    }
+	  }
+	});
+
+    }
+
     // Gradient calculation is not implemented yet
     void g(Points& grad);
 
   protected:
 
+    // Accumulators of the upper triangle (i_gr <= j_gr) for _fRange()
+
+    struct AccDense {
+      Matrix& fMatr;
+      AccDense(Matrix& _fMatr): fMatr(_fMatr) {}
+      void operator()(int i_gr, int j_gr, T_num f) {
+	fMatr(i_gr,j_gr) += f;
+      }
+    };
+
+    struct AccSparse {
+      GroupPairMap& fMap;
+      long nGroups;
+      AccSparse(GroupPairMap& _fMap, long _nGroups): fMap(_fMap), nGroups(_nGroups) {}
+      void operator()(int i_gr, int j_gr, T_num f) {
+	fMap[i_gr*nGroups + j_gr] += f;
+      }
+    };
+
+    long _pairKey(int i_gr, int j_gr) const {
+      return long(i_gr)*m_nGroups + j_gr;
+    }
+
+    // Query the points m_qry[begin,end) against the already inserted points,
+    // accumulating the upper triangle of the group-group matrix with 'acc'.
+    // Touches no shared state other than for reading.
+
+    template<class Acc>
+    void _fRange(SpIter& iterSphere, Acc& acc, int begin, int end) {
+      for(int i_q = begin; i_q < end; i_q++) {
+	int i_point = m_qry[i_q].second;
+	const Point& point_i = m_points(i_point);
+	int i_gr = m_indGroups(i_point);
+	int i_ign = m_indIgn(i_point);
+	int i_stamp = m_qryStamp(i_point);
+	for(iterSphere.init(point_i); iterSphere.not_end_lazy(); iterSphere.next()) {
+	  int j_point = *iterSphere;
+	  // only points that the serial loop would have inserted before this one
+	  if( m_insOrder(j_point) < i_stamp ) {
+	    unsigned j_act = m_indAct(j_point);
+	    if( j_act & ACT_CALC ) {
+	      int j_ign = m_indIgn(j_point);
+	      if( ! m_ignMatr(i_ign,j_ign) ) {
+		if( iterSphere.check_dist() ) {
+		  T_num r2 = iterSphere.r2();
+		  T_num f = _parNBTableEntry(i_point,j_point).softCoreLJ.f2(r2);
+		  if( r2 < m_aceCutoff2 ) {
+		    f += aceValue(i_point,j_point) * potAce.f2(r2);
+		  }
+		  int j_gr = m_indGroups(j_point);
+		  if( i_gr <= j_gr ) {
+		    acc(i_gr,j_gr,f);
+		  }
+		  else {
+		    acc(j_gr,i_gr,f);
+		  }
+		}
+	      }
+	    }
+	  }
+	}
+      }
+    }
+
+    // Linear index of a grid cell, used only to order the points by cell
+
+    long _cellKey(const PartIndex& ind) {
+      const typename PartGrid::GridArray& gridArr = m_partPoints._getGrid().getGridArray();
+      long key = 0;
+      for(int i = 0; i < 3; i++) {
+	key = key * gridArr.extent(i) + (ind(i) - gridArr.lbound(i));
+      }
+      return key;
+    }
+
     const ForceParNBTableEntry&
     _parNBTableEntry(int indAtom1,int indAtom2) {
       return m_fParNBTable(m_fParAtom.iType(indAtom1),m_fParAtom.iType(indAtom2));
@@ -25,7 +25,7 @@ typedef real OPTPP_real;
 
 // Header for Differential Evolution value-only method
 
-#include "PRODDL/Optim/DESolver.hpp"
+#include "PRODDL/refine_rigid_de.hpp"
 
 
 //int dummyfunc(real x) { return x; }
@@ -34,6 +34,7 @@ typedef real OPTPP_real;
 #include "PRODDL/potentials.hpp"
 
 #include "PRODDL/Geom/bounding.hpp"
+#include "PRODDL/Geom/bounding_cache.hpp"
 
 #include "PRODDL/Geom/transformation.hpp"
 
@@ -43,6 +44,8 @@ typedef real OPTPP_real;
 
 #include "PRODDL/Common/g_options.hpp"
 
+#include <limits>
+
 
 
 namespace PRODDL {
@@ -315,194 +318,6 @@ namespace PRODDL {
   typename OptPPAdaptor<TargetFunc,T_num>::Self * OptPPAdaptor<TargetFunc,T_num>::s_currentSelf = 0;
 
 
-#define PRODDL_OPT_SELDESTRAT(stratName) \
-      else if( strategyName == ""#stratName"" ) { \
-	ret = &stratName; \
-      }
-
-
-  template<class TargetFunc, typename T_num>
-  class OptDEAdaptor : public DE, public boost::noncopyable {
-
-  public:
-
-    typedef OptDEAdaptor<TargetFunc,T_num> Self;
-
-    typedef typename Geom::SpaceTraits<T_num>::Point3 Point;
-    typedef typename Geom::SpaceTraits<T_num>::VPoint3 Points;
-
-    typedef typename common_types::num_vector_type<double>::Type Doubles;
-
-  public:
-
-    OptDEAdaptor(TargetFunc * pTargetFunc,
-		 const DEParams& params_):
-      DE(params_),
-      m_pTargetFunc(pTargetFunc)
-    {
-      n_coords = params().dim;
-      m_dLower.resize(n_coords), m_dUpper.resize(n_coords);
-    }
-
-
-    T_num optimize(const Points& rbArrLower, 
-		   const Points& rbArrUpper,
-		   Points& rbArrCoords) {
-
-      ATLOG_ASSERT_1(rbArrCoords.size() == 2);
-
-      m_rbArrCoords.reference(rbArrCoords);
-
-      m_rbArrCoordsZero.reference(m_rbArrCoords.copy());
-
-      pointsToDoubles(rbArrLower,m_dLower);
-      pointsToDoubles(rbArrUpper,m_dUpper);
-
-      Setup(m_dLower.data(),
-	    m_dUpper.data(), 
-	    selectStrategy(params().strategy));
-
-      Solve();
-
-      doublesToPoints(Solution(),m_rbArrCoords);      
-
-      T_num f_sol = Energy();
-
-      return f_sol;
-    }
-
-    virtual void seed() {
-
-      // This is called from Setup(), which is in turn called from
-      // optimized(), so m_dLower, m_dUpper and m_rbArrCoordsZero
-      // are already initialized.
-
-      DE::seed();
-
-      Doubles start(nDim);
-
-      pointsToDoubles(m_rbArrCoordsZero,start);
-
-//       for (int i=0; i < nPop; i++) {
-// 	bool goodPoint = false;
-// 	double e = 0.;
-// 	while( ! goodPoint ) {
-// 	  for (int j=0; j < nDim; j++) {
-// 	    Element(population,i,j) = RandomUniform(min[j],max[j]);
-// 	  }
-// 	  double e = f(RowVector(population,i));
-// 	  if( e < -10 ) {
-// 	    goodPoint = true;
-// 	  }
-// 	}
-//       }
-
-      // Replace the first population vector with the initial point
-
-      for(int j = 0; j < nDim; j++) {
-	Element(population,0,j) = start(j);
-      }
-
-    }
-
-    virtual bool checkConstraints(double testSolution[]) {
-      for(int i = 0; i < n_coords; i++) {
-	if( testSolution[i] < m_dLower(i) ||
-	    testSolution[i] > m_dUpper(i) ) {
-	  ATLOG_OUT_4(ATLOGVAR(n_coords) << ATLOGVAR(i) << ATLOGVAR(testSolution[i]) \
-		      << ATLOGVAR(m_dLower(i)) << ATLOGVAR(m_dUpper(i)));
-	  return false;
-	}
-      }
-      return true;
-    }
-
-    virtual double f(double x[]) {
-      doublesToPoints(x,m_rbArrCoords);
-      return m_pTargetFunc->f(m_rbArrCoords);
-    }
-
-  protected:
-
-    DESolver::StrategyFunction selectStrategy(const std::string& strategyName) const {
-
-
-      struct StSel {
-	const char* name;
-	DESolver::StrategyFunction p;
-	StSel(const char* name_,DESolver::StrategyFunction p_) :
-	  name(name_), p(p_) {}
-      };
-
-      StSel strats[] = {
-	StSel("Best1Exp",&DESolver::Best1Exp),
-	StSel("Rand1Exp",&DESolver::Rand1Exp),
-	StSel("RandToBest1Exp",&DESolver::RandToBest1Exp),
-	StSel("Best2Exp",&DESolver::Best2Exp),
-	StSel("Rand2Exp",&DESolver::Rand2Exp),
-	StSel("Best1Bin",&DESolver::Best1Bin),
-	StSel("Rand1Bin",&DESolver::Rand1Bin),
-	StSel("Best1ExpConstr",&DESolver::Best1ExpConstr),
-	StSel("Best2ExpConstr",&DESolver::Best2ExpConstr)
-      };
-
-      DESolver::StrategyFunction ret = 0;
-
-      for(int i = 0; i < sizeof(strats)/sizeof(strats[0]); i++) {
-	if( strats[i].name == strategyName ) {
-	  ret = strats[i].p;
-	  break;
-	}
-      }
-      
-      ATLOG_ASSERT_1(ret != 0);
-
-      return ret;
-
-    }
-
-    static
-    void pointsToDoubles(const Points& p, Doubles& x) {
-      for(int i_p = 0, i_x=0; i_p < p.size(); i_p++) {
-	for(int j_p = 0; j_p < p(i_p).length(); j_p++, i_x++) {
-	  x(i_x) = p(i_p)(j_p);
-	}
-      }
-    }
-
-    static
-    void doublesToPoints(const Doubles& x, Points& p) {
-      for(int i_p = 0, i_x=0; i_p < p.size(); i_p++) {
-	for(int j_p = 0; j_p < p(i_p).length(); j_p++, i_x++) {
-	  p(i_p)(j_p) = x(i_x);
-	}
-      }
-    }
-
-    static
-    void doublesToPoints(const double x[], Points& p) {
-      for(int i_p = 0, i_x=0; i_p < p.size(); i_p++) {
-	for(int j_p = 0; j_p < p(i_p).length(); j_p++, i_x++) {
-	  p(i_p)(j_p) = x[i_x];
-	}
-      }
-    }
-
-  protected:
-
-    int n_coords; // number of coordinates to optimize (6 for xyz+angles)
-    Points m_rbArrCoords; // output coords, reference outside data 2xPoint
-    Points m_rbArrCoordsZero; // saved initial value of m_rbArrCoords
-
-    // bound constraints
-    Doubles m_dLower, m_dUpper;
-
-    TargetFunc * m_pTargetFunc;
-
-  }; // OptDEAdaptor
-
-
-
 
   template<typename T_num>
   class RefinementRigidValue {
@@ -517,6 +332,7 @@ namespace PRODDL {
     typedef typename Geom::SpaceTraits<T_num>::VPoint3 Points;
     typedef Geom::Bounding::Box<T_num> BoundingBox;
     typedef Geom::Bounding::Diameter<T_num> BoundingDiameter;
+    typedef Geom::Bounding::DescriptorCache<T_num> BoundingCache;
     typedef typename BoundingBox::PointPair PointPair;
 
     typedef typename common_types::num_vector_type<T_num>::Type fvect;
@@ -560,6 +376,9 @@ namespace PRODDL {
 
     Translation m_iniTransform;
 
+    // the best energy seen during the current refineOne() call
+    T_num m_eAccepted;
+
   public:
 
     RefinementRigidValue() {}
@@ -590,8 +409,7 @@ namespace PRODDL {
 
       BoundingBox boundingBox(recPoints,true);
       PointPair bounds = boundingBox.getDiagonal();
-      BoundingDiameter boundingDiameter(ligPoints);
-      T_num ligSize = boundingDiameter.getSize();
+      T_num ligSize = BoundingCache::get(ligPoints)->getDiameter().getSize();
       ligSize += receptorMovePadding;
       bounds[0] -= ligSize;
       bounds[1] += ligSize;
@@ -633,12 +451,17 @@ namespace PRODDL {
 
     T_num f(const Points& rbArrCoords) {
 
-      xyzCoords = xyzCoordsZero;
       // rbArrCoords must contain (xyz,angles) in that order,
       // but RotationTranslation ctor has the order historically reversed
       RotationTranslation tr = m_iniTransform.inverse() * RotationTranslation(rbArrCoords(1),rbArrCoords(0)) * m_iniTransform;
-      tr(xyzCoords);
-      return potTotalNB.f(xyzCoords);
+      // transformation is applied inside the energy kernel, relative to xyzCoordsZero
+      T_num e = potTotalNB.fRigid(tr);
+      // let the neighbor cache follow the best point found so far
+      if( e < m_eAccepted ) {
+	m_eAccepted = e;
+	potTotalNB.acceptRigid(tr);
+      }
+      return e;
     }
 
     T_num 
@@ -649,6 +472,10 @@ namespace PRODDL {
       ATLOG_ASSERT_1(xyzCoordsZero.size() == xyzLigStart.size());      
       xyzCoordsZero = xyzLigStart;
 
+      potTotalNB.setRigidReference(xyzCoordsZero);
+
+      m_eAccepted = std::numeric_limits<T_num>::max();
+
       m_iniTransform = Translation(Point(-1*blitz::mean(xyzCoordsZero)));
 
       m_rbArrCoords = m_rbArrCoordsZero;
@@ -693,7 +520,7 @@ namespace PRODDL {
 
       Points xyzLigStart(xyzLigReference.size());
 
-      for(int i_trans = 0; i_trans < transforms.size(); i++) {
+      for(int i_trans = 0; i_trans < transforms.size(); i_trans++) {
 
 	xyzLigStart = xyzLigReference;
 	const RotationTranslation& transform = transforms(i_trans);
@@ -722,6 +549,7 @@ namespace PRODDL {
     typedef typename Geom::SpaceTraits<T_num>::VPoint3 Points;
     typedef Geom::Bounding::Box<T_num> BoundingBox;
     typedef Geom::Bounding::Diameter<T_num> BoundingDiameter;
+    typedef Geom::Bounding::DescriptorCache<T_num> BoundingCache;
     typedef typename BoundingBox::PointPair PointPair;
 
     typedef typename common_types::num_vector_type<T_num>::Type fvect;
@@ -793,8 +621,7 @@ namespace PRODDL {
 
       BoundingBox boundingBox(recPoints,true);
       PointPair bounds = boundingBox.getDiagonal();
-      BoundingDiameter boundingDiameter(ligPoints);
-      T_num ligSize = boundingDiameter.getSize();
+      T_num ligSize = BoundingCache::get(ligPoints)->getDiameter().getSize();
       ligSize += receptorMovePadding;
       bounds[0] -= ligSize;
       bounds[1] += ligSize;
@@ -952,7 +779,7 @@ namespace PRODDL {
 
       Points xyzLigStart(xyzLigReference.size());
 
-      for(int i_trans = 0; i_trans < transforms.size(); i++) {
+      for(int i_trans = 0; i_trans < transforms.size(); i_trans++) {
 
 	xyzLigStart = xyzLigReference;
 	const RotationTranslation& transform = transforms(i_trans);
@@ -0,0 +1,217 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#ifndef AT_PRODDL_REFINE_RIGID_DE_H__
+#define AT_PRODDL_REFINE_RIGID_DE_H__
+
+// Adaptor of Differential Evolution value-only method to rigid body
+// refinement classes. Kept separate from refine_rigid.hpp so that it can be
+// used without OPT++ headers.
+
+#include "PRODDL/Optim/DESolver.hpp"
+
+#include "PRODDL/Geom/traits.hpp"
+
+#include "PRODDL/Common/common_types.hpp"
+
+#include "PRODDL/Common/debug.hpp"
+
+#include <boost/utility.hpp>
+
+
+namespace PRODDL {
+
+#define PRODDL_OPT_SELDESTRAT(stratName) \
+      else if( strategyName == ""#stratName"" ) { \
+	ret = &stratName; \
+      }
+
+
+  template<class TargetFunc, typename T_num>
+  class OptDEAdaptor : public DE, public boost::noncopyable {
+
+  public:
+
+    typedef OptDEAdaptor<TargetFunc,T_num> Self;
+
+    typedef typename Geom::SpaceTraits<T_num>::Point3 Point;
+    typedef typename Geom::SpaceTraits<T_num>::VPoint3 Points;
+
+    typedef typename common_types::num_vector_type<double>::Type Doubles;
+
+  public:
+
+    OptDEAdaptor(TargetFunc * pTargetFunc,
+		 const DEParams& params_):
+      DE(params_),
+      m_pTargetFunc(pTargetFunc)
+    {
+      n_coords = params().dim;
+      m_dLower.resize(n_coords), m_dUpper.resize(n_coords);
+    }
+
+
+    T_num optimize(const Points& rbArrLower, 
+		   const Points& rbArrUpper,
+		   Points& rbArrCoords) {
+
+      ATLOG_ASSERT_1(rbArrCoords.size() == 2);
+
+      m_rbArrCoords.reference(rbArrCoords);
+
+      m_rbArrCoordsZero.reference(m_rbArrCoords.copy());
+
+      pointsToDoubles(rbArrLower,m_dLower);
+      pointsToDoubles(rbArrUpper,m_dUpper);
+
+      Setup(m_dLower.data(),
+	    m_dUpper.data(), 
+	    selectStrategy(params().strategy));
+
+      Solve();
+
+      doublesToPoints(Solution(),m_rbArrCoords);      
+
+      T_num f_sol = Energy();
+
+      return f_sol;
+    }
+
+    virtual void seed() {
+
+      // This is called from Setup(), which is in turn called from
+      // optimized(), so m_dLower, m_dUpper and m_rbArrCoordsZero
+      // are already initialized.
+
+      DE::seed();
+
+      Doubles start(nDim);
+
+      pointsToDoubles(m_rbArrCoordsZero,start);
+
+//       for (int i=0; i < nPop; i++) {
+// 	bool goodPoint = false;
+// 	double e = 0.;
+// 	while( ! goodPoint ) {
+// 	  for (int j=0; j < nDim; j++) {
+// 	    Element(population,i,j) = RandomUniform(min[j],max[j]);
+// 	  }
+// 	  double e = f(RowVector(population,i));
+// 	  if( e < -10 ) {
+// 	    goodPoint = true;
+// 	  }
+// 	}
+//       }
+
+      // Replace the first population vector with the initial point
+
+      for(int j = 0; j < nDim; j++) {
+	Element(population,0,j) = start(j);
+      }
+
+    }
+
+    virtual bool checkConstraints(double testSolution[]) {
+      for(int i = 0; i < n_coords; i++) {
+	if( testSolution[i] < m_dLower(i) ||
+	    testSolution[i] > m_dUpper(i) ) {
+	  ATLOG_OUT_4(ATLOGVAR(n_coords) << ATLOGVAR(i) << ATLOGVAR(testSolution[i]) \
+		      << ATLOGVAR(m_dLower(i)) << ATLOGVAR(m_dUpper(i)));
+	  return false;
+	}
+      }
+      return true;
+    }
+
+    virtual double f(double x[]) {
+      doublesToPoints(x,m_rbArrCoords);
+      return m_pTargetFunc->f(m_rbArrCoords);
+    }
+
+  protected:
+
+    DESolver::StrategyFunction selectStrategy(const std::string& strategyName) const {
+
+
+      struct StSel {
+	const char* name;
+	DESolver::StrategyFunction p;
+	StSel(const char* name_,DESolver::StrategyFunction p_) :
+	  name(name_), p(p_) {}
+      };
+
+      StSel strats[] = {
+	StSel("Best1Exp",&DESolver::Best1Exp),
+	StSel("Rand1Exp",&DESolver::Rand1Exp),
+	StSel("RandToBest1Exp",&DESolver::RandToBest1Exp),
+	StSel("Best2Exp",&DESolver::Best2Exp),
+	StSel("Rand2Exp",&DESolver::Rand2Exp),
+	StSel("Best1Bin",&DESolver::Best1Bin),
+	StSel("Rand1Bin",&DESolver::Rand1Bin),
+	StSel("Best1ExpConstr",&DESolver::Best1ExpConstr),
+	StSel("Best2ExpConstr",&DESolver::Best2ExpConstr)
+      };
+
+      DESolver::StrategyFunction ret = 0;
+
+      for(int i = 0; i < sizeof(strats)/sizeof(strats[0]); i++) {
+	if( strats[i].name == strategyName ) {
+	  ret = strats[i].p;
+	  break;
+	}
+      }
+      
+      ATLOG_ASSERT_1(ret != 0);
+
+      return ret;
+
+    }
+
+    static
+    void pointsToDoubles(const Points& p, Doubles& x) {
+      for(int i_p = 0, i_x=0; i_p < p.size(); i_p++) {
+	for(int j_p = 0; j_p < p(i_p).length(); j_p++, i_x++) {
+	  x(i_x) = p(i_p)(j_p);
+	}
+      }
+    }
+
+    static
+    void doublesToPoints(const Doubles& x, Points& p) {
+      for(int i_p = 0, i_x=0; i_p < p.size(); i_p++) {
+	for(int j_p = 0; j_p < p(i_p).length(); j_p++, i_x++) {
+	  p(i_p)(j_p) = x(i_x);
+	}
+      }
+    }
+
+    static
+    void doublesToPoints(const double x[], Points& p) {
+      for(int i_p = 0, i_x=0; i_p < p.size(); i_p++) {
+	for(int j_p = 0; j_p < p(i_p).length(); j_p++, i_x++) {
+	  p(i_p)(j_p) = x[i_x];
+	}
+      }
+    }
+
+  protected:
+
+    int n_coords; // number of coordinates to optimize (6 for xyz+angles)
+    Points m_rbArrCoords; // output coords, reference outside data 2xPoint
+    Points m_rbArrCoordsZero; // saved initial value of m_rbArrCoords
+
+    // bound constraints
+    Doubles m_dLower, m_dUpper;
+
+    TargetFunc * m_pTargetFunc;
+
+  }; // OptDEAdaptor
+
+} // namespace PRODDL
+
+#endif // AT_PRODDL_REFINE_RIGID_DE_H__
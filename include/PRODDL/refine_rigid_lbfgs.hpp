@@ -0,0 +1,378 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#ifndef AT_PRODDL_REFINE_RIGID_LBFGS_H__
+#define AT_PRODDL_REFINE_RIGID_LBFGS_H__
+
+// Rigid body refinement of docking predictions by bound constrained L-BFGS
+// with analytic rigid body gradients. Unlike RefinementRigidGrad from
+// refine_rigid.hpp, this does not depend on OPT++.
+// Optionally, a short Differential Evolution run explores the bounded
+// region first, and its best point is then polished by L-BFGS.
+
+#include "PRODDL/Optim/lbfgsb.hpp"
+
+#include "PRODDL/refine_rigid_de.hpp"
+
+#include "PRODDL/potentials.hpp"
+
+#include "PRODDL/Geom/bounding.hpp"
+#include "PRODDL/Geom/bounding_cache.hpp"
+
+#include "PRODDL/Geom/transformation.hpp"
+
+#include "PRODDL/Geom/move.hpp"
+
+#include "PRODDL/Common/debug.hpp"
+
+#include "PRODDL/Common/g_options.hpp"
+
+#include <boost/shared_ptr.hpp>
+
+#include <limits>
+
+
+namespace PRODDL {
+
+
+  template<typename T_num>
+  class RefinementRigidLbfgs {
+
+  public:
+
+    typedef RefinementRigidLbfgs<T_num> Self;
+
+    typedef typename Potentials<T_num>::PotTotalNonBonded PotTotalNB;
+    typedef typename Potentials<T_num>::MolForceParams MolForceParams;
+    typedef typename Geom::SpaceTraits<T_num>::Point3 Point;
+    typedef typename Geom::SpaceTraits<T_num>::VPoint3 Points;
+    typedef Geom::Bounding::Box<T_num> BoundingBox;
+    typedef Geom::Bounding::Diameter<T_num> BoundingDiameter;
+    typedef Geom::Bounding::DescriptorCache<T_num> BoundingCache;
+    typedef typename BoundingBox::PointPair PointPair;
+
+    typedef typename common_types::num_vector_type<T_num>::Type fvect;
+
+    typedef typename Geom::TransformationTraits<T_num>::VRotationTranslation VRotationTranslation;
+    typedef Geom::Rotation<T_num> Rotation;
+    typedef Geom::Translation<T_num> Translation;
+    typedef Geom::RotationTranslation<T_num> RotationTranslation;
+
+    typedef Geom::Transforms::RigidBody<T_num> RigidBody;
+
+    enum { n_coords = 6 };
+
+    // Optimizer works in double precision regardless of T_num, like DESolver does
+
+    typedef Optim::LbfgsB<double,n_coords> Lbfgs;
+
+  protected:
+
+    typedef OptDEAdaptor<Self,T_num> TOptDEAdaptor;
+
+    typedef boost::shared_ptr<TOptDEAdaptor> POptDEAdaptor;
+
+    typedef boost::shared_ptr<Lbfgs> PLbfgs;
+
+
+    PotTotalNB potTotalNB;
+
+    // buffers for coordinate conversions
+
+    Points xyzCoords, xyzGrads;
+
+    // starting coords in standard orientation (rigid body reference coords)
+
+    Points xyzCoordsZero;
+
+    // rigid body coords of the starting position
+
+    PointPair rbCoordsZero;
+
+    // buffer used by DE adaptor
+
+    Points m_rbArrCoords; // 2xPoint
+
+    PLbfgs m_pLbfgs;
+
+    POptDEAdaptor m_pOptimizerDE;
+
+    // if !0 - run DE before L-BFGS
+    int m_hybridDE;
+
+    // bounds around the starting position
+    T_num m_xyzBound, m_angBound;
+
+    // number of objective function evaluations done by the last refineOne() call
+    int m_nFuncEvals;
+
+    // the best energy seen by DE stage during the current refineOne() call
+    T_num m_eAccepted;
+
+  public:
+
+    RefinementRigidLbfgs() {}
+
+    // NOTE: Array params should be accepted by values, so that we can safely pass
+    // here temporary objects returned by view_as_blitz() Python view creation functions
+    // and such !!!
+
+    RefinementRigidLbfgs(const Points recPoints, const Points ligPoints, const MolForceParams& mfParams):
+      m_hybridDE(0),
+      m_nFuncEvals(0)
+    {
+
+      int runTimeLogLevel;
+
+      gOptions.getdefault("logLevel",runTimeLogLevel,ATLOG_LEVEL_1);
+
+      Logger::setRunTimeLevel(runTimeLogLevel);
+
+      const Options& rigOptions = gOptions.getBlock("rigid");
+
+      T_num receptorMovePadding;
+      rigOptions.getdefault("receptorMovePadding",receptorMovePadding,1.0);
+
+      // select the size of the partiotioning grid as bounding receptor box
+      // along the current coordinate axes ('true' as a 2nd argument to
+      // BoundingBox ctor)
+      // extended in all directions by the diameter of a ligand
+
+      BoundingBox boundingBox(recPoints,true);
+      PointPair bounds = boundingBox.getDiagonal();
+      T_num ligSize = BoundingCache::get(ligPoints)->getDiameter().getSize();
+      ligSize += receptorMovePadding;
+      bounds[0] -= ligSize;
+      bounds[1] += ligSize;
+
+      potTotalNB.init(recPoints,mfParams,bounds,rigOptions);
+
+      xyzCoords.reference(Points(ligPoints.size()));
+      xyzGrads.reference(Points(xyzCoords.size()));
+      xyzCoordsZero.reference(Points(xyzCoords.size()));
+      m_rbArrCoords.resize(2);
+
+      rigOptions.getdefault("xyzBound",m_xyzBound,1);
+
+      T_num Pi = T_num(4.0)*std::atan(T_num(1.0));
+      T_num degToRad = Pi/180.;
+
+      rigOptions.getdefault("angBound",m_angBound,20);
+      m_angBound *= degToRad;
+
+      Optim::LbfgsParams lbPar;
+
+      rigOptions.getdefault("tolerance",lbPar.gTol,lbPar.gTol);
+
+      rigOptions.getdefault("iterMax",lbPar.maxIter,lbPar.maxIter);
+
+      rigOptions.getdefault("fevalMax",lbPar.maxFuncEvals,lbPar.maxFuncEvals);
+
+      if( rigOptions.has_block("lbfgs") ) {
+
+	const Options& lbOptions = rigOptions.getBlock("lbfgs");
+
+	lbOptions.getdefault("fTol",lbPar.fTol,lbPar.fTol);
+
+	lbOptions.getdefault("maxStep",lbPar.maxStep,lbPar.maxStep);
+
+	lbOptions.getdefault("maxLineSearch",lbPar.maxLineSearch,lbPar.maxLineSearch);
+
+      }
+
+      m_pLbfgs.reset(new Lbfgs(lbPar));
+
+      rigOptions.getdefault("hybridDE",m_hybridDE,0);
+
+      if( m_hybridDE ) {
+
+	// Short exploration run: small population and few generations
+	// by default, since L-BFGS will polish the result anyway
+
+	DEParams dePar(n_coords);
+
+	dePar.popSize = 2*n_coords;
+	dePar.maxGenerations = 20;
+
+	const Options& deOptions = rigOptions.getBlock("de");
+
+	deOptions.getdefault("nPopulation",dePar.popSize,dePar.popSize);
+
+	deOptions.getdefault("hybridGenerations",dePar.maxGenerations,dePar.maxGenerations);
+
+	dePar.maxFuncEvals = dePar.popSize*dePar.maxGenerations;
+
+	deOptions.getdefault("testGenerations",dePar.testGenerations,dePar.testGenerations);
+
+	deOptions.getdefault("diffScale",dePar.diffScale,dePar.diffScale);
+
+	deOptions.getdefault("crossoverProb",dePar.crossoverProb,dePar.crossoverProb);
+
+	deOptions.getdefault("scaleFading",dePar.scaleFading,dePar.scaleFading);
+
+	deOptions.getdefault("strategy",dePar.strategy,dePar.strategy);
+
+	m_pOptimizerDE.reset(new TOptDEAdaptor(this,dePar));
+
+      }
+
+    }
+
+    // Value-only objective in (xyz,angles) rigid body coords, called by DE
+
+    T_num f(const Points& rbArrCoords) {
+
+      m_nFuncEvals++;
+      PointPair rbCoords;
+      rbCoords(0) = rbArrCoords(0);
+      rbCoords(1) = rbArrCoords(1);
+      RotationTranslation tr = RigidBody::transformation(rbCoords);
+      T_num e = potTotalNB.fRigid(tr);
+      if( e < m_eAccepted ) {
+	m_eAccepted = e;
+	potTotalNB.acceptRigid(tr);
+      }
+      return e;
+    }
+
+    // Value and gradient in rigid body coords packed as x[n_coords], called by L-BFGS
+
+    double fg(const double x[], double g[]) {
+
+      m_nFuncEvals++;
+      PointPair rbCoords, rbGrads;
+      doublesToPointPair(x,rbCoords);
+      RigidBody::rigidxyz(xyzCoordsZero,rbCoords,xyzCoords);
+      T_num e = potTotalNB.fg(xyzCoords,xyzGrads);
+      RigidBody::xyzGradToRigid(xyzCoords,xyzGrads,rbCoords,rbGrads);
+      pointPairToDoubles(rbGrads,g);
+      return e;
+    }
+
+    T_num
+    refineOne(const Points xyzLigStart,RotationTranslation& resultTransform) {
+
+      ATLOG_ASSERT_1(xyzCoordsZero.size() == xyzLigStart.size());
+
+      m_nFuncEvals = 0;
+
+      fvect mass(xyzLigStart.size());
+      mass = 1.0;
+      RigidBody::standardOrientation(xyzLigStart,mass,xyzCoordsZero,rbCoordsZero);
+
+      if( m_hybridDE ) {
+	potTotalNB.setRigidReference(xyzCoordsZero,RigidBody::transformation(rbCoordsZero));
+	m_eAccepted = std::numeric_limits<T_num>::max();
+      }
+
+      PointPair rbLower, rbUpper;
+      rbLower(0) = rbCoordsZero(0) - m_xyzBound;
+      rbUpper(0) = rbCoordsZero(0) + m_xyzBound;
+      rbLower(1) = rbCoordsZero(1) - m_angBound;
+      rbUpper(1) = rbCoordsZero(1) + m_angBound;
+
+      PointPair rbCoordsResult;
+      rbCoordsResult(0) = rbCoordsZero(0);
+      rbCoordsResult(1) = rbCoordsZero(1);
+
+      if( m_hybridDE ) {
+	Points rbArrLower(2), rbArrUpper(2);
+	rbArrLower(0) = rbLower(0);
+	rbArrLower(1) = rbLower(1);
+	rbArrUpper(0) = rbUpper(0);
+	rbArrUpper(1) = rbUpper(1);
+	m_rbArrCoords(0) = rbCoordsZero(0);
+	m_rbArrCoords(1) = rbCoordsZero(1);
+	T_num eDE = m_pOptimizerDE->optimize(rbArrLower,rbArrUpper,m_rbArrCoords);
+	ATLOG_OUT_4("DE stage: " << ATLOGVAR(eDE) << ATLOGVAR(m_nFuncEvals));
+	rbCoordsResult(0) = m_rbArrCoords(0);
+	rbCoordsResult(1) = m_rbArrCoords(1);
+      }
+
+      double x[n_coords], lower[n_coords], upper[n_coords];
+
+      pointPairToDoubles(rbLower,lower);
+      pointPairToDoubles(rbUpper,upper);
+      pointPairToDoubles(rbCoordsResult,x);
+
+      m_pLbfgs->setBounds(lower,upper);
+
+      T_num e = m_pLbfgs->optimize(*this,x);
+
+      ATLOG_OUT_4(ATLOGVAR(e) << ATLOGVAR(m_nFuncEvals) << ATLOGVAR(m_pLbfgs->numIter()) \
+		  << ATLOGVAR(m_pLbfgs->whyStoppedStr()));
+
+      doublesToPointPair(x,rbCoordsResult);
+
+      // make the result to be relative to the initial position
+      resultTransform = RigidBody::transformation(rbCoordsResult)*
+	RigidBody::transformation(rbCoordsZero).inverse();
+
+      return e;
+    }
+
+    void
+    setPositionsReceptor(const Points points) {
+
+      potTotalNB.setPoints1(points);
+
+    }
+
+    void
+    refineMany(const Points xyzLigReference,
+	       const VRotationTranslation transforms,
+	       VRotationTranslation transforms_new,
+	       fvect e_new) {
+
+      Points xyzLigStart(xyzLigReference.size());
+
+      for(int i_trans = 0; i_trans < transforms.size(); i_trans++) {
+
+	xyzLigStart = xyzLigReference;
+	const RotationTranslation& transform = transforms(i_trans);
+	transform(xyzLigStart);
+	RotationTranslation transform_new;
+	e_new(i_trans) = refineOne(xyzLigStart,transform_new);
+	transforms_new(i_trans) = transform_new*transform;
+
+      }
+
+    }
+
+    // Number of objective function evaluations done by the last refineOne() call
+
+    int numFuncEvals() const {
+      return m_nFuncEvals;
+    }
+
+  protected:
+
+    static
+    void pointPairToDoubles(const PointPair& p, double x[]) {
+      for(int i_p = 0, i_x=0; i_p < 2; i_p++) {
+	for(int j_p = 0; j_p < 3; j_p++, i_x++) {
+	  x[i_x] = p(i_p)(j_p);
+	}
+      }
+    }
+
+    static
+    void doublesToPointPair(const double x[], PointPair& p) {
+      for(int i_p = 0, i_x=0; i_p < 2; i_p++) {
+	for(int j_p = 0; j_p < 3; j_p++, i_x++) {
+	  p(i_p)(j_p) = x[i_x];
+	}
+      }
+    }
+
+  }; // class RefinementRigidLbfgs
+
+
+} // namespace PRODDL
+
+#endif // AT_PRODDL_REFINE_RIGID_LBFGS_H__
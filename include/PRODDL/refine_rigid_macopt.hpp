@@ -14,6 +14,7 @@
 #include "PRODDL/potentials.hpp"
 
 #include "PRODDL/Geom/bounding.hpp"
+#include "PRODDL/Geom/bounding_cache.hpp"
 
 #include "PRODDL/Optim/optim_mac.hpp"
 
@@ -40,6 +41,7 @@ namespace PRODDL {
     typedef typename Geom::SpaceTraits<T_num>::VPoint3 Points;
     typedef Geom::Bounding::Box<T_num> BoundingBox;
     typedef Geom::Bounding::Diameter<T_num> BoundingDiameter;
+    typedef Geom::Bounding::DescriptorCache<T_num> BoundingCache;
     typedef typename BoundingBox::PointPair PointPair;
 
     typedef typename common_types::num_vector_type<T_num>::Type fvect;
@@ -120,8 +122,7 @@ namespace PRODDL {
 
       BoundingBox boundingBox(recPoints,true);
       PointPair bounds = boundingBox.getDiagonal();
-      BoundingDiameter boundingDiameter(ligPoints);
-      T_num ligSize = boundingDiameter.getSize();
+      T_num ligSize = BoundingCache::get(ligPoints)->getDiameter().getSize();
       ligSize += receptorMovePadding;
       bounds[0] -= ligSize;
       bounds[1] += ligSize;
@@ -84,6 +84,10 @@ namespace PRODDL {
     bounds[0] -= ligSize;
     bounds[1] += ligSize;
 
+    m_mfParams = mfParams;
+
+    m_bounds = bounds;
+
     const Options& rotOptions = gOptions.getBlock("rotamers");
 
     m_potTotal.init(points,m_indGroups,m_indAct,m_indIgn,m_ignPairs,m_nGroups,m_nIgn,mfParams,bounds,rotOptions);
@@ -95,6 +99,41 @@ namespace PRODDL {
 
 
 
+  template<typename T_num>
+  typename RefinementRotamers<T_num>::MeanFieldParams
+  RefinementRotamers<T_num>::readMeanFieldParams() const {
+
+    // Boltzman law's 'RT' in kJ/mol at T = 300K
+
+    const T_num R = 2.51/300;
+
+    int runTimeLogLevel;
+
+    gOptions.getdefault("logLevel",runTimeLogLevel,ATLOG_LEVEL_1);
+
+    Logger::setRunTimeLevel(runTimeLogLevel);
+
+    const Options& rotOptions = gOptions.getBlock("rotamers");
+
+    MeanFieldParams mfp;
+
+    T_num T;
+    rotOptions.getdefault("T",T,300.);
+
+    mfp.RT = R * T;
+
+    rotOptions.getdefault("tolerance",mfp.tolerance,1e-7);
+
+    rotOptions.getdefault("lambda",mfp.lambda,0.5);
+
+    rotOptions.getdefault("iterMax",mfp.iterMax,3000);
+
+    return mfp;
+
+  }
+
+
+
   template<typename T_num>
   void
   RefinementRotamers<T_num>::
@@ -104,6 +143,125 @@ namespace PRODDL {
 	   Ints partBestGroup,
 	   Points pointsBest) {
 
+    MeanFieldParams mfp = readMeanFieldParams();
+
+    _optimize(m_points,m_indAct,m_indActW,m_potTotal,mfp,
+	      points,isPartVar,groupState,partBestGroup,pointsBest);
+
+  }
+
+
+
+  template<typename T_num>
+  void
+  RefinementRotamers<T_num>::
+  optimizeMany(const std::vector<Points>& points,
+	       const Ints isPartVar,
+	       std::vector<Floats>& groupState,
+	       std::vector<Ints>& partBestGroup,
+	       std::vector<Points>& pointsBest) {
+
+    ATALWAYS(groupState.size() == points.size() &&
+	     partBestGroup.size() == points.size() &&
+	     pointsBest.size() == points.size(),
+	     "optimizeMany(): sizes of the per pose arguments do not match");
+
+    MeanFieldParams mfp = readMeanFieldParams();
+
+    const Options& rotOptions = gOptions.getBlock("rotamers");
+
+    int nThreads;
+    rotOptions.getdefault("nThreads",nThreads,1);
+
+    nThreads = Parallel::resolveThreads(nThreads);
+
+    int nPoses = points.size();
+
+    nThreads = std::max(1,std::min(nThreads,nPoses));
+
+    // Every additional thread holds its own dense group-group matrix,
+    // so their number is limited by the 'maxThreadBufMb' option
+
+    if( ! m_potTotal.isSparse() ) {
+      int nExtraMax = int(m_potTotal.getMaxThreadBufMb() / m_potTotal.denseMatrixMb(1));
+      if( nThreads > nExtraMax + 1 ) {
+	ATLOG_OUT_2("Limiting the number of threads to " << nExtraMax + 1 << \
+		    " for the memory of the group-group matrices");
+	nThreads = nExtraMax + 1;
+      }
+    }
+
+    // Thread 0 uses the object's own evaluation state, the others get
+    // theirs created here on the first call and reuse it later. All
+    // blitz::Array reference counting happens in this thread - the
+    // workers only touch array elements.
+
+    std::vector<std::unique_ptr<Work> >& works = m_works;
+
+    while( int(works.size()) < nThreads - 1 ) {
+      Work *pWork = new Work();
+      works.push_back(std::unique_ptr<Work>(pWork));
+      pWork->points.reference(m_points.copy());
+      pWork->indAct.reference(m_indAct.copy());
+      pWork->indActW.reference(m_indActW.copy());
+      pWork->pot.init(pWork->points,m_indGroups,pWork->indAct,m_indIgn,m_ignPairs,
+		      m_nGroups,m_nIgn,m_mfParams,m_bounds,rotOptions);
+      pWork->pot.setNThreads(1);
+    }
+
+    int nThreadsPot = m_potTotal.getNThreads();
+
+    m_potTotal.setNThreads(1);
+
+    // Poses are handed out one at a time because their cost varies a lot
+    // with the size of the interface.
+
+    std::atomic<int> nextPose(0);
+
+    try {
+
+      Parallel::runThreads(nThreads,[&](int i_thr) {
+	  for(int i_pose = nextPose++; i_pose < nPoses; i_pose = nextPose++) {
+	    if( i_thr == 0 ) {
+	      _optimize(m_points,m_indAct,m_indActW,m_potTotal,mfp,
+			points[i_pose],isPartVar,groupState[i_pose],
+			partBestGroup[i_pose],pointsBest[i_pose]);
+	    }
+	    else {
+	      Work& work = *works[i_thr-1];
+	      _optimize(work.points,work.indAct,work.indActW,work.pot,mfp,
+			points[i_pose],isPartVar,groupState[i_pose],
+			partBestGroup[i_pose],pointsBest[i_pose]);
+	    }
+	  }
+	});
+
+    }
+    catch(...) {
+      m_potTotal.setNThreads(nThreadsPot);
+      throw;
+    }
+
+    m_potTotal.setNThreads(nThreadsPot);
+
+  }
+
+
+
+  template<typename T_num>
+  void
+  RefinementRotamers<T_num>::
+  _optimize(Points& wPoints,
+	    Uints& indAct,
+	    Uints& indActW,
+	    Pot& pot,
+	    const MeanFieldParams& mfp,
+	    const Points& points,
+	    const Ints& isPartVar,
+	    Floats& groupState,
+	    Ints& partBestGroup,
+	    Points& pointsBest) {
+
     // We first calculate the partMaxGroup 
     // We manipulate m_indGroups (which is referenced inside the m_potTotal)
     // in order to (1) set some parts to constant conformations (all groups but
@@ -120,34 +278,22 @@ namespace PRODDL {
     // in partState
     // Note: Array indStateVar - index of active elements in partState
 
-    // Boltzman law's 'RT' in kJ/mol at T = 300K
+    // NOTE: This can run concurrently for different evaluation states
+    // (see optimizeMany()), so it must not touch any mutable member of this
+    // object other than through its arguments.
 
     const T_num R = 2.51/300;
 
-    int runTimeLogLevel;
-
-    gOptions.getdefault("logLevel",runTimeLogLevel,ATLOG_LEVEL_1);
-
-    Logger::setRunTimeLevel(runTimeLogLevel);
+    const T_num RT = mfp.RT;
 
-    const Options& rotOptions = gOptions.getBlock("rotamers");
+    const T_num tolerance = mfp.tolerance;
 
-    T_num T;
-    rotOptions.getdefault("T",T,300.);
+    const T_num lambda = mfp.lambda;
 
-    const T_num RT = R * T;
+    const int iterMax = mfp.iterMax;
 
-    T_num tolerance;
-    rotOptions.getdefault("tolerance",tolerance,1e-7);
 
-    T_num lambda;
-    rotOptions.getdefault("lambda",lambda,0.5);
-
-    int iterMax;
-    rotOptions.getdefault("iterMax",iterMax,3000);
-
-
-    m_points = points;
+    wPoints = points;
 
     // There are three type of groups: representative states for
     // constant parts, groups of variable parts, and ignored groups
@@ -158,7 +304,7 @@ namespace PRODDL {
 
     grFlag = GR_IGN;
 
-    m_indAct = Pot::ACT_CALC_INS;
+    indAct = Pot::ACT_CALC_INS;
 
     // for parts that are not variable, ignore all the alternative groups
     for( int i_pt = 0; i_pt < m_indGroups.rows(); i_pt++) {
@@ -169,7 +315,7 @@ namespace PRODDL {
       ATLOG_OUT_6(ATLOGVAR(i_gr) << ATLOGVAR(i_part) << ATLOGVAR(part_best_gr) << ATLOGVAR(isPartVar(i_part)));
       if( ! isPartVar(i_part) ) {
 	if( i_gr != part_best_gr ) {
-	  m_indAct(i_pt) = Pot::ACT_IGN;
+	  indAct(i_pt) = Pot::ACT_IGN;
 	}
 	else {
 	  grFlag(i_gr) = GR_CONST;
@@ -204,23 +350,26 @@ namespace PRODDL {
     Floats grVarFC(grVar.rows());
 
 
-    // Zero the energy matrix and empty the PartPoints hash
+    // Zero the energy matrix and empty the PartPoints hash, then start
+    // from the precomputed intramolecular energies
+
+    pot.resetCycle();
 
-    resetPot();
+    pot.addF(m_fConst);
 
     // The following code assumes exactly two molecules (receptor and ligand)
 
     ATLOG_ASSERT_1(m_nMols == 2);
 
-    m_indActW = m_indAct;
+    indActW = indAct;
 
     // Only insert the receptor, do not calculate its interaction with itself,
     // ignore ligand
 
-    m_indAct = blitz::where(m_indMols == m_iRec, m_indAct & Pot::ACT_CALC_NO, m_indAct);
-    m_indAct = blitz::where(m_indMols == m_iLig, m_indAct | Pot::ACT_IGN, m_indAct);
-    m_potTotal.f();
-    m_indAct = m_indActW;
+    indAct = blitz::where(m_indMols == m_iRec, indAct & Pot::ACT_CALC_NO, indAct);
+    indAct = blitz::where(m_indMols == m_iLig, indAct | Pot::ACT_IGN, indAct);
+    pot.f();
+    indAct = indActW;
 
     // Only calculate the interactions for ligand, do not insert (so no interaction with itself),
     // ignore the receptor in this pass (the receptor is already inserted)
@@ -232,24 +381,21 @@ namespace PRODDL {
     // already removed from each other far enough not to appear in iteration over neighbor cells
     // of a PartPoints grid.
 
-    m_indAct = blitz::where(m_indMols == m_iRec, m_indAct | Pot::ACT_IGN, m_indAct);
-    m_indAct = blitz::where(m_indMols == m_iLig, m_indAct | Pot::ACT_INS_NO, m_indAct);
-    m_potTotal.f();
-    m_indAct = m_indActW;
+    indAct = blitz::where(m_indMols == m_iRec, indAct | Pot::ACT_IGN, indAct);
+    indAct = blitz::where(m_indMols == m_iLig, indAct | Pot::ACT_INS_NO, indAct);
+    pot.f();
+    indAct = indActW;
 
     // The net result is that only the interaction between receptor and ligand calculated,
     // and no looping is done over receptor-receptor or ligand-ligand positions.
 
     // Now we have all group-group energies that we need:
-    // intramolecular - in m_fConstMatr,
-    // intermolecular - in m_potTotal.getF()
+    // intramolecular - from m_fConst added at the start,
+    // intermolecular - from the two passes above
 
-    // Because the constant and current energy matrices are complementary, we can just add
-    // the constant one to the current one
+    SparseMatrix fMatr;
 
-    Matrix fMatr = m_potTotal.getF();
-
-    fMatr += m_fConstMatr;
+    pot.getFSparse(fMatr);
 
     // Steps to accumulate the energies for each rotamer of each variable sidechain (group
     // whose part is isPartVar) and optimize the weights:
@@ -258,120 +404,108 @@ namespace PRODDL {
     // (2) sum over corresponding row and variable group columns in fMatr with group weights
     // (3) add (1) to (2), recalculate weights, goto (2) till weight self-consistency is reached
 
-    // const component for each variable group, which includes pairwise interaction with
-    // all constant groups and internal energy of the variable group itself
+    // The iteration works on contiguous arrays indexed by the position of a
+    // group in 'grVar' rather than by the group index, so that every pass
+    // below is a linear sweep over memory.
 
-    grVarFC = 0;
+    const int nVar = grVar.rows();
 
-    for(int i_g = 0; i_g < grVar.rows(); i_g++) {
+    Ints grVarPos(m_nGroups);
+
+    grVarPos = -1;
+
+    for(int i_g = 0; i_g < nVar; i_g++) {
+      grVarPos(grVar(i_g)) = i_g;
+    }
+
+    // One pass over the rows of fMatr for the variable groups gives both
+    // (1) - the const component for each variable group, which includes pairwise
+    // interaction with all constant groups and internal energy of the variable group
+    // itself, and the matrix of interactions between the variable groups for (2).
+
+    SparseMatrix fVar;
+
+    fVar.rowStart.resize(nVar+1);
+
+    for(int i_g = 0; i_g < nVar; i_g++) {
       int i_grp = grVar(i_g);
-      T_num& fc = grVarFC(i_g);
-      for(int j_g = 0; j_g < grConst.rows(); j_g++) {
-	int j_grp = grConst(j_g);
-	fc += fMatr(i_grp,j_grp);
+      T_num fc = 0;
+      fVar.rowStart[i_g] = fVar.col.size();
+      for(int k = fMatr.rowStart[i_grp]; k < fMatr.rowStart[i_grp+1]; k++) {
+	int j_grp = fMatr.col[k];
+	int j_flag = grFlag(j_grp);
+	if( j_flag == GR_CONST ) {
+	  fc += fMatr.val[k];
+	}
+	else if( j_flag == GR_VAR ) {
+	  fVar.col.push_back(grVarPos(j_grp));
+	  fVar.val.push_back(fMatr.val[k]);
+	}
       }
-      fc += m_groupFSelf(i_grp);
+      grVarFC(i_g) = fc + m_groupFSelf(i_grp);
     }
 
-    Floats groupStateW(groupState.rows());
+    fVar.rowStart[nVar] = fVar.col.size();
+
+    ATLOG_OUT_2("Non-zero group-group interactions: " << fMatr.nnz() << \
+		" total, " << fVar.nnz() << " between variable groups");
 
     Floats partW(isPartVar.rows());
 
 
     // variable part and optimization
 
-    int i_iter = 0;
+    // state (weight) and part index of each variable group
 
-    T_num deltaState = 0;
+    Floats stateV(nVar), stateNewV(nVar);
 
-    // TODO: put grVar elements' centers on the PartPoints object with
-    // cutoff larger than max_radius(grVar[i]) + potentialCutoff.
-    // Currently we prebuild lists of interacting grVar for each grVar,
-    // thus replacing the double loop in all but the first iteration.
+    Ints partV(nVar);
 
-    typedef std::vector<int> Vi;
-    typedef std::vector<Vi> VVi;
+    // Boltzmann factor of each variable group, and the sum of these
+    // factors over the part of the group
 
-    VVi grVarInter(grVar.rows());
+    Floats wV(nVar), wPartV(nVar);
 
-    for(int i = 0; i < grVarInter.size(); i++) {
-      grVarInter[i].reserve(100);
+    for(int i_g = 0; i_g < nVar; i_g++) {
+      int i_grp = grVar(i_g);
+      stateV(i_g) = groupState(i_grp);
+      partV(i_g) = m_groupPart(i_grp);
     }
 
-    bool madeGrVarInter = false;
+    int i_iter = 0;
+
+    T_num deltaState = 0;
 
     for(i_iter = 0; i_iter < iterMax; i_iter++) {
 
       grVarF = grVarFC;
 
-      for(int i_g = 0; i_g < grVar.rows(); i_g++) {
-
-	int i_grp = grVar(i_g);
-
-	Vi& inter_i = grVarInter[i_g];
+      fVar.multAdd(stateV,grVarF);
 
-	if( ! madeGrVarInter ) {
+      wV = blitz::exp( - grVarF / RT );
 
-	  for(int j_g = 0; j_g < grVar.rows(); j_g++) {
-	    int j_grp = grVar(j_g);
-	    T_num f = fMatr(i_grp,j_grp);
-	    if( f != 0 ) {
-	      grVarF(i_g) += groupState(j_grp) * f;
-	      inter_i.push_back(j_grp);
-	    }
-	  }
-
-	}
-
-	else {
-
-	  for(int j_g = 0; j_g < inter_i.size(); j_g++) {
-	    int j_grp = inter_i[j_g];
-	    grVarF(i_g) += groupState(j_grp) * fMatr(i_grp,j_grp);
-	  }
+      partW = 0;
 
-	}
+      for(int i_g = 0; i_g < nVar; i_g++) {
+	partW(partV(i_g)) += wV(i_g);
       }
 
-      madeGrVarInter = true;
-
-      groupStateW = 0;
-
-      partW = 0;
+      for(int i_g = 0; i_g < nVar; i_g++) {
+	wPartV(i_g) = partW(partV(i_g));
+      }
 
-      T_num eTot = 0;
+      stateNewV = lambda * ( wV / wPartV ) + ( 1 - lambda ) * stateV;
 
-      for(int i_g = 0; i_g < grVar.rows(); i_g++) {
-	int i_grp = grVar(i_g);
-	T_num e = grVarF(i_g);
-	T_num w = std::exp( - e / RT );
-	groupStateW(i_grp) = w;
-	partW(m_groupPart(i_grp)) += w;
-	eTot += e;
-      }
+      deltaState = std::sqrt(blitz::sum(blitz::sqr(stateV - stateNewV)));
 
-      T_num S = 0;
-      deltaState = 0;
-
-      for(int i_g = 0; i_g < grVar.rows(); i_g++) {
-	int i_grp = grVar(i_g);
-	T_num g_state = groupState(i_grp);
-	T_num g_state_new = lambda * ( groupStateW(i_grp) / partW(m_groupPart(i_grp)) ) +
-	  ( 1 - lambda ) * g_state;
-	//ATLOG_ASSERT_1(g_state_new <= 1.);
-	groupState(i_grp) = g_state_new;
-	deltaState += (g_state - g_state_new)*(g_state - g_state_new);
-	if( g_state_new > 0 ) {
-	  S -= std::log(std::pow(g_state_new,g_state_new));
-	}
-      }
-	
-      S /= R;
+      // Entropy and total energy are only needed for the log
 
-      deltaState = std::sqrt(deltaState);
+      ATLOG_SWITCH_4(T_num eTot = blitz::sum(grVarF);
+		     T_num S = - blitz::sum(blitz::where(stateNewV > 0, stateNewV * blitz::log(stateNewV), 0)) / R;
+		     dbg::out(dbg::info) << dbg::indent() << "Rotamer refinement: " << ATLOGVAR(i_iter) \
+		     << ATLOGVAR(deltaState) << ATLOGVAR(eTot) << ATLOGVAR(S) << "\n");
 
-      ATLOG_OUT_4("Rotamer refinement: " << ATLOGVAR(i_iter) << ATLOGVAR(deltaState) \
-		  << ATLOGVAR(eTot) << ATLOGVAR(S) << "\n");
+      stateV = stateNewV;
 
       if( deltaState < tolerance ) {
 	ATLOG_OUT_2("Rotamer matrix tolerance reached at " << ATLOGVAR(i_iter));
@@ -384,6 +518,10 @@ namespace PRODDL {
       ATLOG_OUT_2("Rotamer matrix iteration limit exceeded at " << ATLOGVAR(deltaState));
     }
 
+    for(int i_g = 0; i_g < nVar; i_g++) {
+      groupState(grVar(i_g)) = stateV(i_g);
+    }
+
     // Find the max state for each part
 
     // First, set partW to a meaningful state value
@@ -441,28 +579,25 @@ namespace PRODDL {
   void
   RefinementRotamers<T_num>::setupMolecules() {
 
-    // We store the calculated values in m_fConstMatr
+    // We store the calculated values in m_fConst
 
     m_potTotal.resetCycle();
 
-    // zero matrix of required size
-
-    m_fConstMatr.reference(m_potTotal.getF().copy());
-
     for( int i_mol=0; i_mol < m_nMols; i_mol++ ) {
 
       m_indAct = blitz::where(m_indMols == i_mol, Pot::ACT_CALC_INS, Pot::ACT_IGN);
 
-      // forget the previously accumulated data inside m_potTotal
+      // forget the previously inserted points of other molecules,
+      // but keep accumulating the energies
 
-      resetPot();
+      m_potTotal.resetPoints();
 
       m_potTotal.f();
 
-      m_fConstMatr += m_potTotal.getF();
-
     }
 
+    m_potTotal.getFSparse(m_fConst);
+
   }
 
 } // namespace PRODDL
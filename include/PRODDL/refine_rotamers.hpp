@@ -12,6 +12,12 @@
 
 #include <cmath>
 
+#include <vector>
+
+#include <memory>
+
+#include <atomic>
+
 #include <boost/utility.hpp>
 
 #include "PRODDL/types.hpp"
@@ -28,6 +34,8 @@
 
 #include "PRODDL/Common/g_options.hpp"
 
+#include "PRODDL/Common/parallel.hpp"
+
 namespace PRODDL {
 
 
@@ -44,6 +52,7 @@ namespace PRODDL {
 
     typedef typename Potentials<T_num>::PotTotalNonBondedRot Pot;
     typedef typename Potentials<T_num>::MolForceParams MolForceParams;
+    typedef typename Pot::SparseMatrix SparseMatrix;
     typedef typename Geom::SpaceTraits<T_num>::Point3 Point;
     typedef typename Geom::SpaceTraits<T_num>::VPoint3 Points;
     typedef typename Types<T_num>::Matrix Matrix;
@@ -106,9 +115,69 @@ namespace PRODDL {
 	     Points pointsBest);
 
 
+    // Optimize the rotamers for many poses concurrently.
+    // Each element of the vectors has the meaning of the corresponding
+    // argument of optimize(), for one pose. 'isPartVar' is the same for all poses.
+    // Poses are distributed over the number of threads given by the
+    // option 'nThreads' of the 'rotamers' block (0 - all cores), but at most
+    // as many as fit their group-group matrices into the 'maxThreadBufMb'
+    // option; inside each pose the energy is then evaluated serially. The
+    // result for each pose does not depend on the number of threads.
+
+    void
+    optimizeMany(const std::vector<Points>& points,
+		 const Ints isPartVar,
+		 std::vector<Floats>& groupState,
+		 std::vector<Ints>& partBestGroup,
+		 std::vector<Points>& pointsBest);
+
+
+  protected:
+
+    // Parameters of the mean field iteration, read from the 'rotamers' options block
+
+    struct MeanFieldParams {
+      T_num RT;
+      T_num tolerance;
+      T_num lambda;
+      int iterMax;
+    };
+
+    // Mutable state of one energy evaluation. The potential object
+    // holds references to 'points' and 'indAct', so this must not be copied.
+
+    struct Work : boost::noncopyable {
+      Points points;
+      Uints indAct;
+      Uints indActW;
+      Pot pot;
+    };
+
+    MeanFieldParams readMeanFieldParams() const;
+
+    // The body of optimize() working on the given evaluation state
+
+    void
+    _optimize(Points& wPoints,
+	      Uints& indAct,
+	      Uints& indActW,
+	      Pot& pot,
+	      const MeanFieldParams& mfp,
+	      const Points& points,
+	      const Ints& isPartVar,
+	      Floats& groupState,
+	      Ints& partBestGroup,
+	      Points& pointsBest);
 
   protected:
 
+    // Force field and partitioning bounds, kept to initialize
+    // additional potential objects for optimizeMany()
+
+    MolForceParams m_mfParams;
+
+    PointPair m_bounds;
+
     // We hold our own copy of coords - this is safer because it is very easy
     // in the calling Python code to mistakingly reallocate Numpy array
 
@@ -118,10 +187,14 @@ namespace PRODDL {
 
     Pot m_potTotal;
 
+    // Evaluation states of the additional threads of optimizeMany()
+
+    std::vector<std::unique_ptr<Work> > m_works;
+
     // Constant (independent of mutual receptor-ligand orientation group-group energy)
     // Computed just once
 
-    Matrix m_fConstMatr;
+    SparseMatrix m_fConst;
 
     // group index of every atom (group is something that we want to calculate energy for)
     // This is a work array - its elements are reassigned by this object depending on the stage
@@ -17,7 +17,7 @@ from argh import arg
 
 from subprocess import check_call
 import logging
-import os, glob, shutil, tempfile
+import os, glob, shutil, tempfile, json
 
 log = logging.getLogger(__name__)
 
@@ -31,19 +31,90 @@ def dock(
         makeflow_args="",
         web=False,
         run_no=False,
-        test_mode=False
+        test_mode=False,
+        local=False,
+        n_threads=0,
+        task_sec=600,
+        split_factor=3
         ):
-    
+    """Dock ligand_pdb to receptor_pdb and write n_models best models into model_pdb.
+    By default, the rotational scan is split into many tasks executed by Makeflow.
+    With local=True, everything runs on this machine in a single
+    proddl-dock-fft process with n_threads threads (0 - all cores).
+    With task_sec > 0, the molforce file is computed and a few rotations
+    are timed on this machine before the workflow is generated, and the
+    rotational grid is split into tasks of about task_sec seconds each.
+    A task that runs longer than split_factor*task_sec seconds (or receives
+    SIGUSR1) splits off the rest of its range, which is then scanned by
+    the multi-threaded gather task. Zero split_factor disables that.
+    With task_sec=0, the grid is split into min(1000,n_rotations) equal tasks."""
+
+    if local:
+        return dock_local(
+                receptor_pdb=receptor_pdb,
+                ligand_pdb=ligand_pdb,
+                model_pdb=model_pdb,
+                n_models=n_models,
+                home_dir=home_dir,
+                options=options,
+                test_mode=test_mode,
+                n_threads=n_threads
+                )
+
     opt = conf_io.load_config_standard_vars(config_file=options,home_dir=home_dir)
     
     workflow = "dock_top.mkf"
     molforce_file = "molforce.dat"
     scan_opt_file = "scan_opt.json"
     rot_scan_list = "rot_scan_list.tab"
+    rot_tail_list = "rot_tail_list.tab"
+    rot_stats_list = "rot_stats_list.tab"
+    cost_file = "scan_cost.json"
     res_file = "res.dat"
+    res_clust_file = "res_clust.tab"
+    stats_file = "stats.json"
 
     wrapper = opt["wrapper"]
 
+    opt_scan = opt["scan"]
+
+    if test_mode:
+        opt_scan["testMode"] = 1
+
+    if task_sec > 0 and split_factor > 0:
+        opt_scan["scanTimeLimit"] = split_factor*task_sec
+
+    conf_io.save_config(opt_scan,scan_opt_file)
+
+    sec_per_rot = None
+
+    # The FFT grid chosen from fftCostTable decides the frame of the stored
+    # poses, so it is planned here once and passed to all scan tasks
+    plan_fft = bool(opt_scan.get("fftCostTable")) and "fftPlan" not in opt_scan
+
+    estimate = task_sec > 0 or plan_fft
+
+    if estimate:
+        force_field_fft.write_molforce(
+                receptor_pdb,
+                ligand_pdb,
+                molforce_file,
+                home_dir=home_dir,
+                options=options
+                )
+        cost = estimate_scan_cost(
+                molforce_file=molforce_file,
+                scan_opt_file=scan_opt_file,
+                cost_file=cost_file,
+                wrapper=wrapper,
+                fft_measure_top=8 if plan_fft else 0
+                )
+        if task_sec > 0:
+            sec_per_rot = cost["secPerRot"]
+        if plan_fft:
+            opt_scan["fftPlan"] = cost["fftPlan"]
+            conf_io.save_config(opt_scan,scan_opt_file)
+
     with makeflow(
         makeflow_bin=opt["makeflow_bin"],
         wrapper=wrapper,
@@ -54,26 +125,21 @@ def dock(
         run=not run_no
         ) as mf_top:
 
-        cmd = """\
-        {wrapper} \
-        proddl-dock write-molforce \
-        {receptor_pdb} \
-        {ligand_pdb} \
-        {molforce_file}""".format(**locals())
-
-        mf_top.task(
-                cmd=cmd,
-                targets=[molforce_file],
-                inputs=[receptor_pdb,ligand_pdb,options],
-                is_local=False
-                )
+        if not estimate:
 
-        opt_scan = opt["scan"]
-        
-        if test_mode:
-            opt_scan["testMode"] = 1
+            cmd = """\
+            {wrapper} \
+            proddl-dock write-molforce \
+            {receptor_pdb} \
+            {ligand_pdb} \
+            {molforce_file}""".format(**locals())
 
-        conf_io.save_config(opt_scan,scan_opt_file)
+            mf_top.task(
+                    cmd=cmd,
+                    targets=[molforce_file],
+                    inputs=[receptor_pdb,ligand_pdb,options],
+                    is_local=False
+                    )
 
         n_ang = -1 #first line is a header
         with open(opt_scan["anglesFile"],"r") as ang:
@@ -83,17 +149,24 @@ def dock(
         if test_mode:
             n_ang = min(opt_scan["testMaxRot"],n_ang)
 
-        n_scans = min(1000,n_ang)
-        n_ang_scan = int(n_ang/n_scans)
+        n_ang_scan = scan_task_size(n_ang,sec_per_rot,task_sec)
+
+        log.info("Splitting {} rotations into tasks of {} rotations".format(n_ang,n_ang_scan))
 
         scan_res_files = []
+        scan_tail_files = []
+        scan_stats_files = []
         
         for start_scan in range(0,n_ang,n_ang_scan):
             
             end_scan = min(start_scan+n_ang_scan,n_ang)
             scan_res_file = "scan_res.{:04}-{:04}.dat".format(start_scan,end_scan)
+            scan_tail_file = "scan_tail.{:04}-{:04}.txt".format(start_scan,end_scan)
+            scan_stats_file = "scan_stats.{:04}-{:04}.json".format(start_scan,end_scan)
 
             scan_res_files.append(scan_res_file)
+            scan_tail_files.append(scan_tail_file)
+            scan_stats_files.append(scan_stats_file)
             
             cmd = """\
             {wrapper} \
@@ -103,32 +176,45 @@ def dock(
             --fft-rot-grid-start {start_scan} \
             --fft-rot-grid-end {end_scan} \
             --molforce-params {molforce_file} \
-            --fft-rot-scan-res {scan_res_file}
+            --fft-rot-scan-res {scan_res_file} \
+            --fft-rot-scan-tail {scan_tail_file} \
+            --stats-out {scan_stats_file}
             """.format(**locals())
             
             mf_top.task(
                     cmd=cmd,
-                    targets=[scan_res_file],
+                    targets=[scan_res_file,scan_tail_file,scan_stats_file],
                     inputs=[molforce_file,scan_opt_file]
                     )
 
         with open(rot_scan_list,"w") as out:
             out.write("\n".join(scan_res_files)+"\n")
 
+        with open(rot_tail_list,"w") as out:
+            out.write("\n".join(scan_tail_files)+"\n")
+
+        with open(rot_stats_list,"w") as out:
+            out.write("\n".join(scan_stats_files)+"\n")
+
         cmd = """\
         {wrapper} \
         proddl-dock-fft \
         --options {scan_opt_file} \
         --task gather \
         --fft-rot-scan-list {rot_scan_list} \
+        --fft-rot-tail-list {rot_tail_list} \
+        --stats-list {rot_stats_list} \
+        --stats-out {stats_file} \
         --fft-res {res_file} \
+        --fft-res-clust {res_clust_file} \
         --molforce-params {molforce_file}
         """.format(**locals())
         
         mf_top.task(
                 cmd=cmd,
-                targets=[res_file],
-                inputs=[molforce_file,scan_opt_file,rot_scan_list]+scan_res_files,
+                targets=[res_file,res_clust_file,stats_file],
+                inputs=[molforce_file,scan_opt_file,rot_scan_list,rot_tail_list,rot_stats_list]+\
+                        scan_res_files+scan_tail_files+scan_stats_files,
                 is_local=False
                 )
 
@@ -151,9 +237,247 @@ def dock(
                 is_local=False
                 )
 
+def estimate_scan_cost(molforce_file,scan_opt_file,cost_file,wrapper="",n_rot=4,fft_measure_top=0):
+    """Time the scan of n_rot rotations on this machine with proddl-dock-fft.
+    With fft_measure_top > 0 and the fftCostTable scan option set, the costs of
+    that many best candidate FFT sizes are also measured and added to the table.
+    The FFT grid chosen from the table is then returned under "fftPlan", which
+    should be set as the scan option of the same name for all rot-scan and gather tasks.
+    Return the estimate as a dict (see the 'estimate' task of proddl-dock-fft)."""
+
+    cmd = """\
+    {wrapper} \
+    proddl-dock-fft \
+    --options {scan_opt_file} \
+    --task estimate \
+    --molforce-params {molforce_file} \
+    --bench-n-rot {n_rot} \
+    --fft-measure-top {fft_measure_top} \
+    --cost-out {cost_file}
+    """.format(**locals())
+
+    log.info("Running: {}".format(cmd))
+
+    check_call(cmd,shell=True)
+
+    with open(cost_file,"r") as inp:
+        return json.load(inp)
+
+def scan_task_size(n_ang,sec_per_rot,task_sec,max_tasks=1000):
+    """Number of rotations per rot-scan task.
+    Without the time estimate, split n_ang rotations into min(max_tasks,n_ang)
+    equal tasks. Otherwise, make tasks of about task_sec seconds, but not
+    more than max_tasks of them."""
+    n_ang = max(1,n_ang)
+    n_min = (n_ang + max_tasks - 1) // max_tasks
+    if not sec_per_rot or task_sec <= 0:
+        return max(1,n_ang//min(max_tasks,n_ang))
+    return min(n_ang,max(n_min,int(task_sec/sec_per_rot)))
+
+def dock_local(
+        receptor_pdb,
+        ligand_pdb,
+        model_pdb,
+        n_models=10,
+        home_dir=None,
+        options=None,
+        test_mode=False,
+        n_threads=0
+        ):
+    """Same as dock() but without Makeflow: rotational scan, selection of
+    the best matches and export of the models are done by one
+    multi-threaded proddl-dock-fft process, without intermediate files."""
+
+    opt = conf_io.load_config_standard_vars(config_file=options,home_dir=home_dir)
+
+    molforce_file = "molforce.dat"
+    scan_opt_file = "scan_opt.json"
+    res_file = "res.dat"
+    res_clust_file = "res_clust.tab"
+    stats_file = "stats.json"
+
+    wrapper = opt["wrapper"]
+
+    force_field_fft.write_molforce(
+            receptor_pdb,
+            ligand_pdb,
+            molforce_file,
+            home_dir=home_dir,
+            options=options
+            )
+
+    opt_scan = opt["scan"]
+
+    if test_mode:
+        opt_scan["testMode"] = 1
+
+    conf_io.save_config(opt_scan,scan_opt_file)
+
+    cmd = """\
+    {wrapper} \
+    proddl-dock-fft \
+    --options {scan_opt_file} \
+    --task dock \
+    --molforce-params {molforce_file} \
+    --n-threads {n_threads} \
+    --fft-res {res_file} \
+    --fft-res-clust {res_clust_file} \
+    --stats-out {stats_file} \
+    --pdb-inp-rec {receptor_pdb} \
+    --pdb-inp-lig {ligand_pdb} \
+    --n-models {n_models} \
+    --model-out {model_pdb}
+    """.format(**locals())
+
+    log.info("Running: {}".format(cmd))
+
+    check_call(cmd,shell=True)
+
+def screen(
+        receptor_pdb,
+        ligand_list,
+        n_models=10,
+        home_dir=None,
+        options=None,
+        makeflow_args="",
+        web=False,
+        run_no=False,
+        test_mode=False,
+        local=False,
+        n_threads=0,
+        n_chunks=1
+        ):
+    """Dock each ligand listed in ligand_list (one PDB file name per line)
+    to receptor_pdb. The receptor side of the FFT scan is computed once
+    for all ligands that share the same receptor class (see the
+    screen* options of the scan block).
+    Ligand number i gets the results in screen_res.{i:04}.dat and
+    n_models best models in screen_model.{i:04}.pdb.
+    The ligand list is split into n_chunks proddl-dock-fft tasks executed
+    by Makeflow, or, with local=True, docked by a single process on this
+    machine."""
+
+    opt = conf_io.load_config_standard_vars(config_file=options,home_dir=home_dir)
+
+    molforce_file = "molforce_screen.dat"
+    scan_opt_file = "scan_opt.json"
+    res_list = "screen_res_list.tab"
+
+    wrapper = opt["wrapper"]
+
+    ligand_pdbs = util.read_lines(ligand_list)
+    n_lig = len(ligand_pdbs)
+
+    res_files = [ "screen_res.{:04}.dat".format(i_lig) for i_lig in range(n_lig) ]
+    model_files = [ "screen_model.{:04}.pdb".format(i_lig) for i_lig in range(n_lig) ]
+
+    with open(res_list,"w") as out:
+        out.write("\n".join(res_files)+"\n")
+
+    opt_scan = opt["scan"]
+
+    if test_mode:
+        opt_scan["testMode"] = 1
+
+    conf_io.save_config(opt_scan,scan_opt_file)
+
+    n_chunks = max(1,min(n_chunks,n_lig))
+
+    def screen_cmd(lig_start,lig_end):
+        return """\
+        {wrapper} \
+        proddl-dock-fft \
+        --options {scan_opt_file} \
+        --task screen \
+        --molforce-params {molforce_file} \
+        --n-threads {n_threads} \
+        --fft-res-list {res_list} \
+        --screen-lig-start {lig_start} \
+        --screen-lig-end {lig_end}
+        """.format(wrapper=wrapper,scan_opt_file=scan_opt_file,
+                molforce_file=molforce_file,n_threads=n_threads,
+                res_list=res_list,lig_start=lig_start,lig_end=lig_end)
+
+    def export_cmd(i_lig):
+        return """\
+        {wrapper} \
+        proddl-export \
+        --model-inp {res_file} \
+        --model-ind-start 0 \
+        --model-ind-end {n_models} \
+        --pdb-inp-rec {receptor_pdb} \
+        --pdb-inp-lig {ligand_pdb} \
+        --format-out pdb_nmr \
+        --model-out {model_pdb}
+        """.format(wrapper=wrapper,res_file=res_files[i_lig],n_models=n_models,
+                receptor_pdb=receptor_pdb,ligand_pdb=ligand_pdbs[i_lig],
+                model_pdb=model_files[i_lig])
+
+    if local:
+
+        force_field_fft.write_molforce_screen(
+                receptor_pdb,
+                ligand_list,
+                molforce_file,
+                home_dir=home_dir,
+                options=options
+                )
+
+        check_call(screen_cmd(0,n_lig),shell=True)
+
+        for i_lig in range(n_lig):
+            check_call(export_cmd(i_lig),shell=True)
+
+        return
+
+    with makeflow(
+        makeflow_bin=opt["makeflow_bin"],
+        wrapper=wrapper,
+        workflow="screen_top.mkf",
+        makeflow_args=makeflow_args,
+        workflow_script=None,
+        web=web,
+        run=not run_no
+        ) as mf_top:
+
+        cmd = """\
+        {wrapper} \
+        proddl-dock write-molforce-screen \
+        {receptor_pdb} \
+        {ligand_list} \
+        {molforce_file}""".format(**locals())
+
+        mf_top.task(
+                cmd=cmd,
+                targets=[molforce_file],
+                inputs=[receptor_pdb,ligand_list,options]+ligand_pdbs,
+                is_local=False
+                )
+
+        n_lig_chunk = (n_lig + n_chunks - 1)//n_chunks
+
+        for lig_start in range(0,n_lig,n_lig_chunk):
+
+            lig_end = min(lig_start+n_lig_chunk,n_lig)
+
+            mf_top.task(
+                    cmd=screen_cmd(lig_start,lig_end),
+                    targets=res_files[lig_start:lig_end],
+                    inputs=[molforce_file,scan_opt_file,res_list]
+                    )
+
+        for i_lig in range(n_lig):
+
+            mf_top.task(
+                    cmd=export_cmd(i_lig),
+                    targets=[model_files[i_lig]],
+                    inputs=[res_files[i_lig],receptor_pdb,ligand_pdbs[i_lig]],
+                    is_local=False
+                    )
+
 def main():
     from argh import ArghParser
     parser = ArghParser()
-    parser.add_commands([dock,force_field_fft.write_molforce])
+    parser.add_commands([dock,screen,force_field_fft.write_molforce,force_field_fft.write_molforce_screen])
     parser.dispatch()
 
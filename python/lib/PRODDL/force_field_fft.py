@@ -8,7 +8,6 @@
 from . import config
 from . import conf_io
 from . import util
-from .imp import force_field_fft
 
 import argh
 from argh import arg
@@ -18,6 +17,7 @@ import numpy as np
 import h5py
 import logging
 import itertools as it
+from subprocess import check_call
 
 log = logging.getLogger(__name__)
 
@@ -26,10 +26,48 @@ def write_molforce(
         ligand_pdb,
         molforce_file,
         home_dir=None,
-        options=None):
+        options=None,
+        imp=False):
+    """Write molforce file for the receptor and the ligand.
+    By default, the parameters are assigned by the compiled proddl-molforce tool.
+    With imp=True, they are computed with IMP CHARMM topology instead
+    (the atoms missing in PDB files are rebuilt then)."""
 
     opt = conf_io.load_config_standard_vars(config_file=options,home_dir=home_dir)
 
+    _write_molforce((receptor_pdb,ligand_pdb),molforce_file,opt,imp=imp)
+
+def write_molforce_screen(
+        receptor_pdb,
+        ligand_list,
+        molforce_file,
+        home_dir=None,
+        options=None,
+        imp=False):
+    """Write molforce file for screening: receptor is the first molecule,
+    followed by each ligand from ligand_list (text file with one PDB file name per line)"""
+
+    opt = conf_io.load_config_standard_vars(config_file=options,home_dir=home_dir)
+
+    if imp:
+        _write_molforce([receptor_pdb]+util.read_lines(ligand_list),molforce_file,opt,imp=True)
+    else:
+        _write_molforce_native([receptor_pdb],molforce_file,opt,pdb_list=ligand_list)
+
+def _write_molforce_native(pdb_files,molforce_file,opt,pdb_list=None):
+    cmd = ["proddl-molforce","--alpha",str(opt["scan"]["alpha"]),"--out",molforce_file]
+    if pdb_list:
+        cmd += ["--pdb-list",pdb_list]
+    cmd += ["--pdb"] + list(pdb_files)
+    check_call(cmd)
+
+def _write_molforce(pdb_files,molforce_file,opt,imp=False):
+
+    if not imp:
+        return _write_molforce_native(pdb_files,molforce_file,opt)
+
+    from .imp import force_field_fft
+
     out = h5py.File(molforce_file,"w")
     #ljComp in FFT needs mix=1 (geometric mean for combining sigma)
     #CHARMM actually uses arithmetic mean [1](
@@ -45,7 +83,7 @@ def write_molforce(
     alpha = []
 
     ind_at = 0
-    for mol_name, recs_mol in it.groupby(force_field_fft.extract_molforce((receptor_pdb,ligand_pdb)),
+    for mol_name, recs_mol in it.groupby(force_field_fft.extract_molforce(pdb_files),
                            lambda rec: rec["mol_name"]):
         ind_at_start = ind_at
         for rec in recs_mol:
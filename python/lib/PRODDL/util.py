@@ -113,3 +113,8 @@ def make_executable(file_name):
     """Set executable permission bit"""
     os.chmod(file_name,os.stat(file_name).st_mode|0o755)
 
+
+def read_lines(file_name):
+    """Return a list of non-empty stripped lines from a text file"""
+    with open(file_name,"r") as inp:
+        return [ l.strip() for l in inp if l.strip() ]
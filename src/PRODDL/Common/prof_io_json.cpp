@@ -0,0 +1,82 @@
+#include "PRODDL/Common/prof_io_json.hpp"
+#include "PRODDL/Common/debug.hpp"
+#include "PRODDL/Common/logger.hpp"
+#include "PRODDL/External/jsoncpp/jsoncpp.hpp"
+#include <fstream>
+
+namespace PRODDL {
+
+	void save_prof_stats_to_json_file(const Prof::Stats& stats,std::string out_file)
+	{
+		Json::Value root(Json::objectValue);
+
+		root["nTasks"] = stats.nTasks;
+		root["wallSeconds"] = stats.wallSeconds;
+		root["rotationsPerSec"] = stats.wallSeconds > 0 ?
+			stats.counts[Prof::CNT_ROTATIONS] / stats.wallSeconds : 0.;
+
+		Json::Value& phases = root["phases"];
+		for(int i = 0; i < Prof::N_PHASES; i++) {
+			Json::Value& phase = phases[Prof::phaseName(i)];
+			phase["seconds"] = stats.seconds[i];
+			phase["calls"] = Json::Int64(stats.calls[i]);
+			phase["secondsPerCall"] = stats.calls[i] > 0 ? stats.seconds[i] / stats.calls[i] : 0.;
+		}
+
+		Json::Value& counters = root["counters"];
+		for(int i = 0; i < Prof::N_COUNTERS; i++) {
+			counters[Prof::counterName(i)] = Json::Int64(stats.counts[i]);
+		}
+
+		std::ofstream out_stream(out_file.c_str());
+		ATALWAYS(out_stream.good(),("Failed to open stats file for writing: " + out_file).c_str());
+		Json::StyledStreamWriter writer;
+		writer.write(out_stream,root);
+		ATALWAYS(out_stream.good(),("Failed to write stats file: " + out_file).c_str());
+	}
+
+	void load_prof_stats_from_json_file(std::string inp_file,Prof::Stats& stats)
+	{
+		Json::Reader reader;
+		Json::Value root;
+		std::ifstream inp_stream(inp_file.c_str());
+		ATALWAYS(reader.parse(inp_stream, root, false),("Failed to load stats file: " + inp_file).c_str());
+		ATALWAYS(root.type() == Json::objectValue,("Stats file should contain JSON object: " + inp_file).c_str());
+
+		stats.clear();
+
+		stats.nTasks = root.get("nTasks",0).asInt();
+		stats.wallSeconds = root.get("wallSeconds",0.).asDouble();
+
+		const Json::Value& phases = root["phases"];
+		for(int i = 0; i < Prof::N_PHASES; i++) {
+			if( phases.isMember(Prof::phaseName(i)) ) {
+				const Json::Value& phase = phases[Prof::phaseName(i)];
+				stats.seconds[i] = phase.get("seconds",0.).asDouble();
+				stats.calls[i] = phase.get("calls",0).asLargestInt();
+			}
+		}
+
+		const Json::Value& counters = root["counters"];
+		for(int i = 0; i < Prof::N_COUNTERS; i++) {
+			if( counters.isMember(Prof::counterName(i)) ) {
+				stats.counts[i] = counters[Prof::counterName(i)].asLargestInt();
+			}
+		}
+	}
+
+	void log_prof_stats(const Prof::Stats& stats)
+	{
+		ATLOG_OUT_1("Stats: " << ATLOGVAR(stats.nTasks) << ATLOGVAR(stats.wallSeconds));
+		for(int i = 0; i < Prof::N_PHASES; i++) {
+			if( stats.calls[i] > 0 ) {
+				ATLOG_OUT_1("Stats: phase " << Prof::phaseName(i) << " seconds " << stats.seconds[i]
+					<< " calls " << stats.calls[i]);
+			}
+		}
+		for(int i = 0; i < Prof::N_COUNTERS; i++) {
+			ATLOG_OUT_1("Stats: counter " << Prof::counterName(i) << " " << stats.counts[i]);
+		}
+	}
+
+} // namespace PRODDL
@@ -0,0 +1,92 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#include "PRODDL/Common/parallel.hpp"
+
+#include <vector>
+
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+
+using namespace PRODDL;
+
+TEST(ParallelTest, BlockRange) {
+
+  const int n = 10, nParts = 4;
+
+  int prevEnd = 0;
+
+  for(int i_part = 0; i_part < nParts; i_part++) {
+    int begin, end;
+    Parallel::blockRange(n,nParts,i_part,begin,end);
+    EXPECT_EQ(prevEnd,begin);
+    EXPECT_TRUE(end - begin == 2 || end - begin == 3);
+    prevEnd = end;
+  }
+
+  EXPECT_EQ(n,prevEnd);
+
+}
+
+TEST(ParallelTest, ForRanges) {
+
+  const int n = 1001;
+
+  std::vector<int> hits(n,0);
+
+  std::vector<double> partSum(4,0);
+
+  Parallel::forRanges(4,n,[&](int i_thr,int begin,int end) {
+      for(int i = begin; i < end; i++) {
+	hits[i]++;
+	partSum[i_thr] += i;
+      }
+    });
+
+  for(int i = 0; i < n; i++) {
+    EXPECT_EQ(1,hits[i]);
+  }
+
+  double sum = 0;
+
+  for(int i_thr = 0; i_thr < 4; i_thr++) {
+    sum += partSum[i_thr];
+  }
+
+  EXPECT_EQ(n*(n-1)/2,sum);
+
+  // fewer items than threads
+
+  std::vector<int> hitsSmall(2,0);
+
+  Parallel::forRanges(8,2,[&](int,int begin,int end) {
+      for(int i = begin; i < end; i++) {
+	hitsSmall[i]++;
+      }
+    });
+
+  EXPECT_EQ(1,hitsSmall[0]);
+  EXPECT_EQ(1,hitsSmall[1]);
+
+}
+
+TEST(ParallelTest, Exception) {
+
+  EXPECT_THROW(Parallel::runThreads(3,[](int i_thr) {
+	if( i_thr == 2 ) {
+	  throw std::runtime_error("worker failed");
+	}
+      }),
+    std::runtime_error);
+
+  EXPECT_GE(Parallel::resolveThreads(0),1);
+
+  EXPECT_EQ(3,Parallel::resolveThreads(3));
+
+}
@@ -0,0 +1,73 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#include "PRODDL/Common/prof.hpp"
+#include "PRODDL/Common/prof_io_json.hpp"
+#include "PRODDL/Common/parallel.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace PRODDL;
+
+TEST(ProfTest, ThreadsAccumulate) {
+
+  Prof::Registry::instance().clear();
+
+  const int nThreads = 4, nIter = 1000;
+
+  Parallel::runThreads(nThreads,[&](int i_thr) {
+      for(int i = 0; i < nIter; i++) {
+	Prof::ScopedTimer t(Prof::PH_SELECT);
+	Prof::count(Prof::CNT_CANDIDATES,2);
+      }
+    });
+
+  Prof::Stats s = Prof::total();
+
+  EXPECT_EQ(nThreads*nIter,s.calls[Prof::PH_SELECT]);
+  EXPECT_EQ(2*nThreads*nIter,s.counts[Prof::CNT_CANDIDATES]);
+  EXPECT_EQ(0,s.calls[Prof::PH_R2C]);
+  EXPECT_GE(s.seconds[Prof::PH_SELECT],0.);
+
+  Prof::Registry::instance().clear();
+
+  EXPECT_EQ(0,Prof::total().calls[Prof::PH_SELECT]);
+
+}
+
+TEST(ProfTest, JsonRoundTripAndMerge) {
+
+  Prof::Stats s;
+
+  s.seconds[Prof::PH_R2C] = 1.5;
+  s.calls[Prof::PH_R2C] = 3;
+  s.counts[Prof::CNT_ROTATIONS] = 10;
+  s.counts[Prof::CNT_BYTES_WRITTEN] = 5000000000LL;
+  s.wallSeconds = 2;
+  s.nTasks = 1;
+
+  save_prof_stats_to_json_file(s,"test_prof.tmp.json");
+
+  Prof::Stats s_in;
+
+  load_prof_stats_from_json_file("test_prof.tmp.json",s_in);
+
+  EXPECT_DOUBLE_EQ(1.5,s_in.seconds[Prof::PH_R2C]);
+  EXPECT_EQ(3,s_in.calls[Prof::PH_R2C]);
+  EXPECT_EQ(10,s_in.counts[Prof::CNT_ROTATIONS]);
+  EXPECT_EQ(5000000000LL,s_in.counts[Prof::CNT_BYTES_WRITTEN]);
+  EXPECT_EQ(1,s_in.nTasks);
+
+  s_in.merge(s);
+
+  EXPECT_DOUBLE_EQ(3.,s_in.seconds[Prof::PH_R2C]);
+  EXPECT_EQ(20,s_in.counts[Prof::CNT_ROTATIONS]);
+  EXPECT_DOUBLE_EQ(4.,s_in.wallSeconds);
+  EXPECT_EQ(2,s_in.nTasks);
+
+}
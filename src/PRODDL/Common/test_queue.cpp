@@ -98,3 +98,28 @@ TEST(BoundPriorityQueueTest, All) {
 
 }
 
+
+TEST(BoundPriorityQueueTest, PushStatus) {
+
+  BoundPriorityQueue<int> q;
+
+  q.init(2,10);
+
+  EXPECT_TRUE(q.push(5));
+
+  EXPECT_TRUE(q.push(7));
+
+  // above the value limit
+  EXPECT_FALSE(q.push(11));
+
+  // full, and not better than the top
+  EXPECT_FALSE(q.push(8));
+
+  // full, pushes out 7
+  EXPECT_TRUE(q.push(1));
+
+  EXPECT_EQ(2,int(q.size()));
+
+  EXPECT_EQ(5,q.top());
+
+}
@@ -0,0 +1,158 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+// Test Geom/bounding_cache.hpp against direct Bounding::Diameter and
+// Bounding::Box calls.
+
+#include "PRODDL/Geom/bounding_cache.hpp"
+
+#include <vector>
+
+#include <cmath>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+	typedef double T_num;
+	typedef PRODDL::Geom::Bounding::DescriptorCache<T_num> Cache;
+	typedef Cache::DescriptorT Descriptor;
+	typedef Descriptor::Point Point;
+	typedef Descriptor::VPoint VPoint;
+	typedef Descriptor::PointPair PointPair;
+
+	// ellipsoidal cloud elongated along (1,1,0)
+
+	void makeCloud(int n, VPoint& p) {
+		p.resize(n);
+		for(int i = 0; i < n; i++) {
+			T_num t = 10.*std::sin(i*0.37);
+			T_num u = 3.*std::cos(i*1.13);
+			T_num w = 1.*std::sin(i*2.71);
+			p(i) = Point((t + u)/std::sqrt(2.),(t - u)/std::sqrt(2.),w);
+		}
+	}
+
+	void expectNear(const Point& x, const Point& y) {
+		for(int j = 0; j < 3; j++) {
+			EXPECT_NEAR(x(j),y(j),1e-10);
+		}
+	}
+
+}
+
+TEST(BoundingCacheTest, SameAsDirect) {
+
+	Cache::clear();
+
+	VPoint p;
+	makeCloud(300,p);
+
+	Cache::Ptr desc = Cache::get(p);
+
+	PRODDL::Geom::Bounding::Diameter<T_num> diam(p);
+	expectNear(diam.getDiameter()(0),desc->getDiameter().getDiameter()(0));
+	expectNear(diam.getDiameter()(1),desc->getDiameter().getDiameter()(1));
+
+	PRODDL::Geom::Bounding::Box<T_num> box(p);
+	expectNear(box.getDiagonal()(0),desc->getBox().getDiagonal()(0));
+	expectNear(box.getDiagonal()(1),desc->getBox().getDiagonal()(1));
+
+	PRODDL::Geom::Bounding::Box<T_num> boxFixed(p,true);
+	expectNear(boxFixed.getDiagonal()(0),desc->getBounds()(0));
+	expectNear(boxFixed.getDiagonal()(1),desc->getBounds()(1));
+
+}
+
+TEST(BoundingCacheTest, KeyedByContents) {
+
+	Cache::clear();
+
+	VPoint p;
+	makeCloud(100,p);
+
+	long nHits = Cache::numHits();
+
+	Cache::Ptr d1 = Cache::get(p);
+
+	// a copy with the same coordinates gets the same descriptor
+	VPoint q(p.copy());
+	Cache::Ptr d2 = Cache::get(q);
+
+	EXPECT_EQ(d1.get(),d2.get());
+	EXPECT_EQ(nHits + 1,Cache::numHits());
+	EXPECT_EQ(1,Cache::size());
+
+	// changed coordinates get a new one
+	q(17)(1) += 0.5;
+	Cache::Ptr d3 = Cache::get(q);
+
+	EXPECT_NE(d1.get(),d3.get());
+	EXPECT_EQ(2,Cache::size());
+	EXPECT_TRUE(d3->matches(q));
+	EXPECT_FALSE(d3->matches(p));
+
+	// the descriptor keeps its own copy of the coordinates
+	p(0)(0) += 1.;
+	EXPECT_FALSE(d1->matches(p));
+
+}
+
+TEST(BoundingCacheTest, PrincipalAxes) {
+
+	VPoint p;
+	makeCloud(500,p);
+
+	Cache::Ptr desc = Cache::get(p);
+
+	const Descriptor::Matrix3& axes = desc->getPrincipalAxes();
+	const Point& moments = desc->getPrincipalMoments();
+
+	EXPECT_GE(moments(0),moments(1));
+	EXPECT_GE(moments(1),moments(2));
+
+	// the longest axis is along (1,1,0)
+	EXPECT_NEAR(1.,std::abs(axes(0,0) + axes(0,1))/std::sqrt(2.),1e-2);
+	EXPECT_NEAR(0.,axes(0,2),1e-2);
+
+	// the centroid is the mean of the points
+	Point cm(0.);
+	for(int i = 0; i < p.size(); i++) {
+		cm += p(i);
+	}
+	cm /= p.size();
+	expectNear(cm,desc->getCentroid());
+
+}
+
+TEST(BoundingCacheTest, Threads) {
+
+	Cache::clear();
+
+	VPoint p;
+	makeCloud(200,p);
+
+	const int nThreads = 4;
+
+	std::vector<Cache::Ptr> desc(nThreads);
+	std::vector<T_num> size(nThreads);
+
+	PRODDL::Parallel::runThreads(nThreads,[&](int i_thr) {
+			desc[i_thr] = Cache::get(p);
+			size[i_thr] = desc[i_thr]->getDiameter().getSize();
+			desc[i_thr]->computeAll();
+		});
+
+	for(int i_thr = 1; i_thr < nThreads; i_thr++) {
+		EXPECT_EQ(desc[0].get(),desc[i_thr].get());
+		EXPECT_EQ(size[0],size[i_thr]);
+	}
+
+	EXPECT_NEAR(PRODDL::Geom::Bounding::Diameter<T_num>(p).getSize(),size[0],1e-10);
+
+}
@@ -0,0 +1,157 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+// Test Geom/interface_contacts.hpp against Neighbors::contactGroupPairs()
+// called separately for each pose.
+
+#include "PRODDL/Geom/interface_contacts.hpp"
+#include "PRODDL/Geom/pairdist.hpp"
+
+#include <vector>
+
+#include <cmath>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+	typedef double T_num;
+	typedef PRODDL::InterfaceContacts<T_num> Contacts;
+	typedef Contacts::Point Point;
+	typedef Contacts::Points Points;
+	typedef Contacts::Ints Ints;
+	typedef Contacts::RotationTranslation RotationTranslation;
+	typedef PRODDL::Geom::Points::Neighbors<T_num,3> Nbs;
+
+	const T_num cutoff = 4.5;
+
+	// 'n' atoms on a helix, 'perRes' atoms per group
+
+	void makeChain(int n, int perRes, T_num radius, Points& p, Ints& groups) {
+		p.resize(n);
+		groups.resize(n);
+		for(int i = 0; i < n; i++) {
+			p(i) = Point(radius*std::cos(i*0.5),radius*std::sin(i*0.5),i*0.4 - n*0.2);
+			groups(i) = i / perRes;
+		}
+	}
+
+	std::vector<RotationTranslation> makePoses(int n) {
+		std::vector<RotationTranslation> poses;
+		for(int i = 0; i < n; i++) {
+			// ligand close to the receptor surface, the last one far away
+			T_num shift = (i == n - 1) ? 200. : 10. + (i % 3);
+			poses.push_back(RotationTranslation(Point(0.3 + i*0.9,1.1 - i*0.3,-0.5 + i*0.2),
+				Point(shift,i*0.5 - 2.,i*0.3)));
+		}
+		return poses;
+	}
+
+	void checkPoses(int minContacts, int nThreads) {
+
+		Points rec, lig;
+		Ints recGroup, ligGroup;
+		makeChain(400,7,8.,rec,recGroup);
+		makeChain(150,5,4.,lig,ligGroup);
+
+		std::vector<RotationTranslation> poses = makePoses(13);
+		int nPoses = poses.size();
+
+		Contacts contacts(rec,recGroup,lig,ligGroup,cutoff,minContacts);
+
+		Contacts::Result res;
+		contacts.compute(poses.begin(),nPoses,res,nThreads);
+
+		ASSERT_EQ(nPoses,res.numPoses());
+		ASSERT_EQ(res.offsets[nPoses],int(res.recGroup.size()));
+
+		int nTotal = 0;
+
+		for(int i_pose = 0; i_pose < nPoses; i_pose++) {
+
+			Points ligPos;
+			poses[i_pose](lig,ligPos);
+
+			Nbs::ivect2 recCont, ligCont;
+			Nbs::contactGroupPairs(rec,ligPos,recGroup,ligGroup,cutoff,minContacts,recCont,ligCont);
+
+			// expected pairs in the same order: receptor group, then ligand group
+			std::vector<int> expRec, expLig;
+			for(int i_rec = 0; i_rec < int(recCont.size()); i_rec++) {
+				for(size_t k = 0; k < recCont[i_rec].size(); k++) {
+					expRec.push_back(i_rec);
+					expLig.push_back(recCont[i_rec][k]);
+				}
+			}
+
+			ASSERT_EQ(int(expRec.size()),res.numContacts(i_pose)) << "pose " << i_pose;
+
+			for(int k = 0; k < int(expRec.size()); k++) {
+				EXPECT_EQ(expRec[k],res.recGroup[res.offsets[i_pose] + k]);
+				EXPECT_EQ(expLig[k],res.ligGroup[res.offsets[i_pose] + k]);
+			}
+
+			for(int i_rec = 0; i_rec < contacts.numRecGroups(); i_rec++) {
+				bool exp = i_rec < int(recCont.size()) && ! recCont[i_rec].empty();
+				EXPECT_EQ(exp,res.isRecInterface(i_pose,i_rec));
+			}
+
+			for(int i_lig = 0; i_lig < contacts.numLigGroups(); i_lig++) {
+				bool exp = i_lig < int(ligCont.size()) && ! ligCont[i_lig].empty();
+				EXPECT_EQ(exp,res.isLigInterface(i_pose,i_lig));
+			}
+
+			nTotal += expRec.size();
+
+		}
+
+		// the test is meaningless if the poses do not touch the receptor
+		EXPECT_GT(nTotal,nPoses);
+
+		EXPECT_EQ(0,res.numContacts(nPoses-1));
+
+	}
+
+}
+
+TEST(InterfaceContactsTest, SingleThread) {
+	checkPoses(1,1);
+}
+
+TEST(InterfaceContactsTest, MinContactsThreads) {
+	checkPoses(3,4);
+}
+
+TEST(InterfaceContactsTest, RotTranValue) {
+
+	Points rec, lig;
+	Ints recGroup, ligGroup;
+	makeChain(100,4,6.,rec,recGroup);
+	makeChain(40,4,3.,lig,ligGroup);
+
+	std::vector<RotationTranslation> poses = makePoses(5);
+
+	std::vector<PRODDL::Types<T_num>::RotTranValue> values(poses.size());
+	for(size_t i = 0; i < poses.size(); i++) {
+		values[i].tran = poses[i];
+		values[i].value = -T_num(i);
+	}
+
+	Contacts contacts(rec,recGroup,lig,ligGroup,cutoff);
+
+	Contacts::Result resTran, resValue;
+	contacts.compute(poses.begin(),poses.size(),resTran);
+	contacts.compute(values.begin(),values.size(),resValue,0);
+
+	EXPECT_EQ(resTran.offsets,resValue.offsets);
+	EXPECT_EQ(resTran.recGroup,resValue.recGroup);
+	EXPECT_EQ(resTran.ligGroup,resValue.ligGroup);
+	EXPECT_EQ(resTran.recMask,resValue.recMask);
+	EXPECT_EQ(resTran.ligMask,resValue.ligMask);
+
+}
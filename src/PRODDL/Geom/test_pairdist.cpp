@@ -174,3 +174,77 @@ TEST(PairdistTest, ContactPairs) {
 
   }
 
+
+
+  // Sort pairs so that the results of two implementations can be compared
+
+  struct cmpPairDist {
+    bool operator()(const std::pair<Nbs::IPair,T_num>& x, const std::pair<Nbs::IPair,T_num>& y) {
+      return x.first(0) < y.first(0) || ( x.first(0) == y.first(0) && x.first(1) < y.first(1) );
+    }
+  };
+
+  void cmpPairLists(const Nbs::VIPair& pairs1, const Nbs::fvect& dist1,
+		    const Nbs::VIPair& pairs2, const Nbs::fvect& dist2) {
+    std::vector<std::pair<Nbs::IPair,T_num> > pd1, pd2;
+    for(int i = 0; i < pairs1.size(); i++) pd1.push_back(std::make_pair(pairs1[i],dist1[i]));
+    for(int i = 0; i < pairs2.size(); i++) pd2.push_back(std::make_pair(pairs2[i],dist2[i]));
+    std::sort(pd1.begin(),pd1.end(),cmpPairDist());
+    std::sort(pd2.begin(),pd2.end(),cmpPairDist());
+    ASSERT_EQ(pd1.size(),pd2.size());
+    for(int i = 0; i < pd1.size(); i++) {
+      ASSERT_EQ(pd1[i].first(0),pd2[i].first(0));
+      ASSERT_EQ(pd1[i].first(1),pd2[i].first(1));
+      ASSERT_NEAR(pd1[i].second,pd2[i].second,small_val);
+    }
+  }
+
+TEST(PairdistTest, PartitionedPointsCompact) {
+
+    const int n_points1 = 2000, n_points2 = 1000;
+
+    const T_num cutoff = 1.;
+    const T_num distrRadius = cutoff*5;
+    Nbs::vect vCenter1(-distrRadius/3,0,0), vCenter2(distrRadius/3,0,0);
+
+    Nbs::Vvect vv1(n_points1), vv2(n_points2);
+
+    generateRandomPoints(vCenter1,distrRadius,vv1);
+    generateRandomPoints(vCenter2,distrRadius,vv2);
+
+    // the domain is deliberately smaller than the point clouds,
+    // so that border cells receive points from outside
+
+    Nbs::vect lBound(-distrRadius,-distrRadius,-distrRadius/2), uBound(distrRadius,distrRadius,distrRadius/2);
+
+    Nbs::VIPair pairsRef, pairsCompact;
+    Nbs::fvect distRef, distCompact;
+
+    Nbs::PartitionedPoints2 partPoints(lBound,uBound,cutoff);
+    Nbs::PartitionedPointsCompact2 partPointsCompact(lBound,uBound,cutoff);
+
+    partPoints.insert(vv1,pairsRef,distRef);
+    partPointsCompact.insert(vv1,pairsCompact,distCompact);
+
+    cmpPairLists(pairsRef,distRef,pairsCompact,distCompact);
+
+    partPoints.search(vv2,pairsRef,distRef);
+    partPointsCompact.search(vv2,pairsCompact,distCompact);
+
+    cmpPairLists(pairsRef,distRef,pairsCompact,distCompact);
+
+    // reuse of both objects for swapped point sets
+
+    partPoints.zapPoints();
+    partPoints.insert(vv2);
+    partPoints.search(vv1,pairsRef,distRef);
+
+    partPointsCompact.zapPoints();
+    partPointsCompact.insert(vv2);
+    partPointsCompact.search(vv1,pairsCompact,distCompact);
+
+    ASSERT_GT(pairsCompact.size(),0);
+
+    cmpPairLists(pairsRef,distRef,pairsCompact,distCompact);
+
+  }
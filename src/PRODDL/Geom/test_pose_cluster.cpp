@@ -0,0 +1,109 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+// Test Geom/pose_cluster.hpp: the pose features must reproduce the ligand RMSD,
+// and clustering must group the poses around distinct binding modes.
+
+#include "PRODDL/Geom/pose_cluster.hpp"
+
+#include "PRODDL/Common/bz_vect_ext.hpp"
+
+#include <vector>
+
+#include <cmath>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+	typedef double T_num;
+	typedef PRODDL::Types<T_num> TypesT;
+	typedef TypesT::Point Point;
+	typedef TypesT::Points Points;
+	typedef TypesT::RotationTranslation RotationTranslation;
+	typedef TypesT::RotTranValue RotTranValue;
+	typedef PRODDL::PoseClusterer<T_num> Clusterer;
+
+	// elongated ligand with some atoms off the main axis
+	Points makeLigand() {
+		Points lig(40);
+		for(int i = 0; i < 40; i++) {
+			lig(i) = Point(i*0.8 + 3.,std::sin(i*1.3)*2.,std::cos(i*0.7)*1. - 5.);
+		}
+		return lig;
+	}
+
+	T_num rmsd(const Points& lig, const RotationTranslation& t1, const RotationTranslation& t2) {
+		T_num s = 0;
+		for(int i = 0; i < lig.size(); i++) {
+			Point d = t1(lig(i)) - t2(lig(i));
+			s += blitz_ext::dotSelf(d);
+		}
+		return std::sqrt(s/lig.size());
+	}
+
+}
+
+TEST(PoseClusterTest, FeaturesGiveRmsd) {
+
+	Points lig = makeLigand();
+
+	Clusterer clusterer(lig);
+
+	RotationTranslation t1(Point(0.3,1.2,-0.7),Point(10.,-4.,2.));
+	RotationTranslation t2(Point(0.5,1.0,-0.2),Point(12.,-3.,0.5));
+
+	Clusterer::Feature f1 = clusterer.features(t1), f2 = clusterer.features(t2);
+
+	T_num d2 = 0;
+	for(int j = 0; j < Clusterer::N_feat; j++) {
+		d2 += (f1(j) - f2(j))*(f1(j) - f2(j));
+	}
+
+	EXPECT_NEAR(rmsd(lig,t1,t2),std::sqrt(d2),1e-6);
+
+}
+
+TEST(PoseClusterTest, TwoModes) {
+
+	Points lig = makeLigand();
+
+	Clusterer clusterer(lig);
+
+	std::vector<RotTranValue> poses;
+
+	// 30 poses near the first mode, 20 near the second one, the best
+	// pose of each mode has the lowest value
+
+	for(int i = 0; i < 50; i++) {
+		bool first = i < 30;
+		T_num jitter = 0.01*(i % 10);
+		RotTranValue p;
+		p.tran = first ?
+			RotationTranslation(Point(0.2 + jitter,0.4,0.),Point(20. + jitter,0.,0.)) :
+			RotationTranslation(Point(2.0,-1.0 + jitter,0.5),Point(-20.,5.,jitter));
+		p.value = -100. + (i % 10) + (first ? 0. : 5.);
+		poses.push_back(p);
+	}
+
+	clusterer.cluster(poses.begin(),int(poses.size()),4.,2);
+
+	const Clusterer::Clusters& clusters = clusterer.getClusters();
+
+	ASSERT_EQ(2,int(clusters.size()));
+
+	EXPECT_EQ(30,clusters[0].size);
+	EXPECT_EQ(20,clusters[1].size);
+	EXPECT_DOUBLE_EQ(-100.,clusters[0].value);
+	EXPECT_DOUBLE_EQ(-95.,clusters[1].value);
+	EXPECT_EQ(0,clusters[0].iRep % 10);
+
+	EXPECT_EQ(0,clusterer.getMembership()[5]);
+	EXPECT_EQ(1,clusterer.getMembership()[45]);
+
+}
@@ -0,0 +1,149 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+// Test Geom/rigid_kernel.hpp: SoA, AoS and ensemble kernels must give the same
+// coordinates as applying RotationTranslation to each point.
+
+#include "PRODDL/Geom/transformation.hpp"
+#include "PRODDL/Geom/rigid_kernel.hpp"
+
+#include <vector>
+
+#include <cmath>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+	typedef double T_num;
+	typedef PRODDL::Geom::RotationTranslation<T_num> RotationTranslation;
+	typedef RotationTranslation::Point Point;
+	typedef RotationTranslation::Points Points;
+	typedef PRODDL::Geom::RigidKernel<T_num> Kernel;
+	typedef PRODDL::Geom::SoAPoints<T_num> SoAPoints;
+
+	// not a multiple of the SoA padding or of the ensemble block
+	const int nPoints = 1029;
+
+	Points makePoints() {
+		Points p(nPoints);
+		for(int i = 0; i < nPoints; i++) {
+			p(i) = Point(std::sin(i*0.37)*20.,std::cos(i*0.11)*15. + 3.,i*0.05 - 25.);
+		}
+		return p;
+	}
+
+	RotationTranslation makeTran(int i) {
+		return RotationTranslation(Point(0.3 + i*0.7,1.2 - i*0.4,-0.7 + i*0.2),Point(10. - i,-4. + 2*i,2.));
+	}
+
+	void expectNear(const Point& expected, const Point& actual) {
+		for(int k = 0; k < 3; k++) {
+			EXPECT_NEAR(expected(k),actual(k),1e-10);
+		}
+	}
+
+}
+
+TEST(RigidKernelTest, AoS) {
+
+	Points p = makePoints();
+
+	RotationTranslation tr = makeTran(1);
+
+	Points out;
+	tr(p,out);
+
+	ASSERT_EQ(nPoints,out.size());
+
+	Points inPlace(p.copy());
+	tr(inPlace);
+
+	for(int i = 0; i < nPoints; i++) {
+		expectNear(tr(p(i)),out(i));
+		expectNear(tr(p(i)),inPlace(i));
+	}
+
+	// strided view goes through the generic loop
+	Points even(p(blitz::Range(0,nPoints-1,2)));
+	Points evenOut;
+	tr(even,evenOut);
+	for(int i = 0; i < even.size(); i++) {
+		expectNear(tr(p(2*i)),evenOut(i));
+	}
+
+}
+
+TEST(RigidKernelTest, SoA) {
+
+	Points p = makePoints();
+
+	SoAPoints soa(p);
+
+	ASSERT_EQ(nPoints,soa.size());
+	ASSERT_EQ(0,soa.sizePadded() % int(SoAPoints::padding));
+
+	RotationTranslation tr = makeTran(2);
+
+	SoAPoints soaOut;
+	Kernel(tr.getTensor(),tr.getVector()).apply(soa,soaOut);
+
+	Points out;
+	soaOut.copyTo(out);
+
+	ASSERT_EQ(nPoints,out.size());
+
+	for(int i = 0; i < nPoints; i++) {
+		expectNear(tr(p(i)),out(i));
+	}
+
+}
+
+TEST(RigidKernelTest, Ensemble) {
+
+	Points p = makePoints();
+
+	SoAPoints soa(p);
+
+	const int nTr = 5;
+
+	std::vector<RotationTranslation> trs;
+	std::vector<Kernel> kernels;
+	for(int i_tr = 0; i_tr < nTr; i_tr++) {
+		trs.push_back(makeTran(i_tr));
+		kernels.push_back(Kernel(trs[i_tr].getTensor(),trs[i_tr].getVector()));
+	}
+
+	std::vector<SoAPoints> outs(nTr);
+
+	Kernel::applyEnsemble(&kernels[0],nTr,soa,&outs[0]);
+
+	for(int i_tr = 0; i_tr < nTr; i_tr++) {
+		ASSERT_EQ(nPoints,outs[i_tr].size());
+		for(int i = 0; i < nPoints; i++) {
+			expectNear(trs[i_tr](p(i)),outs[i_tr](i));
+		}
+	}
+
+	// the visitor sees every point of every transform once
+
+	std::vector<int> nSeen(nTr,0);
+
+	Kernel::applyEnsemble(&kernels[0],nTr,soa,
+		[&](int i_tr, int begin, int n, const SoAPoints& block) {
+			for(int i = 0; i < n; i++) {
+				expectNear(trs[i_tr](p(begin + i)),block(i));
+			}
+			nSeen[i_tr] += n;
+		});
+
+	for(int i_tr = 0; i_tr < nTr; i_tr++) {
+		EXPECT_EQ(nPoints,nSeen[i_tr]);
+	}
+
+}
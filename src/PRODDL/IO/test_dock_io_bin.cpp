@@ -102,3 +102,180 @@ TEST_F(DockIO_BinTest, RotFftScanIO_Collector) {
 
 	}
 }
+
+TEST_F(DockIO_BinTest, RotFftScanIO_BinAppend) {
+
+	{
+		D::RotFftScanIO_Bin io("dock_rot_scan.tmp.bin",ios::out|ios::trunc);
+		io.write_record(rot,tv);
+		io.flush();
+	}
+	{
+		D::TranValues tv_in;
+		D::RotFftScanIO_Bin io("dock_rot_scan.tmp.bin",ios::in);
+		EXPECT_TRUE(io.read_record(rot,tv_in));
+		EXPECT_EQ(D::RotFftScanIO_Bin::record_size(2),io.tell_read());
+	}
+	{
+		// the way a resumed rot-scan task continues the file
+		D::RotFftScanIO_Bin io("dock_rot_scan.tmp.bin",ios::out|ios::app);
+		tv(1).value = 5.;
+		io.write_record(rot,tv);
+	}
+	{
+		D::TranValues tv_in;
+		D::RotFftScanIO_Bin io("dock_rot_scan.tmp.bin",ios::in);
+		EXPECT_TRUE(io.read_record(rot,tv_in));
+		EXPECT_TRUE(tv_in.size() == 2 && tv_in(1).value==2.);
+		EXPECT_TRUE(io.read_record(rot,tv_in));
+		EXPECT_TRUE(tv_in.size() == 2 && tv_in(1).value==5.);
+		EXPECT_FALSE(io.read_record(rot,tv_in));
+	}
+}
+
+TEST_F(DockIO_BinTest, RotFftScanIO_CollectorEmptyFile) {
+
+	{
+		D::RotFftScanIO_Bin io("dock_rot_scan.tmp.1.bin",ios::out);
+		io.write_record(rot,tv);
+	}
+	{
+		D::RotFftScanIO_Bin io("dock_rot_scan.tmp.2.bin",ios::out);
+	}
+	{
+		D::RotFftScanIO_Bin io("dock_rot_scan.tmp.3.bin",ios::out);
+		tv(1).value = 4.;
+		io.write_record(rot,tv);
+	}
+	{
+		ofstream task_list("dock_rot_scan.tasks.tmp.tab");
+		task_list << "dock_rot_scan.tmp.1.bin" << "\n";
+		task_list << "dock_rot_scan.tmp.2.bin" << "\n";
+		task_list << "dock_rot_scan.tmp.3.bin" << "\n";
+	}
+	{
+		D::TranValues tv_in;
+		D::RotFftScanIO_Collector<D::RotFftScanIO_Bin> task_coll("dock_rot_scan.tasks.tmp.tab");
+		EXPECT_TRUE(task_coll.read_record(rot,tv_in));
+		EXPECT_TRUE(tv_in.size() == 2 && tv_in(1).value==2.);
+		EXPECT_TRUE(task_coll.read_record(rot,tv_in));
+		EXPECT_TRUE(tv_in.size() == 2 && tv_in(1).value==4.);
+		EXPECT_FALSE(task_coll.read_record(rot,tv_in));
+	}
+}
+
+// A scan interrupted after a checkpoint and resumed produces the same file
+// as an uninterrupted one
+
+class DockIO_CheckpointTest : public ::testing::Test {
+
+protected:
+
+	std::deque<D::Rotation> rots;
+
+	enum { nRot = 7 };
+
+	enum { nDone = 3 };
+
+public:
+
+	virtual void SetUp() {
+
+		for(int i = 0; i < nRot; i++) {
+			rots.push_back(D::Rotation(D::Point(0.1*i,0.2 - 0.05*i,0.3*i)));
+		}
+
+	}
+
+	static D::TranValues tranValues(int i_rot) {
+		D::TranValues tv(1 + i_rot % 3);
+		for(int i = 0; i < tv.size(); i++) {
+			tv(i).value = -1.*i_rot - 0.1*i;
+			tv(i).tran = D::Translation(D::Point(1.*i_rot,1.*i,-1.*i));
+		}
+		return tv;
+	}
+
+	void writeRotations(D::RotFftScanIO_Checkpointed& io, int i_start, int i_end) {
+		for(int i_rot = i_start; i_rot < i_end; i_rot++) {
+			EXPECT_TRUE(io.write_record(rots[i_rot],tranValues(i_rot)));
+		}
+	}
+
+	// Write the first 'nDone' rotations and a checkpoint, and then two more
+	// rotations that the checkpoint does not cover. The object is dropped
+	// without close(), as if the task was killed.
+
+	void writeInterrupted(const std::string& fileName) {
+		D::RotFftScanIO_Checkpointed io;
+		EXPECT_EQ(0,io.open(fileName,0,nRot,rots,true));
+		writeRotations(io,0,nDone);
+		io.write_checkpoint();
+		writeRotations(io,nDone,nDone+2);
+	}
+
+	static std::string readFile(const std::string& fileName) {
+		std::ifstream inp(fileName.c_str(),std::ios::binary);
+		std::ostringstream out;
+		out << inp.rdbuf();
+		return out.str();
+	}
+
+};
+
+TEST_F(DockIO_CheckpointTest, ResumeSameAsUninterrupted) {
+
+	{
+		D::RotFftScanIO_Checkpointed io;
+		EXPECT_EQ(0,io.open("dock_rot_scan.tmp.full.bin",0,nRot,rots,false));
+		writeRotations(io,0,nRot);
+		io.close();
+	}
+
+	writeInterrupted("dock_rot_scan.tmp.part.bin");
+
+	EXPECT_TRUE(boost::filesystem::exists("dock_rot_scan.tmp.part.bin.ckpt"));
+
+	{
+		D::RotFftScanIO_Checkpointed io;
+		ASSERT_EQ(nDone,io.open("dock_rot_scan.tmp.part.bin",0,nRot,rots,true));
+		writeRotations(io,nDone,nRot);
+		io.close();
+	}
+
+	EXPECT_FALSE(boost::filesystem::exists("dock_rot_scan.tmp.part.bin.ckpt"));
+
+	std::string full = readFile("dock_rot_scan.tmp.full.bin");
+	EXPECT_FALSE(full.empty());
+	EXPECT_TRUE(full == readFile("dock_rot_scan.tmp.part.bin"));
+
+}
+
+TEST_F(DockIO_CheckpointTest, IgnoreMismatchedCheckpoint) {
+
+	writeInterrupted("dock_rot_scan.tmp.part.bin");
+
+	// another range of rotations starts from scratch
+
+	{
+		D::RotFftScanIO_Checkpointed io;
+		EXPECT_EQ(0,io.open("dock_rot_scan.tmp.part.bin",0,nRot+1,rots,true));
+		EXPECT_EQ(0,io.n_records());
+		io.close();
+	}
+
+	EXPECT_EQ(0,int(boost::filesystem::file_size("dock_rot_scan.tmp.part.bin")));
+
+	// so does a disabled resume
+
+	writeInterrupted("dock_rot_scan.tmp.part.bin");
+
+	{
+		D::RotFftScanIO_Checkpointed io;
+		EXPECT_EQ(0,io.open("dock_rot_scan.tmp.part.bin",0,nRot,rots,false));
+		io.close();
+	}
+
+	EXPECT_EQ(0,int(boost::filesystem::file_size("dock_rot_scan.tmp.part.bin")));
+
+}
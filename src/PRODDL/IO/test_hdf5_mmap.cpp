@@ -0,0 +1,66 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#include <blitz/array.h>
+#include "PRODDL/IO/hdf5_mmap.hpp"
+#include "gtest/gtest.h"
+
+#include <cstdio>
+
+using namespace PRODDL;
+
+TEST(Hdf5MappedFileTest, MapArrays) {
+
+  const char *fileName = "test_hdf5_mmap.tmp.h5";
+
+  blitz::Array<double,2> pos(7,3);
+  blitz::firstIndex i;
+  blitz::secondIndex j;
+  pos = i * 10. + j;
+
+  blitz::Array<int,1> ind(5);
+  ind = i * 3;
+
+  {
+    Hdf5::HDF5File out(fileName,Hdf5::HDF5File::trunc);
+    out.setArray("pos",pos);
+    out.setArray("ind",ind);
+  }
+
+  Hdf5MappedFile::Ptr mf = Hdf5MappedFile::open(fileName);
+
+  ASSERT_TRUE(mf->isMapped());
+
+  // the second open of the same file reuses the mapping
+  EXPECT_EQ(mf.get(),Hdf5MappedFile::open(fileName).get());
+
+  blitz::Array<double,2> posMapped;
+  ASSERT_TRUE(mf->mapArray("pos",posMapped));
+  ASSERT_EQ(7,posMapped.rows());
+  ASSERT_EQ(3,posMapped.columns());
+  EXPECT_TRUE(blitz::all(posMapped == pos));
+
+  blitz::Array<int,1> indMapped;
+  ASSERT_TRUE(mf->mapArray("ind",indMapped));
+  EXPECT_TRUE(blitz::all(indMapped == ind));
+
+  // element type or rank that does not match the dataset is not mapped
+  blitz::Array<float,2> posFloat;
+  EXPECT_FALSE(mf->mapArray("pos",posFloat));
+  blitz::Array<double,1> posFlat;
+  EXPECT_FALSE(mf->mapArray("pos",posFlat));
+
+  // the views are read-only, a copy is needed to modify the data
+  EXPECT_DEATH(posMapped(0,0) = -1.,"");
+  blitz::Array<double,2> posCopy(posMapped.copy());
+  posCopy(0,0) = -1.;
+  EXPECT_EQ(0.,posMapped(0,0));
+
+  std::remove(fileName);
+
+}
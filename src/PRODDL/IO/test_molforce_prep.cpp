@@ -0,0 +1,140 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#include <blitz/array.h>
+#include "PRODDL/IO/molforce_prep.hpp"
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+
+using namespace PRODDL;
+using namespace std;
+
+typedef double T_num;
+typedef MolForcePrep<T_num> Prep;
+
+namespace {
+
+  // a dipeptide with a hydrogen and an alternative location of CB
+
+  const char *recText =
+    "ATOM      1  N   ALA A   1      11.104   6.134  -6.504  1.00  0.00           N\n"
+    "ATOM      2  CA  ALA A   1      11.639   6.071  -5.147  1.00  0.00           C\n"
+    "ATOM      3  C   ALA A   1      13.140   5.806  -5.215  1.00  0.00           C\n"
+    "ATOM      4  O   ALA A   1      13.716   5.640  -6.290  1.00  0.00           O\n"
+    "ATOM      5  H   ALA A   1      10.104   6.134  -6.504  1.00  0.00           H\n"
+    "ATOM      6  CB AALA A   1      11.344   7.352  -4.359  0.50  0.00           C\n"
+    "ATOM      7  CB BALA A   1      11.300   7.300  -4.300  0.50  0.00           C\n"
+    "ATOM      8  N   GLY A   2      13.758   5.762  -4.038  1.00  0.00           N\n"
+    "ATOM      9  CA  GLY A   2      15.185   5.507  -3.921  1.00  0.00           C\n"
+    "ATOM     10  C   GLY A   2      15.558   4.197  -4.599  1.00  0.00           C\n"
+    "ATOM     11  O   GLY A   2      14.800   3.223  -4.580  1.00  0.00           O\n"
+    "ATOM     12  OXT GLY A   2      16.680   4.130  -5.178  1.00  0.00           O\n";
+
+  // a non-standard residue, and an atom that is not in the ALA topology
+
+  const char *ligText =
+    "ATOM      1  C1  LIG B   1       1.000   2.000   3.000  1.00  0.00           C\n"
+    "ATOM      2  N1  LIG B   1       2.000   2.000   3.000  1.00  0.00           N\n"
+    "ATOM      3  CA  ALA B   2       3.000   2.000   3.000  1.00  0.00           C\n"
+    "ATOM      4  CX  ALA B   2       4.000   2.000   3.000  1.00  0.00           C\n";
+
+  vector<PDBPP::PDB> loadRecords(const char *text) {
+    vector<PDBPP::PDB> records;
+    istringstream in(text);
+    PDBPP::PDB record;
+    while( in >> record ) {
+      records.push_back(record);
+    }
+    return records;
+  }
+
+  T_num charmmEps(T_num eps) {
+    return -4.184 * eps;
+  }
+
+  T_num charmmSigma(T_num rMinHalf) {
+    return 2. * std::pow(2.,-1./6) * rMinHalf;
+  }
+
+}
+
+TEST(MolForcePrepTest, TypesAndLayout) {
+
+  Prep prep(0.4);
+
+  EXPECT_EQ(10,prep.addMolecule(loadRecords(recText)));
+  EXPECT_EQ(3,prep.addMolecule(loadRecords(ligText)));
+
+  EXPECT_EQ(2,prep.numMolecules());
+  EXPECT_EQ(13,prep.numAtoms());
+  EXPECT_EQ(1,prep.numSkipped());
+  EXPECT_EQ(2,prep.numByElement());
+
+  const char *fileName = "test_molforce_prep.tmp.h5";
+
+  prep.write(fileName);
+
+  Hdf5::HDF5File inp(fileName,Hdf5::HDF5File::in);
+
+  int mix;
+  inp.getAttribute("/","mix",mix);
+  EXPECT_EQ(1,mix);
+
+  blitz::Array<int,2> offsets(inp.readArray<int,2>("mol_offsets"));
+  blitz::Array<T_num,2> pos(inp.readArray<T_num,2>("pos"));
+  blitz::Array<T_num,1> mass(inp.readArray<T_num,1>("mass"));
+  blitz::Array<T_num,1> eps(inp.readArray<T_num,1>("eps"));
+  blitz::Array<T_num,1> sigma(inp.readArray<T_num,1>("sigma"));
+  blitz::Array<T_num,1> alpha(inp.readArray<T_num,1>("alpha"));
+
+  ASSERT_EQ(2,offsets.rows());
+  EXPECT_EQ(0,offsets(0,0));
+  EXPECT_EQ(10,offsets(0,1));
+  EXPECT_EQ(10,offsets(1,0));
+  EXPECT_EQ(13,offsets(1,1));
+
+  ASSERT_EQ(13,pos.rows());
+  ASSERT_EQ(3,pos.columns());
+
+  // the first location of CB is kept, the hydrogen is skipped
+  EXPECT_DOUBLE_EQ(11.344,pos(4,0));
+  EXPECT_DOUBLE_EQ(13.758,pos(5,0));
+
+  // N-terminal N is NH3, the rest of the chain by the residue topology
+  EXPECT_NEAR(charmmEps(-0.2),eps(0),1e-12);
+  EXPECT_NEAR(charmmSigma(1.85),sigma(0),1e-12);
+  // CT1
+  EXPECT_NEAR(charmmEps(-0.02),eps(1),1e-12);
+  EXPECT_NEAR(charmmSigma(2.275),sigma(1),1e-12);
+  // ALA CB is CT3
+  EXPECT_NEAR(charmmEps(-0.08),eps(4),1e-12);
+  // GLY CA is CT2
+  EXPECT_NEAR(charmmEps(-0.055),eps(6),1e-12);
+  // C-terminal C is CC, O and OXT are OC
+  EXPECT_NEAR(charmmEps(-0.07),eps(7),1e-12);
+  EXPECT_NEAR(charmmSigma(1.7),sigma(8),1e-12);
+  EXPECT_NEAR(charmmSigma(1.7),sigma(9),1e-12);
+
+  // by element
+  EXPECT_NEAR(charmmEps(-0.055),eps(10),1e-12);
+  EXPECT_NEAR(charmmEps(-0.2),eps(11),1e-12);
+
+  EXPECT_NEAR(12.011,mass(1),1e-12);
+  EXPECT_NEAR(14.007,mass(0),1e-12);
+  EXPECT_NEAR(15.999,mass(9),1e-12);
+
+  for(int i = 0; i < 13; i++) {
+    EXPECT_DOUBLE_EQ(0.4,alpha(i));
+  }
+
+  std::remove(fileName);
+
+}
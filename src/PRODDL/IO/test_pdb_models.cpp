@@ -0,0 +1,202 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#include <blitz/array.h>
+#include "PRODDL/IO/pdb_models.hpp"
+#include "gtest/gtest.h"
+
+#include <sstream>
+#include <cstdio>
+
+using namespace PRODDL;
+using namespace std;
+
+typedef double T_num;
+typedef PdbModelWriter<T_num> Writer;
+typedef Writer::Points Points;
+
+namespace {
+
+  const char *recText =
+    "ATOM      1  N   ALA A   1      11.104   6.134  -6.504  1.00  0.00           N\n"
+    "ATOM      2  CA  ALA A   1      11.639   6.071  -5.147  1.00  0.00           C\n";
+
+  const char *ligText =
+    "ATOM      1  N   GLY B   1      -1.500   0.250 100.000  1.00  0.00           N\n"
+    "ATOM      2  CA  GLY B   1      -0.001   2.125  -9.875  1.00  0.00           C\n"
+    "ATOM      3  C   GLY B   1     999.999-999.999   0.000  1.00  0.00           C\n";
+
+  void loadRecords(const char *text, vector<PDBPP::PDB>& records, Points& coords) {
+    istringstream in(text);
+    PDBPP::PDB record;
+    while( in >> record ) {
+      records.push_back(record);
+    }
+    coords.resize(records.size());
+    for(size_t i = 0; i < records.size(); i++) {
+      for(int k = 0; k < 3; k++) {
+	coords(i)(k) = records[i].atom.xyz[k];
+      }
+    }
+  }
+
+  // Reference output produced by the Pdb++ writer
+
+  string pdbppModel(int modelNum, const vector<PDBPP::PDB>& records) {
+    ostringstream out;
+    PDBPP::PDB rec_mod(PDBPP::PDB::MODEL);
+    rec_mod.model.num = modelNum;
+    out << rec_mod;
+    for(size_t i = 0; i < records.size(); i++) {
+      out << records[i];
+    }
+    PDBPP::PDB rec_ter(PDBPP::PDB::TER);
+    rec_ter.ter.serialNum = records.back().atom.serialNum;
+    rec_ter.ter.residue = records.back().atom.residue;
+    out << rec_ter;
+    out << PDBPP::PDB(PDBPP::PDB::ENDMDL);
+    return out.str();
+  }
+
+} // namespace
+
+TEST(PdbModelsTest, FormatCoord) {
+
+  const double values[] = { 0., -0., 1.5, -1.5, 0.0004, -0.0004, 12.3456, -123.4564,
+			    9999.999, -999.999, 42.0 };
+
+  for(size_t i = 0; i < sizeof(values)/sizeof(values[0]); i++) {
+    char ref[32], buf[9];
+    std::sprintf(ref,"%8.3f",values[i]);
+    ASSERT_TRUE(formatPdbCoord(buf,values[i]));
+    buf[8] = '\0';
+    EXPECT_EQ(string(ref),string(buf));
+  }
+
+  char buf[8];
+
+  EXPECT_FALSE(formatPdbCoord(buf,10000.));
+  EXPECT_FALSE(formatPdbCoord(buf,-1000.));
+
+}
+
+TEST(PdbModelsTest, MatchesPdbpp) {
+
+  vector<PDBPP::PDB> records_rec, records_lig;
+
+  Points coords_rec, coords_lig;
+
+  loadRecords(recText,records_rec,coords_rec);
+  loadRecords(ligText,records_lig,coords_lig);
+
+  ASSERT_EQ(2,int(records_rec.size()));
+  ASSERT_EQ(3,int(records_lig.size()));
+
+  Writer writer(records_rec,records_lig,coords_lig);
+
+  // with identity transformations, the output must be byte identical
+  // to the one of the Pdb++ writer
+
+  vector<Writer::RotTranValue> models(5);
+
+  ostringstream out;
+
+  writer.writeModels(out,models,1,false,3,2);
+
+  string ref;
+
+  for(int i = 0; i < int(models.size()); i++) {
+    ref += pdbppModel(i+1,records_lig);
+  }
+
+  EXPECT_EQ(ref,out.str());
+
+  // with the receptor
+
+  string model;
+
+  writer.formatModel(7,models[0].tran,true,model);
+
+  string refRec = pdbppModel(7,records_lig);
+
+  refRec.insert(refRec.find('\n')+1,writer.receptorText());
+
+  EXPECT_EQ(refRec,model);
+
+}
+
+TEST(PdbModelsTest, ReceptorTakenAsIs) {
+
+  vector<PDBPP::PDB> records_rec, records_lig;
+
+  Points coords_rec, coords_lig;
+
+  loadRecords(recText,records_rec,coords_rec);
+  loadRecords(ligText,records_lig,coords_lig);
+
+  // serial number overflows its field, which can shift the columns;
+  // the receptor is not patched, so it is written like the Pdb++ writer does
+
+  records_rec[1].atom.serialNum = 1234567;
+
+  Writer writer(records_rec,records_lig,coords_lig);
+
+  string ref;
+
+  for(size_t i = 0; i < records_rec.size(); i++) {
+    ref += records_rec[i].chars();
+    ref += '\n';
+  }
+
+  EXPECT_EQ(0u,writer.receptorText().find(ref));
+
+}
+
+TEST(PdbModelsTest, ThreadsKeepModelOrder) {
+
+  vector<PDBPP::PDB> records_rec, records_lig;
+
+  Points coords_rec, coords_lig;
+
+  loadRecords(recText,records_rec,coords_rec);
+  loadRecords(ligText,records_lig,coords_lig);
+
+  Writer writer(records_rec,records_lig,coords_lig);
+
+  typedef Writer::Point Point;
+
+  // translations that keep the ligand coordinates within the PDB fields
+
+  vector<Writer::RotTranValue> models(13);
+
+  for(int i = 0; i < int(models.size()); i++) {
+    models[i].tran = Writer::RotationTranslation(Point(0.),Point(-0.1*i,0.05*i,0.3*i));
+  }
+
+  ostringstream ref;
+
+  writer.writeModels(ref,models,1,true,1);
+
+  // more chunks than threads, each thread formats several of them
+
+  for(int nThreads = 2; nThreads <= 4; nThreads++) {
+    ostringstream out;
+    writer.writeModels(out,models,1,true,nThreads,1);
+    EXPECT_EQ(ref.str(),out.str());
+  }
+
+  // a model that does not fit the PDB format fails the call without
+  // leaving the other threads waiting for its chunk
+
+  models[5].tran = Writer::RotationTranslation(Point(0.),Point(0.,-5.,0.));
+
+  ostringstream out;
+
+  EXPECT_THROW(writer.writeModels(out,models,1,true,4,1),io_error);
+
+}
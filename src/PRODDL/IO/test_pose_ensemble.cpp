@@ -0,0 +1,197 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#include <blitz/array.h>
+#include "PRODDL/IO/pose_ensemble.hpp"
+#include "PRODDL/IO/pose_ensemble_hdf5.hpp"
+#include "gtest/gtest.h"
+#include <boost/filesystem.hpp>
+
+using namespace PRODDL;
+using namespace std;
+
+typedef double T_num;
+typedef Types<T_num> TypesT;
+typedef TypesT::Point Point;
+typedef TypesT::Points Points;
+typedef TypesT::RotationTranslation RotationTranslation;
+
+class PoseEnsembleTest : public ::testing::Test {
+
+protected:
+
+  std::string topology;
+
+  Points coords;
+
+  std::vector<RotationTranslation> trans;
+
+  std::vector<T_num> values;
+
+public:
+
+  virtual void SetUp() {
+
+    topology = "ATOM      1  CA  GLY B   1       1.000   2.000   3.000  1.00  0.00           C\n";
+
+    coords.resize(3);
+    coords(0) = Point(1,2,3);
+    coords(1) = Point(-1,0.5,7);
+    coords(2) = Point(0,0,-2);
+
+    for(int i = 0; i < 4; i++) {
+      trans.push_back(RotationTranslation(Point(0.1*i,0.2,-0.3*i),Point(i,2*i,-i)));
+      values.push_back(-10.*i);
+    }
+
+  }
+
+  // ligand coordinates for pose 'i'
+
+  Points pose(int i) const {
+    Points c(coords.rows());
+    for(int i_at = 0; i_at < coords.rows(); i_at++) {
+      c(i_at) = trans[i](coords(i_at));
+    }
+    return c;
+  }
+
+  void checkHdf5(long blockBytes);
+
+};
+
+TEST_F(PoseEnsembleTest, Binary) {
+
+  std::string fileName = "tmp_test_pose_ensemble.bin";
+
+  PoseEnsembleWriter<T_num> writer;
+
+  writer.open(fileName,topology,coords.rows(),trans.size());
+
+  for(size_t i = 0; i < trans.size(); i++) {
+    writer.writeFrame(values[i],trans[i],pose(i));
+  }
+
+  writer.close();
+
+  // every frame starts at an aligned offset, whatever the number of atoms
+
+  for(int nAtoms = 1; nAtoms <= 4; nAtoms++) {
+    EXPECT_EQ(0,PoseEnsembleFormat<T_num>::frameSize(nAtoms) % PoseEnsembleFormat<T_num>::FRAME_ALIGN);
+    EXPECT_LE((long long)((PoseEnsembleFormat<T_num>::FRAME_HEAD + 3*nAtoms)*sizeof(float)),
+	      PoseEnsembleFormat<T_num>::frameSize(nAtoms));
+  }
+
+  EXPECT_EQ(PoseEnsembleFormat<T_num>::framesOffset(topology.size()) +
+	    trans.size()*PoseEnsembleFormat<T_num>::frameSize(coords.rows()),
+	    (long long)boost::filesystem::file_size(fileName));
+
+  PoseEnsembleReader<T_num> reader;
+
+  reader.open(fileName);
+
+  EXPECT_EQ(int(coords.rows()),reader.nAtoms());
+  EXPECT_EQ(int(trans.size()),reader.nFrames());
+  EXPECT_EQ(topology,reader.topology());
+
+  // read out of order
+
+  for(int i = int(trans.size()) - 1; i >= 0; i--) {
+    T_num value;
+    RotationTranslation tran;
+    Points c;
+    reader.readFrame(i,value,tran,c);
+    EXPECT_FLOAT_EQ(values[i],value);
+    Points ref(pose(i));
+    ASSERT_EQ(ref.rows(),c.rows());
+    for(int i_at = 0; i_at < c.rows(); i_at++) {
+      Point pt = tran(coords(i_at));
+      for(int k = 0; k < 3; k++) {
+	EXPECT_NEAR(ref(i_at)(k),c(i_at)(k),1e-5);
+	EXPECT_NEAR(ref(i_at)(k),pt(k),1e-4);
+      }
+    }
+  }
+
+  EXPECT_THROW(writer.writeFrame(0.,trans[0],pose(0)),std::exception);
+
+  boost::filesystem::remove(fileName);
+
+}
+
+// 'blockBytes' is the size of the writer buffer, the default one holds
+// all frames of the test
+
+void PoseEnsembleTest::checkHdf5(long blockBytes) {
+
+  std::string fileName = "tmp_test_pose_ensemble.hdf5";
+
+  {
+    PoseEnsembleHdf5Writer<T_num> writer(blockBytes);
+
+    writer.open(fileName,topology,coords.rows(),trans.size());
+
+    for(size_t i = 0; i < trans.size(); i++) {
+      writer.writeFrame(values[i],trans[i],pose(i));
+    }
+
+    writer.close();
+  }
+
+  {
+    Hdf5::HDF5File inp(fileName,Hdf5::HDF5File::in);
+
+    EXPECT_EQ(topology,inp.read<std::string>("topology"));
+
+    int nFrames = 0;
+
+    inp.getAttribute("/","nFrames",nFrames);
+
+    EXPECT_EQ(int(trans.size()),nFrames);
+
+    // frames are stored as lists of per-pose elements
+
+    for(size_t i = 0; i < trans.size(); i++) {
+      EXPECT_FLOAT_EQ(values[i],inp.read<float>("score",i));
+      blitz::Array<float,1> t(inp.readArray<float,1>("transform",i));
+      ASSERT_EQ(6,t.extent(0));
+      Point ang, xyz;
+      trans[i].anglesAndDisplacement(ang,xyz);
+      for(int k = 0; k < 3; k++) {
+	EXPECT_NEAR(ang(k),t(k),1e-5);
+	EXPECT_NEAR(xyz(k),t(k+3),1e-5);
+      }
+      blitz::Array<float,2> c(inp.readArray<float,2>("coords",i));
+      ASSERT_EQ(int(coords.rows()),c.extent(0));
+      ASSERT_EQ(3,c.extent(1));
+      Points ref(pose(i));
+      for(int i_at = 0; i_at < coords.rows(); i_at++) {
+	for(int k = 0; k < 3; k++) {
+	  EXPECT_NEAR(ref(i_at)(k),c(i_at,k),1e-5);
+	}
+      }
+    }
+  }
+
+  boost::filesystem::remove(fileName);
+
+}
+
+TEST_F(PoseEnsembleTest, Hdf5) {
+
+  checkHdf5(4 << 20);
+
+}
+
+// blocks of 3 frames, the last one partially filled
+
+TEST_F(PoseEnsembleTest, Hdf5Blocks) {
+
+  checkHdf5(3 * 3*sizeof(float)*coords.rows());
+
+}
@@ -0,0 +1,90 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+
+#include "PRODDL/Math/fft_shape.hpp"
+
+#include "gtest/gtest.h"
+
+#include <cstdio>
+
+using namespace PRODDL::Math;
+
+typedef FFTShapeCost::Shape Shape;
+
+TEST(FFTShapeTest, CandidateSizes) {
+
+  std::vector<int> sizes = FFTShapePlanner::candidateSizes(53,0.25,4);
+
+  ASSERT_EQ(4,int(sizes.size()));
+  // 53 is prime, 54 = 2*3^3 is the first FFTW-friendly size
+  EXPECT_EQ(54,sizes[0]);
+  EXPECT_EQ(55,sizes[1]);
+  EXPECT_EQ(56,sizes[2]);
+  EXPECT_EQ(60,sizes[3]);
+
+  // the first FFTW-friendly size is kept even when no growth is allowed
+  sizes = FFTShapePlanner::candidateSizes(53,0.,4);
+  ASSERT_EQ(1,int(sizes.size()));
+  EXPECT_EQ(54,sizes[0]);
+
+}
+
+TEST(FFTShapeTest, ModelPrefersSmoothSizesAndHalvedLongAxis) {
+
+  EXPECT_LT(FFTShapeCost::modelCost(Shape(64,64,64)),FFTShapeCost::modelCost(Shape(66,66,66)));
+
+  // the last axis is the halved one, so it should be the longest
+  EXPECT_LT(FFTShapeCost::modelCost(Shape(32,32,128)),FFTShapeCost::modelCost(Shape(128,32,32)));
+
+  FFTShapeCost cost;
+
+  FFTShapePlans plans = FFTShapePlanner::candidates(Shape(120,30,30),0.,1,true);
+
+  ASSERT_EQ(3,int(plans.size()));
+
+  FFTShapePlanner::rank(plans,cost);
+
+  EXPECT_EQ(1,plans[0].shift);
+  EXPECT_EQ(120,plans[0].size(2));
+
+}
+
+TEST(FFTShapeTest, MeasuredCostsOverrideModel) {
+
+  const char* fileName = "test_fft_shape.tmp.txt";
+  std::remove(fileName);
+
+  FFTShapeCost cost;
+
+  EXPECT_EQ(0,cost.load(fileName));
+
+  Shape big(64,64,64), small(54,54,54);
+
+  // pretend that the larger shape was measured to be faster
+  FFTShapeCost::append(fileName,big,1.);
+  FFTShapeCost::append(fileName,small,2.);
+
+  EXPECT_EQ(2,cost.load(fileName));
+  EXPECT_TRUE(cost.isMeasured(big));
+  EXPECT_DOUBLE_EQ(1.,cost.cost(big));
+
+  FFTShapePlans plans = FFTShapePlanner::candidates(small,0.2,6,false);
+  FFTShapePlanner::rank(plans,cost);
+
+  EXPECT_EQ(64,plans[0].size(0));
+  EXPECT_EQ(64,plans[0].size(2));
+
+  // unmeasured shapes are scaled into the units of measured ones
+  Shape other(60,60,60);
+  EXPECT_GT(cost.cost(other),0.1);
+  EXPECT_LT(cost.cost(other),10.);
+
+  std::remove(fileName);
+
+}
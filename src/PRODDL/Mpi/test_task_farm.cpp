@@ -0,0 +1,120 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+// Must be run under mpirun with at least two ranks
+
+#include "PRODDL/Mpi/task_farm.hpp"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace PRODDL;
+
+namespace {
+
+  // Result of task i is i integers equal to 7*i (so task 0 has an empty result)
+
+  void runFarm(int nTasks, int minChunk, std::vector<int>& nReceived, bool& payloadOk) {
+
+    int rank = 0;
+
+    MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+
+    nReceived.assign(nTasks,0);
+
+    payloadOk = true;
+
+    if( rank == 0 ) {
+
+      Mpi::TaskFarmForeman foreman(nTasks,minChunk);
+
+      foreman.run([&](int iTask, const char *data, int size) {
+	  ASSERT_TRUE(iTask >= 0 && iTask < nTasks);
+	  nReceived[iTask]++;
+	  if( size != int(iTask*sizeof(int)) ) {
+	    payloadOk = false;
+	    return;
+	  }
+	  const int *p = reinterpret_cast<const int*>(data);
+	  for(int i = 0; i < iTask; i++) {
+	    if( p[i] != 7*iTask ) {
+	      payloadOk = false;
+	    }
+	  }
+	});
+
+    }
+    else {
+
+      Mpi::TaskFarmWorker worker;
+
+      worker.run([&](int begin, int end) {
+	  for(int iTask = begin; iTask < end; iTask++) {
+	    std::vector<int> res(iTask,7*iTask);
+	    worker.sendResult(iTask,res.empty() ? 0 : &res[0],int(res.size()*sizeof(int)));
+	  }
+	});
+
+      EXPECT_TRUE(worker.isDone());
+
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+
+  }
+
+} // namespace
+
+TEST(MpiTaskFarmTest, AllTasksOnce) {
+
+  int rank = 0;
+
+  MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+
+  const int nTasks = 1000;
+
+  std::vector<int> nReceived;
+
+  bool payloadOk;
+
+  runFarm(nTasks,1,nReceived,payloadOk);
+
+  if( rank == 0 ) {
+    for(int i = 0; i < nTasks; i++) {
+      EXPECT_EQ(1,nReceived[i]) << "task " << i;
+    }
+    EXPECT_TRUE(payloadOk);
+  }
+
+}
+
+TEST(MpiTaskFarmTest, LargeChunksAndFewTasks) {
+
+  int rank = 0;
+
+  MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+
+  for(int nTasks = 0; nTasks < 5; nTasks++) {
+
+    std::vector<int> nReceived;
+
+    bool payloadOk;
+
+    runFarm(nTasks,100,nReceived,payloadOk);
+
+    if( rank == 0 ) {
+      for(int i = 0; i < nTasks; i++) {
+	EXPECT_EQ(1,nReceived[i]) << "task " << i;
+      }
+      EXPECT_TRUE(payloadOk);
+    }
+
+  }
+
+}
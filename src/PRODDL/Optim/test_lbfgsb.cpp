@@ -0,0 +1,103 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+
+#include "PRODDL/Optim/lbfgsb.hpp"
+
+#include "PRODDL/Common/debug.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+  // Rosenbrock's function, min at (1,1)
+
+  struct Rosenbrock {
+
+    double fg(const double x[], double g[]) {
+      double f1 = x[1] - x[0]*x[0];
+      double f2 = 1. - x[0];
+      g[0] = -400.*f1*x[0] - 2.*f2;
+      g[1] = 200.*f1;
+      return 100.*f1*f1 + f2*f2;
+    }
+
+  };
+
+  // f = sum_i(a*(x[i]-1)^2); where a = 1.0/(i+1)
+
+  struct Quadratic {
+
+    double fg(const double x[], double g[]) {
+      double f = 0;
+      for(int i = 0; i < 6; i++) {
+	double a = 1.0/(i+1);
+	f += a*(x[i]-1)*(x[i]-1);
+	g[i] = 2*a*(x[i]-1);
+      }
+      return f;
+    }
+
+  };
+
+} // namespace
+
+
+TEST(LbfgsBTest, Unconstrained) {
+
+  using namespace PRODDL::Optim;
+
+  LbfgsParams params;
+  params.maxIter = 1000;
+  params.maxFuncEvals = 5000;
+  params.gTol = 1e-8;
+  params.fTol = 0;
+
+  LbfgsB<double,2> optimizer(params);
+
+  Rosenbrock func;
+
+  double x[2] = { -1.2, 1.0 };
+
+  double f = optimizer.optimize(func,x);
+
+  ATOUTVAR(f); ATOUTVAR(optimizer.numFuncEvals()); ATOUTVAR(optimizer.whyStoppedStr()); ATOUTENDL();
+
+  EXPECT_NEAR(x[0],1.,1e-5);
+  EXPECT_NEAR(x[1],1.,1e-5);
+  EXPECT_LT(optimizer.numFuncEvals(),200);
+
+}
+
+
+TEST(LbfgsBTest, Bounded) {
+
+  using namespace PRODDL::Optim;
+
+  LbfgsB<double,6> optimizer;
+
+  // unconstrained minimum is outside of the box for odd indices
+
+  double lower[6] = { -1, -1, -1, -1, -1, -1 };
+  double upper[6] = {  2, .5,  2, .5,  2, .5 };
+
+  optimizer.setBounds(lower,upper);
+
+  Quadratic func;
+
+  double x[6] = { -5, -5, -5, -5, -5, -5 };
+
+  optimizer.optimize(func,x);
+
+  for(int i = 0; i < 6; i++) {
+    EXPECT_GE(x[i],lower[i]);
+    EXPECT_LE(x[i],upper[i]);
+    EXPECT_NEAR(x[i],(i % 2 ? .5 : 1.),1e-4);
+  }
+
+}
@@ -0,0 +1,69 @@
+#include "PRODDL/Testing/bench_io_json.hpp"
+#include "PRODDL/Common/debug.hpp"
+#include "PRODDL/External/jsoncpp/jsoncpp.hpp"
+#include <fstream>
+
+namespace PRODDL {
+
+	void save_bench_results_to_json_file(const Bench::Results& results,std::string out_file)
+	{
+		Json::Value root(Json::objectValue);
+
+		Json::Value& benchmarks = root["benchmarks"];
+		benchmarks = Json::Value(Json::arrayValue);
+
+		for(Bench::Results::const_iterator p = results.begin(); p != results.end(); ++p) {
+			Json::Value bench(Json::objectValue);
+			bench["name"] = p->name;
+			bench["nReps"] = p->nReps;
+			bench["secMedian"] = p->secMedian;
+			bench["secMin"] = p->secMin;
+			bench["nItems"] = p->nItems;
+			bench["itemsPerSec"] = p->itemsPerSec();
+			Json::Value& params = bench["params"];
+			params = Json::Value(Json::objectValue);
+			for(Bench::Params::const_iterator p_par = p->params.begin(); p_par != p->params.end(); ++p_par) {
+				params[p_par->first] = p_par->second;
+			}
+			benchmarks.append(bench);
+		}
+
+		std::ofstream out_stream(out_file.c_str());
+		ATALWAYS(out_stream.good(),("Failed to open benchmark file for writing: " + out_file).c_str());
+		Json::StyledStreamWriter writer;
+		writer.write(out_stream,root);
+		ATALWAYS(out_stream.good(),("Failed to write benchmark file: " + out_file).c_str());
+	}
+
+	void load_bench_results_from_json_file(std::string inp_file,Bench::Results& results)
+	{
+		Json::Reader reader;
+		Json::Value root;
+		std::ifstream inp_stream(inp_file.c_str());
+		ATALWAYS(reader.parse(inp_stream, root, false),("Failed to load benchmark file: " + inp_file).c_str());
+		ATALWAYS(root.type() == Json::objectValue && root["benchmarks"].isArray(),
+			("Benchmark file should contain JSON object with 'benchmarks' array: " + inp_file).c_str());
+
+		results.clear();
+
+		const Json::Value& benchmarks = root["benchmarks"];
+		for(Json::Value::ArrayIndex i = 0; i < benchmarks.size(); i++) {
+			const Json::Value& bench = benchmarks[i];
+			Bench::Result res;
+			res.name = bench.get("name","").asString();
+			res.nReps = bench.get("nReps",0).asInt();
+			res.secMedian = bench.get("secMedian",0.).asDouble();
+			res.secMin = bench.get("secMin",0.).asDouble();
+			res.nItems = bench.get("nItems",1.).asDouble();
+			const Json::Value& params = bench["params"];
+			if( params.isObject() ) {
+				Json::Value::Members names = params.getMemberNames();
+				for(Json::Value::Members::const_iterator p = names.begin(); p != names.end(); ++p) {
+					res.params[*p] = params[*p].asDouble();
+				}
+			}
+			results.push_back(res);
+		}
+	}
+
+} // namespace PRODDL
@@ -0,0 +1,19 @@
+#include "PRODDL/Testing/ctestc.hpp"
+#include "gtest/gtest.h"
+
+#include <mpi.h>
+
+// Same as gtestc_main.cpp, but for tests that run under mpirun.
+// Every rank runs all tests, and the exit code is non-zero if any
+// test failed on any rank.
+
+GTEST_API_ int main(int argc, char **argv) {
+  MPI_Init(&argc,&argv);
+  //this will remove all options that it parses
+  ::testing::InitGoogleTest(&argc, argv);
+  int status = init_testing(argc,argv) || RUN_ALL_TESTS();
+  int statusAll = 0;
+  MPI_Allreduce(&status,&statusAll,1,MPI_INT,MPI_MAX,MPI_COMM_WORLD);
+  MPI_Finalize();
+  return statusAll;
+}
@@ -0,0 +1,73 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+#include "PRODDL/Testing/bench.hpp"
+#include "PRODDL/Testing/bench_io_json.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace PRODDL;
+
+TEST(BenchTest, RunnerRepsAndFilter) {
+
+  Bench::Runner runner(0.,5,10,"sum");
+
+  int n_prep = 0, n_run = 0;
+
+  Bench::Params params;
+  params["n"] = 100;
+
+  runner.run("sum/n100",params,[&]() { n_prep++; },[&]() { n_run++; },100);
+  runner.run("skipped",params,[&]() { n_run++; });
+
+  ASSERT_EQ(1,int(runner.getResults().size()));
+
+  const Bench::Result& res = runner.getResults()[0];
+
+  // one warm-up call on top of the timed ones
+  EXPECT_EQ(5,res.nReps);
+  EXPECT_EQ(6,n_run);
+  EXPECT_EQ(6,n_prep);
+  EXPECT_LE(res.secMin,res.secMedian);
+  EXPECT_DOUBLE_EQ(100,res.params.find("n")->second);
+
+}
+
+TEST(BenchTest, JsonRoundTripAndCompare) {
+
+  Bench::Results results(2);
+
+  results[0].name = "a";
+  results[0].secMedian = 1.;
+  results[0].params["fftSize"] = 64;
+  results[1].name = "b";
+  results[1].secMedian = 2.;
+
+  save_bench_results_to_json_file(results,"test_bench.tmp.json");
+
+  Bench::Results baseline;
+
+  load_bench_results_from_json_file("test_bench.tmp.json",baseline);
+
+  ASSERT_EQ(2,int(baseline.size()));
+  EXPECT_EQ("b",baseline[1].name);
+  EXPECT_DOUBLE_EQ(2.,baseline[1].secMedian);
+  EXPECT_DOUBLE_EQ(64,baseline[0].params["fftSize"]);
+
+  results[0].secMedian = 1.05;
+  results[1].secMedian = 2.5;
+
+  Bench::Comparisons comps = Bench::compare(results,baseline,0.1);
+
+  ASSERT_EQ(2,int(comps.size()));
+  EXPECT_FALSE(comps[0].regressed);
+  EXPECT_TRUE(comps[1].regressed);
+  EXPECT_DOUBLE_EQ(1.25,comps[1].ratio);
+  EXPECT_EQ(1,Bench::countRegressed(comps));
+
+}
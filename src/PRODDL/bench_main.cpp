@@ -0,0 +1,890 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+// Benchmarks of the computational kernels of the docking code.
+// The inputs are the test_data/pdb structures (the receptor atoms are
+// replicated to get the larger sizes) and random data with a fixed seed,
+// so that the runs are comparable between builds and machines.
+
+#include "PRODDL/Testing/bench.hpp"
+#include "PRODDL/Testing/bench_io_json.hpp"
+#include "PRODDL/docking.hpp"
+#include "PRODDL/IO/pdb_models.hpp"
+
+#include "PRODDL/Common/g_options.hpp"
+#include "PRODDL/Common/logger.hpp"
+
+#include <boost/program_options.hpp>
+
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace PRODDL {
+
+  Options gOptions;
+
+} // namespace PRODDL
+
+namespace {
+
+namespace po = boost::program_options;
+
+typedef PRODDL_T_NUM T_num;
+
+typedef PRODDL::Docking<T_num> Dk;
+
+typedef Dk::PotentialsT Pot;
+
+typedef std::mt19937 Rng;
+
+typedef Dk::Projector::ProjectorRadialField<Dk::LjPot> ProjectorLJ;
+
+
+int parse_arguments(int ac, char* av[], po::variables_map& vm)
+{
+	using namespace std;
+    try {
+
+        po::options_description desc("Options for benchmarks of docking kernels");
+        desc.add_options()
+            ("help", "produce help message")
+			("test-data-dir", po::value<string>()->default_value("test_data"), "directory with pdb/2ptc_E.pdb and pdb/2ptc_I.pdb")
+			("work-dir", po::value<string>()->default_value("."), "directory for temporary files of IO benchmarks")
+			("out", po::value<string>(), "output JSON file with benchmark results")
+			("baseline", po::value<string>(), "JSON file with baseline results (saved before with --out) to compare against")
+			("tolerance", po::value<double>()->default_value(0.1), "allowed fraction of slowdown relative to the baseline")
+			("filter", po::value<string>()->default_value(""), "run only benchmarks with names that contain this string")
+			("min-seconds", po::value<double>()->default_value(1.), "minimum timed seconds per benchmark")
+			("min-reps", po::value<int>()->default_value(3), "minimum repetitions per benchmark")
+			("max-reps", po::value<int>()->default_value(1000), "maximum repetitions per benchmark")
+			("grid-step", po::value<double>()->default_value(1.5), "FFT grid step")
+			("log-level", po::value<int>()->default_value(ATLOG_LEVEL), "run-time log level")
+        ;
+
+        po::store(po::parse_command_line(ac, av, desc), vm);
+
+        if (vm.count("help")) {
+            cout << desc << "\n";
+            return true;
+        }
+
+		po::notify(vm);
+
+    }
+    catch(exception& e) {
+        cerr << "error: " << e.what() << "\n";
+        return false;
+    }
+    catch(...) {
+        cerr << "Exception of unknown type when parsing arguments!\n";
+		return false;
+    }
+
+    return true;
+}
+
+
+std::string bench_name(const std::string& prefix, int n) {
+	std::ostringstream out;
+	out << prefix << n;
+	return out.str();
+}
+
+
+Dk::Points load_coords(const std::string& pdb_file) {
+
+	std::vector<PDBPP::PDB> records;
+
+	Dk::Points coords;
+
+	PRODDL::loadPdbAtoms<T_num>(pdb_file,records,coords);
+
+	return coords;
+
+}
+
+
+Dk::PointPair bounds(const Dk::Points& points) {
+
+	Dk::PointPair b;
+
+	b(0) = points(0);
+	b(1) = points(0);
+
+	for(int i = 1; i < points.size(); i++) {
+		for(int dim = 0; dim < Dk::N_dim; dim++) {
+			b(0)(dim) = std::min(b(0)(dim),points(i)(dim));
+			b(1)(dim) = std::max(b(1)(dim),points(i)(dim));
+		}
+	}
+
+	return b;
+
+}
+
+
+// Copy of 'points' with the center of the bounding box moved to the origin
+
+Dk::Points centered(const Dk::Points& points) {
+
+	Dk::PointPair b = bounds(points);
+
+	Dk::Point center = (b(0) + b(1)) / 2.;
+
+	Dk::Points x(points.size());
+
+	for(int i = 0; i < points.size(); i++) {
+		x(i) = points(i) - center;
+	}
+
+	return x;
+
+}
+
+
+// 'n' atoms made by placing copies of 'points' side by side
+// on a cubic lattice, centered at the origin
+
+Dk::Points tile_atoms(const Dk::Points& points, int n) {
+
+	Dk::PointPair b = bounds(points);
+
+	Dk::Point cell = b(1) - b(0) + 2.;
+
+	int n_copies = (n + points.size() - 1) / points.size();
+
+	int n_side = 1;
+
+	while( n_side * n_side * n_side < n_copies ) {
+		n_side++;
+	}
+
+	Dk::Points x(n);
+
+	for(int i = 0; i < n; i++) {
+		int i_copy = i / points.size();
+		Dk::Point shift;
+		shift(0) = (i_copy % n_side) * cell(0);
+		shift(1) = ((i_copy / n_side) % n_side) * cell(1);
+		shift(2) = (i_copy / (n_side * n_side)) * cell(2);
+		x(i) = points(i % points.size()) + shift;
+	}
+
+	return centered(x);
+
+}
+
+
+// LJ fields of the receptor atoms with a few distinct parameter sets,
+// using the default values of the docking options
+
+ProjectorLJ::RadialFields lj_fields(int n) {
+
+	ProjectorLJ::RadialFields fields(n);
+
+	for(int i = 0; i < n; i++) {
+		fields(i) = Dk::LjPot(3.0 + 0.2 * (i % 4), 0.46, 0.4, 9.0);
+	}
+
+	return fields;
+
+}
+
+
+void fill_random(Dk::GridArray arr, Rng& rng) {
+
+	std::uniform_real_distribution<T_num> dist(-1,1);
+
+	T_num *p = arr.dataFirst();
+
+	for(int i = 0; i < arr.numElements(); i++) {
+		p[i] = dist(rng);
+	}
+
+}
+
+
+void bench_correlate(PRODDL::Bench::Runner& runner, int n, T_num grid_step, Rng& rng) {
+
+	std::string name = bench_name("correlate/fft",n);
+
+	if( ! runner.enabled(name) ) {
+		return;
+	}
+
+	Dk::PointPair box;
+	box(0) = Dk::Point(0.);
+	box(1) = Dk::Point(n * grid_step);
+
+	Dk::FFTCorrelator corr(box,grid_step);
+
+	Dk::Grid& rec_grid = corr.getGrid(Dk::FFTCorrelator::iGridRec);
+	Dk::Grid& lig_grid = corr.getGrid(Dk::FFTCorrelator::iGridLig);
+
+	fill_random(rec_grid.getGridArray(),rng);
+	corr.preprocessReceptor();
+
+	fill_random(lig_grid.getGridArray(),rng);
+	Dk::GridArray lig_inp(lig_grid.getGridArray().copy());
+
+	Dk::IntPoint size_fft = corr.sizeFft();
+
+	PRODDL::Bench::Params params;
+	params["fftSizeX"] = size_fft(0);
+	params["fftSizeY"] = size_fft(1);
+	params["fftSizeZ"] = size_fft(2);
+
+	// correlate() transforms the ligand grid in place, so restore it before each call
+	runner.run(name,params,
+		[&]() { lig_grid.getGridArray() = lig_inp; },
+		[&]() { corr.correlate(); });
+
+}
+
+
+// Two correlated grids as used by the two-component ("ljComp") potential,
+// either with two inverse FFTs or with one FFT of the summed spectra
+
+void bench_correlate_pair(PRODDL::Bench::Runner& runner, int n, T_num grid_step, bool sum_spectra, Rng& rng) {
+
+	std::string name = bench_name(sum_spectra ? "correlatePairSum/fft" : "correlatePair/fft",n);
+
+	if( ! runner.enabled(name) ) {
+		return;
+	}
+
+	Dk::PointPair box;
+	box(0) = Dk::Point(0.);
+	box(1) = Dk::Point(n * grid_step);
+
+	Dk::FFTCorrelators corrs(box,grid_step,2,sum_spectra);
+
+	std::vector<Dk::GridArray> lig_inp;
+
+	for(int i = 0; i < corrs.size(); i++) {
+		fill_random(corrs.getGridsRec()(i)->getGridArray(),rng);
+		fill_random(corrs.getGridsLig()(i)->getGridArray(),rng);
+		lig_inp.push_back(corrs.getGridsLig()(i)->getGridArray().copy());
+	}
+
+	corrs.preprocessReceptor();
+
+	Dk::IntPoint size_fft = corrs.sizeFft();
+
+	PRODDL::Bench::Params params;
+	params["fftSizeX"] = size_fft(0);
+	params["fftSizeY"] = size_fft(1);
+	params["fftSizeZ"] = size_fft(2);
+
+	runner.run(name,params,
+		[&]() {
+			for(int i = 0; i < corrs.size(); i++) {
+				corrs.getGridsLig()(i)->getGridArray() = lig_inp[i];
+			}
+		},
+		[&]() { corrs.correlate(); });
+
+}
+
+
+void bench_project(PRODDL::Bench::Runner& runner, const Dk::Points& rec, int n_atoms, T_num grid_step) {
+
+	std::string name = bench_name("projectFields/atoms",n_atoms);
+
+	if( ! runner.enabled(name) ) {
+		return;
+	}
+
+	Dk::Points centers = tile_atoms(rec,n_atoms);
+
+	Dk::PointPair b = bounds(centers);
+
+	const T_num margin = 9.0 + 2 * grid_step;
+
+	Dk::Grid grid;
+	grid.init(b(0) - margin,b(1) + margin,Dk::Point(grid_step));
+
+	ProjectorLJ::RadialFields fields = lj_fields(n_atoms);
+
+	ProjectorLJ projector;
+	projector.init(grid,grid.minSpatialStep() / 4.);
+
+	PRODDL::Bench::Params params;
+	params["nAtoms"] = n_atoms;
+	params["gridPoints"] = grid.getGridArray().numElements();
+
+	runner.run(name,params,
+		[&]() { projector.projectFields(fields,centers); },
+		n_atoms);
+
+}
+
+
+// Receptor and ligand correlation over the FFT grid of the size used for
+// docking these two molecules, followed by the selection of the best
+// translations, as it is done for each rotation of the ligand.
+
+void bench_select(PRODDL::Bench::Runner& runner,
+	const Dk::Points& rec, const Dk::Points& lig, T_num grid_step) {
+
+	const std::string name_select = "selectFromFFT/2ptc", name_rot = "scanRotation/2ptc";
+
+	if( ! ( runner.enabled(name_select) || runner.enabled(name_rot) ) ) {
+		return;
+	}
+
+	const T_num cut_off_fft = 9.0;
+	const int max_n_trans_inp = 10000;
+	const T_num max_val_corr = -10.0;
+
+	Dk::Points rec_c = centered(rec), lig_c = centered(lig);
+
+	Dk::PointPair b_rec = bounds(rec_c), b_lig = bounds(lig_c);
+
+	Dk::Point size_box = b_rec(1) - b_rec(0) + b_lig(1) - b_lig(0) + 2 * cut_off_fft;
+
+	Dk::PointPair box;
+	box(0) = Dk::Point(0.);
+	box(1) = Dk::Point(std::max(size_box(0),std::max(size_box(1),size_box(2))));
+
+	Dk::FFTCorrelator corr(box,grid_step);
+
+	Dk::Grid& rec_grid = corr.getGrid(Dk::FFTCorrelator::iGridRec);
+	Dk::Grid& lig_grid = corr.getGrid(Dk::FFTCorrelator::iGridLig);
+
+	ProjectorLJ::RadialFields fields = lj_fields(rec_c.size());
+
+	ProjectorLJ projector;
+	projector.init(rec_grid,rec_grid.minSpatialStep() / 4.);
+	projector.projectFields(fields,rec_c);
+
+	corr.preprocessReceptor();
+
+	auto project_ligand = [&]() {
+		lig_grid = 0.;
+		for(int i = 0; i < lig_c.size(); i++) {
+			lig_grid(lig_c(i)) += 1;
+		}
+	};
+
+	project_ligand();
+	corr.correlate();
+
+	Dk::CorrelationProcessor proc;
+	proc.init(corr.getGrid(Dk::FFTCorrelator::iGridOut),max_n_trans_inp,max_val_corr);
+	proc.selectFromFFT();
+
+	Dk::IntPoint size_fft = corr.sizeFft();
+
+	PRODDL::Bench::Params params;
+	params["fftSizeX"] = size_fft(0);
+	params["fftSizeY"] = size_fft(1);
+	params["fftSizeZ"] = size_fft(2);
+	params["nSelected"] = proc.size();
+
+	runner.run(name_select,params,
+		[&]() { proc.selectFromFFT(); },
+		blitz::product(size_fft));
+
+	params["nAtomsRec"] = rec_c.size();
+	params["nAtomsLig"] = lig_c.size();
+
+	runner.run(name_rot,params,
+		[&]() {
+			project_ligand();
+			corr.correlate();
+			proc.selectFromFFT();
+		});
+
+}
+
+
+// Clusters of translations, similar to what the TranClust post-processing
+// gets from selectFromFFT()
+
+void bench_cluster(PRODDL::Bench::Runner& runner, int n, Rng& rng) {
+
+	std::string name = bench_name("cluster/n",n);
+
+	if( ! runner.enabled(name) ) {
+		return;
+	}
+
+	typedef PRODDL::ClusterMatrix<T_num,Dk::N_dim> ClusterTrans;
+
+	const int n_centers = std::max(1,n / 20);
+	const T_num rmsd_cutoff = 5.0;
+
+	std::uniform_real_distribution<T_num> dist_center(-40,40);
+	std::normal_distribution<T_num> dist_spread(0,3);
+	std::uniform_real_distribution<T_num> dist_weight(-50,-10);
+
+	ClusterTrans::Matrix m(n,int(Dk::N_dim));
+	ClusterTrans::Floats weights(n);
+
+	std::vector<Dk::Point> cluster_centers(n_centers);
+
+	for(int i = 0; i < n_centers; i++) {
+		for(int dim = 0; dim < Dk::N_dim; dim++) {
+			cluster_centers[i](dim) = dist_center(rng);
+		}
+	}
+
+	for(int i = 0; i < n; i++) {
+		for(int dim = 0; dim < Dk::N_dim; dim++) {
+			m(i,dim) = cluster_centers[i % n_centers](dim) + dist_spread(rng);
+		}
+		weights(i) = dist_weight(rng);
+	}
+
+	ClusterTrans clust;
+
+	clust.cluster(m,weights,rmsd_cutoff);
+
+	PRODDL::Bench::Params params;
+	params["n"] = n;
+	params["nClusters"] = clust.numClusters();
+
+	runner.run(name,params,
+		[&]() { clust.cluster(m,weights,rmsd_cutoff); },
+		n);
+
+}
+
+
+// Clustering of final poses by ligand RMSD: poses scattered around
+// a few binding modes, as the gather task gets them
+
+void bench_pose_cluster(PRODDL::Bench::Runner& runner, const Dk::Points& lig, int n, Rng& rng) {
+
+	std::string name = bench_name("poseCluster/n",n);
+
+	if( ! runner.enabled(name) ) {
+		return;
+	}
+
+	const int n_modes = std::max(1,n / 50);
+	const T_num rmsd_cutoff = 4.0;
+
+	std::uniform_real_distribution<T_num> dist_ang(0,2*3.14159);
+	std::uniform_real_distribution<T_num> dist_center(-40,40);
+	std::normal_distribution<T_num> dist_spread(0,1);
+	std::uniform_real_distribution<T_num> dist_value(-50,-10);
+
+	std::vector<Dk::RotTranValue> modes(n_modes);
+
+	for(int i = 0; i < n_modes; i++) {
+		modes[i].tran = Dk::RotationTranslation(Dk::Point(dist_ang(rng),dist_ang(rng),dist_ang(rng)),
+			Dk::Point(dist_center(rng),dist_center(rng),dist_center(rng)));
+	}
+
+	std::vector<Dk::RotTranValue> poses(n);
+
+	for(int i = 0; i < n; i++) {
+		Dk::Point ang, xyz;
+		modes[i % n_modes].tran.anglesAndDisplacement(ang,xyz);
+		for(int dim = 0; dim < Dk::N_dim; dim++) {
+			ang(dim) += 0.05*dist_spread(rng);
+			xyz(dim) += dist_spread(rng);
+		}
+		poses[i].tran = Dk::RotationTranslation(ang,xyz);
+		poses[i].value = dist_value(rng);
+	}
+
+	PRODDL::PoseClusterer<T_num> clusterer(lig);
+
+	clusterer.cluster(poses.begin(),n,rmsd_cutoff);
+
+	PRODDL::Bench::Params params;
+	params["n"] = n;
+	params["nClusters"] = clusterer.getClusters().size();
+
+	runner.run(name,params,
+		[&]() { clusterer.cluster(poses.begin(),n,rmsd_cutoff,0); },
+		n);
+
+}
+
+
+// Rigid transforms of the ligand for an ensemble of poses: one point at a
+// time (the old Points loop), with the AoS kernel, and with the blocked
+// SoA ensemble kernel
+
+void bench_rigid_transform(PRODDL::Bench::Runner& runner, const Dk::Points& lig, int n_poses, Rng& rng) {
+
+	typedef PRODDL::Geom::RigidKernel<T_num> Kernel;
+	typedef PRODDL::Geom::SoAPoints<T_num> SoAPoints;
+
+	const std::string name_point = bench_name("rigidTransform/point/poses",n_poses),
+		name_aos = bench_name("rigidTransform/aos/poses",n_poses),
+		name_soa = bench_name("rigidTransform/soaEnsemble/poses",n_poses);
+
+	if( ! ( runner.enabled(name_point) || runner.enabled(name_aos) || runner.enabled(name_soa) ) ) {
+		return;
+	}
+
+	std::uniform_real_distribution<T_num> dist_ang(0,2*3.14159);
+	std::uniform_real_distribution<T_num> dist_xyz(-40,40);
+
+	std::vector<Dk::RotationTranslation> poses(n_poses);
+	std::vector<Kernel> kernels(n_poses);
+
+	for(int i = 0; i < n_poses; i++) {
+		poses[i] = Dk::RotationTranslation(Dk::Point(dist_ang(rng),dist_ang(rng),dist_ang(rng)),
+			Dk::Point(dist_xyz(rng),dist_xyz(rng),dist_xyz(rng)));
+		kernels[i] = Kernel(poses[i].getTensor(),poses[i].getVector());
+	}
+
+	const int n_atoms = lig.size();
+
+	Dk::Points out(n_atoms);
+
+	SoAPoints lig_soa(lig);
+
+	// the consumer of the coordinates is a sum, so that the work is not optimized away
+	T_num sum = 0;
+
+	PRODDL::Bench::Params params;
+	params["nPoses"] = n_poses;
+	params["nAtoms"] = n_atoms;
+
+	runner.run(name_point,params,
+		[&]() {
+			for(int i = 0; i < n_poses; i++) {
+				for(int i_at = 0; i_at < n_atoms; i_at++) {
+					out(i_at) = poses[i](lig(i_at));
+				}
+				sum += out(0)(0);
+			}
+		},
+		n_poses * n_atoms);
+
+	runner.run(name_aos,params,
+		[&]() {
+			for(int i = 0; i < n_poses; i++) {
+				poses[i](lig,out);
+				sum += out(0)(0);
+			}
+		},
+		n_poses * n_atoms);
+
+	runner.run(name_soa,params,
+		[&]() {
+			Kernel::applyEnsemble(&kernels[0],n_poses,lig_soa,
+				[&](int i_tr, int begin, int n, const SoAPoints& block) {
+					sum += block.x()[0];
+				});
+		},
+		n_poses * n_atoms);
+
+	ATLOG_OUT_4(ATLOGVAR(sum));
+
+}
+
+
+// Force field parameters with a few atom types assigned round-robin
+
+Pot::ForceParAtoms force_par_atoms(const Dk::Points& points, int n_types, int n_ace_types) {
+
+	int n = points.size();
+
+	Pot::ForceParAtoms fpa;
+
+	fpa.m_pos.reference(points.copy());
+	fpa.m_mass.resize(n);
+	fpa.m_mass = 12.;
+	fpa.m_iType.resize(n);
+	fpa.m_aceType.resize(n);
+
+	for(int i = 0; i < n; i++) {
+		fpa.m_iType(i) = i % n_types;
+		fpa.m_aceType(i) = i % n_ace_types;
+	}
+
+	return fpa;
+
+}
+
+
+void bench_potential(PRODDL::Bench::Runner& runner,
+	const Dk::Points& rec, const Dk::Points& lig, Rng& rng) {
+
+	const std::string name_f = "potential/f/2ptc", name_g = "potential/g/2ptc",
+		name_search = "partPoints/search/2ptc";
+
+	if( ! ( runner.enabled(name_f) || runner.enabled(name_g) || runner.enabled(name_search) ) ) {
+		return;
+	}
+
+	const int n_types = 4, n_ace_types = 18;
+	const T_num cutoff = 9.0;
+
+	// the complex in the test data is in its native (bound) pose
+
+	Dk::Points both(rec.size() + lig.size());
+	both(blitz::Range(0,rec.size()-1)) = rec;
+	both(blitz::Range(rec.size(),blitz::toEnd)) = lig;
+
+	Dk::PointPair b = bounds(both);
+	b(0) -= cutoff;
+	b(1) += cutoff;
+
+	Pot::MolForceParams mf_params;
+
+	mf_params.fpAtoms.push_back(force_par_atoms(rec,n_types,n_ace_types));
+	mf_params.fpAtoms.push_back(force_par_atoms(lig,n_types,n_ace_types));
+
+	mf_params.nbTypes.sigma.resize(n_types);
+	mf_params.nbTypes.eps.resize(n_types);
+	mf_params.nbTypes.mix = Pot::LJ_MIX_0;
+
+	for(int i = 0; i < n_types; i++) {
+		mf_params.nbTypes.sigma(i) = 3.0 + 0.2 * i;
+		mf_params.nbTypes.eps(i) = 0.1 + 0.1 * i;
+	}
+
+	std::uniform_real_distribution<T_num> dist_ace(-0.5,0.5);
+
+	mf_params.m_aceMatr.resize(n_ace_types,n_ace_types);
+
+	for(int i = 0; i < n_ace_types; i++) {
+		for(int j = 0; j <= i; j++) {
+			mf_params.m_aceMatr(i,j) = mf_params.m_aceMatr(j,i) = dist_ace(rng);
+		}
+	}
+
+	PRODDL::Options options;
+	options.set("alpha",T_num(0.4));
+	options.set("cutoff",T_num(cutoff));
+
+	Pot::PotTotalNonBonded pot;
+	pot.init(rec,mf_params,b,options);
+
+	Dk::Points grad(lig.size());
+
+	Pot::PartPoints part_points;
+	part_points.init(b(0),b(1),cutoff);
+	part_points.insert(rec);
+
+	Pot::VIPair index_pairs;
+	Pot::fvect distance_p2;
+
+	part_points.search(lig,index_pairs,distance_p2);
+
+	PRODDL::Bench::Params params;
+	params["nAtomsRec"] = rec.size();
+	params["nAtomsLig"] = lig.size();
+	params["nPairs"] = distance_p2.size();
+
+	T_num f = 0;
+
+	runner.run(name_f,params,
+		[&]() { f += pot.f(lig); },
+		lig.size());
+
+	runner.run(name_g,params,
+		[&]() { pot.g(lig,grad); },
+		lig.size());
+
+	runner.run(name_search,params,
+		[&]() { part_points.search(lig,index_pairs,distance_p2); },
+		lig.size());
+
+	ATLOG_OUT_4(ATLOGVAR(f));
+
+}
+
+
+void bench_io(PRODDL::Bench::Runner& runner, const std::string& work_dir, Rng& rng) {
+
+	const std::string name_bin = "io/rotFftScanBin/read", name_rigid = "io/rigid/read";
+
+	const int n_rot = 10000, n_tran = 10, n_rigid = 100000;
+
+	std::uniform_real_distribution<T_num> dist_ang(0,2*M_PI), dist_xyz(-40,40);
+
+	if( runner.enabled(name_bin) ) {
+
+		std::string file_name = work_dir + "/bench_rot_scan.tmp.bin";
+
+		Dk::Rotation rot;
+		Dk::TranValues tran_vals(n_tran);
+
+		{
+			Dk::RotFftScanIO_Bin io(file_name,std::ios::out|std::ios::trunc);
+			for(int i_rot = 0; i_rot < n_rot; i_rot++) {
+				for(int i = 0; i < n_tran; i++) {
+					tran_vals(i).tran = Dk::Translation(dist_xyz(rng));
+					tran_vals(i).value = dist_xyz(rng);
+				}
+				io.write_record(rot,tran_vals);
+			}
+		}
+
+		PRODDL::Bench::Params params;
+		params["nRecords"] = n_rot;
+		params["nTransPerRecord"] = n_tran;
+
+		runner.run(name_bin,params,
+			[&]() {
+				Dk::RotFftScanIO_Bin io(file_name,std::ios::in);
+				int n = 0;
+				while( io.read_record(rot,tran_vals) ) {
+					n++;
+				}
+				ATALWAYS(n == n_rot,"Unexpected number of records read");
+			},
+			n_rot);
+
+		boost::filesystem::remove(file_name);
+
+	}
+
+	if( runner.enabled(name_rigid) ) {
+
+		std::string file_name = work_dir + "/bench_rigid.tmp.bin";
+
+		std::vector<Dk::RotTranValue> vals(n_rigid);
+
+		for(int i = 0; i < n_rigid; i++) {
+			Dk::Point ang, xyz;
+			for(int dim = 0; dim < Dk::N_dim; dim++) {
+				ang(dim) = dist_ang(rng);
+				xyz(dim) = dist_xyz(rng);
+			}
+			vals[i].tran = Dk::RotationTranslation(ang,xyz);
+			vals[i].value = dist_xyz(rng);
+		}
+
+		{
+			PRODDL::IORigid<T_num> io;
+			io.writeCoords(file_name,vals.begin(),n_rigid);
+		}
+
+		PRODDL::Bench::Params params;
+		params["nRecords"] = n_rigid;
+
+		runner.run(name_rigid,params,
+			[&]() {
+				PRODDL::IORigid<T_num> io;
+				int n = io.readCoords(file_name);
+				ATALWAYS(n == n_rigid,"Unexpected number of records read");
+				io.getCoords(0,n,vals.begin());
+			},
+			n_rigid);
+
+		boost::filesystem::remove(file_name);
+
+	}
+
+}
+
+
+// Returns the number of benchmarks that regressed relative to the baseline
+
+int process_arguments(const po::variables_map& vm) {
+
+	using namespace PRODDL;
+
+	Logger::setRunTimeLevel(vm["log-level"].as<int>());
+
+	Bench::Runner runner(vm["min-seconds"].as<double>(),
+		vm["min-reps"].as<int>(),
+		vm["max-reps"].as<int>(),
+		vm["filter"].as<std::string>());
+
+	const std::string test_data_dir = vm["test-data-dir"].as<std::string>();
+
+	const T_num grid_step = vm["grid-step"].as<double>();
+
+	Dk::Points rec = load_coords(test_data_dir + "/pdb/2ptc_E.pdb");
+	Dk::Points lig = load_coords(test_data_dir + "/pdb/2ptc_I.pdb");
+
+	Rng rng(20140127);
+
+	const int fft_sizes[] = { 64, 96, 128 };
+
+	for(int i = 0; i < int(sizeof(fft_sizes)/sizeof(fft_sizes[0])); i++) {
+		bench_correlate(runner,fft_sizes[i],grid_step,rng);
+	}
+
+	bench_correlate_pair(runner,96,grid_step,false,rng);
+	bench_correlate_pair(runner,96,grid_step,true,rng);
+
+	const int n_atoms[] = { 1000, 10000, 50000 };
+
+	for(int i = 0; i < int(sizeof(n_atoms)/sizeof(n_atoms[0])); i++) {
+		bench_project(runner,rec,n_atoms[i],grid_step);
+	}
+
+	bench_select(runner,rec,lig,grid_step);
+
+	bench_cluster(runner,2000,rng);
+	bench_cluster(runner,10000,rng);
+
+	bench_pose_cluster(runner,lig,100000,rng);
+
+	bench_rigid_transform(runner,lig,1000,rng);
+
+	bench_potential(runner,rec,lig,rng);
+
+	bench_io(runner,vm["work-dir"].as<std::string>(),rng);
+
+	if( vm.count("out") ) {
+		save_bench_results_to_json_file(runner.getResults(),vm["out"].as<std::string>());
+	}
+
+	int n_regressed = 0;
+
+	if( vm.count("baseline") ) {
+
+		Bench::Results baseline;
+
+		load_bench_results_from_json_file(vm["baseline"].as<std::string>(),baseline);
+
+		Bench::Comparisons comps = Bench::compare(runner.getResults(),baseline,vm["tolerance"].as<double>());
+
+		for(Bench::Comparisons::const_iterator p = comps.begin(); p != comps.end(); ++p) {
+			std::cout << (p->regressed ? "REGRESSED " : "ok        ") << p->name
+				<< " " << p->secMedian << " s (baseline " << p->secBaseline
+				<< " s, ratio " << p->ratio << ")\n";
+		}
+
+		n_regressed = Bench::countRegressed(comps);
+
+		std::cout << n_regressed << " of " << comps.size() << " benchmarks regressed\n";
+
+	}
+
+	return n_regressed;
+
+}
+
+} // namespace
+
+
+int main(int ac, char* av[]) {
+	PRODDL::Logger::init();
+	int n_regressed = 0;
+	ATLOG_STD_EXCEPTIONS_TRY();
+	po::variables_map vm;
+	int parse_status = parse_arguments(ac, av, vm);
+	if (!parse_status) {
+		return -1;
+	}
+	else {
+		if(vm.count("help")) {
+			return 0;
+		}
+	}
+	n_regressed = process_arguments(vm);
+	ATLOG_STD_EXCEPTIONS_CATCH();
+    return n_regressed > 0 ? 1 : 0;
+}
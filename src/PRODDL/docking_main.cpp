@@ -8,8 +8,10 @@
 //
 
 #include "PRODDL/Common/options_io_json.hpp"
+#include "PRODDL/Common/prof_io_json.hpp"
 #include "PRODDL/Common/argparse.hpp"
 #include "PRODDL/docking.hpp"
+#include "PRODDL/IO/pdb_models.hpp"
 
 #include "PRODDL/Common/g_options.hpp"
 #include "PRODDL/Common/logger.hpp"
@@ -17,7 +19,9 @@
 
 
 #include <iostream>
+#include <fstream>
 #include <iterator>
+#include <vector>
 
 namespace PRODDL {
 
@@ -57,12 +61,35 @@ int parse_arguments(int ac, char* av[], po::variables_map& vm)
             ("help", "produce help message")
             ("options", po::value<string>(), "file with options common for this run")
 			("molforce-params", po::value<string>(), "molforce parameters file")
-			("task", po::value<string>(), "type of task to perform")
+			("task", po::value<string>(), "type of task to perform: rot-scan, gather, dock "
+			 "(complete scan and export of models within this process), screen "
+			 "(dock each ligand of a multi-ligand molforce file to the same receptor) or estimate "
+			 "(time a few rotations to plan the split of the scan into rot-scan tasks)")
 			("fft-rot-grid-start", po::value<int>(), "start index in rot-grid")
 			("fft-rot-grid-end", po::value<int>(), "end index in rot-grid")
 			("fft-rot-scan-res", po::value<string>(), "output file of fft scan for one task")
 			("fft-rot-scan-list", po::value<string>(), "file with a list of fft rot scan tasks")
+			("fft-rot-scan-tail", po::value<string>(), "output file for the range of rotations that "
+			 "a rot-scan task split off and left unscanned (enables splitting on SIGUSR1 or after scanTimeLimit)")
+			("fft-rot-tail-list", po::value<string>(), "file with a list of rot-scan tail files to scan (gather task)")
 			("fft-res", po::value<string>(), "output file for entire fft scan")
+			("fft-res-clust", po::value<string>(), "output file with the clusters of the results "
+			 "by ligand RMSD (gather and dock tasks, see option poseClusterRmsd)")
+			("n-threads", po::value<int>(), "number of threads for the dock and gather tasks (0 - all cores)")
+			("pdb-inp-rec", po::value<string>(), "input PDB file with receptor (dock task)")
+			("pdb-inp-lig", po::value<string>(), "input PDB file with ligand (dock task)")
+			("model-out", po::value<string>(), "output multi-model PDB file (dock task)")
+			("n-models", po::value<int>()->default_value(10), "number of models to export (dock task)")
+			("fft-res-list", po::value<string>(), "file with the output file name for each ligand (screen task)")
+			("screen-lig-start", po::value<int>(), "start index in the ligand list (screen task)")
+			("screen-lig-end", po::value<int>(), "end index in the ligand list (screen task)")
+			("cost-out", po::value<string>(), "output JSON file with the cost estimate (estimate task)")
+			("bench-n-rot", po::value<int>()->default_value(4), "number of rotations to time (estimate task)")
+			("fft-measure-top", po::value<int>(), "measure the costs of this many best candidate FFT sizes "
+			 "missing from the fftCostTable file and add them to it (estimate task)")
+			("stats-out", po::value<string>(), "output JSON file with phase timers and counters of this task")
+			("stats-list", po::value<string>(), "file with a list of stats files of rot-scan tasks "
+			 "to merge into the stats of the gather task")
         ;
 
         po::store(po::parse_command_line(ac, av, desc), vm);
@@ -88,9 +115,153 @@ int parse_arguments(int ac, char* av[], po::variables_map& vm)
 }
 
 
+// Read non-empty lines of a text file
+
+std::vector<std::string> read_lines(const std::string& file_name) {
+
+	std::ifstream inp(file_name.c_str());
+
+	ATALWAYS( inp.good(), "Unable to open input file: " + file_name);
+
+	std::vector<std::string> lines;
+
+	std::string line;
+
+	while(std::getline(inp,line)) {
+		if( ! line.empty() ) {
+			lines.push_back(line);
+		}
+	}
+
+	return lines;
+
+}
+
+
+// Time the scan of a few rotations and write the cost estimate as JSON.
+// The cost of one rotation is proportional to the total size of the FFT
+// grids (costUnits), and 'secPerCostUnit' calibrates it for this machine.
+// With the FFT size planner enabled, the plan of the receptor box is also
+// written as the 'fftPlan' block, which the scan tasks take as an option, so
+// that they all work in the same frame of the molecules.
+
+void write_cost_estimate(
+	PRODDL::Docking<T_num>::Worker& app,
+	int n_rot,
+	const std::string& cost_out
+	) {
+	using namespace PRODDL;
+
+	double sec_per_rot = app.timeRotations(n_rot);
+
+	const Docking<T_num>::RotScanner& scanner = app.getScanner();
+
+	Docking<T_num>::IntPoint size_fft = scanner.sizeFft();
+
+	std::ofstream out(cost_out.c_str());
+
+	ATALWAYS( out.good(), "Unable to open output cost file: " + cost_out);
+
+	out.precision(8);
+
+	out << "{\n"
+		<< "  \"nRotGrid\": " << app.getNRotGrid() << ",\n"
+		<< "  \"sizeFft\": [" << size_fft(0) << ", " << size_fft(1) << ", " << size_fft(2) << "],\n"
+		<< "  \"nGrids\": " << scanner.nGrids() << ",\n"
+		<< "  \"nBoxClasses\": " << scanner.nBoxClasses() << ",\n"
+		<< "  \"costUnits\": " << scanner.costUnits() << ",\n"
+		<< "  \"secPerRot\": " << sec_per_rot << ",\n"
+		<< "  \"secPerCostUnit\": " << sec_per_rot / scanner.costUnits();
+
+	Docking<T_num>::FFTSizePlanner& size_planner = Docking<T_num>::FFTSizePlanner::instance();
+
+	if( size_planner.isEnabled() ) {
+		const Math::FFTShapePlan& plan = size_planner.getBoxPlan();
+		out << ",\n"
+			<< "  \"fftPlan\": {\"size0\": " << plan.size(0) << ", \"size1\": " << plan.size(1)
+			<< ", \"size2\": " << plan.size(2) << ", \"shift\": " << plan.shift << "}";
+	}
+
+	out << "\n}\n";
+
+	ATALWAYS( out.good(), "Error when writing cost file: " + cost_out);
+
+}
+
+
+// Write the first 'n_models' of 'results' (already in the original frame of
+// the input molecules) as a multi-model PDB file, the same way as
+// 'proddl-export --format-out pdb_nmr' does for the saved results.
+
+void export_models(
+	const PRODDL::Docking<T_num>::Foreman::ResultsContainerType& results,
+	int n_models,
+	const std::string& pdb_inp_rec,
+	const std::string& pdb_inp_lig,
+	const std::string& model_out
+	) {
+	using namespace PRODDL;
+
+	typedef Types<T_num>::Points Points;
+
+	std::vector<PDBPP::PDB> records_rec, records_lig;
+
+	Points coords_rec, coords_lig;
+
+	loadPdbAtoms<T_num>(pdb_inp_rec,records_rec,coords_rec);
+	loadPdbAtoms<T_num>(pdb_inp_lig,records_lig,coords_lig);
+
+	PdbModelWriter<T_num> writer(records_rec,records_lig,coords_lig);
+
+	int n_mod = std::max(0,std::min(n_models,int(results.size())));
+
+	std::vector<Types<T_num>::RotTranValue> models(results.begin(),results.begin()+n_mod);
+
+	std::ofstream m_out(model_out.c_str());
+
+	ATALWAYS( m_out.good(), "Unable to open output model file: " + model_out);
+
+	int n_threads;
+	gOptions.getdefault("nThreads",n_threads,0);
+
+	writer.writeModels(m_out,models,1,true,n_threads);
+
+}
+
+
+// Log the phase timers and counters of this task, merged with those of
+// the tasks listed in 'stats-list' (gather task), and save them into
+// 'stats-out' if given.
+
+void write_stats(const po::variables_map& vm, const PRODDL::Prof::TaskTimer& task_timer) {
+	using namespace PRODDL;
+	using namespace std;
+
+	Prof::Stats stats = task_timer.stop();
+
+	if(vm.count("stats-list")) {
+		std::vector<std::string> stats_files = read_lines(vm["stats-list"].as<string>());
+		for(size_t i = 0; i < stats_files.size(); i++) {
+			Prof::Stats stats_task;
+			load_prof_stats_from_json_file(stats_files[i],stats_task);
+			stats.merge(stats_task);
+		}
+	}
+
+	log_prof_stats(stats);
+
+	if(vm.count("stats-out")) {
+		save_prof_stats_to_json_file(stats,vm["stats-out"].as<string>());
+	}
+
+}
+
+
 void process_arguments(const po::variables_map& vm) {
 	using namespace PRODDL;
 	using namespace std;
+
+	Prof::TaskTimer task_timer;
 	
 	Options opt;
 	
@@ -104,10 +275,49 @@ void process_arguments(const po::variables_map& vm) {
 		set_option_from_arg<int>(vm,opt,"fft-rot-grid-start",true);
 		set_option_from_arg<int>(vm,opt,"fft-rot-grid-end",true);
 		set_option_from_arg<string>(vm,opt,"fft-rot-scan-res",true);
+		set_option_from_arg<string>(vm,opt,"fft-rot-scan-tail",false);
 	}
 	else if(task == "gather") {
 		set_option_from_arg<string>(vm,opt,"fft-rot-scan-list",true);
+		set_option_from_arg<string>(vm,opt,"fft-rot-tail-list",false);
 		set_option_from_arg<string>(vm,opt,"fft-res",true);
+		set_option_from_arg<string>(vm,opt,"fft-res-clust",false);
+		if(vm.count("n-threads")) {
+			opt.set("nThreads",vm["n-threads"].as<int>());
+		}
+	}
+	else if(task == "estimate") {
+		require_arg(vm,"cost-out");
+		// warm-up rotation followed by the timed ones
+		int start = vm.count("fft-rot-grid-start") ? vm["fft-rot-grid-start"].as<int>() : 0;
+		opt.set("fft_rot_grid_start",start);
+		opt.set("fft_rot_grid_end",start + vm["bench-n-rot"].as<int>() + 1);
+		if(vm.count("fft-measure-top")) {
+			opt.set("fftMeasureTop",vm["fft-measure-top"].as<int>());
+		}
+	}
+	else if(task == "dock") {
+		set_option_from_arg<int>(vm,opt,"fft-rot-grid-start",false);
+		set_option_from_arg<int>(vm,opt,"fft-rot-grid-end",false);
+		if(vm.count("n-threads")) {
+			opt.set("nThreads",vm["n-threads"].as<int>());
+		}
+		set_option_from_arg<string>(vm,opt,"fft-res",false);
+		set_option_from_arg<string>(vm,opt,"fft-res-clust",false);
+		if(vm.count("model-out")) {
+			require_arg(vm,"pdb-inp-rec");
+			require_arg(vm,"pdb-inp-lig");
+		}
+	}
+	else if(task == "screen") {
+		set_option_from_arg<int>(vm,opt,"fft-rot-grid-start",false);
+		set_option_from_arg<int>(vm,opt,"fft-rot-grid-end",false);
+		if(vm.count("n-threads")) {
+			opt.set("nThreads",vm["n-threads"].as<int>());
+		}
+		set_option_from_arg<string>(vm,opt,"fft-res-list",true);
+		set_option_from_arg<int>(vm,opt,"screen-lig-start",false);
+		set_option_from_arg<int>(vm,opt,"screen-lig-end",false);
 	}
 	else {
 		AT_THROW(po::invalid_option_value("Option 'task' has invalid value: " + task));
@@ -117,23 +327,69 @@ void process_arguments(const po::variables_map& vm) {
 
 	string molforce_params_file = vm["molforce-params"].as<string>();
 
+	if(task == "screen") {
+		std::vector<Docking<T_num>::MolForceParams> lig_mfp;
+		Docking<T_num>::load_from_hdf5(molforce_params_file,lig_mfp);
+		string res_list_file;
+		opt.get("fft_res_list",res_list_file);
+		Docking<T_num>::Screener app;
+		app.init(lig_mfp,read_lines(res_list_file));
+		app.run();
+		write_stats(vm,task_timer);
+		return;
+	}
+
 	Docking<T_num>::MolForceParams mfp;
 
 	Docking<T_num>::load_from_hdf5(molforce_params_file,mfp);
 
 	if(task == "gather") {
-		Docking<T_num>::Foreman app;
+		Docking<T_num>::Gatherer app;
 		app.init(mfp);
 		app.run();
 		string res_file;
 		opt.get("fft_res",res_file);
 		app.writeResults(res_file,'b');
+		if(opt.has_option("fft_res_clust")) {
+			string clust_file;
+			opt.get("fft_res_clust",clust_file);
+			app.writeClusters(clust_file);
+		}
 	}
 	else if(task == "rot-scan") {
 		Docking<T_num>::Worker app;
 		app.init(mfp);
 		app.run();
 	}
+	else if(task == "estimate") {
+		Docking<T_num>::Worker app;
+		app.init(mfp);
+		write_cost_estimate(app,vm["bench-n-rot"].as<int>(),vm["cost-out"].as<string>());
+	}
+	else if(task == "dock") {
+		Docking<T_num>::Docker app;
+		app.init(mfp);
+		app.run();
+		if(opt.has_option("fft_res")) {
+			string res_file;
+			opt.get("fft_res",res_file);
+			app.writeResults(res_file,'b');
+		}
+		if(opt.has_option("fft_res_clust")) {
+			string clust_file;
+			opt.get("fft_res_clust",clust_file);
+			app.writeClusters(clust_file);
+		}
+		if(vm.count("model-out")) {
+			export_models(app.getResults(),
+				vm["n-models"].as<int>(),
+				vm["pdb-inp-rec"].as<string>(),
+				vm["pdb-inp-lig"].as<string>(),
+				vm["model-out"].as<string>());
+		}
+	}
+
+	write_stats(vm,task_timer);
 }
 
 } // namespace
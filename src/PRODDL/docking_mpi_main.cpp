@@ -0,0 +1,271 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+
+// MPI version of the rotational scan: rank 0 is the foreman that hands out
+// chunks of rotations and collects the results into its queue as they
+// arrive, all other ranks are workers (each can use several threads).
+// Run as, for example:
+// mpirun -np 8 proddl-dock-fft-mpi --options scan_opt.json --molforce-params molforce.dat --fft-res res.dat
+
+#include "PRODDL/Common/options_io_json.hpp"
+#include "PRODDL/Common/prof_io_json.hpp"
+#include "PRODDL/Common/argparse.hpp"
+#include "PRODDL/docking.hpp"
+
+#include "PRODDL/Mpi/task_farm.hpp"
+#include "PRODDL/Mpi/mpi_logger.hpp"
+
+#include "PRODDL/Common/g_options.hpp"
+#include "PRODDL/Common/logger.hpp"
+
+#include <iostream>
+#include <iterator>
+#include <vector>
+#include <cstring>
+
+namespace PRODDL {
+
+  Options gOptions;
+
+} // namespace PRODDL
+
+namespace {
+
+namespace po = boost::program_options;
+
+typedef PRODDL_T_NUM T_num;
+
+typedef PRODDL::Docking<T_num> Dk;
+
+
+void
+  setGlobalOptions(const PRODDL::Options& options) {
+
+    int runTimeLogLevel = ATLOG_LEVEL;
+
+    options.getdefault("logLevel",runTimeLogLevel,ATLOG_LEVEL);
+
+	PRODDL::gOptions = options;
+
+	PRODDL::Logger::setRunTimeLevel(runTimeLogLevel);
+
+  }
+
+
+// Foreman rank. It does not scan anything, so it does not create the FFT scanners.
+
+class MpiForeman : public Dk::Docker {
+
+public:
+
+	void init(const Dk::MolForceParams& mfParams) {
+
+		Dk::Foreman::init(mfParams);
+
+		initRotations();
+
+	}
+
+	void run() {
+
+		using namespace PRODDL;
+
+		int mpiMinChunk;
+		gOptions.getdefault("mpiMinChunk",mpiMinChunk,1);
+
+		int mpiChunkDiv;
+		gOptions.getdefault("mpiChunkDiv",mpiChunkDiv,2);
+
+		Mpi::TaskFarmForeman farm(rotEnd - rotStart,mpiMinChunk,mpiChunkDiv);
+
+		ATLOG_OUT_1("Foreman: " << (rotEnd - rotStart) << " rotations for " << farm.getNWorkers() << " workers");
+
+		Dk::TranValues tranVals;
+
+		farm.run([&](int iTask, const char *data, int size) {
+
+			ATALWAYS(size % sizeof(Dk::TranValue) == 0,"Result size is not a multiple of TranValue size");
+
+			tranVals.resize(size / sizeof(Dk::TranValue));
+
+			if( size > 0 ) {
+				std::memcpy(tranVals.dataFirst(),data,size);
+			}
+
+			collectRotTranVals(rotGrid(rotStart + iTask),tranVals);
+
+		});
+
+		rtvalQueue.sort();
+
+	}
+
+};
+
+
+// Worker rank: scans the chunks of rotations it gets from the foreman with
+// all its threads, and sends back the translations found for each rotation.
+
+class MpiWorker : public Dk::Docker {
+
+public:
+
+	void run() {
+
+		using namespace PRODDL;
+
+		Mpi::TaskFarmWorker farm;
+
+		std::vector<Dk::TranValues> rotResults;
+
+		farm.run([&](int begin, int end) {
+
+			scanRotations(rotStart + begin,rotStart + end,rotResults);
+
+			for(int i_rot = 0; i_rot < end - begin; i_rot++) {
+
+				const Dk::TranValues& tranVals = rotResults[i_rot];
+
+				ATALWAYS(tranVals.size() == 0 || tranVals.isStorageContiguous(),"Need contiguous arrays to send");
+
+				farm.sendResult(begin + i_rot,
+					tranVals.size() > 0 ? tranVals.dataFirst() : 0,
+					int(tranVals.size()*sizeof(Dk::TranValue)));
+
+			}
+
+		});
+
+	}
+
+};
+
+
+int parse_arguments(int ac, char* av[], po::variables_map& vm)
+{
+	using namespace std;
+    try {
+
+        po::options_description desc("Options for MPI FFT scan");
+        desc.add_options()
+            ("help", "produce help message")
+            ("options", po::value<string>(), "file with options common for this run")
+			("molforce-params", po::value<string>(), "molforce parameters file")
+			("fft-rot-grid-start", po::value<int>(), "start index in rot-grid")
+			("fft-rot-grid-end", po::value<int>(), "end index in rot-grid")
+			("fft-res", po::value<string>(), "output file for entire fft scan")
+			("n-threads", po::value<int>(), "number of threads in each worker rank (0 - all cores)")
+        ;
+
+        po::store(po::parse_command_line(ac, av, desc), vm);
+
+        if (vm.count("help")) {
+            cout << desc << "\n";
+            return true;
+        }
+
+		po::notify(vm);
+
+    }
+    catch(exception& e) {
+        cerr << "error: " << e.what() << "\n";
+        return false;
+    }
+    catch(...) {
+        cerr << "Exception of unknown type when parsing arguments!\n";
+		return false;
+    }
+
+    return true;
+}
+
+
+void process_arguments(const po::variables_map& vm) {
+	using namespace PRODDL;
+	using namespace std;
+
+	Prof::TaskTimer task_timer;
+
+	Options opt;
+
+	if(vm.count("options")) {
+		load_options_from_json_file(vm["options"].as<string>(),opt);
+	}
+
+	set_option_from_arg<int>(vm,opt,"fft-rot-grid-start",false);
+	set_option_from_arg<int>(vm,opt,"fft-rot-grid-end",false);
+	set_option_from_arg<string>(vm,opt,"fft-res",true);
+	if(vm.count("n-threads")) {
+		opt.set("nThreads",vm["n-threads"].as<int>());
+	}
+
+	setGlobalOptions(opt);
+
+	string molforce_params_file = vm["molforce-params"].as<string>();
+
+	Dk::MolForceParams mfp;
+
+	Dk::load_from_hdf5(molforce_params_file,mfp);
+
+	int rank = 0, size = 1;
+
+	MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+	MPI_Comm_size(MPI_COMM_WORLD,&size);
+
+	string res_file;
+	opt.get("fft_res",res_file);
+
+	if(size == 1) {
+		// nobody to farm out to
+		Dk::Docker app;
+		app.init(mfp);
+		app.run();
+		app.writeResults(res_file,'b');
+	}
+	else if(rank == 0) {
+		MpiForeman app;
+		app.init(mfp);
+		app.run();
+		app.writeResults(res_file,'b');
+	}
+	else {
+		MpiWorker app;
+		app.init(mfp);
+		app.run();
+	}
+
+	// each rank logs its own
+	log_prof_stats(task_timer.stop());
+}
+
+} // namespace
+
+int main(int ac, char* av[]) {
+	MPI_Init(&ac,&av);
+	PRODDL::Logger::init();
+	PRODDL::MpiLogger::postInit();
+	try {
+		ATLOG_STD_EXCEPTIONS_TRY();
+		po::variables_map vm;
+		int parse_status = parse_arguments(ac, av, vm);
+		if (!parse_status) {
+			MPI_Abort(MPI_COMM_WORLD,1);
+		}
+		if(!vm.count("help")) {
+			process_arguments(vm);
+		}
+		ATLOG_STD_EXCEPTIONS_CATCH();
+	}
+	catch(...) {
+		// other ranks might be blocked waiting for this one
+		MPI_Abort(MPI_COMM_WORLD,1);
+	}
+	MPI_Finalize();
+    return 0;
+}
@@ -12,6 +12,12 @@
 #include "PRODDL/Common/argparse.hpp"
 #include "PRODDL/External/Pdb++/pdb++.hpp"
 #include "PRODDL/IO/rigid.hpp"
+#include "PRODDL/IO/pdb_models.hpp"
+#include "PRODDL/IO/pose_ensemble.hpp"
+#include "PRODDL/IO/pose_ensemble_hdf5.hpp"
+#include "PRODDL/IO/hdf5.hpp"
+#include "PRODDL/Geom/interface_contacts.hpp"
+#include "PRODDL/Geom/rigid_kernel.hpp"
 
 #include "PRODDL/Common/g_options.hpp"
 #include "PRODDL/Common/logger.hpp"
@@ -29,92 +35,120 @@
 
 #include <iostream>
 #include <iterator>
+#include <vector>
+#include <algorithm>
 
 namespace PRODDL {
 
     typedef PRODDL_T_NUM T_num;
 
-    void load_pdb_atoms(
-            std::string file_name,
-            std::vector<PDBPP::PDB>& records,
-            Types<T_num>::Points& coords
+    // Write models [model_ind_start,model_ind_end) from 'model_inp' as one
+    // multi-model PDB file 'model_out'.
+    // If 'rec_out' is empty, each model contains the receptor followed by the
+    // transformed ligand. Otherwise, models contain only the ligand, and the
+    // receptor is written once into 'rec_out'.
+
+    void export_pdb_nmr(
+            std::string model_inp,
+            int model_ind_start,
+            int model_ind_end,
+            std::string pdb_inp_rec,
+            std::string pdb_inp_lig,
+            std::string model_out,
+            std::string rec_out,
+            int n_threads
             ) {
 
+
         typedef Types<T_num> TypesT;
         typedef TypesT::Point Point;
         typedef TypesT::Points Points;
+        typedef IORigid<T_num> IORigidT; 
+        typedef PdbModelWriter<T_num> PdbModelWriterT;
 
-        records.clear();
+        std::vector<PDBPP::PDB> records_rec, records_lig;
 
-        std::ifstream file_in(file_name.c_str());
+        Points coords_rec, coords_lig;
 
-        ATALWAYS( file_in.good(),"Unable to open input pdb file: " + file_name);
+        loadPdbAtoms<T_num>(pdb_inp_rec,records_rec,coords_rec);
+        loadPdbAtoms<T_num>(pdb_inp_lig,records_lig,coords_lig);
 
-        PDBPP::PDB record;
+        PdbModelWriterT writer(records_rec,records_lig,coords_lig);
 
-        bool cont = true;
+        bool with_rec = rec_out.empty();
 
-        while (cont && file_in >> record) {
-            switch (record.type()) {
+        if( ! with_rec ) {
 
-                case PDBPP::PDB::ATOM:
-                    records.push_back(record);
-                    break;
+            std::ofstream r_out(rec_out.c_str());
 
-                case PDBPP::PDB::END:
-                    //allow for format extensions that add stuff after the END (e.g. Rosetta)
-                    cont = false;
-                    break;
-            }
-        }
+            ATALWAYS( r_out.good(), "Unable to open output receptor file: " + rec_out);
 
-        coords.resize(records.size());
+            r_out << writer.receptorText() << "END\n";
 
-        for(int i = 0; i < records.size(); i++) {
+            ATALWAYS( r_out.good(), "Error when writing output receptor file: " + rec_out);
 
-            const PDBPP::PDB& r = records[i];
+        }
 
-            Point& c = coords(i);
+        std::ofstream m_out(model_out.c_str());
+
+        ATALWAYS( m_out.good(), "Unable to open output model file: " + model_out);
 
-            c(0) = r.atom.xyz[0];
-            c(1) = r.atom.xyz[1];
-            c(2) = r.atom.xyz[2];
+        IORigidT inp_tr;
 
+        int n_mod_tot = inp_tr.readCoords(model_inp);
+
+        if (model_ind_end > n_mod_tot) {
+            model_ind_end = n_mod_tot;
         }
 
+        int n_mod = std::max(0,model_ind_end - model_ind_start);
+
+        std::vector<IORigidT::RotTranValue> tr_v(n_mod);
+
+        inp_tr.getCoords(model_ind_start,n_mod,tr_v.begin());
+
+        //@todo limit max model by field width
+        writer.writeModels(m_out,tr_v,1,with_rec,n_threads);
+
     }
 
-    void export_pdb_nmr(
+    // Write models [model_ind_start,model_ind_end) from 'model_inp' as a binary
+    // ensemble of ligand poses: the ligand records as topology, followed by
+    // score, transformation and transformed coordinates of every pose.
+    // PoseWriter is PoseEnsembleWriter or PoseEnsembleHdf5Writer.
+    // Poses are transformed in batches with RigidKernel::applyEnsemble(), which
+    // reads each block of ligand atoms once for all poses of the batch.
+
+    template<class PoseWriter>
+    void export_pose_ensemble(
             std::string model_inp,
             int model_ind_start,
             int model_ind_end,
-            std::string pdb_inp_rec,
             std::string pdb_inp_lig,
             std::string model_out
             ) {
 
-
         typedef Types<T_num> TypesT;
-        typedef TypesT::Point Point;
         typedef TypesT::Points Points;
         typedef IORigid<T_num> IORigidT; 
+        typedef Geom::RigidKernel<T_num> RigidKernelT;
+        typedef Geom::SoAPoints<T_num> SoAPointsT;
 
-        std::vector<PDBPP::PDB> records_rec, records_lig;
-
-        Points coords_rec, coords_lig;
+        // transformed coordinates of a batch take n_batch*n_atoms*3 numbers
+        const int n_batch = 64;
 
-        load_pdb_atoms(pdb_inp_rec,records_rec,coords_rec);
-        load_pdb_atoms(pdb_inp_lig,records_lig,coords_lig);
+        std::vector<PDBPP::PDB> records_lig;
 
-        std::ofstream m_out(model_out.c_str());
+        Points coords_lig;
 
-        ATALWAYS( m_out.good(), "Unable to open output model file: " + model_out);
+        loadPdbAtoms<T_num>(pdb_inp_lig,records_lig,coords_lig);
 
-        PDBPP::PDB rec_mod(PDBPP::PDB::MODEL);
-        PDBPP::PDB rec_endmdl(PDBPP::PDB::ENDMDL);
-        PDBPP::PDB rec_ter(PDBPP::PDB::TER);
+        std::string topology;
 
-        PDBPP::PDB rec_out;
+        for(int i_rec = 0; i_rec < records_lig.size(); i_rec++) {
+            topology += records_lig[i_rec].chars();
+            topology += '\n';
+        }
 
         IORigidT inp_tr;
 
@@ -124,58 +158,155 @@ namespace PRODDL {
             model_ind_end = n_mod_tot;
         }
 
-        IORigidT::RotTranValue tr_v;
+        int n_mod = std::max(0,model_ind_end - model_ind_start);
+
+        std::vector<IORigidT::RotTranValue> tr_v(n_mod);
+
+        inp_tr.getCoords(model_ind_start,n_mod,tr_v.begin());
+
+        int n_atoms = coords_lig.rows();
+
+        Points coords_out(n_atoms);
 
-        for(int i_mod = model_ind_start; i_mod < model_ind_end; i_mod++) {
+        SoAPointsT soa_lig(coords_lig);
 
-            //@todo limit max model by field width
-            rec_mod.model.num = i_mod - model_ind_start + 1;
+        std::vector<RigidKernelT> kernels(n_batch);
 
-            m_out << rec_mod;
+        std::vector<SoAPointsT> soa_out(n_batch);
 
-            for(int i_rec = 0; i_rec < records_rec.size(); i_rec++) {
-                m_out << records_rec[i_rec];
+        PoseWriter writer;
+
+        writer.open(model_out,topology,n_atoms,n_mod);
+
+        for(int batch_start = 0; batch_start < n_mod; batch_start += n_batch) {
+
+            int n_tr = std::min(n_batch,n_mod - batch_start);
+
+            for(int i_tr = 0; i_tr < n_tr; i_tr++) {
+                const IORigidT::RotTranValue& x = tr_v[batch_start + i_tr];
+                kernels[i_tr].set(x.tran.getTensor(),x.tran.getVector());
             }
 
+            RigidKernelT::applyEnsemble(&kernels[0],n_tr,soa_lig,&soa_out[0]);
+
+            for(int i_tr = 0; i_tr < n_tr; i_tr++) {
+
+                const IORigidT::RotTranValue& x = tr_v[batch_start + i_tr];
+
+                soa_out[i_tr].copyTo(coords_out);
+
+                writer.writeFrame(x.value,x.tran,coords_out);
 
-            if(records_rec.size()) {
-                int rec_size = records_rec.size();
-                rec_ter.ter.serialNum = records_rec[rec_size-1].atom.serialNum;
-                rec_ter.ter.residue = records_rec[rec_size-1].atom.residue;
-                m_out << rec_ter;
             }
 
-            inp_tr.getCoords(i_mod,1,&tr_v);
+        }
 
-            Points coords_out(coords_lig.copy());
+        writer.close();
 
-            tr_v.tran(coords_out);
+    }
 
-            for(int i_rec = 0; i_rec < records_lig.size(); i_rec++) {
+    // Write residue-residue contacts between the receptor and the ligand
+    // for models [model_ind_start,model_ind_end) from 'model_inp' into the
+    // HDF5 file 'model_out' (see Geom/interface_contacts.hpp):
+    //   /offsets - int[n_mod+1], contacts of model i are rows [offsets[i],offsets[i+1]) of /pairs
+    //   /pairs - int[n_pairs][2], receptor and ligand residue index
+    //   /rec_mask, /lig_mask - uint64[n_mod][n_words], bitsets of interface residues
+    //   /rec_res_atom, /lig_res_atom - int[n_res], index of the first ATOM record of each residue
+    // Residues are numbered from 0 in the order of the PDB files. Datasets get
+    // at least one row, the actual sizes are in the nModels and nPairs attributes.
+
+    void export_contacts(
+            std::string model_inp,
+            int model_ind_start,
+            int model_ind_end,
+            std::string pdb_inp_rec,
+            std::string pdb_inp_lig,
+            std::string model_out,
+            double cutoff,
+            int min_contacts,
+            int n_threads
+            ) {
+
+        typedef Types<T_num> TypesT;
+        typedef TypesT::Points Points;
+        typedef TypesT::Ints Ints;
+        typedef IORigid<T_num> IORigidT; 
+        typedef InterfaceContacts<T_num> InterfaceContactsT;
+        typedef InterfaceContactsT::Word Word;
 
-                rec_out = records_lig[i_rec]; // a copy
+        std::vector<PDBPP::PDB> records_rec, records_lig;
 
-                const Point& c = coords_out(i_rec);
+        Points coords_rec, coords_lig;
 
-                rec_out.atom.xyz[0] = c(0);
-                rec_out.atom.xyz[1] = c(1);
-                rec_out.atom.xyz[2] = c(2);
+        loadPdbAtoms<T_num>(pdb_inp_rec,records_rec,coords_rec);
+        loadPdbAtoms<T_num>(pdb_inp_lig,records_lig,coords_lig);
 
-                m_out << rec_out;
+        Ints res_rec, res_lig;
 
-            }
+        int n_res_rec = pdbResidueIndex(records_rec,res_rec);
+        int n_res_lig = pdbResidueIndex(records_lig,res_lig);
 
-            if(records_lig.size()) {
-                int rec_size = records_lig.size();
-                rec_ter.ter.serialNum = records_lig[rec_size-1].atom.serialNum;
-                rec_ter.ter.residue = records_lig[rec_size-1].atom.residue;
-                m_out << rec_ter;
-            }
+        InterfaceContactsT contacts(coords_rec,res_rec,coords_lig,res_lig,T_num(cutoff),min_contacts);
 
-            m_out << rec_endmdl;
+        IORigidT inp_tr;
+
+        int n_mod_tot = inp_tr.readCoords(model_inp);
 
+        if (model_ind_end > n_mod_tot) {
+            model_ind_end = n_mod_tot;
         }
 
+        int n_mod = std::max(0,model_ind_end - model_ind_start);
+
+        std::vector<IORigidT::RotTranValue> tr_v(n_mod);
+
+        inp_tr.getCoords(model_ind_start,n_mod,tr_v.begin());
+
+        InterfaceContactsT::Result res;
+
+        contacts.compute(tr_v.begin(),n_mod,res,n_threads);
+
+        int n_pairs = res.offsets[n_mod];
+
+        blitz::Array<int,1> offsets(&res.offsets[0],blitz::shape(n_mod+1),blitz::neverDeleteData);
+
+        blitz::Array<int,2> pairs(std::max(n_pairs,1),2);
+        pairs = 0;
+        for(int i = 0; i < n_pairs; i++) {
+            pairs(i,0) = res.recGroup[i];
+            pairs(i,1) = res.ligGroup[i];
+        }
+
+        blitz::Array<Word,2> rec_mask(std::max(n_mod,1),res.nRecWords), lig_mask(std::max(n_mod,1),res.nLigWords);
+        rec_mask = 0;
+        lig_mask = 0;
+        std::copy(res.recMask.begin(),res.recMask.end(),rec_mask.dataFirst());
+        std::copy(res.ligMask.begin(),res.ligMask.end(),lig_mask.dataFirst());
+
+        blitz::Array<int,1> rec_res_atom(n_res_rec), lig_res_atom(n_res_lig);
+        for(int i = res_rec.size() - 1; i >= 0; i--) {
+            rec_res_atom(res_rec(i)) = i;
+        }
+        for(int i = res_lig.size() - 1; i >= 0; i--) {
+            lig_res_atom(res_lig(i)) = i;
+        }
+
+        Hdf5::HDF5File out(model_out,Hdf5::HDF5File::trunc);
+
+        out.setAttribute("/","nModels",n_mod);
+        out.setAttribute("/","nPairs",n_pairs);
+        out.setAttribute("/","cutoff",cutoff);
+        out.setAttribute("/","minContacts",contacts.getMinContacts());
+
+        out.setArray("offsets",offsets);
+        out.setArray("pairs",pairs);
+        out.setArray("rec_mask",rec_mask);
+        out.setArray("lig_mask",lig_mask);
+        out.setArray("rec_res_atom",rec_res_atom);
+        out.setArray("lig_res_atom",lig_res_atom);
+
+        ATLOG_OUT_2("Wrote " << n_pairs << " residue contacts of " << n_mod << " models into " << model_out);
+
     }
 
 } // namespace PRODDL
@@ -221,8 +352,16 @@ namespace {
                 ("model-ind-end", po::value<int>(), "end index in model list")
                 ("pdb-inp-rec", po::value<string>(), "input PDB file with receptor")
                 ("pdb-inp-lig", po::value<string>(), "input PDB file with ligand")
-                ("format-out", po::value<string>(), "output format for models")
+                ("format-out", po::value<string>(), "output format for models: "
+                 "pdb_nmr (multi-model PDB), pose_bin (binary pose stream), pose_hdf5 (HDF5 pose ensemble) "
+                 "or contacts_hdf5 (receptor-ligand residue contacts of each model)")
                 ("model-out", po::value<string>(), "output file for models")
+                ("rec-out", po::value<string>(), "if given, write models with the ligand only, "
+                 "and write the receptor once into this file")
+                ("n-threads", po::value<int>()->default_value(1), "number of threads for formatting models (0 - all cores)")
+                ("contact-cutoff", po::value<double>()->default_value(4.5), "atom-atom distance cutoff for contacts_hdf5")
+                ("min-contacts", po::value<int>()->default_value(1), "minimum number of atom-atom contacts "
+                 "between two residues in contact for contacts_hdf5")
                 ;
 
             po::store(po::parse_command_line(ac, av, desc), vm);
@@ -269,9 +408,42 @@ namespace {
                     vm["model-ind-end"].as<int>(),
                     vm["pdb-inp-rec"].as<string>(),
                     vm["pdb-inp-lig"].as<string>(),
+                    vm["model-out"].as<string>(),
+                    vm.count("rec-out") ? vm["rec-out"].as<string>() : string(),
+                    vm["n-threads"].as<int>()
+                    );
+        }
+        else if(format_out == "pose_bin") {
+            export_pose_ensemble<PoseEnsembleWriter<T_num> >(
+                    vm["model-inp"].as<string>(),
+                    vm["model-ind-start"].as<int>(),
+                    vm["model-ind-end"].as<int>(),
+                    vm["pdb-inp-lig"].as<string>(),
+                    vm["model-out"].as<string>()
+                    );
+        }
+        else if(format_out == "pose_hdf5") {
+            export_pose_ensemble<PoseEnsembleHdf5Writer<T_num> >(
+                    vm["model-inp"].as<string>(),
+                    vm["model-ind-start"].as<int>(),
+                    vm["model-ind-end"].as<int>(),
+                    vm["pdb-inp-lig"].as<string>(),
                     vm["model-out"].as<string>()
                     );
         }
+        else if(format_out == "contacts_hdf5") {
+            export_contacts(
+                    vm["model-inp"].as<string>(),
+                    vm["model-ind-start"].as<int>(),
+                    vm["model-ind-end"].as<int>(),
+                    vm["pdb-inp-rec"].as<string>(),
+                    vm["pdb-inp-lig"].as<string>(),
+                    vm["model-out"].as<string>(),
+                    vm["contact-cutoff"].as<double>(),
+                    vm["min-contacts"].as<int>(),
+                    vm["n-threads"].as<int>()
+                    );
+        }
         else {
             AT_THROW(po::invalid_option_value("Option 'format-out' has invalid value: " + format_out));
         }
@@ -0,0 +1,156 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+// Write the molforce file (force field parameters of the receptor and the
+// ligand atoms) from PDB files, see IO/molforce_prep.hpp.
+
+#include "PRODDL/types.hpp"
+#include "PRODDL/Common/options_io_json.hpp"
+#include "PRODDL/IO/molforce_prep.hpp"
+
+#include "PRODDL/Common/g_options.hpp"
+#include "PRODDL/Common/logger.hpp"
+
+#include <boost/program_options.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace PRODDL {
+
+    Options gOptions;
+
+} // namespace PRODDL
+
+namespace {
+
+    namespace po = boost::program_options;
+
+    typedef PRODDL_T_NUM T_num;
+
+    int parse_arguments(int ac, char* av[], po::variables_map& vm)
+    {
+        using namespace std;
+        try {
+
+            po::options_description desc("Options for writing the molforce file");
+            desc.add_options()
+                ("help", "produce help message")
+                ("options", po::value<string>(), "docking config file (the 'alpha' value is taken from its 'scan' block, "
+                 "or from the top level of a scan options file)")
+                ("pdb", po::value<vector<string> >()->composing(), "input PDB file, one per molecule in the order "
+                 "of the molecules in the output (receptor first)")
+                ("pdb-list", po::value<string>(), "text file with more input PDB files, one per line, "
+                 "that follow those given by --pdb (ligands for screening)")
+                ("alpha", po::value<double>(), "soft core alpha parameter of every atom, overrides --options")
+                ("out", po::value<string>()->required(), "output molforce file")
+                ("log-level", po::value<int>()->default_value(ATLOG_LEVEL), "run-time log level")
+                ;
+
+            po::positional_options_description pos;
+            pos.add("pdb",-1);
+
+            po::store(po::command_line_parser(ac, av).options(desc).positional(pos).run(), vm);
+
+            if (vm.count("help")) {
+                cout << desc << "\n";
+                return true;
+            }
+
+            po::notify(vm);
+
+        }
+        catch(exception& e) {
+            cerr << "error: " << e.what() << "\n";
+            return false;
+        }
+        catch(...) {
+            cerr << "Exception of unknown type when parsing arguments!\n";
+            return false;
+        }
+
+        return true;
+    }
+
+
+    void process_arguments(const po::variables_map& vm) {
+        using namespace PRODDL;
+        using namespace std;
+
+        Logger::setRunTimeLevel(vm["log-level"].as<int>());
+
+        double alpha = 0.4;
+
+        if(vm.count("options")) {
+            Options opt;
+            load_options_from_json_file(vm["options"].as<string>(),opt);
+            const Options& opt_scan = opt.has_block("scan") ? opt.getBlock("scan") : opt;
+            opt_scan.getdefault("alpha",alpha,alpha);
+        }
+
+        if(vm.count("alpha")) {
+            alpha = vm["alpha"].as<double>();
+        }
+
+        vector<string> pdb_files;
+
+        if(vm.count("pdb")) {
+            pdb_files = vm["pdb"].as<vector<string> >();
+        }
+
+        if(vm.count("pdb-list")) {
+            string list_file = vm["pdb-list"].as<string>();
+            ifstream list_in(list_file.c_str());
+            ATALWAYS(list_in.good(),"Unable to open PDB list file: " + list_file);
+            string line;
+            while(getline(list_in,line)) {
+                if(!line.empty()) {
+                    pdb_files.push_back(line);
+                }
+            }
+        }
+
+        ATALWAYS(pdb_files.size() >= 2,"At least two PDB files (receptor and ligand) are needed");
+
+        MolForcePrep<T_num> prep(alpha);
+
+        for(size_t i = 0; i < pdb_files.size(); i++) {
+            int n = prep.addPdbFile(pdb_files[i]);
+            ATLOG_OUT_2("Molecule " << i << ": " << n << " atoms from " << pdb_files[i]);
+        }
+
+        if(prep.numSkipped() > 0 || prep.numByElement() > 0) {
+            ATLOG_OUT_1("Skipped " << prep.numSkipped() << " atoms not in the residue topology, typed "
+                    << prep.numByElement() << " atoms of non-standard residues by element");
+        }
+
+        prep.write(vm["out"].as<string>());
+
+    }
+
+} // namespace
+
+int main(int ac, char* av[]) {
+    PRODDL::Logger::init();
+    ATLOG_STD_EXCEPTIONS_TRY();
+    po::variables_map vm;
+    int parse_status = parse_arguments(ac, av, vm);
+    if (!parse_status) {
+        return -1;
+    }
+    else {
+        if(vm.count("help")) {
+            return 0;
+        }
+    }
+    process_arguments(vm);
+    ATLOG_STD_EXCEPTIONS_CATCH();
+    return 0;
+}
@@ -0,0 +1,168 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+// Test that the "ljComp" potential (MolForceLJCompSum, one inverse FFT of
+// the summed spectra) gives the same total correlation as "ljCompTree"
+// (MolForceLJComp, one inverse FFT per component)
+
+#include <blitz/array.h>
+#include "PRODDL/docking.hpp"
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace PRODDL {
+
+	// read by the LJ components and by FFTSizePlanner
+
+	Options gOptions;
+
+} // namespace PRODDL
+
+using namespace PRODDL;
+using namespace std;
+
+typedef double T_num;
+typedef Docking<T_num> D;
+
+const T_num gridStep = 1.;
+
+const int nAtomsRec = 40;
+
+const int nAtomsLig = 8;
+
+class DockMolForceTest : public ::testing::Test {
+
+protected:
+
+	D::PointPair box;
+
+	D::MolForceParams params;
+
+public:
+
+	virtual void SetUp() {
+
+		gOptions.clear();
+		gOptions.set("cutOffFft",T_num(10.));
+
+		box(0) = D::Point(-16.,-14.,-15.);
+		box(1) = D::Point(16.,14.,15.);
+
+		int nAtoms[D::N_mol] = { nAtomsRec, nAtomsLig };
+		T_num radius[D::N_mol] = { 8., 3. };
+
+		for(int i_mol = 0; i_mol < D::N_mol; i_mol++) {
+			int n = nAtoms[i_mol];
+			params.pos(i_mol).resize(n);
+			params.mass(i_mol).resize(n);
+			params.alpha(i_mol).resize(n);
+			params.eps(i_mol).resize(n);
+			params.sigma(i_mol).resize(n);
+			for(int i = 0; i < n; i++) {
+				T_num t = 0.7*i + 0.3*i_mol;
+				params.pos(i_mol)(i) = D::Point(std::sin(1.3*t),std::cos(2.1*t),std::sin(0.9*t + 0.5))*radius[i_mol];
+				params.mass(i_mol)(i) = 12.;
+				params.alpha(i_mol)(i) = 0.5 + 0.1*(i % 3);
+				params.eps(i_mol)(i) = 0.1 + 0.05*(i % 4);
+				params.sigma(i_mol)(i) = 3.2 + 0.2*(i % 5);
+			}
+		}
+
+		params.mix = D::PotentialsT::LJ_MIX_1;
+
+	}
+
+	// Project the ligand at 'shift' from its input position and correlate
+	// it with the receptor already in 'corr'
+
+	void correlateLigand(D::MolForce& mf, D::FFTCorrelators& corr, const D::Point& shift) {
+		D::Points lig(params.pos(D::iLig).size());
+		for(int i = 0; i < lig.size(); i++) {
+			lig(i) = params.pos(D::iLig)(i) + shift;
+		}
+		mf.projectMol(D::iLig,lig,corr.getGridsLig());
+		corr.correlate();
+		if( ! corr.sumsSpectra() ) {
+			mf.collectTotal(corr.getGridsOut(),corr.getGridTot());
+		}
+	}
+
+	void prepareReceptor(D::MolForce& mf, D::FFTCorrelators& corr) {
+		mf.projectMol(D::iRec,params.pos(D::iRec),corr.getGridsRec());
+		corr.preprocessReceptor();
+	}
+
+	// Largest difference of the total grids relative to the largest
+	// absolute value, over the logical shape (without the FFT padding)
+
+	static T_num relDiff(D::FFTCorrelators& corr1, D::FFTCorrelators& corr2) {
+		D::Grid& grid1 = *corr1.getGridTot();
+		D::Grid& grid2 = *corr2.getGridTot();
+		D::IntPoint shape = grid1.getLogicalShape();
+		EXPECT_TRUE(blitz::all(shape == grid2.getLogicalShape()));
+		const D::GridArray& arr1 = grid1.getGridArray();
+		const D::GridArray& arr2 = grid2.getGridArray();
+		T_num maxAbs = 1., maxDiff = 0.;
+		for(int i = 0; i < shape(0); i++) for(int j = 0; j < shape(1); j++) for(int k = 0; k < shape(2); k++) {
+			D::IntPoint ind(i,j,k);
+			maxAbs = std::max(maxAbs,T_num(std::abs(arr1(ind))));
+			maxDiff = std::max(maxDiff,T_num(std::abs(arr1(ind) - arr2(ind))));
+		}
+		return maxDiff/maxAbs;
+	}
+
+};
+
+TEST_F(DockMolForceTest, SumSameAsTree) {
+
+	D::MolForceLJCompSum mfSum(params);
+	D::MolForceLJComp mfTree(params);
+
+	ASSERT_EQ(mfTree.nGrids(),mfSum.nGrids());
+	ASSERT_TRUE(mfSum.isSpectralSum());
+	ASSERT_FALSE(mfTree.isSpectralSum());
+
+	D::FFTCorrelators corrSum(box,gridStep,mfSum.nGrids(),mfSum.isSpectralSum());
+	D::FFTCorrelators corrTree(box,gridStep,mfTree.nGrids(),mfTree.isSpectralSum());
+
+	prepareReceptor(mfSum,corrSum);
+	prepareReceptor(mfTree,corrTree);
+
+	correlateLigand(mfSum,corrSum,D::Point(0.));
+	correlateLigand(mfTree,corrTree,D::Point(0.));
+
+	EXPECT_LT(relDiff(corrSum,corrTree),1e-9);
+
+	// the next ligand position reuses the receptor spectra
+
+	D::Point shift(2.,-1.,0.5);
+
+	correlateLigand(mfSum,corrSum,shift);
+	correlateLigand(mfTree,corrTree,shift);
+
+	EXPECT_LT(relDiff(corrSum,corrTree),1e-9);
+
+	// receptor spectra copied into other correlators, as the scanner
+	// threads do, give the same grids
+
+	D::FFTCorrelators copySum(box,gridStep,mfSum.nGrids(),mfSum.isSpectralSum());
+	D::FFTCorrelators copyTree(box,gridStep,mfTree.nGrids(),mfTree.isSpectralSum());
+
+	copySum.copyReceptor(corrSum);
+	copyTree.copyReceptor(corrTree);
+
+	correlateLigand(mfSum,copySum,shift);
+	correlateLigand(mfTree,copyTree,shift);
+
+	EXPECT_LT(relDiff(copySum,copyTree),1e-9);
+	EXPECT_LT(relDiff(copySum,corrSum),1e-12);
+	EXPECT_LT(relDiff(copyTree,corrTree),1e-12);
+
+}
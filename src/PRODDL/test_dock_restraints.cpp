@@ -0,0 +1,194 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+// Test restraints applied by CorrelationProcessor::selectFromFFT()
+
+#include <blitz/array.h>
+#include "PRODDL/docking.hpp"
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+
+using namespace PRODDL;
+using namespace std;
+
+typedef double T_num;
+typedef Docking<T_num> D;
+
+const int nGrid = 16;
+
+const int maxInpN = 30;
+
+class DockRestraintsTest : public ::testing::Test {
+
+protected:
+
+	D::Grid grid;
+
+	D::Points rec, lig;
+
+	const char *fileName;
+
+public:
+
+	DockRestraintsTest():
+		fileName("dock_restraints.tmp.txt")
+	{}
+
+	virtual void SetUp() {
+
+		grid.init(D::Point(1.),D::IntPoint(nGrid));
+
+		// the best (lowest) correlation values are at the largest displacements
+
+		Math::WrappedIndex<T_num,D::N_dim> wrappedIndex(D::IntPoint(nGrid));
+
+		D::GridArray& arr = grid.getGridArray();
+
+		for(D::IntPoint ind = wrappedIndex.before_first(); wrappedIndex.next(ind); ) {
+			D::IntPoint n = wrappedIndex.unwrap(ind);
+			arr(ind) = -1. - std::sqrt(T_num(blitz::dot(n,n)));
+		}
+
+		// receptor atom 1 and ligand atom 0 are 3 A apart along X when the
+		// ligand is not translated
+
+		rec.resize(2);
+		rec(0) = D::Point(-5.,0.,0.);
+		rec(1) = D::Point(3.,0.,0.);
+
+		lig.resize(2);
+		lig(0) = D::Point(0.);
+		lig(1) = D::Point(0.,4.,0.);
+
+		ofstream out(fileName);
+		out << "# distance receptor : ligand\n";
+		out << "\n";
+		out << "2.5 1 : 0 # from a crosslink\n";
+
+	}
+
+	virtual void TearDown() {
+		std::remove(fileName);
+	}
+
+	// translations of the last selection
+
+	std::vector<D::Point> selected(D::CorrelationProcessor& proc) {
+		std::vector<D::Point> x;
+		D::TranValues tv = proc.getTranValuesFilled(maxInpN);
+		for(int i = 0; i < tv.size(); i++) {
+			x.push_back(tv(i).tran.getVector());
+		}
+		return x;
+	}
+
+};
+
+TEST_F(DockRestraintsTest, Mask) {
+
+	D::TranRestraints restraints;
+	restraints.load(fileName,-1,0.);
+	restraints.setMolecules(rec,lig.size());
+
+	ASSERT_EQ(1,restraints.size());
+	ASSERT_EQ(1,restraints.minSatisfied());
+
+	D::CorrelationProcessor proc;
+	proc.init(grid,maxInpN,0.);
+
+	proc.selectFromFFT();
+
+	// without the restraints, the queue is filled with the far translations
+	ASSERT_EQ(maxInpN,proc.size());
+	std::vector<D::Point> x = selected(proc);
+	for(size_t i = 0; i < x.size(); i++) {
+		EXPECT_GT(blitz::dot(x[i],x[i]),16.);
+	}
+
+	proc.setRestraints(restraints,lig);
+	proc.selectFromFFT();
+
+	// grid points within 2.5 A of (3,0,0)
+	int nExpected = 0;
+	for(int i = -3; i <= 3; i++) for(int j = -3; j <= 3; j++) for(int k = -3; k <= 3; k++) {
+		if( i*i + j*j + k*k <= 6.25 ) {
+			nExpected++;
+		}
+	}
+
+	ASSERT_EQ(std::min(nExpected,maxInpN),proc.size());
+	x = selected(proc);
+	for(size_t i = 0; i < x.size(); i++) {
+		D::Point d = rec(1) - (lig(0) + x[i]);
+		EXPECT_LE(blitz::dot(d,d),6.25 + 1e-10);
+	}
+
+	// the restraints apply to one selection only
+	proc.selectFromFFT();
+	EXPECT_EQ(maxInpN,proc.size());
+	x = selected(proc);
+	EXPECT_GT(blitz::dot(x[0],x[0]),16.);
+
+}
+
+TEST_F(DockRestraintsTest, Penalty) {
+
+	const T_num penalty = 8.;
+
+	D::TranRestraints restraints;
+	restraints.load(fileName,-1,penalty);
+	restraints.setMolecules(rec,lig.size());
+
+	EXPECT_EQ(0,restraints.minSatisfied());
+
+	D::CorrelationProcessor proc;
+	proc.init(grid,maxInpN,0.);
+
+	proc.setRestraints(restraints,lig);
+	proc.selectFromFFT();
+
+	// the penalty is small enough for some of the far translations
+	// to stay ahead of those that satisfy the restraint
+
+	ASSERT_EQ(maxInpN,proc.size());
+	D::TranValues tv = proc.getTranValuesFilled(maxInpN);
+	int nSatisfied = 0;
+	for(int i = 0; i < tv.size(); i++) {
+		D::Point t = tv(i).tran.getVector();
+		D::Point d = rec(1) - (lig(0) + t);
+		bool satisfied = blitz::dot(d,d) <= 6.25 + 1e-10;
+		T_num expected = -1. - std::sqrt(blitz::dot(t,t)) + (satisfied ? 0. : penalty);
+		EXPECT_NEAR(expected,tv(i).value,1e-10);
+		nSatisfied += satisfied;
+	}
+	EXPECT_GT(nSatisfied,0);
+	EXPECT_LT(nSatisfied,maxInpN);
+
+}
+
+TEST_F(DockRestraintsTest, BadFile) {
+
+	{
+		ofstream out(fileName);
+		out << "2.5 1 0\n";
+	}
+
+	D::TranRestraints restraints;
+	EXPECT_ANY_THROW(restraints.load(fileName,-1,0.));
+
+	{
+		ofstream out(fileName);
+		out << "2.5 7 : 0\n";
+	}
+
+	restraints.load(fileName,-1,0.);
+	EXPECT_ANY_THROW(restraints.setMolecules(rec,lig.size()));
+
+}
@@ -0,0 +1,270 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+// Test FFTSlabCorrelators and CorrelationProcessor::selectFromSlab()
+// against the correlation over the full FFT grid
+
+#include <blitz/array.h>
+#include "PRODDL/docking.hpp"
+#include "gtest/gtest.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+namespace PRODDL {
+
+	// read by FFTSizePlanner when the FFT correlators are created
+
+	Options gOptions;
+
+} // namespace PRODDL
+
+using namespace PRODDL;
+using namespace std;
+
+typedef double T_num;
+typedef Docking<T_num> D;
+
+const T_num gridStep = 1.;
+
+const int nFfts = 2;
+
+const int maxInpN = 50;
+
+const T_num ligExtent = 3.;
+
+class DockSlabTest : public ::testing::Test {
+
+protected:
+
+	D::PointPair box;
+
+	D::Points lig;
+
+public:
+
+	virtual void SetUp() {
+
+		box(0) = D::Point(-14.,-8.,-9.);
+		box(1) = D::Point(14.,8.,9.);
+
+		lig.resize(3);
+		lig(0) = D::Point(-2.,0.,1.);
+		lig(1) = D::Point(1.5,1.,-1.);
+		lig(2) = D::Point(0.2,-2.,0.5);
+
+	}
+
+	// receptor potential of grid 'i_fft', zero far from the origin,
+	// so that the full grid has no receptor where the ligand wraps around
+
+	static T_num recValue(int i_fft, const D::Point& x) {
+		if( blitz::dot(x,x) > 36. ) {
+			return 0.;
+		}
+		return (1. + i_fft)*std::sin(0.9*x(0) + 0.5*i_fft)*std::cos(0.4*x(1) - 0.3*x(2)) + 0.1*x(2);
+	}
+
+	static void projectRec(D::VPRawGrid& grids) {
+		for(int i_fft = 0; i_fft < grids.size(); i_fft++) {
+			D::Grid& grid = *grids(i_fft);
+			D::IntPoint shape = grid.getLogicalShape();
+			D::GridArray& arr = grid.getGridArray();
+			for(int i = 0; i < shape(0); i++) for(int j = 0; j < shape(1); j++) for(int k = 0; k < shape(2); k++) {
+				D::IntPoint ind(i,j,k);
+				arr(ind) = recValue(i_fft,grid.getGeometry().toSpatial(ind));
+			}
+		}
+	}
+
+	void projectLig(D::VPRawGrid& grids) {
+		for(int i_fft = 0; i_fft < grids.size(); i_fft++) {
+			D::Grid& grid = *grids(i_fft);
+			grid = 0.;
+			for(int i = 0; i < lig.size(); i++) {
+				grid(lig(i)) += 1. + 0.5*i - i_fft;
+			}
+		}
+	}
+
+	// Sum of the output grids into the total grid (the first of them),
+	// as MolForce::collectTotal() does for non-summed spectra
+
+	static void collectTotal(D::VPRawGrid& gridsOut, D::PRawGrid gridTot) {
+		for(int i_fft = 0; i_fft < gridsOut.size(); i_fft++) {
+			if( gridsOut(i_fft) != gridTot ) {
+				gridTot->getGridArray() += gridsOut(i_fft)->getGridArray();
+			}
+		}
+	}
+
+	static std::vector<T_num> sortedValues(const D::TranValues& tv) {
+		std::vector<T_num> v;
+		for(int i = 0; i < tv.size(); i++) {
+			v.push_back(tv(i).value);
+		}
+		std::sort(v.begin(),v.end());
+		return v;
+	}
+
+	// Select translations with the slabs and over the full grid, and compare
+
+	void compareWithFullGrid(bool sumSpectra);
+
+};
+
+void DockSlabTest::compareWithFullGrid(bool sumSpectra) {
+
+	D::FFTCorrelators full(box,gridStep,nFfts,sumSpectra);
+
+	projectRec(full.getGridsRec());
+	full.preprocessReceptor();
+	projectLig(full.getGridsLig());
+	full.correlate();
+	if( ! sumSpectra ) {
+		collectTotal(full.getGridsOut(),full.getGridTot());
+	}
+
+	D::CorrelationProcessor procFull;
+	procFull.init(*full.getGridTot(),maxInpN,1e10);
+	procFull.selectFromFFT();
+	D::TranValues tvFull = procFull.getTranValuesFilled(maxInpN).copy();
+
+	D::IntPoint sizeFull = full.sizeFft();
+
+	// memory for half of the full grid
+
+	D::IntPoint sizeCap = sizeFull;
+	sizeCap(0) = sizeFull(0)/2;
+	double maxMemory = D::FFTCorrelators::memoryFor(sizeCap,nFfts);
+
+	D::FFTSlabCorrelators slabs(box,gridStep,nFfts,sumSpectra,ligExtent,maxMemory,".");
+
+	ASSERT_EQ(sumSpectra,slabs.sumsSpectra());
+	ASSERT_TRUE(blitz::all(slabs.sizeFft() == sizeFull));
+	ASSERT_LE(slabs.sizeFftSlab()(0),sizeCap(0));
+	ASSERT_GT(slabs.nSlabs(),1);
+
+	int nTran = 0;
+	for(int i_slab = 0; i_slab < slabs.nSlabs(); i_slab++) {
+		projectRec(slabs.getGridsRec(i_slab));
+		slabs.preprocessReceptor(i_slab);
+		nTran += slabs.slabWidth(i_slab);
+	}
+
+	EXPECT_EQ(sizeFull(0),nTran);
+
+	ASSERT_TRUE(slabs.fitsLigand(lig));
+	projectLig(slabs.getGridsLig());
+	slabs.transformLigand();
+
+	D::CorrelationProcessor procSlab;
+	procSlab.initSlabs(*slabs.getGridTot(),sizeFull,maxInpN,1e10);
+	procSlab.beginSlabs();
+	for(int i_slab = 0; i_slab < slabs.nSlabs(); i_slab++) {
+		slabs.correlate(i_slab);
+		if( ! sumSpectra ) {
+			collectTotal(slabs.getGridsOut(),slabs.getGridTot());
+		}
+		procSlab.selectFromSlab(slabs.slabWidth(i_slab),slabs.slabOffset(i_slab));
+	}
+	procSlab.endSlabs();
+	D::TranValues tvSlab = procSlab.getTranValuesFilled(maxInpN);
+
+	ASSERT_EQ(maxInpN,tvFull.size());
+	ASSERT_EQ(maxInpN,tvSlab.size());
+
+	// the same best values
+
+	std::vector<T_num> vFull = sortedValues(tvFull), vSlab = sortedValues(tvSlab);
+	for(int i = 0; i < maxInpN; i++) {
+		EXPECT_NEAR(vFull[i],vSlab[i],1e-8);
+	}
+
+	// and each one is the value of the full grid at its translation
+
+	const D::GridArray& arrFull = full.getGridTot()->getGridArray();
+	for(int i = 0; i < tvSlab.size(); i++) {
+		D::Point t = tvSlab(i).tran.getVector();
+		D::IntPoint ind;
+		for(int j = 0; j < D::N_dim; j++) {
+			int d = int(std::floor(t(j)/gridStep + 0.5));
+			ind(j) = ((-d) % sizeFull(j) + sizeFull(j)) % sizeFull(j);
+		}
+		EXPECT_NEAR(arrFull(ind),tvSlab(i).value,1e-8);
+	}
+
+	// the next rotation reuses the receptor spectra
+
+	lig(0)(1) += 1.;
+	projectLig(slabs.getGridsLig());
+	slabs.transformLigand();
+	procSlab.beginSlabs();
+	for(int i_slab = 0; i_slab < slabs.nSlabs(); i_slab++) {
+		slabs.correlate(i_slab);
+		if( ! sumSpectra ) {
+			collectTotal(slabs.getGridsOut(),slabs.getGridTot());
+		}
+		procSlab.selectFromSlab(slabs.slabWidth(i_slab),slabs.slabOffset(i_slab));
+	}
+	procSlab.endSlabs();
+
+	projectLig(full.getGridsLig());
+	full.correlate();
+	if( ! sumSpectra ) {
+		collectTotal(full.getGridsOut(),full.getGridTot());
+	}
+	procFull.selectFromFFT();
+
+	vFull = sortedValues(procFull.getTranValuesFilled(maxInpN));
+	vSlab = sortedValues(procSlab.getTranValuesFilled(maxInpN));
+	ASSERT_EQ(vFull.size(),vSlab.size());
+	for(size_t i = 0; i < vFull.size(); i++) {
+		EXPECT_NEAR(vFull[i],vSlab[i],1e-8);
+	}
+
+}
+
+TEST_F(DockSlabTest, SameAsFullGrid) {
+
+	compareWithFullGrid(true);
+
+}
+
+// separate output grids of the components, summed into getGridTot()
+
+TEST_F(DockSlabTest, SameAsFullGridComponents) {
+
+	compareWithFullGrid(false);
+
+}
+
+TEST_F(DockSlabTest, Limits) {
+
+	D::IntPoint sizeFull = D::FFTCorrelator::sizeFor(box,gridStep);
+
+	D::IntPoint sizeCap = sizeFull;
+	sizeCap(0) = sizeFull(0)/2;
+
+	// too little memory even for the ligand window
+
+	EXPECT_ANY_THROW(D::FFTSlabCorrelators::slabLength(sizeFull,nFfts,sizeFull(0)/2,
+		D::FFTCorrelators::memoryFor(sizeCap,nFfts)));
+
+	D::FFTSlabCorrelators slabs(box,gridStep,nFfts,true,ligExtent,
+		D::FFTCorrelators::memoryFor(sizeCap,nFfts),".");
+
+	lig(1)(0) = ligExtent + 2*gridStep;
+	EXPECT_FALSE(slabs.fitsLigand(lig));
+
+	// receptor spectra are not there yet
+
+	EXPECT_ANY_THROW(slabs.correlate(0));
+
+}
@@ -0,0 +1,218 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+// Test the incremental evaluation of rigid moves by PotTotalNonBonded
+// (fRigid(), fgRigid(), acceptRigid()) against f() and fg()
+
+#include <blitz/array.h>
+#include "PRODDL/docking.hpp"
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace PRODDL {
+
+	Options gOptions;
+
+} // namespace PRODDL
+
+using namespace PRODDL;
+using namespace std;
+
+typedef double T_num;
+typedef Docking<T_num> D;
+typedef D::PotentialsT Pot;
+
+const int nAtomsRec = 120;
+
+const int nAtomsLig = 15;
+
+const int nTypes = 4;
+
+const int nAceTypes = 5;
+
+// small cutoff, so that the moves below cross many partition cells
+
+const T_num cutoff = 5.;
+
+class PotentialsTest : public ::testing::Test {
+
+protected:
+
+	Pot::Points rec, lig;
+
+	Pot::MolForceParams mfParams;
+
+	Pot::PotTotalNonBonded pot;
+
+	// deterministic points spread over a ball of 'radius'
+
+	static Pot::Points makePoints(int n, T_num radius, T_num phase) {
+		Pot::Points points(n);
+		for(int i = 0; i < n; i++) {
+			T_num t = 0.37*i + phase;
+			T_num r = radius*(0.2 + 0.8*std::fabs(std::sin(2.3*t)));
+			points(i) = Pot::Point(std::sin(1.7*t)*std::cos(3.1*t),
+				std::sin(1.7*t)*std::sin(3.1*t),
+				std::cos(1.7*t))*r;
+		}
+		return points;
+	}
+
+	// force field parameters with the atom types assigned round-robin
+
+	static Pot::ForceParAtoms forceParAtoms(const Pot::Points& points) {
+		int n = points.size();
+		Pot::ForceParAtoms fpa;
+		fpa.m_pos.reference(points.copy());
+		fpa.m_mass.resize(n);
+		fpa.m_mass = 12.;
+		fpa.m_iType.resize(n);
+		fpa.m_aceType.resize(n);
+		for(int i = 0; i < n; i++) {
+			fpa.m_iType(i) = i % nTypes;
+			fpa.m_aceType(i) = i % nAceTypes;
+		}
+		return fpa;
+	}
+
+public:
+
+	virtual void SetUp() {
+
+		rec.reference(makePoints(nAtomsRec,12.,0.));
+		lig.reference(makePoints(nAtomsLig,4.,0.5));
+
+		mfParams.fpAtoms.push_back(forceParAtoms(rec));
+		mfParams.fpAtoms.push_back(forceParAtoms(lig));
+
+		mfParams.nbTypes.sigma.resize(nTypes);
+		mfParams.nbTypes.eps.resize(nTypes);
+		mfParams.nbTypes.mix = Pot::LJ_MIX_0;
+
+		for(int i = 0; i < nTypes; i++) {
+			mfParams.nbTypes.sigma(i) = 3.0 + 0.2*i;
+			mfParams.nbTypes.eps(i) = 0.1 + 0.1*i;
+		}
+
+		mfParams.m_aceMatr.resize(nAceTypes,nAceTypes);
+
+		for(int i = 0; i < nAceTypes; i++) {
+			for(int j = 0; j <= i; j++) {
+				mfParams.m_aceMatr(i,j) = mfParams.m_aceMatr(j,i) = 0.3*std::sin(1. + i + 2.*j);
+			}
+		}
+
+		Options options;
+		options.set("alpha",T_num(0.4));
+		options.set("cutoff",cutoff);
+		options.set("harmonicBasinUse",1);
+
+		D::PointPair bounds;
+		bounds(0) = Pot::Point(-30.);
+		bounds(1) = Pot::Point(30.);
+
+		pot.init(rec,mfParams,bounds,options);
+
+	}
+
+	// fRigid() and fgRigid() at 'pose' against f() and fg() of the transformed ligand
+
+	void expectSameAsFull(const Pot::RotationTranslation& pose) {
+
+		Pot::Points ligPose(lig.size()), grad(lig.size()), gradRigid(lig.size());
+
+		pose(lig,ligPose);
+
+		T_num f = pot.f(ligPose);
+		T_num tol = 1e-10*std::max(T_num(1.),T_num(std::fabs(f)));
+
+		EXPECT_NEAR(f,pot.fRigid(pose),tol);
+
+		T_num fg = pot.fg(ligPose,grad);
+
+		EXPECT_NEAR(f,fg,tol);
+		EXPECT_NEAR(fg,pot.fgRigid(pose,gradRigid),tol);
+
+		T_num gradMax = 1.;
+		for(int i = 0; i < lig.size(); i++) {
+			gradMax = std::max(gradMax,T_num(std::sqrt(blitz::dot(grad(i),grad(i)))));
+		}
+		for(int i = 0; i < lig.size(); i++) {
+			for(int j = 0; j < D::N_dim; j++) {
+				EXPECT_NEAR(grad(i)(j),gradRigid(i)(j),1e-10*gradMax);
+			}
+		}
+
+	}
+
+	// Random walk from the current pose, where every second step is
+	// accepted. Steps are larger than the partition cells.
+
+	void walk(int nSteps, Pot::Point& angles, Pot::Point& displ) {
+
+		for(int i_step = 0; i_step < nSteps; i_step++) {
+
+			T_num t = 0.9*i_step + angles(0);
+
+			Pot::Point anglesNew = angles + Pot::Point(0.3*std::sin(t),0.2*std::cos(1.3*t),0.25*std::sin(0.7*t));
+			Pot::Point displNew = displ + Pot::Point(std::sin(2.1*t),std::cos(1.9*t),std::sin(1.1*t + 1.))*(0.8*cutoff);
+
+			Pot::RotationTranslation pose(anglesNew,displNew);
+
+			expectSameAsFull(pose);
+
+			if( i_step % 2 == 0 ) {
+				pot.acceptRigid(pose);
+				angles = anglesNew;
+				displ = displNew;
+				// the accepted pose itself, now served from the refreshed cache
+				expectSameAsFull(pose);
+			}
+
+		}
+
+	}
+
+};
+
+TEST_F(PotentialsTest, RigidSameAsFull) {
+
+	Pot::Point angles(0.), displ(0.);
+
+	pot.setRigidReference(lig,Pot::RotationTranslation(angles,displ));
+
+	expectSameAsFull(Pot::RotationTranslation(angles,displ));
+
+	walk(30,angles,displ);
+
+}
+
+TEST_F(PotentialsTest, RigidAfterSetPoints1) {
+
+	Pot::Point angles(0.2,-0.1,0.4), displ(1.,2.,-1.);
+
+	pot.setRigidReference(lig,Pot::RotationTranslation(angles,displ));
+
+	walk(10,angles,displ);
+
+	// move a part of the receptor by more than a partition cell
+
+	Pot::Points recMoved(rec.copy());
+	for(int i = 0; i < recMoved.size(); i += 3) {
+		recMoved(i) += Pot::Point(1.5*cutoff,-0.5*cutoff,0.3);
+	}
+
+	pot.setPoints1(recMoved);
+
+	expectSameAsFull(Pot::RotationTranslation(angles,displ));
+
+	walk(10,angles,displ);
+
+}
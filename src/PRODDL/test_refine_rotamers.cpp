@@ -0,0 +1,449 @@
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//#
+//#   See COPYING file distributed along with the PRODDL package for the
+//#   copyright and license terms.
+//#
+//### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ### ##
+//
+//
+// Test the group-group energies of PotTotalNonBondedRot and the
+// rotamer optimization of RefinementRotamers on a small synthetic system:
+// two molecules, each with a fixed backbone and a few side chains
+// facing the other molecule in several rotamers.
+
+#include <blitz/array.h>
+#include "PRODDL/refine_rotamers.hpp"
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+namespace PRODDL {
+
+	Options gOptions;
+
+} // namespace PRODDL
+
+using namespace PRODDL;
+using namespace std;
+
+typedef double T_num;
+typedef Potentials<T_num> PotT;
+typedef PotT::PotTotalNonBondedRot RotPot;
+typedef RefinementRotamers<T_num> Refinement;
+typedef Types<T_num>::Point Point;
+typedef Types<T_num>::Points Points;
+typedef Types<T_num>::Ints Ints;
+typedef Types<T_num>::Uints Uints;
+typedef Types<T_num>::Floats Floats;
+typedef Types<T_num>::Matrix Matrix;
+typedef Types<T_num>::IntMatrix IntMatrix;
+
+const int nMols = 2;
+
+const int nScParts = 3;
+
+const int nRot = 3;
+
+const int nBbAtoms = 6;
+
+const int nScAtoms = 3;
+
+const int nTypes = 4;
+
+const int nAceTypes = 5;
+
+class RefineRotamersTest : public ::testing::Test {
+
+protected:
+
+	Points points;
+
+	Ints indGroups, indParts, indMols, indIgn, groupPart, isPartVar, partBestGroup0;
+
+	Floats groupFSelf, groupState0;
+
+	IntMatrix rangeMols;
+
+	PotT::MolForceParams mfParams;
+
+	int nGroups, nParts, nPointsBest;
+
+public:
+
+	virtual void SetUp() {
+
+		std::vector<Point> pts;
+		std::vector<int> grs, parts, mols, grPart, partVar, partFirstGroup;
+
+		rangeMols.resize(nMols,2);
+
+		for(int i_mol = 0; i_mol < nMols; i_mol++) {
+
+			rangeMols(i_mol,0) = pts.size();
+
+			Point c(8.*i_mol,0.,0.);
+			T_num side = (i_mol == 0) ? 1. : -1.;
+
+			// backbone - one group in a constant part
+
+			partFirstGroup.push_back(grPart.size());
+			for(int k = 0; k < nBbAtoms; k++) {
+				pts.push_back(c + Point(0.,1.5*k - 3.75,0.));
+				grs.push_back(grPart.size());
+				parts.push_back(partVar.size());
+				mols.push_back(i_mol);
+			}
+			grPart.push_back(partVar.size());
+			partVar.push_back(0);
+
+			// side chains - groups with the same number of atoms in a variable part
+
+			for(int i_sc = 0; i_sc < nScParts; i_sc++) {
+				Point a = c + Point(0.5*side,2.5*(i_sc - 1),0.);
+				partFirstGroup.push_back(grPart.size());
+				for(int i_rot = 0; i_rot < nRot; i_rot++) {
+					T_num phi = -0.6 + 0.6*i_rot + 0.2*i_sc;
+					Point d(side*std::cos(phi),std::sin(phi),0.4*(i_rot - 1));
+					for(int k = 0; k < nScAtoms; k++) {
+						pts.push_back(a + d*(0.9*(k + 1)));
+						grs.push_back(grPart.size());
+						parts.push_back(partVar.size());
+						mols.push_back(i_mol);
+					}
+					grPart.push_back(partVar.size());
+				}
+				partVar.push_back(1);
+			}
+
+			rangeMols(i_mol,1) = pts.size() - 1;
+
+		}
+
+		int nPoints = pts.size();
+
+		nGroups = grPart.size();
+		nParts = partVar.size();
+		nPointsBest = nMols*(nBbAtoms + nScParts*nScAtoms);
+
+		points.resize(nPoints);
+		indGroups.resize(nPoints);
+		indParts.resize(nPoints);
+		indMols.resize(nPoints);
+
+		for(int i = 0; i < nPoints; i++) {
+			points(i) = pts[i];
+			indGroups(i) = grs[i];
+			indParts(i) = parts[i];
+			indMols(i) = mols[i];
+		}
+
+		// rotamers of one side chain never see each other
+
+		indIgn.reference(indParts.copy());
+
+		groupPart.resize(nGroups);
+		groupFSelf.resize(nGroups);
+		groupState0.resize(nGroups);
+
+		for(int i_gr = 0; i_gr < nGroups; i_gr++) {
+			groupPart(i_gr) = grPart[i_gr];
+			groupFSelf(i_gr) = 0.1*(i_gr % 4);
+			groupState0(i_gr) = partVar[grPart[i_gr]] ? 1./nRot : 1.;
+		}
+
+		isPartVar.resize(nParts);
+		partBestGroup0.resize(nParts);
+
+		for(int i_part = 0; i_part < nParts; i_part++) {
+			isPartVar(i_part) = partVar[i_part];
+			partBestGroup0(i_part) = partFirstGroup[i_part];
+		}
+
+		// all atoms are in the 'molecule' 0 of the force field parameters
+
+		PotT::ForceParAtoms fpa;
+		fpa.m_pos.reference(points.copy());
+		fpa.m_mass.resize(nPoints);
+		fpa.m_mass = 12.;
+		fpa.m_iType.resize(nPoints);
+		fpa.m_aceType.resize(nPoints);
+		for(int i = 0; i < nPoints; i++) {
+			fpa.m_iType(i) = i % nTypes;
+			fpa.m_aceType(i) = i % nAceTypes;
+		}
+		mfParams.fpAtoms.push_back(fpa);
+
+		mfParams.nbTypes.sigma.resize(nTypes);
+		mfParams.nbTypes.eps.resize(nTypes);
+		mfParams.nbTypes.mix = PotT::LJ_MIX_0;
+
+		for(int i = 0; i < nTypes; i++) {
+			mfParams.nbTypes.sigma(i) = 3.0 + 0.2*i;
+			mfParams.nbTypes.eps(i) = 0.1 + 0.1*i;
+		}
+
+		mfParams.m_aceMatr.resize(nAceTypes,nAceTypes);
+
+		for(int i = 0; i < nAceTypes; i++) {
+			for(int j = 0; j <= i; j++) {
+				mfParams.m_aceMatr(i,j) = mfParams.m_aceMatr(j,i) = 0.3*std::sin(1. + i + 2.*j);
+			}
+		}
+
+		Options rotOptions;
+		rotOptions.set("cutoff",T_num(6.));
+		rotOptions.set("alpha",T_num(0.5));
+		rotOptions.set("nThreads",1);
+		rotOptions.set("iterMax",500);
+
+		gOptions.clear();
+		gOptions.set("rotamers",rotOptions);
+
+	}
+
+	// Coordinates of pose 'i_pose': the ligand is shifted a little
+
+	Points posePoints(int i_pose) const {
+		Points p(points.copy());
+		Point shift(0.15*i_pose - 0.3,0.2*std::sin(T_num(i_pose)),0.1*std::cos(T_num(i_pose)));
+		for(int i = 0; i < p.size(); i++) {
+			if( indMols(i) == 1 ) {
+				p(i) += shift;
+			}
+		}
+		return p;
+	}
+
+	// Group-group energies from the two passes that RefinementRotamers
+	// makes: all points of both molecules queried and inserted, then the
+	// ligand queried again without insertion. 'nThreads' == 0 means fSerial().
+
+	void computeF(RotPot& pot, Uints& indAct, int nThreads) {
+		pot.resetCycle();
+		indAct = RotPot::ACT_DFL;
+		if( nThreads == 0 ) {
+			pot.fSerial();
+		}
+		else {
+			pot.fParallel(nThreads);
+		}
+		for(int i = 0; i < indAct.size(); i++) {
+			indAct(i) = ( indMols(i) == 1 ) ? unsigned(RotPot::ACT_CALC) : unsigned(RotPot::ACT_IGN);
+		}
+		if( nThreads == 0 ) {
+			pot.fSerial();
+		}
+		else {
+			pot.fParallel(nThreads);
+		}
+	}
+
+	void initPot(RotPot& pot, Uints& indAct, const Options& options) {
+		IntMatrix ignPairs(0,2);
+		Geom::SpaceTraits<T_num>::Point3Pair bounds;
+		bounds(0) = Point(-20.);
+		bounds(1) = Point(20.);
+		pot.init(points,indGroups,indAct,indIgn,ignPairs,nGroups,nParts,mfParams,bounds,options);
+	}
+
+	static void expectSameMatrix(const Matrix& fRef, const Matrix& f) {
+		ASSERT_EQ(fRef.rows(),f.rows());
+		ASSERT_EQ(fRef.cols(),f.cols());
+		for(int i = 0; i < fRef.rows(); i++) {
+			for(int j = 0; j < fRef.cols(); j++) {
+				EXPECT_NEAR(fRef(i,j),f(i,j),1e-10*std::max(T_num(1.),T_num(std::fabs(fRef(i,j)))));
+			}
+		}
+	}
+
+	// Optimize every pose with optimize() or with one optimizeMany() call
+
+	void optimizePoses(Refinement& ref, int nPoses, bool many,
+		std::vector<Floats>& groupState, std::vector<Ints>& partBestGroup, std::vector<Points>& pointsBest) {
+
+		std::vector<Points> poses;
+
+		groupState.clear();
+		partBestGroup.clear();
+		pointsBest.clear();
+
+		for(int i_pose = 0; i_pose < nPoses; i_pose++) {
+			poses.push_back(posePoints(i_pose));
+			groupState.push_back(groupState0.copy());
+			partBestGroup.push_back(partBestGroup0.copy());
+			pointsBest.push_back(Points(nPointsBest));
+		}
+
+		if( many ) {
+			ref.optimizeMany(poses,isPartVar,groupState,partBestGroup,pointsBest);
+		}
+		else {
+			for(int i_pose = 0; i_pose < nPoses; i_pose++) {
+				ref.optimize(poses[i_pose],isPartVar,groupState[i_pose],partBestGroup[i_pose],pointsBest[i_pose]);
+			}
+		}
+
+	}
+
+};
+
+TEST_F(RefineRotamersTest, FParallelSameAsSerial) {
+
+	const Options& rotOptions = gOptions.getBlock("rotamers");
+
+	Uints indAct(points.size());
+	RotPot potSerial;
+	initPot(potSerial,indAct,rotOptions);
+	computeF(potSerial,indAct,0);
+
+	const Matrix& fSerial = potSerial.getF();
+
+	// there is something to compare
+
+	EXPECT_GT(blitz::max(blitz::abs(fSerial)),0.);
+
+	for(int nThreads = 1; nThreads <= 4; nThreads += 3) {
+
+		Uints indActPar(points.size());
+		RotPot potPar;
+		initPot(potPar,indActPar,rotOptions);
+		computeF(potPar,indActPar,nThreads);
+
+		expectSameMatrix(fSerial,potPar.getF());
+
+		// per-thread maps instead of the dense per-thread matrices
+
+		Options optionsMaps(rotOptions);
+		optionsMaps.set("maxThreadBufMb",0.);
+
+		Uints indActMaps(points.size());
+		RotPot potMaps;
+		initPot(potMaps,indActMaps,optionsMaps);
+		computeF(potMaps,indActMaps,nThreads);
+
+		expectSameMatrix(fSerial,potMaps.getF());
+
+	}
+
+}
+
+TEST_F(RefineRotamersTest, OptimizeManySameAsOptimize) {
+
+	const int nPoses = 7;
+
+	std::vector<Floats> stateLoop, stateMany;
+	std::vector<Ints> bestLoop, bestMany;
+	std::vector<Points> pointsLoop, pointsMany;
+
+	{
+		Refinement ref(points,indGroups,indParts,indMols,indIgn,groupPart,groupFSelf,rangeMols,mfParams);
+		optimizePoses(ref,nPoses,false,stateLoop,bestLoop,pointsLoop);
+	}
+
+	gOptions.getBlock("rotamers").set("nThreads",3);
+
+	// the second buffer limit leaves room for the matrices of no additional thread
+
+	const double maxThreadBufMb[] = { 1024., 0. };
+
+	for(int i_lim = 0; i_lim < 2; i_lim++) {
+
+		gOptions.getBlock("rotamers").set("maxThreadBufMb",maxThreadBufMb[i_lim]);
+
+		Refinement ref(points,indGroups,indParts,indMols,indIgn,groupPart,groupFSelf,rangeMols,mfParams);
+
+		// the second call reuses the evaluation states of the threads
+
+		for(int i_call = 0; i_call < 2; i_call++) {
+
+			optimizePoses(ref,nPoses,true,stateMany,bestMany,pointsMany);
+
+			for(int i_pose = 0; i_pose < nPoses; i_pose++) {
+				for(int i_gr = 0; i_gr < nGroups; i_gr++) {
+					EXPECT_NEAR(stateLoop[i_pose](i_gr),stateMany[i_pose](i_gr),1e-12);
+				}
+				EXPECT_TRUE(blitz::all(bestLoop[i_pose] == bestMany[i_pose]));
+				for(int i = 0; i < nPointsBest; i++) {
+					EXPECT_TRUE(blitz::all(pointsLoop[i_pose](i) == pointsMany[i_pose](i)));
+				}
+			}
+
+		}
+
+	}
+
+}
+
+TEST_F(RefineRotamersTest, SparseSameAsDense) {
+
+	const Options& rotOptions = gOptions.getBlock("rotamers");
+
+	Uints indAct(points.size());
+	RotPot potDense;
+	initPot(potDense,indAct,rotOptions);
+	computeF(potDense,indAct,0);
+
+	Options optionsSparse(rotOptions);
+	optionsSparse.set("sparseF",true);
+
+	for(int nThreads = 1; nThreads <= 4; nThreads += 3) {
+
+		Uints indActSparse(points.size());
+		RotPot potSparse;
+		initPot(potSparse,indActSparse,optionsSparse);
+		ASSERT_TRUE(potSparse.isSparse());
+		computeF(potSparse,indActSparse,nThreads);
+
+		RotPot::SparseMatrix fSparse;
+		potSparse.getFSparse(fSparse);
+
+		ASSERT_EQ(nGroups,fSparse.rows());
+
+		Matrix f(nGroups,nGroups);
+		f = 0;
+		for(int i_gr = 0; i_gr < nGroups; i_gr++) {
+			for(int k = fSparse.rowStart[i_gr]; k < fSparse.rowStart[i_gr+1]; k++) {
+				if( k > fSparse.rowStart[i_gr] ) {
+					EXPECT_LT(fSparse.col[k-1],fSparse.col[k]);
+				}
+				f(i_gr,fSparse.col[k]) = fSparse.val[k];
+			}
+		}
+
+		expectSameMatrix(potDense.getF(),f);
+
+	}
+
+	// the same optimized rotamers
+
+	const int nPoses = 4;
+
+	std::vector<Floats> stateDense, stateSparse;
+	std::vector<Ints> bestDense, bestSparse;
+	std::vector<Points> pointsDense, pointsSparse;
+
+	{
+		Refinement ref(points,indGroups,indParts,indMols,indIgn,groupPart,groupFSelf,rangeMols,mfParams);
+		optimizePoses(ref,nPoses,false,stateDense,bestDense,pointsDense);
+	}
+
+	gOptions.getBlock("rotamers").set("sparseF",true);
+
+	{
+		Refinement ref(points,indGroups,indParts,indMols,indIgn,groupPart,groupFSelf,rangeMols,mfParams);
+		optimizePoses(ref,nPoses,false,stateSparse,bestSparse,pointsSparse);
+	}
+
+	for(int i_pose = 0; i_pose < nPoses; i_pose++) {
+		for(int i_gr = 0; i_gr < nGroups; i_gr++) {
+			EXPECT_NEAR(stateDense[i_pose](i_gr),stateSparse[i_pose](i_gr),1e-8);
+		}
+		EXPECT_TRUE(blitz::all(bestDense[i_pose] == bestSparse[i_pose]));
+		for(int i = 0; i < nPointsBest; i++) {
+			EXPECT_TRUE(blitz::all(pointsDense[i_pose](i) == pointsSparse[i_pose](i)));
+		}
+	}
+
+}